@@ -23,8 +23,8 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <sys/file.h>
+#include <algorithm>
 #include <memory>
-#include <regex>
 #include <indicom.h>
 #include <sys/stat.h>
 
@@ -38,11 +38,11 @@
 static unsigned int nplots = 1;
 static std::unique_ptr<AHP_XC> array(new AHP_XC());
 
-std::string regex_replace_compat(const std::string &input, const std::string &pattern, const std::string &replace)
+static std::string replaceAll(std::string input, const std::string &pattern, const std::string &replace)
 {
-    std::stringstream s;
-    std::regex_replace(std::ostreambuf_iterator<char>(s), input.begin(), input.end(), std::regex(pattern), replace);
-    return s.str();
+    for (size_t pos = input.find(pattern); pos != std::string::npos; pos = input.find(pattern, pos + replace.length()))
+        input.replace(pos, pattern.length(), replace);
+    return input;
 }
 
 int AHP_XC::getFileIndex(const char * dir, const char * prefix, const char * ext)
@@ -54,8 +54,8 @@ int AHP_XC::getFileIndex(const char * dir, const char * prefix, const char * ext
     std::vector<std::string> files = std::vector<std::string>();
 
     std::string prefixIndex = prefix;
-    prefixIndex             = regex_replace_compat(prefixIndex, "_ISO8601", "");
-    prefixIndex             = regex_replace_compat(prefixIndex, "_XXX", "");
+    prefixIndex             = replaceAll(prefixIndex, "_ISO8601", "");
+    prefixIndex             = replaceAll(prefixIndex, "_XXX", "");
 
     // Create directory if does not exist
     struct stat st;
@@ -109,6 +109,59 @@ int AHP_XC::getFileIndex(const char * dir, const char * prefix, const char * ext
     return (maxIndex + 1);
 }
 
+int AHP_XC::nextFileIndex(const char * dir, const char * prefix)
+{
+    std::string key = std::string(dir) + "/" + prefix;
+
+    // Scan the directory only the first time, or when the upload settings changed
+    if (fileIndex < 0 || key != fileIndexKey)
+    {
+        fileIndex = getFileIndex(dir, prefix, nullptr);
+        if (fileIndex < 0)
+            return -1;
+        fileIndexKey = key;
+    }
+    return fileIndex++;
+}
+
+std::string AHP_XC::fileName(const char * label, const char * ext)
+{
+    const char *dir = UploadSettingsT[UPLOAD_DIR].text;
+    char imageFileName[MAXRBUF];
+
+    char ts[32];
+    struct tm * tp;
+    time_t t;
+    time(&t);
+    tp = localtime(&t);
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H-%M-%S", tp);
+
+    // The cached index does not see files written by others, skip any that exist
+    bool indexed = (strstr(UploadSettingsT[UPLOAD_PREFIX].text, "XXX") != nullptr);
+    struct stat st;
+    do
+    {
+        int index = nextFileIndex(dir, UploadSettingsT[UPLOAD_PREFIX].text);
+        if (index < 0)
+        {
+            LOGF_ERROR("Error iterating directory %s. %s", dir, strerror(errno));
+            return "";
+        }
+
+        char indexString[MAXINDILABEL + 4];
+        snprintf(indexString, sizeof(indexString), "%s_%03d", label, index);
+
+        std::string prefix = UploadSettingsT[UPLOAD_PREFIX].text;
+        prefix = replaceAll(prefix, "ISO8601", ts);
+        prefix = replaceAll(prefix, "XXX", indexString);
+
+        snprintf(imageFileName, MAXRBUF, "%s/%s%s", dir, prefix.c_str(), ext);
+    }
+    while (indexed && stat(imageFileName, &st) == 0);
+
+    return imageFileName;
+}
+
 void AHP_XC::sendFile(IBLOB* Blobs, IBLOBVectorProperty BlobP, unsigned int len)
 {
     bool sendImage = (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON);
@@ -120,43 +173,14 @@ void AHP_XC::sendFile(IBLOB* Blobs, IBLOBVectorProperty BlobP, unsigned int len)
             snprintf(Blobs[x].format, MAXINDIBLOBFMT, ".%s", getIntegrationFileExtension());
 
             FILE * fp = nullptr;
-            char imageFileName[MAXRBUF];
-
-            std::string prefix = UploadSettingsT[UPLOAD_PREFIX].text;
-            int maxIndex       = getFileIndex(UploadSettingsT[UPLOAD_DIR].text, UploadSettingsT[UPLOAD_PREFIX].text,
-                                              Blobs[x].format);
-
-            if (maxIndex < 0)
-            {
-                LOGF_ERROR("Error iterating directory %s. %s", UploadSettingsT[0].text,
-                           strerror(errno));
+            std::string imageFileName = fileName(Blobs[x].label, Blobs[x].format);
+            if (imageFileName.empty())
                 return;
-            }
 
-            if (maxIndex > 0)
-            {
-                char ts[32];
-                struct tm * tp;
-                time_t t;
-                time(&t);
-                tp = localtime(&t);
-                strftime(ts, sizeof(ts), "%Y-%m-%dT%H-%M-%S", tp);
-                std::string filets(ts);
-                prefix = std::regex_replace(prefix, std::regex("ISO8601"), filets);
-
-                char indexString[MAXINDILABEL + 4];
-                sprintf(indexString, "%s_%03d", Blobs[x].label, maxIndex);
-                std::string prefixIndex = indexString;
-                //prefix.replace(prefix.find("XXX"), std::string::npos, prefixIndex);
-                prefix = std::regex_replace(prefix, std::regex("XXX"), prefixIndex);
-            }
-
-            snprintf(imageFileName, MAXRBUF, "%s/%s%s", UploadSettingsT[0].text, prefix.c_str(), Blobs[x].format);
-
-            fp = fopen(imageFileName, "w");
+            fp = fopen(imageFileName.c_str(), "w");
             if (fp == nullptr)
             {
-                LOGF_ERROR("Unable to save image file (%s). %s", imageFileName, strerror(errno));
+                LOGF_ERROR("Unable to save image file (%s). %s", imageFileName.c_str(), strerror(errno));
                 return;
             }
 
@@ -167,9 +191,9 @@ void AHP_XC::sendFile(IBLOB* Blobs, IBLOBVectorProperty BlobP, unsigned int len)
             fclose(fp);
 
             // Save image file path
-            IUSaveText(&FileNameT[0], imageFileName);
+            IUSaveText(&FileNameT[0], imageFileName.c_str());
 
-            LOGF_INFO("Image saved to %s", imageFileName);
+            LOGF_INFO("Image saved to %s", imageFileName.c_str());
             FileNameTP.s = IPS_OK;
             IDSetText(&FileNameTP, nullptr);
         }
@@ -210,7 +234,7 @@ void AHP_XC::sendFile(IBLOB* Blobs, IBLOBVectorProperty BlobP, unsigned int len)
     LOG_INFO( "Upload complete");
 }
 
-void* AHP_XC::createFITS(int bpp, size_t *memsize, dsp_stream_p stream)
+bool AHP_XC::createFITS(int bpp, dsp_stream_p stream, FITSBuffer *fits, int *len)
 {
     int img_type  = USHORT_IMG;
     int byte_type = TUSHORT;
@@ -255,72 +279,82 @@ void* AHP_XC::createFITS(int bpp, size_t *memsize, dsp_stream_p stream)
 
         default:
             DEBUGF(INDI::Logger::DBG_ERROR, "Unsupported bits per sample value %d", getBPS());
-            return nullptr;
+            return false;
     }
 
     fitsfile *fptr = nullptr;
-    void *memptr;
     int status    = 0;
-    uint32_t dims = 0;
-    int *sizes = nullptr;
-    uint8_t *buf = getBuffer(stream, &dims, &sizes);
-    int naxis    = static_cast<int>(dims);
-    long *naxes = static_cast<long*>(malloc(sizeof(long) * dims));
-    long nelements = 0;
-
-    for (uint32_t i = 0, nelements = 1; i < dims; nelements *= static_cast<long>(sizes[i++]))
-        naxes[i] = sizes[i];
-    char error_status[MAXINDINAME];
+    int naxis     = stream->dims;
+    std::vector<long> naxes(naxis);
+    long nelements = 1;
 
-    //  Now we have to send fits format data to the client
-    *memsize = 5760;
-    memptr  = malloc(*memsize);
-    if (!memptr)
+    for (int i = 0; i < naxis; i++)
     {
-        LOGF_ERROR("Error: failed to allocate memory: %lu", *memsize);
-        return nullptr;
+        naxes[i] = stream->sizes[i];
+        nelements *= naxes[i];
     }
+    char error_status[MAXINDINAME];
 
-    fits_create_memfile(&fptr, &memptr, memsize, 2880, realloc, &status);
+    // The samples are written straight from the stream when they are already in the output type
+    uint8_t *buf = reinterpret_cast<uint8_t*>(stream->buf);
+    bool converted = !(bpp == -64 && sizeof(dsp_t) == sizeof(double));
+    if (converted)
+    {
+        uint32_t dims = 0;
+        int *sizes = nullptr;
+        buf = getBuffer(stream, &dims, &sizes);
+        free(sizes);
+        if (buf == nullptr)
+            return false;
+    }
 
-    if (status)
+    //  Now we have to send fits format data to the client, cfitsio grows the buffer as needed
+    if (fits->data == nullptr)
     {
-        fits_report_error(stderr, status); /* print out any error messages */
-        fits_get_errstatus(status, error_status);
-        fits_close_file(fptr, &status);
-        free(memptr);
-        LOGF_ERROR("FITS Error: %s", error_status);
-        return nullptr;
+        fits->size = 5760;
+        fits->data = malloc(fits->size);
+        if (!fits->data)
+        {
+            LOGF_ERROR("Error: failed to allocate memory: %lu", fits->size);
+            fits->size = 0;
+            if (converted)
+                free(buf);
+            return false;
+        }
     }
 
-    fits_create_img(fptr, img_type, naxis, naxes, &status);
+    fits_create_memfile(&fptr, &fits->data, &fits->size, 2880, realloc, &status);
 
-    if (status)
+    if (status == 0)
+        fits_create_img(fptr, img_type, naxis, naxes.data(), &status);
+
+    if (status == 0)
     {
-        fits_report_error(stderr, status); /* print out any error messages */
-        fits_get_errstatus(status, error_status);
-        fits_close_file(fptr, &status);
-        free(memptr);
-        LOGF_ERROR("FITS Error: %s", error_status);
-        return nullptr;
+        addFITSKeywords(fptr, buf, static_cast<int>(nelements));
+        fits_write_img(fptr, byte_type, 1, nelements, buf, &status);
     }
 
-    addFITSKeywords(fptr, buf, *memsize);
+    // The buffer is larger than the file when it was grown for a previous one
+    LONGLONG headstart, datastart, dataend;
+    if (status == 0)
+        fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status);
 
-    fits_write_img(fptr, byte_type, 1, nelements, buf, &status);
+    if (converted)
+        free(buf);
 
     if (status)
     {
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
+        status = 0;
         fits_close_file(fptr, &status);
-        free(memptr);
         LOGF_ERROR("FITS Error: %s", error_status);
-        return nullptr;
+        return false;
     }
     fits_close_file(fptr, &status);
 
-    return memptr;
+    *len = static_cast<int>(dataend);
+    return true;
 }
 
 uint8_t* AHP_XC::getBuffer(dsp_stream_p in, uint32_t *dims, int **sizes)
@@ -348,16 +382,139 @@ uint8_t* AHP_XC::getBuffer(dsp_stream_p in, uint32_t *dims, int **sizes)
             break;
         default:
             free (buffer);
+            buffer = nullptr;
             break;
     }
     *dims = in->dims;
     *sizes = (int*)malloc(sizeof(int) * in->dims);
     for(int d = 0; d < in->dims; d++)
-        *sizes[d] = in->sizes[d];
+        (*sizes)[d] = in->sizes[d];
     return static_cast<uint8_t *>(buffer);
 }
 
 
+// Header of the stream file and of every stream BLOB, followed by rows of doubles:
+// timestamp, nlines autocorrelation spectra of auto_lags, nbaselines crosscorrelation spectra of cross_lags
+struct stream_header
+{
+    char magic[8];
+    uint32_t nlines;
+    uint32_t nbaselines;
+    uint32_t auto_lags;
+    uint32_t cross_lags;
+};
+
+void AHP_XC::openStream(ahp_xc_packet *packet)
+{
+    stream_header header;
+    memcpy(header.magic, "AHPXCST", 8);
+    header.nlines = ahp_xc_get_nlines();
+    header.nbaselines = ahp_xc_get_nbaselines();
+    header.auto_lags = streamAutoLags = (ahp_xc_get_autocorrelator_lagsize() > 1 ? packet->autocorrelations[0].lag_size : 0);
+    header.cross_lags = streamCrossLags = (ahp_xc_get_crosscorrelator_lagsize() > 1 ? packet->crosscorrelations[0].lag_size : 0);
+
+    streamRow.assign(1 + header.nlines * streamAutoLags + header.nbaselines * streamCrossLags, 0.0);
+    streamLive.assign(reinterpret_cast<char*>(&header), reinterpret_cast<char*>(&header) + sizeof(header));
+    streamLiveRows = 0;
+    streamLiveSent = getCurrentTime();
+
+    if (UploadS[1].s == ISS_ON || UploadS[2].s == ISS_ON)
+    {
+        std::string streamFileName = fileName(streamB.label, ".xcs");
+        if (streamFileName.empty())
+            return;
+
+        streamFile = fopen(streamFileName.c_str(), "w");
+        if (streamFile == nullptr)
+        {
+            LOGF_ERROR("Unable to save stream file (%s). %s", streamFileName.c_str(), strerror(errno));
+            return;
+        }
+        // rows are written in large chunks, not one packet at a time
+        setvbuf(streamFile, nullptr, _IOFBF, 1 << 20);
+        fwrite(&header, sizeof(header), 1, streamFile);
+
+        IUSaveText(&FileNameT[0], streamFileName.c_str());
+        LOGF_INFO("Streaming correlations to %s", streamFileName.c_str());
+        FileNameTP.s = IPS_OK;
+        IDSetText(&FileNameTP, nullptr);
+    }
+}
+
+void AHP_XC::appendStream(ahp_xc_packet *packet)
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+
+    if (streamRow.empty())
+        openStream(packet);
+
+    double *row = streamRow.data();
+    *row++ = getCurrentTime();
+    for(unsigned int x = 0; x < ahp_xc_get_nlines() && streamAutoLags > 0; x++)
+    {
+        unsigned int lags = std::min(streamAutoLags, static_cast<unsigned int>(packet->autocorrelations[x].lag_size));
+        for(unsigned int i = 0; i < lags; i++)
+            row[i] = packet->autocorrelations[x].correlations[i].magnitude;
+        row += streamAutoLags;
+    }
+    for(unsigned int x = 0; x < ahp_xc_get_nbaselines() && streamCrossLags > 0; x++)
+    {
+        unsigned int lags = std::min(streamCrossLags, static_cast<unsigned int>(packet->crosscorrelations[x].lag_size));
+        for(unsigned int i = 0; i < lags; i++)
+            row[i] = packet->crosscorrelations[x].correlations[i].magnitude;
+        row += streamCrossLags;
+    }
+
+    size_t rowsize = streamRow.size() * sizeof(double);
+    if (streamFile != nullptr && fwrite(streamRow.data(), rowsize, 1, streamFile) != 1)
+    {
+        LOGF_ERROR("Unable to write stream file. %s", strerror(errno));
+        fclose(streamFile);
+        streamFile = nullptr;
+    }
+
+    const char *bytes = reinterpret_cast<const char*>(streamRow.data());
+    streamLive.insert(streamLive.end(), bytes, bytes + rowsize);
+    streamLiveRows++;
+}
+
+void AHP_XC::sendStream(bool force)
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+
+    if (streamLiveRows == 0)
+        return;
+    if (!force && getCurrentTime() - streamLiveSent < getCurrentPollingPeriod() / 1000.0)
+        return;
+
+    if (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON)
+    {
+        streamB.blob = streamLive.data();
+        streamB.bloblen = streamB.size = static_cast<int>(streamLive.size());
+        streamBP.s = IPS_OK;
+        IDSetBLOB(&streamBP, nullptr);
+    }
+
+    // keep the header, drop the rows just sent
+    streamLive.resize(sizeof(stream_header));
+    streamLiveRows = 0;
+    streamLiveSent = getCurrentTime();
+}
+
+void AHP_XC::closeStream()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+
+    if (streamFile != nullptr)
+    {
+        fclose(streamFile);
+        streamFile = nullptr;
+    }
+    streamRow.clear();
+    streamLive.clear();
+    streamLiveRows = 0;
+}
+
 void AHP_XC::Callback()
 {
     ahp_xc_packet* packet = ahp_xc_alloc_packet();
@@ -456,91 +613,69 @@ void AHP_XC::Callback()
                 timeleft = 0;
                 // We're done exposing
                 LOG_INFO("Integration complete, downloading plots...");
-                // Additional BLOBs
-                char **blobs = static_cast<char**>(malloc(sizeof(char*)*static_cast<unsigned int>(plotBP.nbp) + 1));
+                bool streaming = (streamingS[0].s == ISS_ON);
+                if(streaming)
+                {
+                    sendStream(true);
+                    closeStream();
+                }
+                // Additional BLOBs, encoded in place into the FITS buffers kept from the previous integration
+                plotFITS.resize(nplots, FITSBuffer{nullptr, 0});
                 for(unsigned int x = 0; x < nplots; x++)
                 {
                     if(HasDSP())
                     {
                         DSP->processBLOB(static_cast<unsigned char*>(static_cast<void*>(plot_str[x]->buf)), static_cast<unsigned int>(plot_str[x]->dims), plot_str[x]->sizes, -64); //TODO
                     }
-                    size_t memsize = static_cast<unsigned int>(plot_str[x]->len) * sizeof(double);
-                    void* fits = createFITS(-64, &memsize, plot_str[x]);
-                    if(fits != nullptr)
+                    int len = 0;
+                    if(createFITS(-64, plot_str[x], &plotFITS[x], &len))
                     {
-                        blobs[x] = static_cast<char*>(malloc(memsize));
-                        memcpy(blobs[x], fits, memsize);
-                        plotB[x].blob = blobs[x];
-                        plotB[x].bloblen = static_cast<int>(memsize);
-                        free(fits);
+                        plotB[x].blob = plotFITS[x].data;
+                        plotB[x].bloblen = len;
                     }
                 }
                 LOG_INFO("Plots BLOBs generated, downloading...");
                 sendFile(plotB, plotBP, nplots);
                 for(unsigned int x = 0; x < nplots; x++)
                 {
-                    free(blobs[x]);
                     memset(plot_str[x]->buf, 0, sizeof(dsp_t)*static_cast<size_t>(plot_str[x]->len));
                 }
-                LOG_INFO("Generating additional BLOBs...");
-                if(ahp_xc_get_nlines() > 0 && ahp_xc_get_autocorrelator_lagsize() > 1)
+                // In streaming mode the lag spectra are already in the stream file
+                if(!streaming && ahp_xc_get_nlines() > 0 && ahp_xc_get_autocorrelator_lagsize() > 1)
                 {
-                    blobs = static_cast<char**>(realloc(blobs, sizeof(char*)*static_cast<unsigned int>(autocorrelationsBP.nbp) + 1));
+                    LOG_INFO("Generating additional BLOBs...");
+                    autocorrelationsFITS.resize(ahp_xc_get_nlines(), FITSBuffer{nullptr, 0});
                     for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
                     {
-                        size_t memsize = static_cast<unsigned int>(autocorrelations_str[x]->len) * sizeof(double);
-                        void* fits = createFITS(-64, &memsize, autocorrelations_str[x]);
-                        if(fits != nullptr)
+                        int len = 0;
+                        if(createFITS(-64, autocorrelations_str[x], &autocorrelationsFITS[x], &len))
                         {
-                            blobs[x] = static_cast<char*>(malloc(memsize));
-                            memcpy(blobs[x], fits, memsize);
-                            autocorrelationsB[x].blob = blobs[x];
-                            autocorrelationsB[x].bloblen = static_cast<int>(memsize);
-                            free(fits);
+                            autocorrelationsB[x].blob = autocorrelationsFITS[x].data;
+                            autocorrelationsB[x].bloblen = len;
                         }
                         autocorrelations_str[x]->sizes[1] = 1;
                         autocorrelations_str[x]->len = autocorrelations_str[x]->sizes[0];
-                        dsp_stream_alloc_buffer(autocorrelations_str[x], autocorrelations_str[x]->len);
                     }
                     LOG_INFO("Autocorrelations BLOBs generated, downloading...");
                     sendFile(autocorrelationsB, autocorrelationsBP, ahp_xc_get_nlines());
-                    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
-                    {
-                        free(blobs[x]);
-                    }
                 }
-                if(ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
+                if(!streaming && ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
                 {
-                    blobs = static_cast<char**>(realloc(blobs, sizeof(char*)*static_cast<unsigned int>(crosscorrelationsBP.nbp) + 1));
-                    idx = 0;
-                    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
+                    crosscorrelationsFITS.resize(ahp_xc_get_nbaselines(), FITSBuffer{nullptr, 0});
+                    for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
                     {
-                        for(unsigned int y = x + 1; y < ahp_xc_get_nlines(); y++)
+                        int len = 0;
+                        if(createFITS(-64, crosscorrelations_str[x], &crosscorrelationsFITS[x], &len))
                         {
-                            size_t memsize = static_cast<unsigned int>(crosscorrelations_str[x]->len) * sizeof(double);
-                            void* fits = createFITS(-64, &memsize, crosscorrelations_str[x]);
-                            if(fits != nullptr)
-                            {
-                                blobs[x] = static_cast<char*>(malloc(memsize));
-                                memcpy(blobs[x], fits, memsize);
-                                crosscorrelationsB[x].blob = blobs[x];
-                                crosscorrelationsB[x].bloblen = static_cast<int>(memsize);
-                                free(fits);
-                            }
-                            crosscorrelations_str[idx]->sizes[1] = 1;
-                            crosscorrelations_str[idx]->len = crosscorrelations_str[idx]->sizes[0];
-                            dsp_stream_alloc_buffer(crosscorrelations_str[idx], crosscorrelations_str[idx]->len);
-                            idx++;
+                            crosscorrelationsB[x].blob = crosscorrelationsFITS[x].data;
+                            crosscorrelationsB[x].bloblen = len;
                         }
+                        crosscorrelations_str[x]->sizes[1] = 1;
+                        crosscorrelations_str[x]->len = crosscorrelations_str[x]->sizes[0];
                     }
                     LOG_INFO("Crosscorrelations BLOBs generated, downloading...");
                     sendFile(crosscorrelationsB, crosscorrelationsBP, ahp_xc_get_nbaselines());
-                    for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
-                    {
-                        free(blobs[x]);
-                    }
                 }
-                free(blobs);
                 LOG_INFO("Download complete.");
             }
             else
@@ -575,7 +710,12 @@ void AHP_XC::Callback()
                         }
                     }
                 }
-                if(ahp_xc_get_nlines() > 0 && ahp_xc_get_autocorrelator_lagsize() > 1)
+                if(streamingS[0].s == ISS_ON)
+                {
+                    appendStream(packet);
+                    sendStream(false);
+                }
+                else if(ahp_xc_get_nlines() > 0 && ahp_xc_get_autocorrelator_lagsize() > 1)
                 {
                     for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
                     {
@@ -588,7 +728,7 @@ void AHP_XC::Callback()
                             autocorrelations_str[x]->buf[pos++] = packet->autocorrelations[x].correlations[i].magnitude;
                     }
                 }
-                if(ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
+                if(streamingS[0].s != ISS_ON && ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
                 {
                     for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
                     {
@@ -703,6 +843,8 @@ bool AHP_XC::Disconnect()
     readThread->join();
     readThread->~thread();
 
+    closeStream();
+
     ahp_xc_disconnect();
 
     return true;
@@ -732,6 +874,7 @@ bool AHP_XC::saveConfigItems(FILE *fp)
         }
     }
     IUSaveConfigNumber(fp, &settingsNP);
+    IUSaveConfigSwitch(fp, &streamingSP);
 
     INDI::Spectrograph::saveConfigItems(fp);
     return true;
@@ -755,6 +898,15 @@ bool AHP_XC::initProperties()
     IUFillNumberVector(&settingsNP, settingsN, 2, getDeviceName(), "INTERFEROMETER_SETTINGS", "AHP_XC Settings",
                        MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
 
+    IUFillSwitch(&streamingS[0], "STREAMING_ON", "On", ISS_OFF);
+    IUFillSwitch(&streamingS[1], "STREAMING_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&streamingSP, streamingS, 2, getDeviceName(), "CORRELATIONS_STREAMING", "Stream correlations",
+                       MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillBLOB(&streamB, "STREAM", "Stream", ".xcs");
+    IUFillBLOBVector(&streamBP, &streamB, 1, getDeviceName(), "CORRELATIONS_STREAM", "Correlations stream", "Stats", IP_RO, 60,
+                     IPS_IDLE);
+
     // Set minimum exposure speed to 0.001 seconds
     setMinMaxStep("SENSOR_INTEGRATION", "SENSOR_INTEGRATION_VALUE", 1.0, STELLAR_DAY, 1, false);
     setDefaultPollingPeriod(500);
@@ -786,6 +938,8 @@ void AHP_XC::ISGetProperties(const char *dev)
             defineProperty(&crosscorrelationsBP);
         defineProperty(&correlationsNP);
         defineProperty(&settingsNP);
+        defineProperty(&streamingSP);
+        defineProperty(&streamBP);
 
         // Define our properties
     }
@@ -822,6 +976,8 @@ bool AHP_XC::updateProperties()
             defineProperty(&crosscorrelationsBP);
         defineProperty(&correlationsNP);
         defineProperty(&settingsNP);
+        defineProperty(&streamingSP);
+        defineProperty(&streamBP);
     }
     else
         // We're disconnected
@@ -832,6 +988,8 @@ bool AHP_XC::updateProperties()
             deleteProperty(crosscorrelationsBP.name);
         deleteProperty(correlationsNP.name);
         deleteProperty(settingsNP.name);
+        deleteProperty(streamingSP.name);
+        deleteProperty(streamBP.name);
         for (unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
         {
             deleteProperty(lineEnableSP[x].name);
@@ -887,6 +1045,7 @@ bool AHP_XC::StartIntegration(double duration)
 bool AHP_XC::AbortIntegration()
 {
     InIntegration = false;
+    closeStream();
     return true;
 }
 
@@ -976,6 +1135,21 @@ bool AHP_XC::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
         }
     }
 
+    if(!strcmp(name, streamingSP.name))
+    {
+        // the integration in progress keeps the output it was started with
+        if(InIntegration)
+        {
+            streamingSP.s = IPS_ALERT;
+            IDSetSwitch(&streamingSP, "Cannot change the stream mode during an integration");
+            return true;
+        }
+        IUUpdateSwitch(&streamingSP, states, names, n);
+        streamingSP.s = IPS_OK;
+        IDSetSwitch(&streamingSP, nullptr);
+        return true;
+    }
+
     for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
         baselines[x]->ISNewSwitch(dev, name, states, names, n);
 
@@ -23,6 +23,9 @@
 #include "indispectrograph.h"
 #include "indicorrelator.h"
 #include <ahp/ahp_xc.h>
+#include <mutex>
+#include <string>
+#include <vector>
 
 class baseline : public INDI::Correlator
 {
@@ -80,6 +83,14 @@ public:
         free(crosscorrelations_str);
         free(plot_str);
 
+        closeStream();
+        for(auto &fits : plotFITS)
+            free(fits.data);
+        for(auto &fits : autocorrelationsFITS)
+            free(fits.data);
+        for(auto &fits : crosscorrelationsFITS)
+            free(fits.data);
+
         free(totalcounts);
         free(totalcorrelations);
         free(delay);
@@ -171,6 +182,36 @@ private:
     dsp_stream_p *crosscorrelations_str;
     dsp_stream_p *plot_str;
 
+    // FITS memory files, kept across integrations so cfitsio reuses them
+    struct FITSBuffer
+    {
+        void *data;
+        size_t size;
+    };
+    std::vector<FITSBuffer> plotFITS;
+    std::vector<FITSBuffer> autocorrelationsFITS;
+    std::vector<FITSBuffer> crosscorrelationsFITS;
+
+    // Streaming output: lag spectra appended as rows to one file per integration
+    ISwitch streamingS[2];
+    ISwitchVectorProperty streamingSP;
+
+    IBLOB streamB;
+    IBLOBVectorProperty streamBP;
+
+    std::mutex streamMutex;
+    FILE *streamFile { nullptr };
+    std::vector<double> streamRow;
+    std::vector<char> streamLive;
+    unsigned int streamLiveRows { 0 };
+    double streamLiveSent { 0 };
+    unsigned int streamAutoLags { 0 };
+    unsigned int streamCrossLags { 0 };
+
+    // Next file index for the upload directory and prefix, so saving does not rescan the directory
+    std::string fileIndexKey;
+    int fileIndex { -1 };
+
     INumber settingsN[2];
     INumberVectorProperty settingsNP;
 
@@ -189,9 +230,15 @@ private:
     void ActiveLine(unsigned int, bool, bool, bool, bool);
     void EnableCapture(bool start);
     void sendFile(IBLOB* Blobs, IBLOBVectorProperty BlobP, unsigned int len);
-    void* createFITS(int bpp, size_t *size, dsp_stream *buf);
+    bool createFITS(int bpp, dsp_stream_p stream, FITSBuffer *fits, int *len);
     uint8_t* getBuffer(dsp_stream_p in, uint32_t *dims, int **sizes);
     int getFileIndex(const char * dir, const char * prefix, const char * ext);
+    int nextFileIndex(const char * dir, const char * prefix);
+    std::string fileName(const char * label, const char * ext);
+    void openStream(ahp_xc_packet *packet);
+    void appendStream(ahp_xc_packet *packet);
+    void sendStream(bool force);
+    void closeStream();
     // Struct to keep timing
     struct timeval ExpStart;
     double IntegrationRequest;
@@ -32,14 +32,17 @@
 #include <cmath>
 #include <vector>
 #include <map>
+#include <thread>
 #include <unistd.h>
 
 #define MAX_EXP_RETRIES         3
 #define VERBOSE_EXPOSURE        3
 #define TEMP_TIMER_MS           1000 /* Temperature polling time (ms) */
 #define TEMP_THRESHOLD          .25  /* Differential temperature threshold (C)*/
+#define STREAM_STATS_PERIOD     1.0  /* Streaming statistics update period (s) */
 
 #define CONTROL_TAB "Controls"
+#define STREAM_TAB  "Streaming"
 
 static bool warn_roi_height = true;
 static bool warn_roi_width = true;
@@ -67,15 +70,41 @@ void ASIBase::workerStreamVideo(const std::atomic_bool &isAboutToQuit)
         LOGF_ERROR("Failed to start video capture (%s).", Helpers::toString(ret));
     }
 
+    uint32_t totalBytes = PrimaryCCD.getFrameBufferSize();
+    int waitMS          = static_cast<int>((ExposureRequest * 2000.0) + 500);
+
+    allocateStreamRing(totalBytes);
+
+    // The consumer does the fix-ups and blocks on the streamer, so this thread only has to keep up with the SDK.
+    std::thread consumer(&ASIBase::workerStreamConsumer, this, std::cref(isAboutToQuit), totalBytes, ExposureRequest);
+
     while (!isAboutToQuit)
     {
-        uint8_t *targetFrame = PrimaryCCD.getFrameBuffer();
-        uint32_t totalBytes  = PrimaryCCD.getFrameBufferSize();
-        int waitMS           = static_cast<int>((ExposureRequest * 2000.0) + 500);
+        size_t slot;
+        {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            if (!mStreamFree.empty())
+            {
+                slot = mStreamFree.front();
+                mStreamFree.pop_front();
+            }
+            else
+            {
+                // Consumer fell behind, recycle the oldest queued frame.
+                slot = mStreamReady.front();
+                mStreamReady.pop_front();
+                ++mStreamDropped;
+            }
+        }
 
-        ret = ASIGetVideoData(mCameraInfo.CameraID, targetFrame, totalBytes, waitMS);
+        ret = ASIGetVideoData(mCameraInfo.CameraID, mStreamSlots[slot].data.data(), totalBytes, waitMS);
         if (ret != ASI_SUCCESS)
         {
+            {
+                std::lock_guard<std::mutex> lock(mStreamMutex);
+                mStreamFree.push_back(slot);
+            }
+
             if (ret != ASI_ERROR_TIMEOUT)
             {
                 Streamer->setStream(false);
@@ -87,14 +116,126 @@ void ASIBase::workerStreamVideo(const std::atomic_bool &isAboutToQuit)
             continue;
         }
 
-        if (mCurrentVideoFormat == ASI_IMG_RGB24)
-            for (uint32_t i = 0; i < totalBytes; i += 3)
-                std::swap(targetFrame[i], targetFrame[i + 2]);
+        mStreamSlots[slot].timestamp = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            mStreamReady.push_back(slot);
+            ++mStreamReceived;
+        }
+        mStreamCondition.notify_one();
+    }
 
-        Streamer->newFrame(targetFrame, totalBytes);
+    {
+        std::lock_guard<std::mutex> lock(mStreamMutex);
+        mStreamProducerDone = true;
     }
+    mStreamCondition.notify_one();
+    consumer.join();
 
     ASIStopVideoCapture(mCameraInfo.CameraID);
+
+    updateStreamStats(true);
+}
+
+void ASIBase::workerStreamConsumer(const std::atomic_bool &isAboutToQuit, uint32_t frameBytes, double framePeriod)
+{
+    const auto maxLatency = std::chrono::duration<double>(framePeriod);
+
+    while (true)
+    {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mStreamMutex);
+            mStreamCondition.wait(lock, [this]
+            {
+                return !mStreamReady.empty() || mStreamProducerDone;
+            });
+
+            if (mStreamProducerDone || isAboutToQuit)
+                break;
+
+            slot = mStreamReady.front();
+            mStreamReady.pop_front();
+        }
+
+        auto &frame = mStreamSlots[slot];
+
+        if (std::chrono::steady_clock::now() - frame.timestamp > maxLatency)
+            ++mStreamLate;
+
+        if (mCurrentVideoFormat == ASI_IMG_RGB24)
+        {
+            uint8_t *data = frame.data.data();
+            for (uint32_t i = 0; i < frameBytes; i += 3)
+                std::swap(data[i], data[i + 2]);
+        }
+
+        Streamer->newFrame(frame.data.data(), frameBytes);
+
+        {
+            std::lock_guard<std::mutex> lock(mStreamMutex);
+            mStreamFree.push_back(slot);
+        }
+
+        updateStreamStats(false);
+    }
+}
+
+void ASIBase::allocateStreamRing(uint32_t frameBytes)
+{
+    size_t depth = std::max(2, static_cast<int>(StreamBufferNP[0].getValue()));
+
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+
+    mStreamSlots.resize(depth);
+    for (auto &slot : mStreamSlots)
+        slot.data.resize(frameBytes);
+
+    mStreamFree.clear();
+    mStreamReady.clear();
+    for (size_t i = 0; i < depth; i++)
+        mStreamFree.push_back(i);
+
+    mStreamProducerDone  = false;
+    mStreamReceived      = 0;
+    mStreamDropped       = 0;
+    mStreamLate          = 0;
+    mStreamStatsReceived = 0;
+    mStreamStatsTime     = std::chrono::steady_clock::now();
+
+    LOGF_DEBUG("Allocated %zu video buffers of %u bytes.", depth, frameBytes);
+}
+
+void ASIBase::updateStreamStats(bool force)
+{
+    auto now     = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - mStreamStatsTime).count();
+
+    if (!force && elapsed < STREAM_STATS_PERIOD)
+        return;
+
+    uint64_t received, dropped;
+    {
+        std::lock_guard<std::mutex> lock(mStreamMutex);
+        received = mStreamReceived;
+        dropped  = mStreamDropped;
+    }
+
+    int sdkDropped = 0;
+    ASIGetDroppedFrames(mCameraInfo.CameraID, &sdkDropped);
+
+    StreamStatsNP[STATS_RECEIVED   ].setValue(received);
+    StreamStatsNP[STATS_DROPPED    ].setValue(dropped);
+    StreamStatsNP[STATS_LATE       ].setValue(mStreamLate);
+    StreamStatsNP[STATS_SDK_DROPPED].setValue(sdkDropped);
+    if (elapsed > 0)
+        StreamStatsNP[STATS_FPS].setValue((received - mStreamStatsReceived) / elapsed);
+    StreamStatsNP.setState((dropped > 0 || sdkDropped > 0) ? IPS_ALERT : IPS_OK);
+    StreamStatsNP.apply();
+
+    mStreamStatsReceived = received;
+    mStreamStatsTime     = now;
 }
 
 void ASIBase::workerBlinkExposure(const std::atomic_bool &isAboutToQuit, int blinks, float duration)
@@ -337,6 +478,16 @@ bool ASIBase::initProperties()
     BlinkNP[BLINK_DURATION].fill("BLINK_DURATION", "Blink duration",         "%2.3f", 0,  60, 0.001, 0);
     BlinkNP.fill(getDeviceName(), "BLINK", "Blink", CONTROL_TAB, IP_RW, 60, IPS_IDLE);
 
+    StreamBufferNP[0].fill("DEPTH", "Frames", "%.f", 2, 64, 1, 4);
+    StreamBufferNP.fill(getDeviceName(), "STREAM_BUFFER", "Video Buffer", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+    StreamStatsNP[STATS_RECEIVED   ].fill("RECEIVED",    "Received",     "%.f",   0, 1e12, 0, 0);
+    StreamStatsNP[STATS_DROPPED    ].fill("DROPPED",     "Dropped",      "%.f",   0, 1e12, 0, 0);
+    StreamStatsNP[STATS_LATE       ].fill("LATE",        "Late",         "%.f",   0, 1e12, 0, 0);
+    StreamStatsNP[STATS_SDK_DROPPED].fill("SDK_DROPPED", "SDK Dropped",  "%.f",   0, 1e12, 0, 0);
+    StreamStatsNP[STATS_FPS        ].fill("FPS",         "Sustained FPS", "%.2f", 0, 1e4,  0, 0);
+    StreamStatsNP.fill(getDeviceName(), "STREAM_STATS", "Video Stats", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
     IUSaveText(&BayerT[2], getBayerString());
 
     ADCDepthNP[0].fill("BITS", "Bits", "%2.0f", 0, 32, 1, mCameraInfo.BitDepth);
@@ -462,6 +613,8 @@ bool ASIBase::updateProperties()
         }
 
         defineProperty(BlinkNP);
+        defineProperty(StreamBufferNP);
+        defineProperty(StreamStatsNP);
         defineProperty(ADCDepthNP);
         defineProperty(SDKVersionSP);
         if (!mSerialNumber.empty())
@@ -495,6 +648,8 @@ bool ASIBase::updateProperties()
             deleteProperty(VideoFormatSP.getName());
 
         deleteProperty(BlinkNP.getName());
+        deleteProperty(StreamBufferNP.getName());
+        deleteProperty(StreamStatsNP.getName());
         deleteProperty(SDKVersionSP.getName());
         if (!mSerialNumber.empty())
         {
@@ -566,6 +721,8 @@ bool ASIBase::Disconnect()
         ASICloseCamera(mCameraInfo.CameraID);
     }
 
+    mRGBBuffer.release();
+
     LOG_INFO("Camera is offline.");
 
 
@@ -778,6 +935,15 @@ bool ASIBase::ISNewNumber(const char *dev, const char *name, double values[], ch
             BlinkNP.apply();
             return true;
         }
+
+        if (StreamBufferNP.isNameMatch(name))
+        {
+            StreamBufferNP.setState(StreamBufferNP.update(values, names, n) ? IPS_OK : IPS_ALERT);
+            StreamBufferNP.apply();
+            if (Streamer->isBusy())
+                LOG_INFO("Video buffer depth takes effect when streaming is restarted.");
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewNumber(dev, name, values, names, n);
@@ -1139,14 +1305,7 @@ int ASIBase::grabImage(float duration)
     size_t nTotalBytes = subW * subH * nChannels * (PrimaryCCD.getBPP() / 8);
 
     if (type == ASI_IMG_RGB24)
-    {
-        buffer = static_cast<uint8_t *>(malloc(nTotalBytes));
-        if (buffer == nullptr)
-        {
-            LOGF_ERROR("%s: %d malloc failed (RGB 24).", getDeviceName());
-            return -1;
-        }
-    }
+        buffer = mRGBBuffer.get(nTotalBytes);
 
     ret = ASIGetDataAfterExp(mCameraInfo.CameraID, buffer, nTotalBytes);
     if (ret != ASI_SUCCESS)
@@ -1155,29 +1314,11 @@ int ASIBase::grabImage(float duration)
             "Failed to get data after exposure (%dx%d #%d channels) (%s).",
             subW, subH, nChannels, Helpers::toString(ret)
         );
-        if (type == ASI_IMG_RGB24)
-            free(buffer);
         return -1;
     }
 
     if (type == ASI_IMG_RGB24)
-    {
-        uint8_t *dstR = image;
-        uint8_t *dstG = image + subW * subH;
-        uint8_t *dstB = image + subW * subH * 2;
-
-        const uint8_t *src = buffer;
-        const uint8_t *end = buffer + subW * subH * 3;
-
-        while (src != end)
-        {
-            *dstB++ = *src++;
-            *dstG++ = *src++;
-            *dstR++ = *src++;
-        }
-
-        free(buffer);
-    }
+        PixelConvert::toPlanar(PixelConvert::BGR24, buffer, image, subW, subH);
     guard.unlock();
 
     PrimaryCCD.setNAxis(type == ASI_IMG_RGB24 ? 3 : 2);
@@ -1535,6 +1676,7 @@ bool ASIBase::saveConfigItems(FILE *fp)
         VideoFormatSP.save(fp);
 
     BlinkNP.save(fp);
+    StreamBufferNP.save(fp);
 
     return true;
 }
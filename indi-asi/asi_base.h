@@ -23,12 +23,17 @@
 #pragma once
 
 #include <ASICamera2.h>
+#include <pixelconvert.h>
 
 #include "indipropertyswitch.h"
 #include "indipropertynumber.h"
 #include "indipropertytext.h"
 #include "indisinglethreadpool.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 #include <indiccd.h>
@@ -86,6 +91,7 @@ class ASIBase : public INDI::CCD
     protected:
         INDI::SingleThreadPool mWorker;
         void workerStreamVideo(const std::atomic_bool &isAboutToQuit);
+        void workerStreamConsumer(const std::atomic_bool &isAboutToQuit, uint32_t frameBytes, double framePeriod);
         void workerBlinkExposure(const std::atomic_bool &isAboutToQuit, int blinks, float duration);
         void workerExposure(const std::atomic_bool &isAboutToQuit, float duration);
 
@@ -132,6 +138,12 @@ class ASIBase : public INDI::CCD
         /** Can the camera flip the image horizontally and vertically */
         bool hasFlipControl();
 
+        /** Allocate the video ring for frames of the given size */
+        void allocateStreamRing(uint32_t frameBytes);
+
+        /** Publish the streaming statistics */
+        void updateStreamStats(bool force);
+
         /** Additional Properties to INDI::CCD */
         INDI::PropertyNumber  CoolerNP {1};
         INDI::PropertySwitch  CoolerSP {2};
@@ -152,6 +164,18 @@ class ASIBase : public INDI::CCD
             BLINK_DURATION
         };
 
+        INDI::PropertyNumber  StreamBufferNP {1};
+
+        INDI::PropertyNumber  StreamStatsNP {5};
+        enum
+        {
+            STATS_RECEIVED,
+            STATS_DROPPED,
+            STATS_LATE,
+            STATS_SDK_DROPPED,
+            STATS_FPS
+        };
+
         INDI::PropertySwitch  FlipSP {2};
         enum
         {
@@ -164,4 +188,26 @@ class ASIBase : public INDI::CCD
         uint8_t mExposureRetry {0};
         ASI_IMG_TYPE mCurrentVideoFormat;
         std::vector<ASI_CONTROL_CAPS> mControlCaps;
+
+        /** Packed BGR frames are downloaded here before being split into FITS planes */
+        PixelConvert::ScratchBuffer mRGBBuffer;
+
+        /** Video ring: the producer only pulls frames from the SDK, the consumer fixes them up and feeds the streamer */
+        struct StreamSlot
+        {
+            std::vector<uint8_t> data;
+            std::chrono::steady_clock::time_point timestamp;
+        };
+        std::vector<StreamSlot> mStreamSlots;
+        std::deque<size_t> mStreamFree;
+        std::deque<size_t> mStreamReady;
+        std::mutex mStreamMutex;
+        std::condition_variable mStreamCondition;
+        bool mStreamProducerDone {false};
+
+        uint64_t mStreamReceived {0};
+        uint64_t mStreamDropped {0};
+        uint64_t mStreamLate {0};
+        std::chrono::steady_clock::time_point mStreamStatsTime;
+        uint64_t mStreamStatsReceived {0};
 };
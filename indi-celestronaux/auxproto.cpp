@@ -24,6 +24,7 @@
 #include "auxproto.h"
 
 #include <indilogger.h>
+#include <algorithm>
 #include <math.h>
 #include <string.h>
 #include <unistd.h>
@@ -467,3 +468,85 @@ void AUXCommand::setData(uint32_t value, uint8_t bytes)
             break;
     }
 }
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+AUXFrameParser::AUXFrameParser(size_t capacity) : m_Ring(capacity)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXFrameParser::push(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (m_Count == m_Ring.size())
+            drop(1);
+        m_Ring[(m_Head + m_Count) % m_Ring.size()] = data[i];
+        m_Count++;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Packet layout: 0x3b <len> <source> <destination> <command> <len-3 bytes data> <checksum>
+/////////////////////////////////////////////////////////////////////////////////////
+bool AUXFrameParser::next(AUXBuffer &frame)
+{
+    while (m_Count > 0)
+    {
+        if (at(0) != 0x3b)
+        {
+            drop(1);
+            continue;
+        }
+        if (m_Count < 2)
+            return false;
+
+        size_t len = at(1);
+        if (len < 3)
+        {
+            drop(1);
+            continue;
+        }
+        if (m_Count < len + 3)
+            return false;
+
+        int cs = 0;
+        for (size_t i = 1; i < len + 2; i++)
+            cs += at(i);
+        if (static_cast<uint8_t>((~cs) + 1) != at(len + 2))
+        {
+            // Not a packet start after all, resync on the next preamble
+            drop(1);
+            continue;
+        }
+
+        frame.resize(len + 3);
+        for (size_t i = 0; i < len + 3; i++)
+            frame[i] = at(i);
+        drop(len + 3);
+        return true;
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXFrameParser::clear()
+{
+    m_Head = m_Count = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXFrameParser::drop(size_t n)
+{
+    n = std::min(n, m_Count);
+    m_Head = (m_Head + n) % m_Ring.size();
+    m_Count -= n;
+}
@@ -167,3 +167,42 @@ class AUXCommand
 
 
 };
+
+/**
+ * @brief Reassembles AUX packets from a byte stream.
+ * Received bytes are kept in a ring buffer across reads so packets split over several
+ * reads are not lost. Garbage and packets with a bad checksum are skipped by searching
+ * for the next 0x3b preamble.
+ */
+class AUXFrameParser
+{
+    public:
+        explicit AUXFrameParser(size_t capacity = 1024);
+
+        /** Append received bytes. When full, the oldest bytes are dropped. */
+        void push(const uint8_t *data, size_t size);
+
+        /**
+         * @brief next Extract the next complete packet.
+         * @param frame Filled with the packet, from preamble to checksum.
+         * @return True if a packet was extracted, false if more bytes are needed.
+         */
+        bool next(AUXBuffer &frame);
+
+        void clear();
+        size_t size() const
+        {
+            return m_Count;
+        }
+
+    private:
+        uint8_t at(size_t i) const
+        {
+            return m_Ring[(m_Head + i) % m_Ring.size()];
+        }
+        void drop(size_t n);
+
+        std::vector<uint8_t> m_Ring;
+        size_t m_Head {0};
+        size_t m_Count {0};
+};
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <math.h>
 #include <queue>
+#include <poll.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
@@ -93,6 +94,8 @@ CelestronAUX::~CelestronAUX()
 bool CelestronAUX::Handshake()
 {
     LOGF_DEBUG("CAUX: connect %d (%s)", PortFD, (getActiveConnection() == serialConnection) ? "serial" : "net");
+    m_RxFrames.clear();
+    m_PendingCommands.clear();
     if (PortFD > 0)
     {
         if (getActiveConnection() == serialConnection)
@@ -1048,26 +1051,20 @@ bool CelestronAUX::ReadScopeStatus()
     if (!isConnected())
         return false;
 
-    if (!getStatus(AXIS_AZ))
-        return false;
-    if (!getStatus(AXIS_ALT))
-        return false;
-
     double axis1 = EncoderNP[AXIS_AZ].getValue();
     double axis2 = EncoderNP[AXIS_ALT].getValue();
 
-    if (!getEncoder(AXIS_AZ))
+    // Slew status and encoders of both axes in one go, see getStatus and getEncoder.
+    std::vector<AUXCommand> commands;
+    for (INDI_HO_AXIS axis : {AXIS_AZ, AXIS_ALT})
     {
-        if (EncoderNP.getState() != IPS_ALERT)
-        {
-            EncoderNP.setState(IPS_ALERT);
-            AngleNP.setState(IPS_ALERT);
-            EncoderNP.apply();
-            AngleNP.apply();
-        }
-        return false;
+        if (m_AxisStatus[axis] == SLEWING && ScopeStatus != SLEWING_MANUAL)
+            commands.emplace_back(MC_SLEW_DONE, APP, axis == AXIS_AZ ? AZM : ALT);
     }
-    if (!getEncoder(AXIS_ALT))
+    commands.emplace_back(MC_GET_POSITION, APP, AZM);
+    commands.emplace_back(MC_GET_POSITION, APP, ALT);
+
+    if (!sendAUXCommands(commands))
     {
         if (EncoderNP.getState() != IPS_ALERT)
         {
@@ -1093,7 +1090,8 @@ bool CelestronAUX::ReadScopeStatus()
     }
 
     // Send to client if updated
-    if (std::abs(axis1 - EncoderNP[AXIS_AZ].getValue()) > 1 || std::abs(axis2 - EncoderNP[AXIS_ALT].getValue()) > 1)
+    if (EncoderNP.getState() == IPS_ALERT ||
+            std::abs(axis1 - EncoderNP[AXIS_AZ].getValue()) > 1 || std::abs(axis2 - EncoderNP[AXIS_ALT].getValue()) > 1)
     {
         EncoderNP.setState(IPS_OK);
         EncoderNP.apply();
@@ -2473,65 +2471,34 @@ bool CelestronAUX::serialReadResponse(AUXCommand c)
     if ( PortFD <= 0 )
         return false;
 
-    if (m_IsRTSCTS || !m_isHandController)
-    {
-        // if connected to AUX or PC ports, receive AUX command response.
-        // search for packet preamble (0x3b)
-        do
-        {
-            if (aux_tty_read((char*)buf, 1, READ_TIMEOUT, &n) != TTY_OK)
-                return false;
-        }
-        while (buf[0] != 0x3b);
-
-        // packet preamble is found, now read packet length.
-        if (aux_tty_read((char*)(buf + 1), 1, READ_TIMEOUT, &n) != TTY_OK)
-            return false;
-
-        // now packet length is known, read the rest of the packet.
-        if (aux_tty_read((char*)(buf + 2), buf[1] + 1, READ_TIMEOUT, &n)
-                != TTY_OK || n != buf[1] + 1)
-        {
-            LOG_DEBUG("Did not got whole packet. Dropping out.");
-            return false;
-        }
+    // Connected to HC serial, build up the AUX command response from
+    // given AUX command and passthrough response without checksum.
+    // read passthrough response
+    if ((tty_read(PortFD, (char *)buf + 5, response_data_size + 1, READ_TIMEOUT, &n) !=
+            TTY_OK) || (n != response_data_size + 1))
+        return false;
 
-        AUXBuffer b(buf, buf + (n + 2));
-        hex_dump(hexbuf, b, b.size());
-        DEBUGF(DBG_SERIAL, "RES <%s>", hexbuf);
-        cmd.parseBuf(b);
-    }
-    else
+    // if last char is not '#', there was an error.
+    if (buf[response_data_size + 5] != '#')
     {
-        // if connected to HC serial, build up the AUX command response from
-        // given AUX command and passthrough response without checksum.
-        // read passthrough response
-        if ((tty_read(PortFD, (char *)buf + 5, response_data_size + 1, READ_TIMEOUT, &n) !=
-                TTY_OK) || (n != response_data_size + 1))
-            return false;
-
-        // if last char is not '#', there was an error.
-        if (buf[response_data_size + 5] != '#')
-        {
-            LOGF_ERROR("Resp. char %d is %2.2x ascii %c", n, buf[n + 5], (char)buf[n + 5]);
-            AUXBuffer b(buf, buf + (response_data_size + 5));
-            hex_dump(hexbuf, b, b.size());
-            LOGF_ERROR("RES <%s>", hexbuf);
-            return false;
-        }
-
-        buf[0] = 0x3b;
-        buf[1] = response_data_size + 1;
-        buf[2] = c.destination();
-        buf[3] = c.source();
-        buf[4] = c.command();
-
+        LOGF_ERROR("Resp. char %d is %2.2x ascii %c", n, buf[n + 5], (char)buf[n + 5]);
         AUXBuffer b(buf, buf + (response_data_size + 5));
         hex_dump(hexbuf, b, b.size());
-        DEBUGF(DBG_SERIAL, "RES (%d B): <%s>", (int)b.size(), hexbuf);
-        cmd.parseBuf(b, false);
+        LOGF_ERROR("RES <%s>", hexbuf);
+        return false;
     }
 
+    buf[0] = 0x3b;
+    buf[1] = response_data_size + 1;
+    buf[2] = c.destination();
+    buf[3] = c.source();
+    buf[4] = c.command();
+
+    AUXBuffer b(buf, buf + (response_data_size + 5));
+    hex_dump(hexbuf, b, b.size());
+    DEBUGF(DBG_SERIAL, "RES (%d B): <%s>", (int)b.size(), hexbuf);
+    cmd.parseBuf(b, false);
+
     // Got the packet, process it
     // n:length field >=3
     // The buffer of n+2>=5 bytes contains:
@@ -2544,81 +2511,117 @@ bool CelestronAUX::serialReadResponse(AUXCommand c)
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
-///
+/// Read from the AUX bus until the response to c arrives. Every packet received on
+/// the way is processed and checked off the pending commands, so responses to
+/// commands issued back to back may arrive in any order or in a single read.
 /////////////////////////////////////////////////////////////////////////////////////
-bool CelestronAUX::tcpReadResponse()
+bool CelestronAUX::readFramedResponse(const AUXCommand &c)
 {
-    int n, i;
-    unsigned char buf[BUFFER_SIZE] = {0};
-    AUXCommand cmd;
-
     // We are not connected. Nothing to do.
     if ( PortFD <= 0 )
         return false;
 
-    timeval tv;
-    tv.tv_sec  = 0;
-    tv.tv_usec = 50000;
-    setsockopt(PortFD, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(struct timeval));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(READ_TIMEOUT);
+    AUXBuffer frame;
 
-    // Drain the channel
-    while ((n = recv(PortFD, buf, sizeof(buf), MSG_DONTWAIT | MSG_PEEK)) > 0)
+    while (true)
     {
-        //        DEBUGF(DBG_CAUX, "Got %d bytes: ", n);
-        //        for (i = 0; i < n; i++)
-        //            IDLog("%02x ", buf[i]);
-
-        for (i = 0; i < n;)
+        while (m_RxFrames.next(frame))
         {
-            if (buf[i] == 0x3b)
-            {
-                int shft;
-                shft = i + buf[i + 1] + 3;
-                if (shft <= n)
-                {
-                    AUXBuffer b(buf + i, buf + shft);
-                    cmd.parseBuf(b);
+            AUXCommand cmd;
+            cmd.parseBuf(frame);
 
-                    char hexbuf[32 * 3] = {0};
-                    hex_dump(hexbuf, b, b.size());
-                    DEBUGF(DBG_SERIAL, "RES <%s>", hexbuf);
+            char hexbuf[32 * 3] = {0};
+            hex_dump(hexbuf, frame, std::min<size_t>(frame.size(), 32));
+            DEBUGF(DBG_SERIAL, "RES <%s>", hexbuf);
 
-                    processResponse(cmd);
-                }
-                else
-                {
-                    DEBUGF(DBG_SERIAL, "Partial message recv. dropping (i=%d %d/%d)", i, shft, n);
-                    logBytes(buf + i, n - i, getDeviceName(), DBG_SERIAL);
-                    recv(PortFD, buf, n, MSG_DONTWAIT);
-                    break;
-                }
-                i = shft;
-            }
-            else
+            if (cmd.destination() == APP)
             {
-                i++;
+                auto match = std::find_if(m_PendingCommands.begin(), m_PendingCommands.end(), [&cmd](const PendingCommand & p)
+                {
+                    return p.command == cmd.command() && p.destination == cmd.source();
+                });
+                if (match != m_PendingCommands.end())
+                    m_PendingCommands.erase(match);
             }
+
+            processResponse(cmd);
         }
-        // Actually consume data we parsed. Leave the rest for later.
-        if (i > 0)
+
+        if (!isPending(c))
+            return true;
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || !readAvailable(remaining.count()))
         {
-            n = recv(PortFD, buf, i, MSG_DONTWAIT);
-            //DEBUGF(DBG_CAUX, "Consumed %d/%d bytes", n, i);
+            DEBUGF(DBG_SERIAL, "No response to %s.", c.commandName());
+            auto stale = std::find_if(m_PendingCommands.begin(), m_PendingCommands.end(), [&c](const PendingCommand & p)
+            {
+                return p.command == c.command() && p.destination == c.destination();
+            });
+            if (stale != m_PendingCommands.end())
+                m_PendingCommands.erase(stale);
+            return false;
         }
     }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Append whatever is available within timeout ms to the receive buffer.
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::readAvailable(int timeout)
+{
+    // if hardware flow control is required, set RTS to off to receive: PC port
+    // bahaves as half duplex.
+    if (m_IsRTSCTS)
+        setRTS(0);
+
+    struct pollfd pfd = { PortFD, POLLIN, 0 };
+    if (poll(&pfd, 1, timeout) <= 0)
+        return false;
+
+    uint8_t buf[256];
+    int n = read(PortFD, buf, sizeof(buf));
+    if (n <= 0)
+    {
+        if (n < 0)
+            LOGF_ERROR("Error reading from mount %s(%d).", strerror(errno), errno);
+        return false;
+    }
+
+    m_RxFrames.push(buf, n);
     return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::isPending(const AUXCommand &c)
+{
+    return std::any_of(m_PendingCommands.begin(), m_PendingCommands.end(), [&c](const PendingCommand & p)
+    {
+        return p.command == c.command() && p.source == c.source() && p.destination == c.destination();
+    });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Connected to the HC serial port, commands are wrapped in passthrough requests and
+/// responses carry no header.
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::isPassthrough()
+{
+    return !m_IsRTSCTS && m_isHandController && getActiveConnection() == serialConnection;
+}
 
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 /////////////////////////////////////////////////////////////////////////////////////
 bool CelestronAUX::readAUXResponse(AUXCommand c)
 {
-    if (getActiveConnection() == serialConnection)
+    if (isPassthrough())
         return serialReadResponse(c);
     else
-        return tcpReadResponse();
+        return readFramedResponse(c);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -2633,7 +2636,6 @@ int CelestronAUX::sendBuffer(AUXBuffer buf)
         if (aux_tty_write((char*)buf.data(), buf.size(), CTS_TIMEOUT, &n) != TTY_OK)
             return 0;
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
         if (n == -1)
             LOG_ERROR("CAUX::sendBuffer");
         if ((unsigned)n != buf.size())
@@ -2657,9 +2659,19 @@ bool CelestronAUX::sendAUXCommand(AUXCommand &command)
     AUXBuffer buf;
     command.logCommand();
 
-    if (m_IsRTSCTS || !m_isHandController || getActiveConnection() != serialConnection)
-        // Direct connection (AUX/PC/USB port)
+    if (!isPassthrough())
+    {
+        // Direct connection (AUX/PC/USB port or network)
         command.fillBuf(buf);
+
+        // Remember what we asked for, the response is matched in readFramedResponse
+        if (command.source() == APP)
+        {
+            if (m_PendingCommands.size() >= MAX_PENDING)
+                m_PendingCommands.pop_front();
+            m_PendingCommands.push_back({command.command(), command.source(), command.destination()});
+        }
+    }
     else
     {
         // connection is through HC serial and destination is not HC,
@@ -2679,12 +2691,38 @@ bool CelestronAUX::sendAUXCommand(AUXCommand &command)
             buf[i + 4] = command.data()[i];
         }
         buf[7] = response_data_size = command.responseDataSize();
+
+        // Passthrough responses cannot be told apart, drop anything stale
+        tcflush(PortFD, TCIOFLUSH);
     }
 
-    tcflush(PortFD, TCIOFLUSH);
     return (sendBuffer(buf) == static_cast<int>(buf.size()));
 }
 
+/////////////////////////////////////////////////////////////////////////////////////
+/// Issue all commands before waiting for any response, so a poll of several
+/// motor controllers costs a single round trip.
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::sendAUXCommands(std::vector<AUXCommand> &commands)
+{
+    bool rc = true;
+
+    // Passthrough responses carry no header and the half duplex PC port verifies the
+    // echo right after each write, so those go one command at a time.
+    if (isPassthrough() || m_IsRTSCTS)
+    {
+        for (auto &command : commands)
+            rc = sendAUXCommand(command) && readAUXResponse(command) && rc;
+        return rc;
+    }
+
+    for (auto &command : commands)
+        rc = sendAUXCommand(command) && rc;
+    for (auto &command : commands)
+        rc = readAUXResponse(command) && rc;
+    return rc;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Wrap functions around the standard driver communication functions tty_read
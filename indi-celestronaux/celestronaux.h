@@ -37,6 +37,8 @@
 #include <pid.h>
 #include <termios.h>
 
+#include <deque>
+
 #include "auxproto.h"
 
 class CelestronAUX :
@@ -274,10 +276,14 @@ class CelestronAUX :
         /// Auxiliary Command Communication
         /////////////////////////////////////////////////////////////////////////////////////
         bool sendAUXCommand(AUXCommand &command);
+        bool sendAUXCommands(std::vector<AUXCommand> &commands);
         void closeConnection();
         void emulateGPS(AUXCommand &m);
         bool serialReadResponse(AUXCommand c);
-        bool tcpReadResponse();
+        bool readFramedResponse(const AUXCommand &c);
+        bool readAvailable(int timeout);
+        bool isPending(const AUXCommand &c);
+        bool isPassthrough();
         bool readAUXResponse(AUXCommand c);
         bool processResponse(AUXCommand &cmd);
         int sendBuffer(AUXBuffer buf);
@@ -324,6 +330,16 @@ class CelestronAUX :
         bool m_IsRTSCTS {false};
         bool m_isHandController {false};
 
+        // Received bytes not yet parsed into packets, kept across reads
+        AUXFrameParser m_RxFrames;
+        // Commands sent and still waiting for their response, oldest first
+        struct PendingCommand
+        {
+            AUXCommands command;
+            AUXTargets source, destination;
+        };
+        std::deque<PendingCommand> m_PendingCommands;
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Celestron AUX Properties
         ///////////////////////////////////////////////////////////////////////////////
@@ -425,7 +441,8 @@ class CelestronAUX :
         // MC_SET_POS_GUIDERATE & MC_SET_NEG_GUIDERATE use 24bit number rate in
         static constexpr uint8_t RATE_PER_ARCSEC {4};
 
-        static constexpr uint32_t BUFFER_SIZE {10240};
+        // Responses never received are forgotten past this many outstanding commands
+        static constexpr uint8_t MAX_PENDING {32};
         // seconds
         static constexpr uint8_t READ_TIMEOUT {1};
         // ms
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <math.h>
 #include <memory>
+#include <thread>
 #include <unistd.h>
 
 #ifdef __APPLE__
@@ -858,13 +859,15 @@ unsigned char *DSI::Device::downloadImage()
     unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
     unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
     unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-    unsigned char *odd_data = new unsigned char[odd_size];
-    unsigned char *even_data = nullptr;
 
-    if (interlaced)
-        even_data = new unsigned char[even_size];
+    /* field and frame buffers are kept between frames, they only grow */
+    odd_buffer.resize(odd_size);
+    even_buffer.resize(even_size);
+    frame_buffer.resize(all_size);
 
-    framebuffer = new unsigned char[all_size];
+    unsigned char *odd_data  = odd_buffer.data();
+    unsigned char *even_data = even_buffer.data();
+    framebuffer              = frame_buffer.data();
 
     if (interlaced)
     {
@@ -889,7 +892,17 @@ unsigned char *DSI::Device::downloadImage()
             throw device_read_error(ss.str());
         }
 
-        status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transferred, 60000 * MILLISEC);
+        /* read the odd field while the even rows are copied into place */
+        std::thread odd_reader([&]()
+        {
+            status = libusb_bulk_transfer(handle, 0x86, odd_data, odd_size, &transferred, 60000 * MILLISEC);
+        });
+
+        copyFieldRows(even_data, true, 0, t_read_width, t_image_width, t_image_height, t_image_offset_x,
+                      t_image_offset_y);
+
+        odd_reader.join();
+
         if (log_commands)
         {
             log_command_info(false, "r 86", (status > 0 ? status : 0), (char *)odd_data, 0);
@@ -945,11 +958,6 @@ unsigned char *DSI::Device::downloadImage()
     /* disable 2x2 binning after downloading image (gs) */
     disable2x2Binning();
 
-    unsigned char msb = 0, lsb = 0, is_odd = 0;
-    unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-    char *even = (char *)even_data;
-    char *odd  = (char *)odd_data;
-
     if (log_commands)
         std::cerr << "t_image_height  =" << t_image_height << std::endl
                   << "t_image_width   =" << t_image_width << std::endl
@@ -959,71 +967,38 @@ unsigned char *DSI::Device::downloadImage()
                   << "t_read_height   =" << t_read_height << std::endl
                   << "t_read_bpp      =" << t_read_bpp << std::endl;
 
-    if (interlaced)
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-            is_odd     = (y_ptr + t_image_offset_y) % 2;
-
-            std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                      << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                      << std::endl;
+    /* the even rows are already in place for interlaced readout */
+    copyFieldRows(odd_data, interlaced, 1, t_read_width, t_image_width, t_image_height, t_image_offset_x,
+                  t_image_offset_y);
 
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                if (is_odd == 1) // odd line
-                {
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-                }
-                else
-                {
-                    // even line
-                    msb = even[read_ptr];
-                    lsb = even[read_ptr + 1];
-                }
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
-    }
-    else
-    {
-        for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-        {
-            line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-            // std::cerr << "starting image row " << y_ptr
-            //      << ", write_ptr=" << write_ptr
-            //      << ", line_start=" << line_start
-            //      << ", read_ptr=" << (line_start+t_image_offset_x)*2
-            //      << std::endl;
-            for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-            {
-                read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-
-                msb = odd[read_ptr];
-                lsb = odd[read_ptr + 1];
+    return framebuffer;
 
-                framebuffer[write_ptr++] = msb;
-                framebuffer[write_ptr++] = lsb;
-            }
-        }
-    }
+    throw dsi_exception("unsupported image command");
+}
 
-    if (log_commands)
-        std::cerr << "write_ptr=" << write_ptr << std::endl;
+/* Copy the image rows held by one field into the frame buffer, a whole row
+   at a time. Interlaced fields hold every other sensor line, field 0 the
+   even and field 1 the odd ones. A progressive field holds all lines. */
 
-    delete[] odd_data;
+void DSI::Device::copyFieldRows(const unsigned char *field, bool interlaced, unsigned int parity,
+                                unsigned int t_read_width, unsigned int t_image_width, unsigned int t_image_height,
+                                unsigned int t_image_offset_x, unsigned int t_image_offset_y)
+{
+    const size_t row_bytes = t_image_width * 2;
 
-    if (interlaced)
-        delete[] even_data;
+    for (unsigned int y_ptr = 0; y_ptr < t_image_height; y_ptr++)
+    {
+        unsigned int line = y_ptr + t_image_offset_y;
 
-    return framebuffer;
+        if (interlaced)
+        {
+            if (line % 2 != parity)
+                continue;
+            line /= 2;
+        }
 
-    throw dsi_exception("unsupported image command");
+        memcpy(framebuffer + y_ptr * row_bytes, field + (size_t)(t_read_width * line + t_image_offset_x) * 2, row_bytes);
+    }
 }
 
 /* ask camera for remaining exposure time for long exposures (gs) */
@@ -1306,13 +1281,14 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
         unsigned int odd_size  = t_read_bpp * t_read_width * t_read_height_odd;
         unsigned int even_size = t_read_bpp * t_read_width * t_read_height_even;
         unsigned int all_size  = t_read_bpp * t_read_width * t_read_height;
-        unsigned char *odd_data = new unsigned char[odd_size];
-        unsigned char *even_data = nullptr;
 
-        if (interlaced)
-            even_data = new unsigned char[even_size];
+        odd_buffer.resize(odd_size);
+        even_buffer.resize(even_size);
+        frame_buffer.resize(all_size);
 
-        framebuffer = new unsigned char[all_size];
+        unsigned char *odd_data  = odd_buffer.data();
+        unsigned char *even_data = even_buffer.data();
+        framebuffer              = frame_buffer.data();
 
         /* The Meade driver seems to only issue a GET_EXP_TIME_COUNT command
          * when the exposure is over about 2 seconds (count = 20,000).  From
@@ -1383,11 +1359,6 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
 
         disable2x2Binning();
 
-        unsigned char msb = 0, lsb = 0, is_odd = 0;
-        unsigned int x_ptr = 0, line_start = 0, y_ptr = 0, read_ptr = 0, write_ptr = 0;
-        char *even = (char *)even_data;
-        char *odd  = (char *)odd_data;
-
         if (log_commands)
             std::cerr << "t_image_height  =" << t_image_height << std::endl
                       << "t_image_width   =" << t_image_width << std::endl
@@ -1398,64 +1369,10 @@ unsigned char *DSI::Device::getImage(DeviceCommand __command, int howlong)
                       << "t_read_bpp      =" << t_read_bpp << std::endl;
 
         if (interlaced)
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * ((y_ptr + t_image_offset_y) / 2);
-                is_odd     = (y_ptr + t_image_offset_y) % 2;
-
-                std::cerr << "starting image row " << y_ptr << ", write_ptr=" << write_ptr << ", line_start=" << line_start
-                          << ", is_odd=" << (is_odd == 0 ? 0 : 1) << ", read_ptr=" << (line_start + t_image_offset_x) * 2
-                          << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-                    if (is_odd == 1) // odd line
-                    {
-                        msb = odd[read_ptr];
-                        lsb = odd[read_ptr + 1];
-                    }
-                    else
-                    {
-                        // even line
-                        msb = even[read_ptr];
-                        lsb = even[read_ptr + 1];
-                    }
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-        else
-        {
-            for (write_ptr = y_ptr = 0; y_ptr < t_image_height; y_ptr++)
-            {
-                line_start = t_read_width * (y_ptr + t_image_offset_y);
-
-                //std::cerr << "starting image row " << y_ptr
-                //     << ", write_ptr=" << write_ptr
-                //     << ", line_start=" << line_start
-                //     << ", read_ptr=" << (line_start+t_image_offset_x)*2 << std::endl;
-                for (x_ptr = 0; x_ptr < t_image_width; x_ptr++)
-                {
-                    read_ptr = (line_start + x_ptr + t_image_offset_x) * 2;
-
-                    msb = odd[read_ptr];
-                    lsb = odd[read_ptr + 1];
-
-                    framebuffer[write_ptr++] = msb;
-                    framebuffer[write_ptr++] = lsb;
-                }
-            }
-        }
-
-        if (log_commands)
-            std::cerr << "write_ptr=" << write_ptr << std::endl;
-
-        delete[] odd_data;
-
-        if (interlaced)
-            delete[] even_data;
+            copyFieldRows(even_data, true, 0, t_read_width, t_image_width, t_image_height, t_image_offset_x,
+                          t_image_offset_y);
+        copyFieldRows(odd_data, interlaced, 1, t_read_width, t_image_width, t_image_height, t_image_offset_x,
+                      t_image_offset_y);
 
         return framebuffer;
     }
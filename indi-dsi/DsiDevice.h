@@ -11,6 +11,7 @@
 #include <libusb-1.0/libusb.h>
 
 #include <string>
+#include <vector>
 
 #ifndef LONGEXP
 #define LONGEXP 20000
@@ -33,6 +34,15 @@ class Device
     /* image frame buffer (gs) */
     unsigned char *framebuffer;
 
+    /* storage behind framebuffer and the two readout fields, reused between frames */
+    std::vector<unsigned char> frame_buffer;
+    std::vector<unsigned char> even_buffer;
+    std::vector<unsigned char> odd_buffer;
+
+    void copyFieldRows(const unsigned char *field, bool interlaced, unsigned int parity, unsigned int t_read_width,
+                       unsigned int t_image_width, unsigned int t_image_height, unsigned int t_image_offset_x,
+                       unsigned int t_image_offset_y);
+
     /* These are chip-specific sizes required to parameterize the image
          * retrieval.
          */
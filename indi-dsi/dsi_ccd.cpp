@@ -504,7 +504,7 @@ void DSICCD::grabImage()
         }
     }
 
-    delete buf;
+    // buf is the camera's frame buffer, it is reused for the next frame
 
     // Let INDI::CCD know we're done filling the image buffer
     ExposureComplete(&PrimaryCCD);
@@ -34,6 +34,7 @@
 
 #include <indicontroller.h>
 
+#include <algorithm>
 #include <memory>
 #include <sys/stat.h>
 
@@ -92,183 +93,34 @@ void indiduino::TimerHit()
     if (isConnected() == false)
         return;
 
-    sf->OnIdle();
-
-    for (const auto &it: *getProperties())
+    // The firmata reader thread keeps pin_info current, only the pins that changed are dispatched
+    std::vector<pin_event_t> events;
+    std::vector<INumberVectorProperty *> changedNumbers;
+    sf->takePinEvents(events);
+    for (const auto &event : events)
     {
-        const char *name = it->getName();
-        INDI_PROPERTY_TYPE type = it->getType();
+        if (event.pin >= MAX_IO_PIN)
+            continue;
+        for (const auto &binding : pinBindings[event.pin])
+            applyPinEvent(binding, event.mode, event.value, changedNumbers);
+    }
+    // analog values are sent once per poll
+    for (auto nvp : changedNumbers)
+        IDSetNumber(nvp, nullptr);
 
-        //DIGITAL INPUT
-        if (type == INDI_LIGHT)
+    //TEXT
+    char text[MAX_STRING_DATA_LEN];
+    if (!textBindings.empty() && sf->takeStringData(text))
+    {
+        for (const auto &binding : textBindings)
         {
-            bool changed = false;
-            ILightVectorProperty *lvp = getLight(name);
-            if (lvp->aux != (void *)indiduino_id)
-                continue;
-
-            for (int i = 0; i < lvp->nlp; i++)
+            ITextVectorProperty *tvp = (ITextVectorProperty *)binding.vector;
+            IText *eqp               = (IText *)binding.element;
+            if (strcmp(eqp->text, text) != 0)
             {
-                ILight *lqp = &lvp->lp[i];
-                if (!lqp)
-                    return;
-
-                IO *pin_config = (IO *)lqp->aux;
-                if (pin_config == nullptr)
-                    continue;
-                if (pin_config->IOType == DI)
-                {
-                    int pin = pin_config->pin;
-                    if (sf->pin_info[pin].mode == FIRMATA_MODE_INPUT)
-                    {
-                        if ((sf->pin_info[pin].value == 1) && (lqp->s != IPS_OK))
-                        {
-                            //LOGF_DEBUG("%s.%s on pin %u change to  ON",lvp->name,lqp->name,pin);
-                            //IDSetLight (lvp, "%s.%s change to ON\n",lvp->name,lqp->name);
-                            lqp->s = IPS_OK;
-                            changed = true;
-
-                        }
-                        else if ((sf->pin_info[pin].value == 0) && (lqp->s != IPS_IDLE))
-                        {
-                            //LOGF_DEBUG("%s.%s on pin %u change to  OFF",lvp->name,lqp->name,pin);
-                            //IDSetLight (lvp, "%s.%s change to OFF\n",lvp->name,lqp->name);
-                            lqp->s = IPS_IDLE;
-                            changed = true;
-                        }
-                    }
-                }
-            }
-            if (changed) IDSetLight(lvp, nullptr);
-        }
-
-        //read back DIGITAL OUTPUT values as reported by the board (FIRMATA_PIN_STATE_RESPONSE)
-        if (type == INDI_SWITCH)
-        {
-            bool changed = false;
-            int n_on = 0;
-            ISwitchVectorProperty *svp = getSwitch(name);
-
-            if (svp->aux != (void *)indiduino_id)
-                continue;
-
-            for (int i = 0; i < svp->nsp; i++)
-            {
-                ISwitch *sqp = &svp->sp[i];
-                if (!sqp)
-                    return;
-
-                IO *pin_config = (IO *)sqp->aux;
-                if (pin_config == nullptr)
-                    continue;
-                if ((pin_config->IOType == DO) || (pin_config->IOType == DI))
-                {
-                    int pin = pin_config->pin;
-                    if ((sf->pin_info[pin].mode == FIRMATA_MODE_OUTPUT) || (sf->pin_info[pin].mode == FIRMATA_MODE_INPUT))
-                    {
-                        if (sf->pin_info[pin].value == 1)
-                        {
-                            changed = changed || (sqp->s != ISS_ON);
-                            sqp->s = ISS_ON;
-                            n_on++;
-                        }
-                        else
-                        {
-                            changed = changed || (sqp->s != ISS_OFF);
-                            sqp->s = ISS_OFF;
-                        }
-                    }
-                }
-            }
-            if (changed)
-            {
-                if (svp->r == ISR_1OFMANY) // make sure that 1 switch is on
-                {
-                    for (int i = 0; i < svp->nsp; i++)
-                    {
-                        ISwitch *sqp = &svp->sp[i];
-
-                        if ((IO *)sqp->aux != nullptr)
-                            continue;
-                        if (n_on > 0)
-                        {
-                            sqp->s = ISS_OFF;
-                        }
-                        else
-                        {
-                            sqp->s = ISS_ON;
-                            n_on++;
-                        }
-                    }
-                }
-                IDSetSwitch(svp, nullptr);
-            }
-        }
-
-        //ANALOG
-        if (type == INDI_NUMBER)
-        {
-            bool changed = false;
-            INumberVectorProperty *nvp = getNumber(name);
-
-            if (nvp->aux != (void *)indiduino_id)
-                continue;
-
-            for (int i = 0; i < nvp->nnp; i++)
-            {
-                INumber *eqp = &nvp->np[i];
-                if (!eqp)
-                    return;
-
-                IO *pin_config = (IO *)eqp->aux0;
-                if (pin_config == nullptr)
-                    continue;
-
-                if (pin_config->IOType == AI)
-                {
-                    int pin = pin_config->pin;
-                    if (sf->pin_info[pin].mode == FIRMATA_MODE_ANALOG)
-                    {
-                        double new_value = pin_config->MulScale * (double)(sf->pin_info[pin].value) + pin_config->AddScale;
-                        changed = changed || (eqp->value != new_value);
-                        eqp->value = new_value;
-                        //LOGF_DEBUG("%f",eqp->value);
-                    }
-                }
-                if (pin_config->IOType == AO) // read back ANALOG OUTPUT values as reported by the board (FIRMATA_PIN_STATE_RESPONSE)
-                {
-                    int pin = pin_config->pin;
-                    if (sf->pin_info[pin].mode == FIRMATA_MODE_PWM)
-                    {
-                        double new_value = ((double)(sf->pin_info[pin].value) - pin_config->AddScale) / pin_config->MulScale;
-                        changed = changed || (eqp->value != new_value);
-                        eqp->value = new_value;
-                        //LOGF_DEBUG("%f",eqp->value);
-                    }
-                }
-            }
-            if (changed) IDSetNumber(nvp, nullptr);
-        }
-
-        //TEXT
-        if (type == INDI_TEXT)
-        {
-            ITextVectorProperty *tvp = getText(name);
-            if (tvp->aux != (void *)indiduino_id)
-                continue;
-
-            for (int i=0;i<tvp->ntp;i++) {
-                IText *eqp = &tvp->tp[i];
-                if (!eqp)
-                    return;
-
-                if (eqp->aux0 == nullptr) continue;
-                if (strcmp(eqp->text, (char*)eqp->aux0) != 0)
-                {
-                    IUSaveText(eqp, (char*)eqp->aux0);
-                    //LOGF_DEBUG("%s.%s TEXT: %s ",tvp->name,eqp->name,eqp->text);
-                    IDSetText(tvp, nullptr);
-                }
+                IUSaveText(eqp, text);
+                //LOGF_DEBUG("%s.%s TEXT: %s ",tvp->name,eqp->name,eqp->text);
+                IDSetText(tvp, nullptr);
             }
         }
     }
@@ -311,6 +163,108 @@ void indiduino::TimerHit()
     SetTimer(getCurrentPollingPeriod());
 }
 
+void indiduino::applyPinEvent(const PinBinding &binding, uint8_t mode, uint64_t value,
+                              std::vector<INumberVectorProperty *> &changedNumbers)
+{
+    IO *pin_config = binding.config;
+
+    //DIGITAL INPUT
+    if (binding.type == INDI_LIGHT)
+    {
+        ILightVectorProperty *lvp = (ILightVectorProperty *)binding.vector;
+        ILight *lqp               = (ILight *)binding.element;
+
+        if ((pin_config->IOType != DI) || (mode != FIRMATA_MODE_INPUT))
+            return;
+        if ((value == 1) && (lqp->s != IPS_OK))
+            lqp->s = IPS_OK;
+        else if ((value == 0) && (lqp->s != IPS_IDLE))
+            lqp->s = IPS_IDLE;
+        else
+            return;
+        // digital changes are sent right away, so short pulses are not lost
+        IDSetLight(lvp, nullptr);
+    }
+
+    //read back DIGITAL OUTPUT values as reported by the board (FIRMATA_PIN_STATE_RESPONSE)
+    if (binding.type == INDI_SWITCH)
+    {
+        ISwitchVectorProperty *svp = (ISwitchVectorProperty *)binding.vector;
+        ISwitch *sqp               = (ISwitch *)binding.element;
+
+        if ((mode != FIRMATA_MODE_OUTPUT) && (mode != FIRMATA_MODE_INPUT))
+            return;
+        ISState state = (value == 1) ? ISS_ON : ISS_OFF;
+        if (sqp->s == state)
+            return;
+        sqp->s = state;
+
+        if (svp->r == ISR_1OFMANY) // make sure that 1 switch is on
+        {
+            int n_on = 0;
+            for (int i = 0; i < svp->nsp; i++)
+            {
+                if (((IO *)svp->sp[i].aux != nullptr) && (svp->sp[i].s == ISS_ON))
+                    n_on++;
+            }
+            for (int i = 0; i < svp->nsp; i++)
+            {
+                ISwitch *other = &svp->sp[i];
+
+                if ((IO *)other->aux != nullptr)
+                    continue;
+                if (n_on > 0)
+                {
+                    other->s = ISS_OFF;
+                }
+                else
+                {
+                    other->s = ISS_ON;
+                    n_on++;
+                }
+            }
+        }
+        IDSetSwitch(svp, nullptr);
+    }
+
+    //ANALOG
+    if (binding.type == INDI_NUMBER)
+    {
+        INumberVectorProperty *nvp = (INumberVectorProperty *)binding.vector;
+        INumber *eqp               = (INumber *)binding.element;
+        double new_value;
+
+        if ((pin_config->IOType == AI) && (mode == FIRMATA_MODE_ANALOG))
+            new_value = pin_config->MulScale * (double)value + pin_config->AddScale;
+        // read back ANALOG OUTPUT values as reported by the board (FIRMATA_PIN_STATE_RESPONSE)
+        else if ((pin_config->IOType == AO) && (mode == FIRMATA_MODE_PWM))
+            new_value = ((double)value - pin_config->AddScale) / pin_config->MulScale;
+        else
+            return;
+
+        if (eqp->value == new_value)
+            return;
+        eqp->value = new_value;
+        //LOGF_DEBUG("%f",eqp->value);
+        if (std::find(changedNumbers.begin(), changedNumbers.end(), nvp) == changedNumbers.end())
+            changedNumbers.push_back(nvp);
+    }
+}
+
+void indiduino::bindPin(INDI_PROPERTY_TYPE type, void *vector, void *element, IO *config)
+{
+    PinBinding binding;
+    binding.type    = type;
+    binding.vector  = vector;
+    binding.element = element;
+    binding.config  = config;
+
+    if (type == INDI_TEXT)
+        textBindings.push_back(binding);
+    else
+        pinBindings[config->pin].push_back(binding);
+}
+
 /**************************************************************************************
 ** Initialize all properties & set default values.
 **************************************************************************************/
@@ -426,7 +380,7 @@ bool indiduino::updateProperties()
             this->serialConnection->Disconnect();
             return false;
         }
-
+        sf->startReader();
 
         // Mapping the controller according to the properties previously read from the XML file
         // We only map controls for pin of type AO and SERVO
@@ -609,7 +563,7 @@ bool indiduino::ISNewSwitch(const char *dev, const char *name, ISState *states,
                 if (sf->writeDigitalPin(pin, ARDUINO_HIGH) == 0)
                 {
                     //IDSetSwitch(svp, "%s.%s ON", svp->name, sqp->name); Seems not to work anymore!
-                    sf->pin_info[pin].value = 1; // Set Standard Firmata record, so time loop can set correct switch state!
+                    sf->setPinValue(pin, 1); // Set Standard Firmata record, so the board read back matches the switch state!
                     svp->s = IPS_OK;
                 }
             }
@@ -619,7 +573,7 @@ bool indiduino::ISNewSwitch(const char *dev, const char *name, ISState *states,
                 if (sf->writeDigitalPin(pin, ARDUINO_LOW) ==0)
                 {
                     //IDSetSwitch(svp, "%s.%s OFF", svp->name, sqp->name); Seems not to work anymore!
-                    sf->pin_info[pin].value = 0; // Set Standard Firmata record, so time loop can set correct switch state!
+                    sf->setPinValue(pin, 0); // Set Standard Firmata record, so the board read back matches the switch state!
                     svp->s = IPS_OK;
                 }
             }
@@ -743,6 +697,10 @@ bool indiduino::setPinModesFromSKEL()
 
     LOG_INFO("Setting pins behaviour from <indiduino> tags");
 
+    for (auto &bindings : pinBindings)
+        bindings.clear();
+    textBindings.clear();
+
     for (const auto &it: *getProperties())
     {
         const char *name = it->getName();
@@ -789,6 +747,8 @@ bool indiduino::setPinModesFromSKEL()
                     iopin[numiopin].defVectorName = svp->name;
                     iopin[numiopin].defName       = sqp->name;
                     int pin                       = iopin[numiopin].pin;
+                    if ((iopin[numiopin].IOType == DO) || (iopin[numiopin].IOType == DI))
+                        bindPin(INDI_SWITCH, svp, sqp, &iopin[numiopin]);
                     if (iopin[numiopin].IOType == DO)
                     {
                         LOGF_DEBUG("%s.%s  pin %u set as DIGITAL OUTPUT", svp->name, sqp->name, pin);
@@ -839,6 +799,7 @@ bool indiduino::setPinModesFromSKEL()
                     }
                     tvp->aux                      = (void *)indiduino_id;
                     tqp->aux0                     = (void *)&sf->string_buffer;
+                    bindPin(INDI_TEXT, tvp, tqp, nullptr);
                     iopin[numiopin].defVectorName = tvp->name;
                     iopin[numiopin].defName       = tqp->name;
                     LOGF_DEBUG("%s.%s ARDUINO TEXT", tvp->name, tqp->name);
@@ -877,6 +838,7 @@ bool indiduino::setPinModesFromSKEL()
                     int pin                       = iopin[numiopin].pin;
                     LOGF_DEBUG("%s.%s  pin %u set as DIGITAL INPUT", lvp->name, lqp->name, pin);
                     sf->setPinMode(pin, FIRMATA_MODE_INPUT);
+                    bindPin(INDI_LIGHT, lvp, lqp, &iopin[numiopin]);
                     LOGF_DEBUG("numiopin:%u", numiopin);
                     numiopin++;
                 }
@@ -911,6 +873,8 @@ bool indiduino::setPinModesFromSKEL()
                     iopin[numiopin].defVectorName = nvp->name;
                     iopin[numiopin].defName       = eqp->name;
                     int pin                       = iopin[numiopin].pin;
+                    if ((iopin[numiopin].IOType == AO) || (iopin[numiopin].IOType == AI))
+                        bindPin(INDI_NUMBER, nvp, eqp, &iopin[numiopin]);
                     if (iopin[numiopin].IOType == AO)
                     {
                         LOGF_DEBUG("%s.%s  pin %u set as ANALOG OUTPUT", nvp->name, eqp->name, pin);
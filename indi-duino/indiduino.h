@@ -26,6 +26,8 @@
 
 #include <defaultdevice.h>
 
+#include <vector>
+
 namespace Connection
 {
 class Serial;
@@ -58,6 +60,16 @@ typedef struct
     char *defVectorName;
 } IO;
 
+/* Property element fed by a pin, so pin changes are
+   dispatched without scanning every property */
+typedef struct
+{
+    INDI_PROPERTY_TYPE type;
+    void *vector;
+    void *element;
+    IO *config;
+} PinBinding;
+
 class indiduino : public INDI::DefaultDevice
 {
   public:
@@ -97,8 +109,13 @@ class indiduino : public INDI::DefaultDevice
     bool Handshake();
     char skelFileName[MAX_SKELTON_FILE_NAME_LEN];
     IO iopin[MAX_IO_PIN];
+    std::vector<PinBinding> pinBindings[MAX_IO_PIN];
+    std::vector<PinBinding> textBindings;
 
     bool setPinModesFromSKEL();
+    void bindPin(INDI_PROPERTY_TYPE type, void *vector, void *element, IO *config);
+    void applyPinEvent(const PinBinding &binding, uint8_t mode, uint64_t value,
+                       std::vector<INumberVectorProperty *> &changedNumbers);
     bool readInduinoXml(XMLEle *ioep, int npin);
     Firmata *sf;
     INDI::Controller *controller;
@@ -44,6 +44,7 @@ Firmata::Firmata(int fd)
 
 Firmata::~Firmata()
 {
+    stopReader();
     delete arduino;
 }
 
@@ -76,14 +77,18 @@ int Firmata::writeDigitalPin(unsigned char pin, unsigned char mode)
 {
     int rv = 0;
     int port;
+    uint8_t port_val;
 
-    port = updateDigitalPort(pin, mode);
-
-    if (port < 0) return port;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        port = updateDigitalPort(pin, mode);
+        if (port < 0) return port;
+        port_val = digitalPortValue[port];
+    }
 
     rv |= arduino->sendUchar(FIRMATA_DIGITAL_MESSAGE + port);
-    rv |= sendValueAsTwo7bitBytes(digitalPortValue[port]); //ARDUINO_HIGH OR ARDUINO_LOW
-    LOGF_DEBUG("Sending DIGITAL_MESSAGE pin:%d, mode:%d, port:%d, port_val:%02X", pin, mode, port, digitalPortValue[port]);
+    rv |= sendValueAsTwo7bitBytes(port_val); //ARDUINO_HIGH OR ARDUINO_LOW
+    LOGF_DEBUG("Sending DIGITAL_MESSAGE pin:%d, mode:%d, port:%d, port_val:%02X", pin, mode, port, port_val);
     return (rv);
 }
 
@@ -262,12 +267,16 @@ int Firmata::sendStringData(char *data)
 int Firmata::askPinStateWaitForReply(int pin)
 {
     OnIdle();
-    pin_info[pin].mode = 0xff;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        pin_info[pin].mode = 0xff;
+    }
     for (int i = 0; i < 100; i++) { // 1s
         if (i % 10 == 0) askPinState(pin); // try again every 0.1 second
         OnIdle(); // 10ms
-        if (pin_info[pin].mode != 0xff) break;
+        if (pinMode(pin) != 0xff) break;
     }
+    std::lock_guard<std::mutex> lock(state_mutex);
     if (pin_info[pin].mode == 0xff) {
         pin_info[pin].mode = FIRMATA_MODE_INPUT;
         return -1;
@@ -275,6 +284,18 @@ int Firmata::askPinStateWaitForReply(int pin)
     return 0;
 }
 
+uint8_t Firmata::pinMode(int pin)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return pin_info[pin].mode;
+}
+
+void Firmata::setPinValue(int pin, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    pin_info[pin].value = value;
+}
+
 int Firmata::init(const char *_serialPort, uint32_t baud)
 {
     arduino  = new Arduino();
@@ -408,7 +429,11 @@ void Firmata::DoMessage(void)
         {
             if (pin_info[pin].analog_channel == analog_ch)
             {
-                pin_info[pin].value = analog_val;
+                if (pin_info[pin].value != (uint64_t)analog_val)
+                {
+                    pin_info[pin].value = analog_val;
+                    pinChanged(pin);
+                }
                 LOGF_DEBUG("ANALOG_MESSAGE: pin %d is A%d = %d", pin, analog_ch, analog_val);
                 return;
             }
@@ -430,6 +455,7 @@ void Firmata::DoMessage(void)
                 {
                     LOGF_DEBUG("pin %d is %d", pin, val);
                     pin_info[pin].value = val;
+                    pinChanged(pin);
                 }
             }
         }
@@ -516,6 +542,7 @@ void Firmata::DoMessage(void)
             LOGF_DEBUG("PIN_STATE_RESPONSE: pin:%u. Mode:%u. Value:%llu", pin, pin_info[pin].mode, static_cast<unsigned long long>(pin_info[pin].value));
             if (pin_info[pin].mode == FIRMATA_MODE_OUTPUT)
                 updateDigitalPort(pin, pin_info[pin].value ? ARDUINO_HIGH : ARDUINO_LOW);
+            pinChanged(pin);
         }
         else if (parse_buf[1] == FIRMATA_STRING_DATA)
         {
@@ -533,6 +560,7 @@ void Firmata::DoMessage(void)
             }
             name[len++] = 0;
             strcpy(string_buffer, name);
+            string_changed = true;
             LOGF_DEBUG("STRING_DATA: %s", name);
         }
         else if (parse_buf[1] == FIRMATA_EXTENDED_ANALOG)
@@ -549,7 +577,11 @@ void Firmata::DoMessage(void)
             {
                 if (pin_info[pin].analog_channel == analog_ch)
                 {
-                    pin_info[pin].value = analog_val;
+                    if (pin_info[pin].value != analog_val)
+                    {
+                        pin_info[pin].value = analog_val;
+                        pinChanged(pin);
+                    }
                     LOGF_DEBUG("EXTENDED_ANALOG: pin %d is A%d = %lu", pin, analog_ch, analog_val);
                     break;
                 }
@@ -573,45 +605,105 @@ void Firmata::DoMessage(void)
     }
 }
 
+void Firmata::pinChanged(int pin)
+{
+    pin_event_t event;
+    event.pin   = pin;
+    event.mode  = pin_info[pin].mode;
+    event.value = pin_info[pin].value;
+    pin_events.push_back(event);
+    if (pin_events.size() > MAX_PIN_EVENTS)
+        pin_events.pop_front();
+}
+
 int Firmata::OnIdle()
 {
     uint8_t buf[1024];
-    int r = 1;
+    int r;
 
-    //if (debug) LOGF_DEBUG("Idle event");
-    if (r > 0)
+    if (reader_running)
     {
-        r = arduino->readPort(buf, sizeof(buf));
-        if (r < 0)
-        {
-            // error
-            return r;
-        }
-        if (r > 0)
-        {
-/*
-            for (int i = 0; i < r; i++)
-            {
-                if (debug)
-                    printf("%02X ", buf[i]);
-            }
-            if (debug)
-                printf("\n");
-*/
-            Parse(buf, r);
-            return 0;
-        }
+        // the reader thread parses the port, give it up to 10ms to get something
+        std::unique_lock<std::mutex> lock(state_mutex);
+        message_cv.wait_for(lock, std::chrono::milliseconds(10));
+        return reader_error;
     }
-    else if (r < 0)
+
+    r = arduino->readPort(buf, sizeof(buf));
+    if (r < 0)
     {
+        // error
         return r;
     }
+    if (r > 0)
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        Parse(buf, r);
+    }
     return 0;
 }
 
+int Firmata::startReader()
+{
+    if (reader_running)
+        return 0;
+
+    // pin events queued while setting up are kept, they give the caller the initial state
+    reader_error = 0;
+    reader_running = true;
+    reader = std::thread(&Firmata::readerLoop, this);
+    LOG_DEBUG("Reader thread started");
+    return 0;
+}
+
+void Firmata::stopReader()
+{
+    reader_running = false;
+    if (reader.joinable())
+        reader.join();
+}
+
+void Firmata::readerLoop()
+{
+    uint8_t buf[1024];
+
+    while (reader_running)
+    {
+        // waits up to 10ms for data
+        int r = arduino->readPort(buf, sizeof(buf));
+        std::unique_lock<std::mutex> lock(state_mutex);
+        reader_error = r < 0 ? r : 0;
+        if (r > 0)
+            Parse(buf, r);
+        lock.unlock();
+        message_cv.notify_all();
+
+        if (r < 0)
+            usleep(10000); // don't spin on a dead port, the driver notices the missing keepalive replies
+    }
+}
+
+void Firmata::takePinEvents(std::vector<pin_event_t> &events)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    events.assign(pin_events.begin(), pin_events.end());
+    pin_events.clear();
+}
+
+bool Firmata::takeStringData(char *text)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (!string_changed)
+        return false;
+    strcpy(text, string_buffer);
+    string_changed = false;
+    return true;
+}
+
 time_t Firmata::secondsSinceVersionReply()
 {
     time_t now;
     time(&now);
+    std::lock_guard<std::mutex> lock(state_mutex);
     return now - version_reply_time;
 }
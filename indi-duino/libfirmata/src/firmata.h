@@ -12,6 +12,12 @@
 */
 
 #include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <stdint.h>
 #include <arduino.h>
 
@@ -73,6 +79,7 @@
 #define FIRMATA_I2C_10BIT_ADDRESS_MODE_MASK B00100000
 
 #define MAX_STRING_DATA_LEN 164
+#define MAX_PIN_EVENTS      4096 // oldest pin events are dropped if nobody takes them
 
 using namespace std;
 
@@ -86,6 +93,14 @@ typedef struct
     uint64_t value;
 } pin_t;
 
+// a pin whose mode or value changed, as reported by the board
+typedef struct
+{
+    uint8_t pin;
+    uint8_t mode;
+    uint64_t value;
+} pin_event_t;
+
 class Firmata
 {
   public:
@@ -113,6 +128,14 @@ class Firmata
     int askPinStateWaitForReply(int pin);
     int initState();
     time_t secondsSinceVersionReply();
+    // The reader thread parses the port continuously, OnIdle() then only waits for it.
+    int startReader();
+    void stopReader();
+    // Moves the pin changes seen since the last call, in arrival order, into events.
+    void takePinEvents(std::vector<pin_event_t> &events);
+    // Copies string data received since the last call into text, returns false if there was none.
+    bool takeStringData(char *text);
+    void setPinValue(int pin, uint64_t value);
     pin_t pin_info[128];
     void print_state();
     char firmata_name[140];
@@ -126,10 +149,22 @@ class Firmata
     uint8_t parse_buf[4096];
     void Parse(const uint8_t *buf, int len);
     void DoMessage(void);
+    void pinChanged(int pin);
+    uint8_t pinMode(int pin);
+    void readerLoop();
     int have_analog_mapping { 0 };
     int have_capabilities { 0 };
     time_t version_reply_time { 0 };
 
+    // state_mutex guards the parser and everything it updates
+    std::mutex state_mutex;
+    std::condition_variable message_cv;
+    std::thread reader;
+    std::atomic<bool> reader_running { false };
+    int reader_error { 0 };
+    std::deque<pin_event_t> pin_events;
+    bool string_changed { false };
+
   protected:
     Arduino *arduino;
 
@@ -0,0 +1,146 @@
+/* Copyright 2012 Geehalel (geehalel AT gmail DOT com) */
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pointindex.h"
+
+#include <algorithm>
+
+static bool fartherFirst(const std::pair<double, HtmID> &a, const std::pair<double, HtmID> &b)
+{
+    return a.first < b.first;
+}
+
+PointIndex::PointIndex()
+{
+    root = -1;
+}
+
+void PointIndex::Reset()
+{
+    nodes.clear();
+    root = -1;
+}
+
+size_t PointIndex::size()
+{
+    return nodes.size();
+}
+
+void PointIndex::Insert(HtmID id, double x, double y, double z)
+{
+    Node n;
+    n.p[0]  = x;
+    n.p[1]  = y;
+    n.p[2]  = z;
+    n.id    = id;
+    n.left  = -1;
+    n.right = -1;
+    n.axis  = 0;
+    nodes.push_back(n);
+    int inserted = nodes.size() - 1;
+
+    if (root < 0)
+    {
+        root = inserted;
+        return;
+    }
+
+    int depth = 1;
+    int cur   = root;
+    while (true)
+    {
+        Node &c    = nodes[cur];
+        int &child = (n.p[c.axis] < c.p[c.axis]) ? c.left : c.right;
+        if (child < 0)
+        {
+            child                = inserted;
+            nodes[inserted].axis = (c.axis + 1) % 3;
+            break;
+        }
+        cur = child;
+        depth++;
+    }
+
+    // Sync points from pointing runs come in sky order which degenerates the tree,
+    // keep the depth within twice the balanced one.
+    int balanced = 1;
+    while ((1u << balanced) <= nodes.size())
+        balanced++;
+    if (depth > 2 * balanced + 2)
+        Rebuild();
+}
+
+int PointIndex::Build(int begin, int end, int depth)
+{
+    if (begin >= end)
+        return -1;
+    int axis = depth % 3;
+    int mid  = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [this, axis](int a, int b) { return nodes[a].p[axis] < nodes[b].p[axis]; });
+    Node &n = nodes[order[mid]];
+    n.axis  = axis;
+    n.left  = Build(begin, mid, depth + 1);
+    n.right = Build(mid + 1, end, depth + 1);
+    return order[mid];
+}
+
+void PointIndex::Rebuild()
+{
+    order.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+        order[i] = i;
+    root = Build(0, nodes.size(), 0);
+}
+
+void PointIndex::Search(int node, const double *q, size_t k, std::vector<std::pair<double, HtmID>> &heap)
+{
+    if (node < 0)
+        return;
+    const Node &n = nodes[node];
+    double dx = q[0] - n.p[0], dy = q[1] - n.p[1], dz = q[2] - n.p[2];
+    double d  = dx * dx + dy * dy + dz * dz;
+    if (heap.size() < k)
+    {
+        heap.push_back(std::make_pair(d, n.id));
+        std::push_heap(heap.begin(), heap.end(), fartherFirst);
+    }
+    else if (d < heap.front().first)
+    {
+        std::pop_heap(heap.begin(), heap.end(), fartherFirst);
+        heap.back() = std::make_pair(d, n.id);
+        std::push_heap(heap.begin(), heap.end(), fartherFirst);
+    }
+
+    // Points equal on the split axis go right when inserted, so ties also descend right first.
+    double delta = q[n.axis] - n.p[n.axis];
+    int nearside = (delta < 0) ? n.left : n.right;
+    int farside  = (delta < 0) ? n.right : n.left;
+    Search(nearside, q, k, heap);
+    if (heap.size() < k || delta * delta < heap.front().first)
+        Search(farside, q, k, heap);
+}
+
+void PointIndex::Nearest(double x, double y, double z, size_t k, std::vector<std::pair<double, HtmID>> &result)
+{
+    double q[3] = { x, y, z };
+    result.clear();
+    if (k == 0)
+        return;
+    Search(root, q, k, result);
+    std::sort_heap(result.begin(), result.end(), fartherFirst);
+}
@@ -0,0 +1,54 @@
+/* Copyright 2012 Geehalel (geehalel AT gmail DOT com) */
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "htm.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/* k-d tree over the unit vectors of the sync points, answers nearest point queries
+   without scanning the whole point set. Points are inserted one at a time as they are
+   synced, the tree is rebuilt balanced when the insertion order made it too deep. */
+class PointIndex
+{
+    public:
+        PointIndex();
+        void Reset();
+        void Insert(HtmID id, double x, double y, double z);
+        /* Fills result with at most k (squared chord distance, id) pairs, nearest first.
+           The vector is cleared first, its storage is reused between calls. */
+        void Nearest(double x, double y, double z, size_t k, std::vector<std::pair<double, HtmID>> &result);
+        size_t size();
+
+    private:
+        typedef struct Node
+        {
+            double p[3];
+            HtmID id;
+            int left, right;
+            int axis;
+        } Node;
+        void Search(int node, const double *q, size_t k, std::vector<std::pair<double, HtmID>> &heap);
+        int Build(int begin, int end, int depth);
+        void Rebuild();
+        std::vector<Node> nodes;
+        std::vector<int> order;
+        int root;
+};
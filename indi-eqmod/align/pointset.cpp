@@ -111,11 +111,6 @@ double sphere_unit_distance(double theta1, double theta2, double phi1, double ph
                       (sqrt_haversin_long * sqrt_haversin_long))));
 }
 
-bool compelt(PointSet::Distance d1, PointSet::Distance d2)
-{
-    return d1.value < d2.value;
-}
-
 PointSet::PointSet(INDI::Telescope *t)
 {
     telescope  = t;
@@ -128,35 +123,27 @@ const char *PointSet::getDeviceName()
     return telescope->getDeviceName();
 }
 
-std::set<PointSet::Distance, bool (*)(PointSet::Distance, PointSet::Distance)> *
-PointSet::ComputeDistances(double alt, double az, PointFilter filter, bool ingoto)
+const std::vector<PointSet::Distance> &PointSet::ComputeDistances(double alt, double az, PointFilter filter,
+        bool ingoto, size_t count)
 {
     INDI_UNUSED(filter);
-    std::map<HtmID, Point>::iterator it;
-    std::set<Distance, bool (*)(Distance, Distance)> *distances =
-        new std::set<Distance, bool (*)(Distance, Distance)>(compelt);
-    std::set<Distance>::iterator distit;
-    std::pair<std::set<Distance>::iterator, bool> ret;
-    /* IDLog("Compute distances for point alt=%f az=%f\n", alt, az);*/
-    for (it = PointSetMap->begin(); it != PointSetMap->end(); it++)
+    double horangle = range360(-180.0 - az) * M_PI / 180.0;
+    double altangle = alt * M_PI / 180.0;
+    PointIndex &index = ingoto ? celestialIndex : telescopeIndex;
+    index.Nearest(cos(altangle) * cos(horangle), cos(altangle) * sin(horangle), sin(altangle), count, nearest);
+    /* chord length orders points like the great circle distance, only compute the latter for the result */
+    distances.clear();
+    for (size_t i = 0; i < nearest.size(); i++)
     {
-        double d;
+        Point &p = PointSetMap->at(nearest[i].second);
+        Distance elt;
+        elt.htmID = nearest[i].second;
         if (ingoto)
-            d = sphere_unit_distance(az, (*it).second.celestialAZ, alt, (*it).second.celestialALT);
+            elt.value = sphere_unit_distance(az, p.celestialAZ, alt, p.celestialALT);
         else
-            d = sphere_unit_distance(az, (*it).second.telescopeAZ, alt, (*it).second.telescopeALT);
-        Distance elt;
-        elt.htmID = (*it).first;
-        elt.value = d;
-        ret       = distances->insert(elt);
-        /*IDLog("  Point %lld (alt=%f az=%f): distance %f \n",  elt.htmID, (*it).second.celestialALT, (*it).second.celestialAZ, elt.value);*/
-    }
-    /*
-    IDLog("  Ordered distances for point alt=%f az=%f\n", alt, az);
-    for ( distit=distances->begin() ; distit != distances->end(); distit++ ) {
-    IDLog("  Point %lld: distance %f \n",  distit->htmID, distit->value);
+            elt.value = sphere_unit_distance(az, p.telescopeAZ, alt, p.telescopeALT);
+        distances.push_back(elt);
     }
-    */
     return distances;
 }
 
@@ -196,11 +183,18 @@ void PointSet::AddPoint(AlignData aligndata, INDI::IGeographicCoordinates *pos)
     point.htmID = cc_radec2ID(point.celestialAZ, point.celestialALT, 19);
     cc_ID2name(point.htmname, point.htmID);
     point.index = getNbPoints();
-    PointSetMap->insert(std::pair<HtmID, Point>(point.htmID, point));
+    if (PointSetMap->insert(std::pair<HtmID, Point>(point.htmID, point)).second)
+    {
+        celestialIndex.Insert(point.htmID, point.cx, point.cy, point.cz);
+        telescopeIndex.Insert(point.htmID, point.tx, point.ty, point.tz);
+    }
     Triangulation->AddPoint(point.htmID);
+    IndexFaces();
+    // the cached face may not belong to the new triangulation
+    current.clear();
     LOGF_INFO("Align Pointset: added point %d alt = %g az = %g\n", point.index,
               point.celestialALT, point.celestialAZ);
-    LOGF_INFO("Align Triangulate: number of faces is %d\n", Triangulation->getFaces().size());
+    LOGF_INFO("Align Triangulate: number of faces is %d\n", faces.size());
 }
 
 PointSet::Point *PointSet::getPoint(HtmID htmid)
@@ -215,7 +209,34 @@ int PointSet::getNbPoints()
 
 int PointSet::getNbTriangles()
 {
-    return Triangulation->getFaces().size();
+    return faces.size();
+}
+
+void PointSet::IndexFaces()
+{
+    std::map<std::pair<HtmID, HtmID>, int> openedges;
+    faces = Triangulation->getFaces();
+    faceNeighbours.assign(3 * faces.size(), -1);
+    vertexFace.clear();
+    /* hull faces are consistently oriented, so a shared edge shows up reversed in the neighbour face */
+    for (size_t f = 0; f < faces.size(); f++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            HtmID a = faces[f]->v[i];
+            HtmID b = faces[f]->v[(i + 1) % 3];
+            vertexFace[a] = f;
+            std::map<std::pair<HtmID, HtmID>, int>::iterator it = openedges.find(std::make_pair(b, a));
+            if (it != openedges.end())
+            {
+                faceNeighbours[3 * f + i]  = it->second / 3;
+                faceNeighbours[it->second] = f;
+                openedges.erase(it);
+            }
+            else
+                openedges[std::make_pair(a, b)] = 3 * f + i;
+        }
+    }
 }
 
 bool PointSet::isInitialized()
@@ -247,6 +268,11 @@ void PointSet::Reset()
     if (lnalignpos)
         free(lnalignpos);
     lnalignpos = nullptr;
+    celestialIndex.Reset();
+    telescopeIndex.Reset();
+    faces.clear();
+    faceNeighbours.clear();
+    vertexFace.clear();
     Triangulation->Reset();
 }
 
@@ -315,6 +341,8 @@ char *PointSet::LoadDataFile(const char *filename)
     lnalignpos->longitude = lon;
     lnalignpos->latitude = lat;
     PointSetMap->clear();
+    celestialIndex.Reset();
+    telescopeIndex.Reset();
     alignxml     = nextXMLEle(sitexml, 1);
     aligndata.jd = -1.0;
     while (alignxml)
@@ -484,7 +512,17 @@ double PointSet::scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto
     return res;
 }
 
-bool PointSet::isPointInside(Point *p, std::vector<HtmID> f, bool ingoto)
+double PointSet::orientation(Point *a, Point *b, Point *c, bool ingoto)
+{
+    if (ingoto)
+        return a->cx * (b->cy * c->cz - b->cz * c->cy) + a->cy * (b->cz * c->cx - b->cx * c->cz) +
+               a->cz * (b->cx * c->cy - b->cy * c->cx);
+    else
+        return a->tx * (b->ty * c->tz - b->tz * c->ty) + a->ty * (b->tz * c->tx - b->tx * c->tz) +
+               a->tz * (b->tx * c->ty - b->ty * c->tx);
+}
+
+bool PointSet::isPointInside(Point *p, const std::vector<HtmID> &f, bool ingoto)
 {
     double r;
     bool left  = false;
@@ -520,8 +558,6 @@ std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, doubl
     INDI_UNUSED(pointaz);
     Point point;
     double horangle = 0, altangle = 0;
-    std::vector<Face *> faces;
-    std::vector<Face *>::iterator it;
 
     point.aligndata.jd        = jd;
     point.aligndata.targetRA  = currentRA;
@@ -537,22 +573,85 @@ std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, doubl
 
     if (Triangulation->isValid() && isPointInside(&point, current, ingoto))
         return current;
-    faces = Triangulation->getFaces();
-    it    = faces.begin();
-    while (it < faces.end())
+
+    int found = -1;
+    if (!faces.empty())
     {
-        if (isPointInside(&point, (*it)->v, ingoto))
+        /* start from a face around the nearest sync point and walk towards the point */
+        int start = 0;
+        (ingoto ? celestialIndex : telescopeIndex).Nearest(point.cx, point.cy, point.cz, 1, nearest);
+        if (!nearest.empty())
+        {
+            std::unordered_map<HtmID, int>::iterator vf = vertexFace.find(nearest[0].second);
+            if (vf != vertexFace.end())
+                start = vf->second;
+        }
+        found = WalkToFace(&point, start, ingoto);
+        /* the walk may loop when the telescope coordinates fold the triangulation, scan all faces then */
+        if (found == -2)
         {
-            currentFace = *it;
-            current     = (*it)->v;
-            LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
-                      PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
-            return current;
+            found = -1;
+            for (size_t f = 0; f < faces.size(); f++)
+            {
+                if (isPointInside(&point, faces[f]->v, ingoto))
+                {
+                    found = f;
+                    break;
+                }
+            }
         }
-        it++;
+    }
+    if (found >= 0)
+    {
+        currentFace = faces[found];
+        current     = faces[found]->v;
+        LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
+                  PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
+        return current;
     }
     if (current.size() > 0)
         LOG_INFO("Align: current face is empty");
     current.clear();
     return current;
 }
+
+/* Visibility walk: cross the edge the point lies beyond until the face contains it.
+   Returns the face index, -1 when the walk leaves the triangulated area, -2 when it gave up. */
+int PointSet::WalkToFace(Point *p, int start, bool ingoto)
+{
+    int cur = start;
+    for (size_t steps = 0; steps <= faces.size(); steps++)
+    {
+        const std::vector<HtmID> &v = faces[cur]->v;
+        Point *vp[3] = { &PointSetMap->at(v[0]), &PointSetMap->at(v[1]), &PointSetMap->at(v[2]) };
+        double s     = orientation(vp[0], vp[1], vp[2], ingoto);
+        double r[3];
+        bool left = false, right = false;
+        for (int i = 0; i < 3; i++)
+        {
+            r[i] = scalarTripleProduct(p, vp[i], vp[(i + 1) % 3], ingoto);
+            if (r[i] < 0)
+                left = true;
+            else
+                right = true;
+        }
+        if (!(left && right))
+            return cur;
+        int edge     = -1;
+        double worst = 0.0;
+        for (int i = 0; i < 3; i++)
+        {
+            if (r[i] * s < worst)
+            {
+                worst = r[i] * s;
+                edge  = i;
+            }
+        }
+        if (edge < 0)
+            return -2;
+        cur = faceNeighbours[3 * cur + edge];
+        if (cur < 0)
+            return -1;
+    }
+    return -2;
+}
@@ -18,9 +18,11 @@
 #pragma once
 
 #include "htm.h"
+#include "pointindex.h"
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 // to get access to lat/long data
@@ -72,8 +74,9 @@ class PointSet
         void setBlobData(IBLOBVectorProperty *bp);
         void setPointBlobData(IBLOB *blob);
         void setTriangulationBlobData(IBLOB *blob);
-        std::set<Distance, bool (*)(Distance, Distance)> *ComputeDistances(double alt, double az, PointFilter filter,
-                bool ingoto);
+        /* The count sync points nearest to alt/az, nearest first. The returned vector is reused by the next call. */
+        const std::vector<Distance> &ComputeDistances(double alt, double az, PointFilter filter, bool ingoto,
+                size_t count = 1);
         std::vector<HtmID> findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
                                     INDI::IGeographicCoordinates *position, bool ingoto);
         double lat, lon, alt;
@@ -81,16 +84,27 @@ class PointSet
         void AltAzFromRaDecSidereal(double ra, double dec, double lst, double *alt, double *az, INDI::IGeographicCoordinates *pos);
         void RaDecFromAltAz(double alt, double az, double jd, double *ra, double *dec, INDI::IGeographicCoordinates *pos);
         double scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto);
-        bool isPointInside(Point *p, std::vector<HtmID> f, bool ingoto);
+        bool isPointInside(Point *p, const std::vector<HtmID> &f, bool ingoto);
 
     protected:
     private:
+        void IndexFaces();
+        int WalkToFace(Point *p, int start, bool ingoto);
+        double orientation(Point *a, Point *b, Point *c, bool ingoto);
         XMLEle *PointSetXmlRoot;
         std::map<HtmID, Point> *PointSetMap;
         bool PointSetInitialized;
         TriangulateCHull *Triangulation;
         Face *currentFace;
         std::vector<HtmID> current;
+        // spatial index of the sync points, one per coordinate set
+        PointIndex celestialIndex, telescopeIndex;
+        std::vector<std::pair<double, HtmID>> nearest;
+        std::vector<Distance> distances;
+        // faces of the triangulation with, for each edge (v[i], v[i+1]), the face across it or -1
+        std::vector<Face *> faces;
+        std::vector<int> faceNeighbours;
+        std::unordered_map<HtmID, int> vertexFace;
         // to get access to lat/long data
         INDI::Telescope *telescope;
         // from align data file
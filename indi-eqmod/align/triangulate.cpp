@@ -26,6 +26,8 @@ void Triangulate::Reset()
 {
     isvalid = false;
     vvertices.clear();
+    for (size_t i = 0; i < vfaces.size(); i++)
+        delete vfaces[i];
     vfaces.clear();
 }
 
@@ -79,6 +79,8 @@ void TriangulateCHull::AddPoint(HtmID id)
         AddOne(v);
         CleanUp(&vnext);
     }
+    for (size_t i = 0; i < vfaces.size(); i++)
+        delete vfaces[i];
     vfaces.clear();
     f = faces;
     do
@@ -819,6 +819,8 @@ bool EQMod::ReadScopeStatus()
     try
     {
         TelescopePierSide pierSide;
+        // Encoders and motor statuses in one round trip, consumed by the getters below
+        mount->ReadStatus();
         currentRAEncoder = mount->GetRAEncoder();
         currentDEEncoder = mount->GetDEEncoder();
         DEBUGF(DBG_SCOPE_STATUS, "Current encoders RA=%ld DE=%ld", static_cast<long>(currentRAEncoder),
@@ -22,6 +22,10 @@
 #include <indicom.h>
 
 #include <termios.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 
@@ -37,6 +41,7 @@ Skywatcher::Skywatcher(EQMod *t)
 Skywatcher::~Skywatcher(void)
 {
     Disconnect();
+    stop_reader();
 }
 
 void Skywatcher::setDebug(bool enable)
@@ -50,6 +55,8 @@ bool Skywatcher::isDebug()
 
 void Skywatcher::setPortFD(int value)
 {
+    if (value != PortFD)
+        stop_reader();
     PortFD = value;
 }
 
@@ -75,6 +82,12 @@ bool Skywatcher::Handshake()
     {
         telescope->simulator->Connect();
     }
+    else
+    {
+        start_reader();
+    }
+    polledPosition[Axis1] = polledPosition[Axis2] = false;
+    polledStatus[Axis1] = polledStatus[Axis2] = false;
 
     uint32_t tmpMCVersion = 0;
 
@@ -97,9 +110,13 @@ bool Skywatcher::Handshake()
 bool Skywatcher::Disconnect()
 {
     if (PortFD < 0)
+    {
+        stop_reader();
         return true;
+    }
     StopMotor(Axis1);
     StopMotor(Axis2);
+    stop_reader();
     // Deactivate motor (for geehalel mount only)
     /*
     if (MountCode == 0xF0) {
@@ -112,16 +129,14 @@ bool Skywatcher::Disconnect()
 
 uint32_t Skywatcher::GetRAEncoder()
 {
-    // Axis Position
-    dispatch_command(GetAxisPosition, Axis1, nullptr);
-
-    uint32_t steps = Revu24str2long(response + 1);
-    if (steps & 0x80000000)
-        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, response);
+    // Axis Position, already read by ReadStatus if polled
+    if (polledPosition[Axis1])
+        polledPosition[Axis1] = false;
     else
-        RAStep = steps;
-
-    gettimeofday(&lastreadmotorposition[Axis1], nullptr);
+    {
+        dispatch_command(GetAxisPosition, Axis1, nullptr);
+        ParseEncoder(Axis1, response);
+    }
     if (RAStep != lastRAStep)
     {
         DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = %ld", __FUNCTION__, static_cast<long>(RAStep));
@@ -132,15 +147,14 @@ uint32_t Skywatcher::GetRAEncoder()
 
 uint32_t Skywatcher::GetDEEncoder()
 {
-    // Axis Position
-    dispatch_command(GetAxisPosition, Axis2, nullptr);
-
-    uint32_t steps = Revu24str2long(response + 1);
-    if (steps & 0x80000000)
-        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, response);
+    // Axis Position, already read by ReadStatus if polled
+    if (polledPosition[Axis2])
+        polledPosition[Axis2] = false;
     else
-        DEStep = steps;
-    gettimeofday(&lastreadmotorposition[Axis2], nullptr);
+    {
+        dispatch_command(GetAxisPosition, Axis2, nullptr);
+        ParseEncoder(Axis2, response);
+    }
     if (DEStep != lastDEStep)
     {
         DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = %ld", __FUNCTION__, static_cast<long>(DEStep));
@@ -149,6 +163,35 @@ uint32_t Skywatcher::GetDEEncoder()
     return DEStep;
 }
 
+void Skywatcher::ParseEncoder(SkywatcherAxis axis, char *reply)
+{
+    uint32_t steps = Revu24str2long(reply + 1);
+    if (steps & 0x80000000)
+        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, reply);
+    else if (axis == Axis1)
+        RAStep = steps;
+    else
+        DEStep = steps;
+    gettimeofday(&lastreadmotorposition[axis], nullptr);
+}
+
+void Skywatcher::ReadStatus()
+{
+    // Send the four queries back to back so a slow link only costs one round trip
+    static const SkywatcherCommand cmds[4] = { GetAxisPosition, GetAxisPosition, GetAxisStatus, GetAxisStatus };
+    static const SkywatcherAxis axes[4]    = { Axis1, Axis2, Axis1, Axis2 };
+    char replies[4][SKYWATCHER_MAX_CMD];
+
+    dispatch_batch(4, cmds, axes, replies);
+
+    ParseEncoder(Axis1, replies[0]);
+    ParseEncoder(Axis2, replies[1]);
+    ParseMotorStatus(Axis1, replies[2]);
+    ParseMotorStatus(Axis2, replies[3]);
+    polledPosition[Axis1] = polledPosition[Axis2] = true;
+    polledStatus[Axis1] = polledStatus[Axis2] = true;
+}
+
 uint32_t Skywatcher::GetRAEncoderZero()
 {
     LOGF_DEBUG("%s() = %ld", __FUNCTION__, static_cast<long>(RAStepInit));
@@ -223,7 +266,10 @@ uint32_t Skywatcher::GetlastreadDEIndexer()
 
 void Skywatcher::GetRAMotorStatus(ILightVectorProperty *motorLP)
 {
-    ReadMotorStatus(Axis1);
+    if (polledStatus[Axis1])
+        polledStatus[Axis1] = false;
+    else
+        ReadMotorStatus(Axis1);
     if (!RAInitialized)
     {
         IUFindLight(motorLP, "RAInitialized")->s = IPS_ALERT;
@@ -244,7 +290,10 @@ void Skywatcher::GetRAMotorStatus(ILightVectorProperty *motorLP)
 
 void Skywatcher::GetDEMotorStatus(ILightVectorProperty *motorLP)
 {
-    ReadMotorStatus(Axis2);
+    if (polledStatus[Axis2])
+        polledStatus[Axis2] = false;
+    else
+        ReadMotorStatus(Axis2);
     if (!DEInitialized)
     {
         IUFindLight(motorLP, "DEInitialized")->s = IPS_ALERT;
@@ -710,36 +759,41 @@ void Skywatcher::ReadMotorStatus(SkywatcherAxis axis)
 {
     dispatch_command(GetAxisStatus, axis, nullptr);
     //read_eqmod();
+    ParseMotorStatus(axis, response);
+}
+
+void Skywatcher::ParseMotorStatus(SkywatcherAxis axis, const char *reply)
+{
     switch (axis)
     {
         case Axis1:
-            RAInitialized = (response[3] & 0x01);
-            RARunning     = (response[2] & 0x01);
-            if (response[1] & 0x01)
+            RAInitialized = (reply[3] & 0x01);
+            RARunning     = (reply[2] & 0x01);
+            if (reply[1] & 0x01)
                 RAStatus.slewmode = SLEW;
             else
                 RAStatus.slewmode = GOTO;
-            if (response[1] & 0x02)
+            if (reply[1] & 0x02)
                 RAStatus.direction = BACKWARD;
             else
                 RAStatus.direction = FORWARD;
-            if (response[1] & 0x04)
+            if (reply[1] & 0x04)
                 RAStatus.speedmode = HIGHSPEED;
             else
                 RAStatus.speedmode = LOWSPEED;
             break;
         case Axis2:
-            DEInitialized = (response[3] & 0x01);
-            DERunning     = (response[2] & 0x01);
-            if (response[1] & 0x01)
+            DEInitialized = (reply[3] & 0x01);
+            DERunning     = (reply[2] & 0x01);
+            if (reply[1] & 0x01)
                 DEStatus.slewmode = SLEW;
             else
                 DEStatus.slewmode = GOTO;
-            if (response[1] & 0x02)
+            if (reply[1] & 0x02)
                 DEStatus.direction = BACKWARD;
             else
                 DEStatus.direction = FORWARD;
-            if (response[1] & 0x04)
+            if (reply[1] & 0x04)
                 DEStatus.speedmode = HIGHSPEED;
             else
                 DEStatus.speedmode = LOWSPEED;
@@ -1435,8 +1489,6 @@ void Skywatcher::StartMotor(SkywatcherAxis axis)
             char cmd[7];
             char motioncmd[3] = "20";                                               // lowspeed goto
             motioncmd[1]      = (NewStatus[axis].direction == FORWARD ? '0' : '1'); // same direction
-            bool *motorrunning;
-            struct timespec wait;
             LOGF_INFO("Performing backlash compensation for axis %c, microsteps = %d", AxisCmd[axis],
                       backlash);
             // Axis Position
@@ -1462,18 +1514,7 @@ void Skywatcher::StartMotor(SkywatcherAxis axis)
             dispatch_command(StartMotion, axis, nullptr);
             //read_eqmod();
             // Wait end of backlash
-            if (axis == Axis1)
-                motorrunning = &RARunning;
-            else
-                motorrunning = &DERunning;
-            wait.tv_sec  = 0;
-            wait.tv_nsec = 100000000; // 100ms
-            ReadMotorStatus(axis);
-            while (*motorrunning)
-            {
-                nanosleep(&wait, nullptr);
-                ReadMotorStatus(axis);
-            }
+            WaitMotorStop(axis);
             // Restore microsteps
             long2Revu24str(currentsteps, cmd);
             dispatch_command(SetAxisPositionCmd, axis, cmd);
@@ -1645,8 +1686,6 @@ void Skywatcher::InstantStopMotor(SkywatcherAxis axis)
 
 void Skywatcher::StopWaitMotor(SkywatcherAxis axis)
 {
-    bool *motorrunning;
-    struct timespec wait;
     ReadMotorStatus(axis);
     if (axis == Axis1 && RARunning)
         LastRunningStatus[Axis1] = RAStatus;
@@ -1655,16 +1694,20 @@ void Skywatcher::StopWaitMotor(SkywatcherAxis axis)
     DEBUGF(telescope->DBG_MOUNT, "%s() : Axis = %c", __FUNCTION__, AxisCmd[axis]);
     dispatch_command(NotInstantAxisStop, axis, nullptr);
     //read_eqmod();
-    if (axis == Axis1)
-        motorrunning = &RARunning;
-    else
-        motorrunning = &DERunning;
-    wait.tv_sec  = 0;
-    wait.tv_nsec = 100000000; // 100ms
+    WaitMotorStop(axis);
+}
+
+void Skywatcher::WaitMotorStop(SkywatcherAxis axis)
+{
+    // The protocol has no stop notification: query again as soon as the previous reply
+    // arrived, but not more often than EQMOD_STOP_POLL so the controller is not flooded.
+    bool *motorrunning = (axis == Axis1) ? &RARunning : &DERunning;
+    auto lastquery     = std::chrono::steady_clock::now();
     ReadMotorStatus(axis);
     while (*motorrunning)
     {
-        nanosleep(&wait, nullptr);
+        std::this_thread::sleep_until(lastquery + std::chrono::microseconds(EQMOD_STOP_POLL));
+        lastquery = std::chrono::steady_clock::now();
         ReadMotorStatus(axis);
     }
 }
@@ -1709,6 +1752,7 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
         {
             int err_code = 0;
             tcflush(PortFD, TCIOFLUSH);
+            clear_replies();
 
             if ((err_code = tty_write_string(PortFD, command, &nbytes_written)) != TTY_OK)
             {
@@ -1772,8 +1816,26 @@ bool Skywatcher::read_eqmod()
     if (!isSimulation())
     {
         //Have to onsider cases when we read ! (error) or 0x01 (buffer overflow)
+        if (readerThread.joinable())
+        {
+            // Next CR terminated reply collected by the reader thread. A transient link error is
+            // only reported once the reply is overdue, a stopped reader fails the read at once.
+            std::unique_lock<std::mutex> lock(replyMutex);
+            replyCV.wait_for(lock, std::chrono::microseconds(EQMOD_TIMEOUT),
+                             [this] { return !replyQueue.empty() || (readerError != 0 && !readerRunning); });
+            if (replyQueue.empty())
+            {
+                int err = readerError;
+                if (readerRunning)
+                    readerError = 0;
+                throw EQModError(EQModError::ErrDisconnect, "tty read failed, check connection: %s",
+                                 err != 0 ? strerror(err) : "Timeout error");
+            }
+            nbytes_read = snprintf(response, SKYWATCHER_MAX_CMD, "%s", replyQueue.front().c_str());
+            replyQueue.pop_front();
+        }
         // Read until encountring a CR
-        if ((err_code = tty_read_section_expanded(PortFD, response, 0x0D, 0, EQMOD_TIMEOUT, &nbytes_read)) != TTY_OK)
+        else if ((err_code = tty_read_section_expanded(PortFD, response, 0x0D, 0, EQMOD_TIMEOUT, &nbytes_read)) != TTY_OK)
         {
             char ttyerrormsg[ERROR_MSG_LENGTH];
             tty_error_msg(err_code, ttyerrormsg, ERROR_MSG_LENGTH);
@@ -1806,6 +1868,207 @@ bool Skywatcher::read_eqmod()
     return true;
 }
 
+bool Skywatcher::dispatch_batch(int count, const SkywatcherCommand *cmds, const SkywatcherAxis *axes,
+                                char (*replies)[SKYWATCHER_MAX_CMD])
+{
+    // Only meant for queries: on error the whole batch is sent again.
+    if (isSimulation() || !readerThread.joinable())
+    {
+        for (int k = 0; k < count; k++)
+        {
+            dispatch_command(cmds[k], axes[k], nullptr);
+            memcpy(replies[k], response, SKYWATCHER_MAX_CMD);
+        }
+        return true;
+    }
+
+    for (uint8_t i = 0; i < EQMOD_MAX_RETRY; i++)
+    {
+        int err_code = TTY_OK;
+        tcflush(PortFD, TCIOFLUSH);
+        clear_replies();
+
+        // One write per command, as UDP links expect one command per datagram
+        for (int k = 0; k < count && err_code == TTY_OK; k++)
+        {
+            int nbytes_written = 0;
+            snprintf(command, SKYWATCHER_MAX_CMD, "%c%c%c%c", SkywatcherLeadingChar, cmds[k], AxisCmd[axes[k]],
+                     SkywatcherTrailingChar);
+            err_code = tty_write_string(PortFD, command, &nbytes_written);
+        }
+        if (err_code != TTY_OK)
+        {
+            if (i == EQMOD_MAX_RETRY - 1)
+            {
+                char ttyerrormsg[ERROR_MSG_LENGTH];
+                tty_error_msg(err_code, ttyerrormsg, ERROR_MSG_LENGTH);
+                throw EQModError(EQModError::ErrDisconnect, "tty write failed, check connection: %s", ttyerrormsg);
+            }
+            continue;
+        }
+        DEBUGF(telescope->DBG_COMM, "dispatch_batch: %d commands written", count);
+
+        try
+        {
+            // The controller answers in order
+            for (int k = 0; k < count; k++)
+            {
+                snprintf(command, SKYWATCHER_MAX_CMD, "%c%c%c", SkywatcherLeadingChar, cmds[k], AxisCmd[axes[k]]);
+                debugnextread = true;
+                read_eqmod();
+                memcpy(replies[k], response, SKYWATCHER_MAX_CMD);
+            }
+            if (i > 0)
+            {
+                LOGF_WARN("%s() : serial port read failed for %dms (%d retries), verify mount link.", __FUNCTION__, (i*EQMOD_TIMEOUT)/1000, i);
+            }
+            return true;
+        }
+        catch (EQModError)
+        {
+            if (i == EQMOD_MAX_RETRY - 1)
+                throw;
+        }
+
+        DEBUG(telescope->DBG_COMM, "batch read error, will retry again...");
+    }
+
+    return true;
+}
+
+void Skywatcher::start_reader()
+{
+    stop_reader();
+    clear_replies();
+    readerError   = 0;
+    readerRunning = true;
+    readerThread  = std::thread(&Skywatcher::reader_loop, this);
+}
+
+void Skywatcher::stop_reader()
+{
+    readerRunning = false;
+    if (readerThread.joinable())
+        readerThread.join();
+}
+
+void Skywatcher::clear_replies()
+{
+    std::lock_guard<std::mutex> lock(replyMutex);
+    replyQueue.clear();
+    partialReply.clear();
+    // Errors of an earlier command do not fail the next one, unless the reader has stopped
+    if (readerRunning)
+        readerError = 0;
+}
+
+// Errors a UDP link reports for one lost or refused datagram, the link itself stays usable
+static bool transient_link_error(int err)
+{
+    switch (err)
+    {
+        case ECONNREFUSED:
+        case EHOSTUNREACH:
+        case ENETUNREACH:
+        case ENETDOWN:
+        case ETIMEDOUT:
+        case ENOBUFS:
+        case ENOMEM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Skywatcher::reader_loop()
+{
+    char buf[256];
+    int err = 0;
+
+    while (readerRunning)
+    {
+        struct pollfd pfd = { PortFD, POLLIN, 0 };
+        int rc            = poll(&pfd, 1, 100);
+        if (rc == 0 || (rc < 0 && (errno == EINTR || errno == EAGAIN)))
+            continue;
+        if (rc < 0)
+        {
+            err = errno;
+            if (transient_link_error(err))
+            {
+                reader_error(err);
+                continue;
+            }
+            break;
+        }
+        if (pfd.revents & POLLNVAL)
+        {
+            err = EBADF;
+            break;
+        }
+        if ((pfd.revents & POLLHUP) && !(pfd.revents & POLLIN))
+        {
+            err = EIO;
+            break;
+        }
+
+        // On POLLERR the read picks up, and clears, the pending socket error
+        ssize_t len = read(PortFD, buf, sizeof(buf));
+        if (len < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+            continue;
+        if (len < 0)
+        {
+            err = errno;
+            if (transient_link_error(err))
+            {
+                reader_error(err);
+                continue;
+            }
+            break;
+        }
+        if (len == 0)
+        {
+            // An empty datagram, unless the serial line hung up
+            if (pfd.revents & POLLHUP)
+            {
+                err = EIO;
+                break;
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(replyMutex);
+            for (ssize_t k = 0; k < len; k++)
+            {
+                partialReply += buf[k];
+                // Overlong garbage is passed on as is and rejected by read_eqmod
+                if (buf[k] == 0x0D || partialReply.size() >= SKYWATCHER_MAX_CMD - 1)
+                {
+                    replyQueue.push_back(partialReply);
+                    partialReply.clear();
+                }
+            }
+        }
+        replyCV.notify_all();
+    }
+
+    // The link is gone, every later read fails at once
+    if (err != 0)
+    {
+        readerRunning = false;
+        reader_error(err);
+    }
+}
+
+// Recorded for the command waiting for a reply
+void Skywatcher::reader_error(int err)
+{
+    std::lock_guard<std::mutex> lock(replyMutex);
+    readerError = err;
+    replyCV.notify_all();
+}
+
 uint32_t Skywatcher::Revu24str2long(char *s)
 {
     uint32_t res = 0;
@@ -23,6 +23,13 @@
 
 #include <lilxml.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #include <time.h>
 #include <sys/time.h>
 
@@ -77,6 +84,9 @@ class Skywatcher
         uint32_t GetDEPeriod();
         void GetRAMotorStatus(ILightVectorProperty *motorLP);
         void GetDEMotorStatus(ILightVectorProperty *motorLP);
+        // Query both encoders and both motor statuses in a single pipelined exchange.
+        // The next GetRA/DEEncoder and GetRA/DEMotorStatus calls use these replies.
+        void ReadStatus();
         void InquireBoardVersion(ITextVectorProperty *boardTP);
         void InquireFeatures();
         void InquireRAEncoderInfo(INumberVectorProperty *encoderNP);
@@ -249,6 +259,9 @@ class Skywatcher
         // Functions
         void CheckMotorStatus(SkywatcherAxis axis);
         void ReadMotorStatus(SkywatcherAxis axis);
+        void ParseMotorStatus(SkywatcherAxis axis, const char *reply);
+        void ParseEncoder(SkywatcherAxis axis, char *reply);
+        void WaitMotorStop(SkywatcherAxis axis);
         void SetMotion(SkywatcherAxis axis, SkywatcherAxisStatus newstatus);
         void SetSpeed(SkywatcherAxis axis, uint32_t period);
         void SetTarget(SkywatcherAxis axis, uint32_t increment);
@@ -271,6 +284,15 @@ class Skywatcher
 
         bool read_eqmod();
         bool dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, char *arg);
+        bool dispatch_batch(int count, const SkywatcherCommand *cmds, const SkywatcherAxis *axes,
+                            char (*replies)[SKYWATCHER_MAX_CMD]);
+
+        // Serial reader thread
+        void start_reader();
+        void stop_reader();
+        void reader_loop();
+        void reader_error(int err);
+        void clear_replies();
 
         uint32_t Revu24str2long(char *);
         uint32_t Highstr2long(char *);
@@ -318,6 +340,19 @@ class Skywatcher
         char command[SKYWATCHER_MAX_CMD];
         char response[SKYWATCHER_MAX_CMD];
 
+        // Replies split on CR by the reader thread, consumed in order by read_eqmod
+        std::thread readerThread;
+        std::atomic<bool> readerRunning {false};
+        std::mutex replyMutex;
+        std::condition_variable replyCV;
+        std::deque<std::string> replyQueue;
+        std::string partialReply;
+        int readerError {0};
+
+        // Set by ReadStatus, cleared by the getter consuming the reply
+        bool polledPosition[NUMBER_OF_SKYWATCHERAXIS] {false, false};
+        bool polledStatus[NUMBER_OF_SKYWATCHERAXIS] {false, false};
+
         bool debug;
         bool debugnextread;
         EQMod *telescope;
@@ -338,4 +373,5 @@ class Skywatcher
 
         const long EQMOD_TIMEOUT = 200000; // us
         const uint8_t EQMOD_MAX_RETRY = 10;
+        const long EQMOD_STOP_POLL = 20000; // us, minimum interval between status queries while waiting for a stop
 };
@@ -3,6 +3,18 @@
 
 #include "config.h"
 #include "eqmodbase.h"
+#include "simulator/skywatcher-simulator.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
 
 
 using ::testing::_;
@@ -147,6 +159,105 @@ public:
         return true;
     }
 
+    void AttachMount(int fd)
+    {
+        mount->setPortFD(fd);
+        mount->Handshake();
+    }
+
+    void DetachMount()
+    {
+        mount->Disconnect();
+        mount->setPortFD(-1);
+    }
+
+    // Average duration in ms of one ReadScopeStatus style poll of encoders and motor statuses
+    double PollCycle(bool pipelined, int cycles)
+    {
+        const char *names[] = { "RAInitialized", "RARunning", "RAGoto", "RAForward", "RAHighspeed",
+                                "DEInitialized", "DERunning", "DEGoto", "DEForward", "DEHighspeed" };
+        ILight lights[10];
+        ILightVectorProperty statusLP;
+        for (int i = 0; i < 10; i++)
+            IUFillLight(&lights[i], names[i], names[i], IPS_IDLE);
+        IUFillLightVector(&statusLP, lights, 10, getDeviceName(), "TEST_STATUS", "Status", "Test", IPS_IDLE);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < cycles; c++)
+        {
+            if (pipelined)
+                mount->ReadStatus();
+            mount->GetRAEncoder();
+            mount->GetDEEncoder();
+            mount->GetRAMotorStatus(&statusLP);
+            mount->GetDEMotorStatus(&statusLP);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / cycles;
+    }
+};
+
+// Skywatcher simulator on the far end of a socket, answering each command after a fixed link latency
+class SimulatedMountLink
+{
+public:
+    SimulatedMountLink(int fd, std::chrono::microseconds latency) : fd(fd), latency(latency)
+    {
+        sim.setupVersion("020300");
+        sim.setupRA(180, 47, 12, 200, 64, 2);
+        sim.setupDE(180, 47, 12, 200, 64, 2);
+        running = true;
+        thread  = std::thread(&SimulatedMountLink::Run, this);
+    }
+
+    ~SimulatedMountLink()
+    {
+        running = false;
+        thread.join();
+    }
+
+private:
+    void Run()
+    {
+        std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> pending;
+        std::string line;
+        char buf[64];
+
+        while (running)
+        {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, 1) > 0)
+            {
+                ssize_t len = read(fd, buf, sizeof(buf));
+                if (len <= 0)
+                    break;
+                for (ssize_t k = 0; k < len; k++)
+                {
+                    line += buf[k];
+                    if (buf[k] == '\r')
+                    {
+                        pending.emplace_back(std::chrono::steady_clock::now() + latency, line);
+                        line.clear();
+                    }
+                }
+            }
+            while (!pending.empty() && pending.front().first <= std::chrono::steady_clock::now())
+            {
+                char reply[32];
+                int received = 0, len = 0;
+                sim.process_command(pending.front().second.c_str(), &received);
+                sim.get_reply(reply, &len);
+                EXPECT_EQ(write(fd, reply, len), len);
+                pending.pop_front();
+            }
+        }
+    }
+
+    int fd;
+    std::chrono::microseconds latency;
+    SkywatcherSimulator sim;
+    std::atomic<bool> running {false};
+    std::thread thread;
 };
 
 
@@ -185,6 +296,29 @@ TEST(EqmodTest, encoder_target_south)
     eqmod.TestEncoderTarget();
 }
 
+TEST(EqmodTest, pipelined_status_poll)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    TestEQMod eqmod;
+    {
+        // 10ms per round trip, typical of a WiFi or Bluetooth adapter
+        SimulatedMountLink link(fds[1], std::chrono::microseconds(10000));
+        eqmod.AttachMount(fds[0]);
+
+        double sequential = eqmod.PollCycle(false, 20);
+        double pipelined  = eqmod.PollCycle(true, 20);
+        std::cout << "[   INFO   ] status poll cycle: " << sequential << " ms sequential, " << pipelined
+                  << " ms pipelined" << std::endl;
+        EXPECT_LT(pipelined, sequential / 2);
+
+        eqmod.DetachMount();
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
 #ifdef WITH_SCOPE_LIMITS
 TEST(EqmodTest, scope_limits_properties)
 {
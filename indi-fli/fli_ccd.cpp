@@ -22,6 +22,7 @@
 */
 
 #include <memory>
+#include <errno.h>
 #include <time.h>
 #include <math.h>
 #include <unistd.h>
@@ -661,8 +662,24 @@ bool FLICCD::grabImage()
     }
     else
     {
-        bool success = true;
-        for (int i = 0; i < height; i++)
+        size_t grabbed = 0;
+        size_t const frame_size = (size_t)height * row_size;
+
+        /* Read the whole frame in large transfers */
+        err = FLIGrabFrame(fli_dev, image, frame_size, &grabbed);
+        if (err == 0 && grabbed != frame_size)
+            err = -EIO;
+
+        if (err && !(err == -EINVAL && grabbed == 0))
+        {
+            LOGF_ERROR("FLIGrabFrame() failed after %zu of %zu bytes. %s.", grabbed, frame_size, strerror(-err));
+            return false;
+        }
+
+        /* Older libfli releases only offer FLIGrabRow() */
+        bool const by_row = (err != 0);
+        bool success      = true;
+        for (int i = 0; by_row && i < height; i++)
         {
             if ((err = FLIGrabRow(fli_dev, image + (i * row_size), width)))
             {
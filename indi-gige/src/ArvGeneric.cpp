@@ -20,6 +20,9 @@
 
 using namespace arv;
 
+#define STREAM_BUFFERS     8      /* Frames keep landing in the pool while one is handed out */
+#define STREAM_POP_TIMEOUT 100000 /* us, how often the stream thread looks for a stop request */
+
 const char *ArvGeneric::_str_val(const char *s)
 {
     return (s ? s : "None");
@@ -91,18 +94,18 @@ bool ArvGeneric::_get_bounds(void (*fn_arv_bounds)(::ArvCamera *, T *min, T *max
 
 bool ArvGeneric::is_exposing()
 {
-    return this->stream_active;
+    return (this->stream_active && !this->streaming);
 }
-bool ArvGeneric::is_connected()
+bool ArvGeneric::is_streaming()
 {
-    return (this->camera ? true : false);
+    return this->streaming;
 }
-bool ArvGeneric::_stream_active()
+bool ArvGeneric::is_connected()
 {
-    return this->stream_active;
+    return (this->camera ? true : false);
 }
 
-ArvGeneric::ArvGeneric(void *camera_device) : ArvCamera(camera_device)
+ArvGeneric::ArvGeneric(void *camera_device) : ArvCamera(camera_device), stream_filling(false), streaming(false)
 {
     this->_init();
     this->camera = (::ArvCamera *)camera_device;
@@ -147,10 +150,12 @@ bool ArvGeneric::_configure(void)
 
 void ArvGeneric::_init()
 {
-    this->camera        = nullptr;
-    this->buffer        = nullptr;
-    this->stream        = nullptr;
-    this->stream_active = false;
+    this->camera         = nullptr;
+    this->stream         = nullptr;
+    this->stream_active  = false;
+    this->stream_payload = 0;
+    this->frame_callback = nullptr;
+    this->frame_usr_ptr  = nullptr;
 
     /* Don't clear device_id, its needed to re-attach with connect() */
 }
@@ -159,10 +164,13 @@ bool ArvGeneric::disconnect()
 {
     if (this->is_connected())
     {
+        this->stream_stop();
         this->_test_exposure_and_abort();
+        this->_stream_destroy();
         g_clear_object(&this->camera);
     }
     this->_init();
+    return true;
 }
 
 bool ArvGeneric::_set_initial_config()
@@ -242,7 +250,7 @@ void ArvGeneric::set_bin(int const bin_x, int const bin_y)
 
 void ArvGeneric::_test_exposure_and_abort(void)
 {
-    if (this->_stream_active())
+    if (this->is_exposing())
         this->exposure_abort();
 }
 
@@ -264,46 +272,74 @@ void ArvGeneric::set_exposure_time(double const val)
     this->_set_cam_exposure_property(arv_camera_set_exposure_time, &this->cam.exposure, val);
 }
 
-::ArvBuffer *ArvGeneric::_buffer_create(void)
+void ArvGeneric::_stream_callback(void *user_data, ::ArvStreamCallbackType type, ::ArvBuffer *buffer)
 {
-    ::ArvBuffer *buffer;
+    (void)buffer;
+    ArvGeneric *const cls = static_cast<ArvGeneric *>(user_data);
 
-    /* Ensure no buffers in stream */
-    while (1)
+    /* Runs on the aravis stream thread, the first packet of a frame has arrived */
+    if (type == ARV_STREAM_CALLBACK_TYPE_START_BUFFER)
+        cls->stream_filling = true;
+}
+
+bool ArvGeneric::_stream_prepare(void)
+{
+    gint const payload = arv_camera_get_payload(this->camera, &(this->error));
+    if (payload <= 0)
+        return false;
+
+    /* The pool was sized for another geometry */
+    if (this->stream && this->stream_payload != (size_t)payload)
+        this->_stream_destroy();
+
+    if (!this->stream)
     {
-        buffer = arv_stream_try_pop_buffer(this->stream);
-        if (buffer)
-            g_clear_object(&buffer);
-        else
-            break;
+        this->stream = arv_camera_create_stream(this->camera, ArvGeneric::_stream_callback, this, &(this->error));
+        if (!this->stream)
+            return false;
+
+        for (int i = 0; i < STREAM_BUFFERS; i++)
+            arv_stream_push_buffer(this->stream, arv_buffer_new(payload, nullptr));
+        this->stream_payload = payload;
+    }
+    else
+    {
+        this->_stream_recycle();
     }
 
-    gint const payload = arv_camera_get_payload(this->camera, &(this->error));
-    buffer             = arv_buffer_new(payload, nullptr);
-    arv_stream_push_buffer(this->stream, buffer);
-    return buffer;
+    this->stream_filling = false;
+    return true;
 }
 
-::ArvStream *ArvGeneric::_stream_create(void)
+void ArvGeneric::_stream_recycle(void)
 {
-    ::ArvStream *stream = arv_camera_create_stream(this->camera, nullptr, nullptr, &(this->error));
-    return stream;
+    /* Hand frames nobody picked up back to the stream */
+    ::ArvBuffer *buffer;
+    while ((buffer = arv_stream_try_pop_buffer(this->stream)) != nullptr)
+        arv_stream_push_buffer(this->stream, buffer);
 }
 
-void ArvGeneric::_stream_start()
+void ArvGeneric::_stream_destroy(void)
+{
+    /* The stream releases the buffers it still holds */
+    g_clear_object(&this->stream);
+    this->stream_payload = 0;
+}
+
+void ArvGeneric::_stream_start(::ArvAcquisitionMode const mode)
 {
     this->stream_active = true;
 
     /* Start the acquisition stream */
-    arv_camera_set_acquisition_mode(this->camera, ARV_ACQUISITION_MODE_SINGLE_FRAME, &(this->error));
+    arv_camera_set_acquisition_mode(this->camera, mode, &(this->error));
     arv_camera_start_acquisition(this->camera, &(this->error));
 }
 
 void ArvGeneric::_stream_stop()
 {
-    /* stop the acquisition stream */
+    /* stop the acquisition stream, the stream itself is kept for the next exposure */
     arv_camera_stop_acquisition(this->camera, &(this->error));
-    g_object_unref(this->stream);
+    this->_stream_recycle();
 
     this->stream_active = false;
 }
@@ -317,68 +353,123 @@ void ArvGeneric::_trigger_exposure()
 void ArvGeneric::exposure_start(void)
 {
     this->_test_exposure_and_abort();
-    this->stream = this->_stream_create();
-    this->buffer = this->_buffer_create();
+    if (this->streaming || !this->_stream_prepare())
+        return;
 
-    this->_stream_start();
+    this->_stream_start(ARV_ACQUISITION_MODE_SINGLE_FRAME);
     this->_trigger_exposure();
 }
 
 void ArvGeneric::exposure_abort(void)
 {
-    if (this->_stream_active())
+    if (this->is_exposing())
     {
         arv_camera_abort_acquisition(this->camera, &(this->error));
         this->_stream_stop();
     }
 }
 
-void ArvGeneric::_get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
+void ArvGeneric::_get_image(::ArvBuffer *buffer,
+                            void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
 {
-    ArvBuffer *const popped_buf = arv_stream_timeout_pop_buffer(this->stream, 100000);
-    if ((popped_buf != nullptr) && (popped_buf == this->buffer) &&
-        arv_buffer_get_status(this->buffer) == ARV_BUFFER_STATUS_SUCCESS)
+    if (fn_image_callback != nullptr)
     {
-        if (fn_image_callback != nullptr)
-        {
-            size_t size;
-            uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(this->buffer, &size);
-            fn_image_callback(usr_ptr, data, size);
-        }
-    }
-    else
-    {
-        //TODO: failure...
+        size_t size;
+        uint8_t const *const data = (uint8_t const *const)arv_buffer_get_data(buffer, &size);
+        fn_image_callback(usr_ptr, data, size);
     }
 }
 
 ARV_EXPOSURE_STATUS ArvGeneric::exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                               void *const usr_ptr)
 {
-    if (!this->_stream_active())
+    if (!this->is_exposing())
         return ARV_EXPOSURE_UNKNOWN;
 
-    ::ArvBufferStatus const status = arv_buffer_get_status(this->buffer);
-    switch (status)
+    ::ArvBuffer *const buffer = arv_stream_try_pop_buffer(this->stream);
+    if (buffer == nullptr)
+        return (this->stream_filling ? ARV_EXPOSURE_FILLING : ARV_EXPOSURE_BUSY);
+
+    ::ArvBufferStatus const status = arv_buffer_get_status(buffer);
+    if (status == ARV_BUFFER_STATUS_SUCCESS)
+        this->_get_image(buffer, fn_image_callback, usr_ptr);
+
+    arv_stream_push_buffer(this->stream, buffer);
+    this->_stream_stop();
+
+    return (status == ARV_BUFFER_STATUS_SUCCESS ? ARV_EXPOSURE_FINISHED : ARV_EXPOSURE_FAILED);
+}
+
+void ArvGeneric::_stream_thread(void)
+{
+    while (this->streaming)
+    {
+        ::ArvBuffer *const buffer = arv_stream_timeout_pop_buffer(this->stream, STREAM_POP_TIMEOUT);
+        if (buffer == nullptr)
+            continue;
+
+        /* The frame is handed out in place, then the buffer goes straight back to the pool */
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS)
+            this->_get_image(buffer, this->frame_callback, this->frame_usr_ptr);
+
+        arv_stream_push_buffer(this->stream, buffer);
+    }
+}
+
+bool ArvGeneric::stream_start(double const frame_rate,
+                              void (*fn_frame_callback)(void *const, uint8_t const *const, size_t),
+                              void *const usr_ptr)
+{
+    this->_test_exposure_and_abort();
+    this->stream_stop();
+    if (!this->_stream_prepare())
+        return false;
+
+    this->frame_callback = fn_frame_callback;
+    this->frame_usr_ptr  = usr_ptr;
+
+    /* Free running at the requested rate instead of software triggered single frames */
+    arv_camera_clear_triggers(this->camera, &(this->error));
+    this->cam.frame_rate.set(frame_rate);
+    arv_camera_set_frame_rate(this->camera, this->cam.frame_rate.val(), &(this->error));
+
+    this->streaming     = true;
+    this->stream_thread = std::thread(&ArvGeneric::_stream_thread, this);
+    this->_stream_start(ARV_ACQUISITION_MODE_CONTINUOUS);
+    return true;
+}
+
+void ArvGeneric::stream_stop(void)
+{
+    if (!this->streaming)
+        return;
+
+    arv_camera_stop_acquisition(this->camera, &(this->error));
+    this->streaming = false;
+    if (this->stream_thread.joinable())
+        this->stream_thread.join();
+
+    this->_stream_recycle();
+    this->stream_active = false;
+
+    /* Back to software triggered exposures */
+    arv_camera_set_trigger(this->camera, "Software", &(this->error));
+}
+
+void ArvGeneric::get_stream_statistics(ARV_STREAM_STATISTICS *stats)
+{
+    guint64 completed = 0, failures = 0, underruns = 0, resent = 0, missing = 0;
+
+    if (this->stream)
     {
-        case ARV_BUFFER_STATUS_CLEARED:
-            return ARV_EXPOSURE_BUSY;
-        case ARV_BUFFER_STATUS_FILLING:
-            return ARV_EXPOSURE_FILLING;
-        case ARV_BUFFER_STATUS_UNKNOWN:
-            return ARV_EXPOSURE_UNKNOWN;
-        case ARV_BUFFER_STATUS_SUCCESS:
-            this->_get_image(fn_image_callback, usr_ptr);
-            this->_stream_stop();
-            return ARV_EXPOSURE_FINISHED;
-        case ARV_BUFFER_STATUS_TIMEOUT:
-        case ARV_BUFFER_STATUS_MISSING_PACKETS:
-        case ARV_BUFFER_STATUS_WRONG_PACKET_ID:
-        case ARV_BUFFER_STATUS_SIZE_MISMATCH:
-        case ARV_BUFFER_STATUS_ABORTED:
-            this->_stream_stop();
-            return ARV_EXPOSURE_FAILED;
-        default:
-            return ARV_EXPOSURE_UNKNOWN;
+        arv_stream_get_statistics(this->stream, &completed, &failures, &underruns);
+        if (ARV_IS_GV_STREAM(this->stream))
+            arv_gv_stream_get_statistics(ARV_GV_STREAM(this->stream), &resent, &missing);
     }
+
+    stats->completed_buffers = completed;
+    stats->failures          = failures;
+    stats->underruns         = underruns;
+    stats->resent_packets    = resent;
+    stats->missing_packets   = missing;
 }
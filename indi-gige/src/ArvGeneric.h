@@ -25,6 +25,9 @@
 #include <arv.h>
 //}
 
+#include <atomic>
+#include <thread>
+
 #include "ArvInterface.h"
 
 using namespace arv;
@@ -37,6 +40,7 @@ class ArvGeneric : public arv::ArvCamera
 
     bool is_connected();
     bool is_exposing();
+    bool is_streaming();
     bool connect();
     bool disconnect();
     const char *vendor_name();
@@ -66,6 +70,11 @@ class ArvGeneric : public arv::ArvCamera
     ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                       void *const usr_ptr);
 
+    bool stream_start(double const frame_rate, void (*fn_frame_callback)(void *const, uint8_t const *const, size_t),
+                      void *const usr_ptr);
+    void stream_stop(void);
+    void get_stream_statistics(ARV_STREAM_STATISTICS *stats);
+
   protected:
     void _init(void);
     bool _configure(void);
@@ -78,24 +87,35 @@ class ArvGeneric : public arv::ArvCamera
     const char *_str_val(const char *s);
     bool _get_initial_config();
     bool _set_initial_config();
-    void _get_image(void (*fn_image_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr);
+    void _get_image(::ArvBuffer *buffer, void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
+                    void *const usr_ptr);
 
     /* aravis library state variables */
     ::ArvCamera *camera;
     ::ArvDevice *dev;
     ::ArvStream *stream;
-    ::ArvBuffer *buffer;
     ::GError *error;
 
-    /* streaming, capturing functions */
-    ::ArvStream *_stream_create(void);
-    ::ArvBuffer *_buffer_create(void);
-    bool _stream_active();
-    void _stream_start();
+    /* streaming, capturing functions
+     * The stream and its buffer pool live until the payload size changes or the camera disconnects */
+    bool _stream_prepare(void);
+    void _stream_recycle(void);
+    void _stream_destroy(void);
+    void _stream_start(::ArvAcquisitionMode const mode);
     void _stream_stop();
+    void _stream_thread(void);
     void _trigger_exposure();
+    static void _stream_callback(void *user_data, ::ArvStreamCallbackType type, ::ArvBuffer *buffer);
 
     bool stream_active;
+    size_t stream_payload;
+    std::atomic<bool> stream_filling;
+
+    /* continuous acquisition */
+    std::atomic<bool> streaming;
+    std::thread stream_thread;
+    void (*frame_callback)(void *const, uint8_t const *const, size_t);
+    void *frame_usr_ptr;
 
     /* Camera properties */
     struct
@@ -33,6 +33,15 @@ typedef enum {
 
 } ARV_EXPOSURE_STATUS;
 
+typedef struct
+{
+    uint64_t completed_buffers; //!< Frames received complete
+    uint64_t failures;          //!< Frames received with errors
+    uint64_t underruns;         //!< Frames lost because no buffer was free
+    uint64_t resent_packets;    //!< Packets the camera had to send again (GigE only)
+    uint64_t missing_packets;   //!< Packets that never arrived (GigE only)
+} ARV_STREAM_STATISTICS;
+
 template <class T>
 class min_max_property
 {
@@ -109,6 +118,14 @@ class ArvCamera
     virtual void exposure_abort(void)                      = 0;
     virtual ARV_EXPOSURE_STATUS exposure_poll(void (*fn_image_callback)(void *const, uint8_t const *const, size_t),
                                               void *const) = 0;
+
+    /* Continuous acquisition, every frame is passed to fn_frame_callback from the stream thread.
+     * The data belongs to the stream and is only valid during the call. */
+    virtual bool stream_start(double const frame_rate,
+                              void (*fn_frame_callback)(void *const, uint8_t const *const, size_t), void *const) = 0;
+    virtual void stream_stop(void)                                   = 0;
+    virtual bool is_streaming()                                      = 0;
+    virtual void get_stream_statistics(ARV_STREAM_STATISTICS *stats) = 0;
 };
 
 class ArvFactory
@@ -115,6 +115,14 @@ void BlackFly::exposure_start(void)
     ArvGeneric::exposure_start();
 }
 
+bool BlackFly::stream_start(double const frame_rate,
+                            void (*fn_frame_callback)(void *const, uint8_t const *const, size_t), void *const usr_ptr)
+{
+    printf("%s\n", __PRETTY_FUNCTION__);
+    this->_fixup();
+    return ArvGeneric::stream_start(frame_rate, fn_frame_callback, usr_ptr);
+}
+
 bool BlackFly::_configure(void)
 {
     printf("%s\n", __PRETTY_FUNCTION__);
@@ -25,6 +25,8 @@ class BlackFly : public ArvGeneric
     BlackFly(void *camera_device);
     bool connect();
     void exposure_start(void);
+    bool stream_start(double const frame_rate, void (*fn_frame_callback)(void *const, uint8_t const *const, size_t),
+                      void *const usr_ptr);
 
   protected:
     bool _configure(void);
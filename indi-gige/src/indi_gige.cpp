@@ -43,7 +43,8 @@
 #define TIMER_US_TO_MS (1000)
 #define TIMER_US_TO_S  (1000000)
 #define TIMER_TICK_MS  (100)
-#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME)
+#define TIMER_STATS_TICKS (10) /* Refresh stream statistics once a second */
+#define CAPS           (CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME | CCD_HAS_STREAMING)
 
 static class Loader
 {
@@ -64,7 +65,9 @@ const char *GigECCD::getDefaultName()
 
 GigECCD::GigECCD(arv::ArvCamera *camera)
 {
-    this->camera = camera;
+    this->camera      = camera;
+    this->timer_id    = 0;
+    this->stats_ticks = 0;
     snprintf(this->name, sizeof(this->name), "GigE CCD%s", this->camera->model_name());
     setDeviceName(this->name);
 }
@@ -91,6 +94,7 @@ bool GigECCD::_update_geometry(void)
     PrimaryCCD.setBin(this->camera->get_bin_x().val(), this->camera->get_bin_y().val());
     PrimaryCCD.setFrame(this->camera->get_x_offset().val(), this->camera->get_y_offset().val(),
                         this->camera->get_width().val(), this->camera->get_height().val());
+    Streamer->setSize(this->camera->get_width().val(), this->camera->get_height().val());
 
     /* Sanity checks, reserve buffers */
     int const width           = this->camera->get_width().val();
@@ -103,12 +107,12 @@ bool GigECCD::_update_geometry(void)
         LOGF_ERROR("Unexpected INDI image buffer size, has %i bytes, camera has %i", indi_bufsize,
                frame_byte_size);
         PrimaryCCD.setFrameBufferSize(0);
+        return false;
     }
-    else
-    {
-        LOGF_INFO("Reserving INDI image buffer size %i bytes", indi_bufsize);
-        PrimaryCCD.setFrameBufferSize(frame_byte_size);
-    }
+
+    LOGF_INFO("Reserving INDI image buffer size %i bytes", indi_bufsize);
+    PrimaryCCD.setFrameBufferSize(frame_byte_size);
+    return true;
 }
 
 void GigECCD::_update_indi_properties(void)
@@ -125,14 +129,50 @@ void GigECCD::_update_indi_properties(void)
     IUFillTextVector(&indiprop_info_prop, indiprop_info, 3, getDeviceName(), "Camera Info", "", MAIN_CONTROL_TAB, IP_RO,
                      0, IPS_IDLE);
 
+    IUFillNumber(&indiprop_stats[0], "Completed", "", "%.f", 0, 0, 0, 0);
+    IUFillNumber(&indiprop_stats[1], "Failures", "", "%.f", 0, 0, 0, 0);
+    IUFillNumber(&indiprop_stats[2], "Underruns", "", "%.f", 0, 0, 0, 0);
+    IUFillNumber(&indiprop_stats[3], "Resent Packets", "", "%.f", 0, 0, 0, 0);
+    IUFillNumber(&indiprop_stats[4], "Missing Packets", "", "%.f", 0, 0, 0, 0);
+    IUFillNumberVector(&indiprop_stats_prop, indiprop_stats, 5, getDeviceName(), "Stream Statistics", "",
+                       MAIN_CONTROL_TAB, IP_RO, 0, IPS_IDLE);
+
     defineProperty(&indiprop_info_prop);
     defineProperty(&this->indiprop_gain_prop);
+    defineProperty(&indiprop_stats_prop);
 }
 
 void GigECCD::_delete_indi_properties(void)
 {
     this->deleteProperty(this->indiprop_gain_prop.name);
     this->deleteProperty(this->indiprop_info_prop.name);
+    this->deleteProperty(this->indiprop_stats_prop.name);
+}
+
+void GigECCD::_update_stream_statistics(void)
+{
+    arv::ARV_STREAM_STATISTICS stats;
+    this->camera->get_stream_statistics(&stats);
+
+    double const values[5] = { (double)stats.completed_buffers, (double)stats.failures, (double)stats.underruns,
+                               (double)stats.resent_packets, (double)stats.missing_packets };
+
+    bool changed = false;
+    for (int i = 0; i < 5; i++)
+    {
+        if (indiprop_stats[i].value != values[i])
+        {
+            indiprop_stats[i].value = values[i];
+            changed                 = true;
+        }
+    }
+
+    if (changed)
+    {
+        /* Lost frames or packets are worth a look at the network setup */
+        indiprop_stats_prop.s = (stats.failures || stats.underruns || stats.missing_packets) ? IPS_ALERT : IPS_OK;
+        IDSetNumber(&indiprop_stats_prop, nullptr);
+    }
 }
 
 //Initial call
@@ -143,6 +183,7 @@ bool GigECCD::updateProperties()
     if (this->camera->is_connected())
     {
         this->_update_indi_properties();
+        Streamer->setPixelFormat(INDI_MONO, this->camera->get_bpp().val());
         this->SetCCDParams(this->camera->get_width().max(), this->camera->get_height().max(),
                            this->camera->get_bpp().val(), this->camera->get_pixel_pitch().val(),
                            this->camera->get_pixel_pitch().val());
@@ -168,6 +209,7 @@ bool GigECCD::Connect()
 bool GigECCD::Disconnect()
 {
     LOGF_INFO("%s", __PRETTY_FUNCTION__);
+    camera->stream_stop();
 #if 0
     //TODO: re-iterate and acquire proper camera from AvrFactory (based on ID?)
     return camera->disconnect();
@@ -182,6 +224,12 @@ bool GigECCD::StartExposure(float duration)
     if (PrimaryCCD.getFrameType() == INDI::CCDChip::BIAS_FRAME)
         duration = 0;
 
+    if (camera->is_streaming())
+    {
+        LOG_ERROR("Cannot take an exposure while streaming.");
+        return false;
+    }
+
     camera->set_exposure_time((double)(duration)*1000000.0);
 
     TIME_VAL_INIT(&this->exposure_transfer_time);
@@ -198,6 +246,27 @@ bool GigECCD::AbortExposure()
     return true;
 }
 
+bool GigECCD::StartStreaming()
+{
+    double const fps = Streamer->getTargetFPS();
+    LOGF_INFO("%s fps=%.2f", __PRETTY_FUNCTION__, fps);
+
+    camera->set_exposure_time(1000000.0 / fps);
+    if (!camera->stream_start(fps, this->_receive_frame_hook, this))
+    {
+        LOG_ERROR("Failed to start the camera stream.");
+        return false;
+    }
+    return true;
+}
+
+bool GigECCD::StopStreaming()
+{
+    LOGF_INFO("%s", __PRETTY_FUNCTION__);
+    camera->stream_stop();
+    return true;
+}
+
 void GigECCD::_update_image(uint8_t const *const data, size_t size)
 {
     LOGF_INFO("Receiving %i bytes image", size);
@@ -224,6 +293,14 @@ void GigECCD::_receive_image_hook(void *const class_ptr, uint8_t const *const da
     cls->_update_image(data, size);
 }
 
+void GigECCD::_receive_frame_hook(void *const class_ptr, uint8_t const *const data, size_t size)
+{
+    /* Called from the stream thread, the data is passed on without an intermediate copy */
+    GigECCD *const cls = static_cast<GigECCD *const>(class_ptr);
+    if (size == (size_t)cls->PrimaryCCD.getFrameBufferSize())
+        cls->Streamer->newFrame(data, size);
+}
+
 void GigECCD::_handle_failed(void)
 {
     LOG_ERROR("Failure occurred, filling image with black");
@@ -263,7 +340,16 @@ void GigECCD::_handle_timeout(struct timeval *const tv, uint32_t timeout_us)
 void GigECCD::TimerHit()
 {
     this->timer_id = this->SetTimer(TIMER_TICK_MS);
-    if (!this->camera->is_connected() || !this->camera->is_exposing())
+    if (!this->camera->is_connected())
+        return;
+
+    if (++this->stats_ticks >= TIMER_STATS_TICKS)
+    {
+        this->stats_ticks = 0;
+        this->_update_stream_statistics();
+    }
+
+    if (!this->camera->is_exposing())
         return;
 
     arv::ARV_EXPOSURE_STATUS const status = camera->exposure_poll(this->_receive_image_hook, this);
@@ -311,6 +397,12 @@ bool GigECCD::UpdateCCDFrame(int x, int y, int w, int h)
 {
     LOGF_INFO("%s x=%i y=%i w=%i h=%i", __PRETTY_FUNCTION__, x, y, w, h);
 
+    if (this->camera->is_streaming())
+    {
+        LOG_ERROR("Cannot change the frame while streaming.");
+        return false;
+    }
+
     this->camera->set_geometry(x, y, w, h);
     return this->_update_geometry();
 }
@@ -31,6 +31,7 @@
 
 #include <deque>
 #include <memory>
+#include <chrono>
 #include <math.h>
 #include <unistd.h>
 #include <sys/mman.h>
@@ -219,6 +220,8 @@ GPhotoCCD::GPhotoCCD(const char * model, const char * port) : FI(this)
 //==========================================================================
 GPhotoCCD::~GPhotoCCD()
 {
+    stopPipeline();
+    libraw_destroy(m_RawProcessor);
     free(on_off[0]);
     free(on_off[1]);
     expTID = 0;
@@ -285,6 +288,25 @@ bool GPhotoCCD::initProperties()
     IUFillSwitchVector(&forceBULBSP, forceBULBS, 2, getDeviceName(), "CCD_FORCE_BLOB", "Force BULB",
                        OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Keep native file
+    IUFillSwitch(&keepNativeS[KEEP_NATIVE_ON], "On", "On", ISS_OFF);
+    IUFillSwitch(&keepNativeS[KEEP_NATIVE_OFF], "Off", "Off", ISS_ON);
+    IUFillSwitchVector(&keepNativeSP, keepNativeS, 2, getDeviceName(), "CCD_KEEP_NATIVE", "Keep Native",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    // Capture pipeline
+    IUFillSwitch(&pipelineS[PIPELINE_ON], "On", "On", ISS_OFF);
+    IUFillSwitch(&pipelineS[PIPELINE_OFF], "Off", "Off", ISS_ON);
+    IUFillSwitchVector(&pipelineSP, pipelineS, 2, getDeviceName(), "CCD_CAPTURE_PIPELINE", "Pipeline",
+                       OPTIONS_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+    // Capture timing
+    IUFillNumber(&captureTimingN[TIMING_DOWNLOAD], "DOWNLOAD_MS", "Download (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&captureTimingN[TIMING_DECODE], "DECODE_MS", "Decode (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumber(&captureTimingN[TIMING_UPLOAD], "UPLOAD_MS", "Upload (ms)", "%.f", 0, 1e6, 0, 0);
+    IUFillNumberVector(&captureTimingNP, captureTimingN, 3, getDeviceName(), "CCD_CAPTURE_TIMING", "Timing",
+                       IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
     // Upload File
     IUFillText(&UploadFileT[0], "PATH", "Path", nullptr);
     IUFillTextVector(&UploadFileTP, UploadFileT, 1, getDeviceName(), "CCD_UPLOAD_FILE", "Upload File", OPTIONS_TAB, IP_RW, 0,
@@ -412,6 +434,9 @@ bool GPhotoCCD::updateProperties()
         }
 
         defineProperty(&forceBULBSP);
+        defineProperty(&keepNativeSP);
+        defineProperty(&pipelineSP);
+        defineProperty(&captureTimingNP);
 
         //timerID = SetTimer(getCurrentPollingPeriod());
     }
@@ -440,6 +465,9 @@ bool GPhotoCCD::updateProperties()
         deleteProperty(SDCardImageSP.name);
 
         deleteProperty(forceBULBSP.name);
+        deleteProperty(keepNativeSP.name);
+        deleteProperty(pipelineSP.name);
+        deleteProperty(captureTimingNP.name);
 
         HideExtendedOptions();
     }
@@ -560,6 +588,34 @@ bool GPhotoCCD::ISNewSwitch(const char * dev, const char * name, ISState * state
             return true;
         }
 
+        if (!strcmp(name, keepNativeSP.name))
+        {
+            if (IUUpdateSwitch(&keepNativeSP, states, names, n) < 0)
+                return false;
+
+            keepNativeSP.s = IPS_OK;
+            if (keepNativeS[KEEP_NATIVE_ON].s == ISS_ON)
+                LOG_INFO("Native images shall be saved to disk before converting them to FITS.");
+            else
+                LOG_INFO("Native images shall be converted to FITS in memory.");
+            IDSetSwitch(&keepNativeSP, nullptr);
+            return true;
+        }
+
+        if (!strcmp(name, pipelineSP.name))
+        {
+            if (IUUpdateSwitch(&pipelineSP, states, names, n) < 0)
+                return false;
+
+            pipelineSP.s = IPS_OK;
+            if (pipelineS[PIPELINE_ON].s == ISS_ON)
+                LOG_INFO("Capture pipeline is enabled. Images are decoded in the background once downloaded from the camera.");
+            else
+                LOG_INFO("Capture pipeline is disabled.");
+            IDSetSwitch(&pipelineSP, nullptr);
+            return true;
+        }
+
         if (!strcmp(name, mExposurePresetSP.name))
         {
             if (IUUpdateSwitch(&mExposurePresetSP, states, names, n) < 0)
@@ -962,6 +1018,7 @@ bool GPhotoCCD::Connect()
 
 bool GPhotoCCD::Disconnect()
 {
+    stopPipeline();
     if (isSimulation())
         return true;
     gphoto_close(gphotodrv);
@@ -987,6 +1044,12 @@ bool GPhotoCCD::StartExposure(float duration)
         return false;
     }
 
+    if (pipelineBacklog() >= PIPELINE_DEPTH)
+    {
+        LOG_ERROR("Previous images are still being decoded.");
+        return false;
+    }
+
     /* start new exposure with last ExpValues settings.
      * ExpGo goes busy. set timer to read when done
      */
@@ -997,8 +1060,6 @@ bool GPhotoCCD::StartExposure(float duration)
     // Microseconds
     uint32_t exp_us = static_cast<uint32_t>(ceil(duration * 1e6));
 
-    PrimaryCCD.setExposureDuration(duration);
-
     if (mMirrorLockN[0].value > 0)
         LOGF_INFO("Starting %g seconds exposure (+%g seconds mirror lock).", duration, mMirrorLockN[0].value);
     else
@@ -1010,6 +1071,8 @@ bool GPhotoCCD::StartExposure(float duration)
         return false;
     }
 
+    PrimaryCCD.setExposureDuration(duration);
+
     ExposureRequest = duration;
     gettimeofday(&ExpStart, nullptr);
     InExposure = true;
@@ -1042,7 +1105,6 @@ bool GPhotoCCD::UpdateCCDFrame(int x, int y, int w, int h)
 // binning
 bool GPhotoCCD::UpdateCCDBin(int hor, int ver)
 {
-
     if(hor == 1 && ver == 1)
     {
         binning = false;
@@ -1176,6 +1238,11 @@ bool GPhotoCCD::grabImage()
     {
         char filename[MAXRBUF] = "/tmp/indi_XXXXXX";
         const char *extension = "unknown";
+        // Image as downloaded from camera, decoded in memory unless the native file should be kept.
+        const char * gphotoFileData = nullptr;
+        unsigned long gphotoFileSize = 0;
+        bool nativeFile = false;
+
         if (isSimulation())
         {
             if (UploadFileT[0].text == nullptr || !UploadFileT[0].text[0])
@@ -1195,12 +1262,21 @@ bool GPhotoCCD::grabImage()
         }
         else
         {
-            int fd = mkstemp(filename);
-            int ret = gphoto_read_exposure_fd(gphotodrv, fd);
-            if (ret != GP_OK || fd == -1)
+            auto downloadStart = std::chrono::steady_clock::now();
+            int fd = -1, ret = GP_OK;
+            if (keepNativeS[KEEP_NATIVE_ON].s == ISS_ON)
+            {
+                fd = mkstemp(filename);
+                ret = gphoto_read_exposure_fd(gphotodrv, fd);
+                nativeFile = true;
+            }
+            else
+                ret = gphoto_read_exposure(gphotodrv);
+
+            if (ret != GP_OK || (nativeFile && fd == -1))
             {
-                if (fd == -1)
-                    LOGF_ERROR("Exposure failed to save image. Cannot create temp file %s", tmpfile);
+                if (nativeFile && fd == -1)
+                    LOGF_ERROR("Exposure failed to save image. Cannot create temp file %s", filename);
                 else
                 {
                     LOGF_ERROR("Exposure failed to save image... %s", gp_result_as_string(ret));
@@ -1208,16 +1284,24 @@ bool GPhotoCCD::grabImage()
                     if (ret == GP_ERROR_DIRECTORY_NOT_FOUND)
                         LOG_INFO("Make sure BULB switch is ON in the camera. Try setting AF switch to OFF.");
                 }
-                unlink(filename);
+                if (nativeFile)
+                    unlink(filename);
                 return false;
             }
 
+            if (!nativeFile)
+                gphoto_get_buffer(gphotodrv, &gphotoFileData, &gphotoFileSize);
+
             extension = gphoto_get_file_extension(gphotodrv);
+            captureTimingN[TIMING_DOWNLOAD].value = std::chrono::duration<double, std::milli>
+                                                    (std::chrono::steady_clock::now() - downloadStart).count();
         }
 
         if (!strcmp(extension, "unknown"))
         {
             LOG_ERROR("Exposure failed.");
+            if (!isSimulation())
+                gphoto_free_buffer(gphotodrv);
             return false;
         }
 
@@ -1225,150 +1309,31 @@ bool GPhotoCCD::grabImage()
         if (ExposureRequest > 3)
             LOG_INFO("Exposure done, downloading image...");
 
-        if (strcasecmp(extension, "jpg") == 0 || strcasecmp(extension, "jpeg") == 0)
-        {
-            if (read_jpeg(filename, &memptr, &memsize, &naxis, &w, &h))
-            {
-                LOG_ERROR("Exposure failed to parse jpeg.");
-                if (!isSimulation())
-                    unlink(filename);
-                return false;
-            }
+        // Camera is free again, pipelined captures are decoded on the worker thread.
+        // Frames queued before the pipeline was turned off are sent first.
+        if (gphotoFileData && (pipelineS[PIPELINE_ON].s == ISS_ON || pipelineBacklog() > 0))
+            return queueImage(gphotoFileData, gphotoFileSize, extension);
 
-            LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
+        bool rc = processImage(gphotoFileData, gphotoFileSize, filename, extension);
 
-            SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
-        }
-        else
+        // Image is processed, release gphoto copy and keep native file around if requested.
+        if (!isSimulation())
+            gphoto_free_buffer(gphotodrv);
+        if (nativeFile)
         {
-            char bayer_pattern[8] = {};
-
-            if (read_libraw(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
-            {
-                LOG_ERROR("Exposure failed to parse raw image.");
-                if (!isSimulation())
-                    unlink(filename);
-                return false;
-            }
-
-            LOGF_DEBUG("read_libraw: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
-                       memsize, naxis, w, h, bpp, bayer_pattern);
-
-            if (!isSimulation())
-                unlink(filename);
-
-            IUSaveText(&BayerT[2], bayer_pattern);
-            IDSetText(&BayerTP, nullptr);
-            SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
-        }
-
-        PrimaryCCD.setImageExtension("fits");
-
-        uint16_t subW = PrimaryCCD.getSubW();
-        uint16_t subH = PrimaryCCD.getSubH();
-
-        // If subframing is requested
-        // If either axis is less than the image resolution
-        // then we subframe, given the OTHER axis is within range as well.
-        if ( (subW > 0 && subH > 0) && ((subW < w && subH <= h) || (subH < h && subW <= w)))
-        {
-
-            uint16_t subX = PrimaryCCD.getSubX();
-            uint16_t subY = PrimaryCCD.getSubY();
-
-            // Align all boundaries to be even
-            // This should fix issues with subframed bayered images.
-            //            subX -= subX % 2;
-            //            subY -= subY % 2;
-            //            subW -= subW % 2;
-            //            subH -= subH % 2;
-
-            int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
-            int oneFrameSize     = subW * subH * bpp / 8;
-
-            int lineW  = subW * bpp / 8;
-
-            LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
-                       subFrameSize, oneFrameSize,
-                       subX, subY, subW, subH);
-
-            if (naxis == 2)
-            {
-                // JM 2020-08-29: Using memmove since regions are overlaping
-                // as proposed by Camiel Severijns on INDI forums.
-                for (int i = subY; i < subY + subH; i++)
-                    memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
-            }
+            char nativeFilename[MAXRBUF];
+            snprintf(nativeFilename, MAXRBUF, "%s.%s", filename, extension);
+            if (rename(filename, nativeFilename) == 0)
+                LOGF_INFO("Native image saved to %s", nativeFilename);
             else
             {
-                uint8_t * subR = memptr;
-                uint8_t * subG = memptr + oneFrameSize;
-                uint8_t * subB = memptr + oneFrameSize * 2;
-
-                uint8_t * startR = memptr;
-                uint8_t * startG = memptr + (w * h * bpp / 8);
-                uint8_t * startB = memptr + (w * h * bpp / 8 * 2);
-
-                for (int i = subY; i < subY + subH; i++)
-                {
-                    memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
-                    memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
-                    memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
-                }
-            }
-
-            PrimaryCCD.setFrameBuffer(memptr);
-            PrimaryCCD.setFrameBufferSize(memsize, false);
-            PrimaryCCD.setResolution(w, h);
-            PrimaryCCD.setFrame(subX, subY, subW, subH);
-            PrimaryCCD.setNAxis(naxis);
-            PrimaryCCD.setBPP(bpp);
-
-            // binning if needed
-            if(binning)
-            {
-
-                // binBayerFrame implemented since 1.9.4
-#if INDI_VERSION_MAJOR >= 1 && INDI_VERSION_MINOR >= 9 && INDI_VERSION_RELEASE >=4
-                PrimaryCCD.binBayerFrame();
-#else
-                PrimaryCCD.binFrame();
-#endif
+                LOGF_WARN("Failed to save native image to %s: %s", nativeFilename, strerror(errno));
+                unlink(filename);
             }
-
-            ExposureComplete(&PrimaryCCD);
-
-            // Restore old pointer and release memory
-            //PrimaryCCD.setFrameBuffer(memptr);
-            //PrimaryCCD.setFrameBufferSize(memsize, false);
-            //delete [] (subframeBuf);
         }
-        else
-        {
-            if (PrimaryCCD.getSubW() != 0 && (w > PrimaryCCD.getSubW() || h > PrimaryCCD.getSubH()))
-                LOGF_WARN("Camera image size (%dx%d) is less than requested size (%d,%d). Purge configuration and update frame size to match camera size.",
-                          w, h, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
-
-            PrimaryCCD.setFrameBuffer(memptr);
-            PrimaryCCD.setFrameBufferSize(memsize, false);
-            PrimaryCCD.setResolution(w, h);
-            PrimaryCCD.setFrame(0, 0, w, h);
-            PrimaryCCD.setNAxis(naxis);
-            PrimaryCCD.setBPP(bpp);
-
-            // binning if needed
-            if(binning)
-            {
-                // binBayerFrame implemented since 1.9.4
-#if INDI_VERSION_MAJOR >= 1 && INDI_VERSION_MINOR >= 9 && INDI_VERSION_RELEASE >=4
-                PrimaryCCD.binBayerFrame();
-#else
-                PrimaryCCD.binFrame();
-#endif
-            }
 
-            ExposureComplete(&PrimaryCCD);
-        }
+        if (rc == false)
+            return false;
     }
 
     // Read Native image AS IS
@@ -1470,6 +1435,411 @@ bool GPhotoCCD::grabImage()
     return true;
 }
 
+bool GPhotoCCD::queueImage(const char * gphotoFileData, unsigned long gphotoFileSize, const char * extension)
+{
+    if (m_PipelineThread.joinable() == false)
+    {
+        m_PipelineRunning = true;
+        m_PipelineThread = std::thread(&GPhotoCCD::pipelineWorker, this);
+    }
+
+    PipelineFrame frame;
+    {
+        // Reuse the memory of a previously sent frame
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        if (!m_PipelineFree.empty())
+        {
+            frame = std::move(m_PipelineFree.back());
+            m_PipelineFree.pop_back();
+        }
+    }
+    frame.data.assign(gphotoFileData, gphotoFileData + gphotoFileSize);
+    frame.extension = extension;
+    gphoto_free_buffer(gphotodrv);
+
+    frame.subX     = PrimaryCCD.getSubX();
+    frame.subY     = PrimaryCCD.getSubY();
+    frame.subW     = PrimaryCCD.getSubW();
+    frame.subH     = PrimaryCCD.getSubH();
+    frame.binX     = PrimaryCCD.getBinX();
+    frame.binY     = PrimaryCCD.getBinY();
+    frame.binning  = binning;
+    frame.duration = ExposureRequest;
+    frame.start    = ExpStart;
+
+    size_t backlog = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        m_PipelineQueue.push_back(std::move(frame));
+        backlog = m_PipelineQueue.size() + m_PipelineDone.size() + (m_PipelineBusy ? 1 : 0);
+    }
+    m_PipelineCondition.notify_all();
+
+    // The camera is released right away, the client may ask for the next exposure while this one
+    // decodes. With the pipeline full, the client is only released when the image is sent.
+    if (backlog < PIPELINE_DEPTH)
+        PrimaryCCD.setExposureComplete();
+
+    // The decoded image is picked up from the main thread
+    if (m_PipelineTimerID == 0)
+        m_PipelineTimerID = IEAddTimer(PIPELINE_POLL, &GPhotoCCD::publishPipelineHelper, this);
+
+    return true;
+}
+
+// Frames downloaded but not sent yet
+size_t GPhotoCCD::pipelineBacklog()
+{
+    std::lock_guard<std::mutex> lock(m_PipelineMutex);
+    return m_PipelineQueue.size() + m_PipelineDone.size() + (m_PipelineBusy ? 1 : 0);
+}
+
+// Only decodes, the chip and the properties are left to the main thread.
+void GPhotoCCD::pipelineWorker()
+{
+    std::unique_lock<std::mutex> lock(m_PipelineMutex);
+    while (true)
+    {
+        m_PipelineCondition.wait(lock, [this]()
+        {
+            return !m_PipelineQueue.empty() || m_PipelineRunning == false;
+        });
+        if (m_PipelineRunning == false)
+            break;
+
+        PipelineFrame frame = std::move(m_PipelineQueue.front());
+        m_PipelineQueue.pop_front();
+        m_PipelineBusy = true;
+        lock.unlock();
+
+        auto decodeStart = std::chrono::steady_clock::now();
+        if (m_PipelineRawProcessor == nullptr)
+            m_PipelineRawProcessor = libraw_create();
+        frame.rc = decodeImage(m_PipelineRawProcessor, reinterpret_cast<const char *>(frame.data.data()),
+                               frame.data.size(), nullptr, frame.extension.c_str(), frame.image);
+        frame.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+
+        lock.lock();
+        m_PipelineBusy = false;
+        m_PipelineDone.push_back(std::move(frame));
+    }
+}
+
+void GPhotoCCD::publishPipelineHelper(void * context)
+{
+    GPhotoCCD * cam = static_cast<GPhotoCCD *>(context);
+    cam->m_PipelineTimerID = 0;
+    cam->publishPipeline();
+}
+
+// Send the frames decoded so far in the order they were taken and check again later while
+// the worker still has frames. Never waits for the worker.
+void GPhotoCCD::publishPipeline()
+{
+    while (true)
+    {
+        PipelineFrame frame;
+        {
+            std::lock_guard<std::mutex> lock(m_PipelineMutex);
+            if (m_PipelineDone.empty())
+            {
+                if (m_PipelineRunning && m_PipelineTimerID == 0 && (m_PipelineBusy || !m_PipelineQueue.empty()))
+                    m_PipelineTimerID = IEAddTimer(PIPELINE_POLL, &GPhotoCCD::publishPipelineHelper, this);
+                return;
+            }
+
+            frame = std::move(m_PipelineDone.front());
+            m_PipelineDone.pop_front();
+        }
+
+        // Frame and binning may have changed since the frame was taken, it is sent with its own
+        // and the current ones are put back afterwards.
+        uint16_t subX = PrimaryCCD.getSubX(), subY = PrimaryCCD.getSubY();
+        uint16_t subW = PrimaryCCD.getSubW(), subH = PrimaryCCD.getSubH();
+        int binX = PrimaryCCD.getBinX(), binY = PrimaryCCD.getBinY();
+        bool currentBinning = binning;
+        bool changed = subX != frame.subX || subY != frame.subY || subW != frame.subW || subH != frame.subH ||
+                       binX != frame.binX || binY != frame.binY || currentBinning != frame.binning;
+        if (changed)
+        {
+            PrimaryCCD.setBin(frame.binX, frame.binY);
+            PrimaryCCD.setFrame(frame.subX, frame.subY, frame.subW, frame.subH);
+            binning = frame.binning;
+        }
+
+        std::unique_lock<std::mutex> guard(ccdBufferLock);
+        // The chip takes over the decoded buffer, its previous one is reused for a later frame
+        uint8_t * previous = PrimaryCCD.getFrameBuffer();
+        bool rc = frameImage(frame.rc, frame.image);
+        if (rc)
+        {
+            frame.image.memptr  = previous;
+            frame.image.memsize = 0;
+        }
+        guard.unlock();
+
+        if (rc)
+        {
+            m_PipelinePublishing = &frame;
+            exposureComplete(frame.decodeMs);
+            m_PipelinePublishing = nullptr;
+        }
+        else
+            PrimaryCCD.setExposureFailed();
+
+        if (changed)
+        {
+            PrimaryCCD.setBin(binX, binY);
+            PrimaryCCD.setFrame(subX, subY, subW, subH);
+            binning = currentBinning;
+        }
+
+        // The next exposure may already be running, its state was overwritten by the frame sent
+        if (InExposure)
+            PrimaryCCD.setExposureLeft(std::max(CalcTimeLeft(), 0.0));
+
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        m_PipelineFree.push_back(std::move(frame));
+    }
+}
+
+void GPhotoCCD::stopPipeline()
+{
+    if (m_PipelineTimerID != 0)
+    {
+        IERmTimer(m_PipelineTimerID);
+        m_PipelineTimerID = 0;
+    }
+
+    if (m_PipelineThread.joinable() == false)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_PipelineMutex);
+        m_PipelineRunning = false;
+    }
+    m_PipelineCondition.notify_all();
+    m_PipelineThread.join();
+
+    // Frames not sent yet are dropped
+    for (auto frames : { &m_PipelineQueue, &m_PipelineDone, &m_PipelineFree })
+    {
+        for (auto &frame : *frames)
+        {
+            if (frame.image.memptr)
+                IDSharedBlobFree(frame.image.memptr);
+        }
+        frames->clear();
+    }
+    m_PipelineBusy = false;
+
+    libraw_destroy(m_PipelineRawProcessor);
+    m_PipelineRawProcessor = nullptr;
+}
+
+// Decode a downloaded image either from memory or from file into image.memptr, reallocated as needed.
+int GPhotoCCD::decodeImage(LibRaw * processor, const char * gphotoFileData, unsigned long gphotoFileSize,
+                           const char * filename, const char * extension, DecodedImage &image)
+{
+    image.isJPEG = strcasecmp(extension, "jpg") == 0 || strcasecmp(extension, "jpeg") == 0;
+    image.naxis  = 2;
+    image.bpp    = 8;
+    image.w = image.h = 0;
+
+    if (image.isJPEG)
+    {
+        if (gphotoFileData)
+            return read_jpeg_buffer(reinterpret_cast<const unsigned char *>(gphotoFileData), gphotoFileSize,
+                                    &image.memptr, &image.memsize, &image.naxis, &image.w, &image.h);
+        return read_jpeg(filename, &image.memptr, &image.memsize, &image.naxis, &image.w, &image.h);
+    }
+
+    if (gphotoFileData)
+        return read_libraw_mem(processor, gphotoFileData, gphotoFileSize, &image.memptr, &image.memsize, &image.naxis,
+                               &image.w, &image.h, &image.bpp, image.bayer_pattern);
+    return read_libraw(processor, filename, &image.memptr, &image.memsize, &image.naxis, &image.w, &image.h, &image.bpp,
+                       image.bayer_pattern);
+}
+
+// Decode a downloaded image straight into the CCD buffer, convert it to the requested frame and send it.
+bool GPhotoCCD::processImage(const char * gphotoFileData, unsigned long gphotoFileSize, const char * filename,
+                             const char * extension)
+{
+    DecodedImage image;
+    image.memptr = PrimaryCCD.getFrameBuffer();
+
+    auto decodeStart = std::chrono::steady_clock::now();
+
+    // Guard CCD Buffer content while the image is decoded into it
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+
+    if (m_RawProcessor == nullptr)
+        m_RawProcessor = libraw_create();
+
+    int rc = decodeImage(m_RawProcessor, gphotoFileData, gphotoFileSize, filename, extension, image);
+    if (frameImage(rc, image) == false)
+        return false;
+
+    guard.unlock();
+    exposureComplete(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count());
+
+    return true;
+}
+
+// Subframe and bin a decoded image into the CCD chip. Called with ccdBufferLock held.
+bool GPhotoCCD::frameImage(int rc, DecodedImage &image)
+{
+    uint8_t * memptr = image.memptr;
+    size_t memsize = image.memsize;
+    int naxis = image.naxis, w = image.w, h = image.h, bpp = image.bpp;
+
+    if (image.isJPEG)
+    {
+        if (rc)
+        {
+            LOG_ERROR("Exposure failed to parse jpeg.");
+            return false;
+        }
+
+        LOGF_DEBUG("read_jpeg: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d)", memsize, naxis, w, h, bpp);
+
+        SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
+    }
+    else
+    {
+        if (rc)
+        {
+            LOG_ERROR("Exposure failed to parse raw image.");
+            return false;
+        }
+
+        LOGF_DEBUG("read_libraw: memsize (%d) naxis (%d) w (%d) h (%d) bpp (%d) bayer pattern (%s)",
+                   memsize, naxis, w, h, bpp, image.bayer_pattern);
+
+        IUSaveText(&BayerT[2], image.bayer_pattern);
+        IDSetText(&BayerTP, nullptr);
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
+    }
+
+    PrimaryCCD.setImageExtension("fits");
+
+    uint16_t subW = PrimaryCCD.getSubW();
+    uint16_t subH = PrimaryCCD.getSubH();
+
+    // If subframing is requested
+    // If either axis is less than the image resolution
+    // then we subframe, given the OTHER axis is within range as well.
+    if ( (subW > 0 && subH > 0) && ((subW < w && subH <= h) || (subH < h && subW <= w)))
+    {
+
+        uint16_t subX = PrimaryCCD.getSubX();
+        uint16_t subY = PrimaryCCD.getSubY();
+
+        // Align all boundaries to be even
+        // This should fix issues with subframed bayered images.
+        //            subX -= subX % 2;
+        //            subY -= subY % 2;
+        //            subW -= subW % 2;
+        //            subH -= subH % 2;
+
+        int subFrameSize     = subW * subH * bpp / 8 * ((naxis == 3) ? 3 : 1);
+        int oneFrameSize     = subW * subH * bpp / 8;
+
+        int lineW  = subW * bpp / 8;
+
+        LOGF_DEBUG("Subframing... subFrameSize: %d - oneFrameSize: %d - subX: %d - subY: %d - subW: %d - subH: %d",
+                   subFrameSize, oneFrameSize,
+                   subX, subY, subW, subH);
+
+        if (naxis == 2)
+        {
+            // JM 2020-08-29: Using memmove since regions are overlaping
+            // as proposed by Camiel Severijns on INDI forums.
+            for (int i = subY; i < subY + subH; i++)
+                memmove(memptr + (i - subY) * lineW, memptr + (i * w + subX) * bpp / 8, lineW);
+        }
+        else
+        {
+            uint8_t * subR = memptr;
+            uint8_t * subG = memptr + oneFrameSize;
+            uint8_t * subB = memptr + oneFrameSize * 2;
+
+            uint8_t * startR = memptr;
+            uint8_t * startG = memptr + (w * h * bpp / 8);
+            uint8_t * startB = memptr + (w * h * bpp / 8 * 2);
+
+            for (int i = subY; i < subY + subH; i++)
+            {
+                memcpy(subR + (i - subY) * lineW, startR + (i * w + subX) * bpp / 8, lineW);
+                memcpy(subG + (i - subY) * lineW, startG + (i * w + subX) * bpp / 8, lineW);
+                memcpy(subB + (i - subY) * lineW, startB + (i * w + subX) * bpp / 8, lineW);
+            }
+        }
+
+        PrimaryCCD.setFrameBuffer(memptr);
+        PrimaryCCD.setFrameBufferSize(memsize, false);
+        PrimaryCCD.setResolution(w, h);
+        PrimaryCCD.setFrame(subX, subY, subW, subH);
+        PrimaryCCD.setNAxis(naxis);
+        PrimaryCCD.setBPP(bpp);
+
+        // binning if needed
+        if(binning)
+        {
+
+            // binBayerFrame implemented since 1.9.4
+#if INDI_VERSION_MAJOR >= 1 && INDI_VERSION_MINOR >= 9 && INDI_VERSION_RELEASE >=4
+            PrimaryCCD.binBayerFrame();
+#else
+            PrimaryCCD.binFrame();
+#endif
+        }
+
+        // Restore old pointer and release memory
+        //PrimaryCCD.setFrameBuffer(memptr);
+        //PrimaryCCD.setFrameBufferSize(memsize, false);
+        //delete [] (subframeBuf);
+    }
+    else
+    {
+        if (PrimaryCCD.getSubW() != 0 && (w > PrimaryCCD.getSubW() || h > PrimaryCCD.getSubH()))
+            LOGF_WARN("Camera image size (%dx%d) is less than requested size (%d,%d). Purge configuration and update frame size to match camera size.",
+                      w, h, PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+
+        PrimaryCCD.setFrameBuffer(memptr);
+        PrimaryCCD.setFrameBufferSize(memsize, false);
+        PrimaryCCD.setResolution(w, h);
+        PrimaryCCD.setFrame(0, 0, w, h);
+        PrimaryCCD.setNAxis(naxis);
+        PrimaryCCD.setBPP(bpp);
+
+        // binning if needed
+        if(binning)
+        {
+            // binBayerFrame implemented since 1.9.4
+#if INDI_VERSION_MAJOR >= 1 && INDI_VERSION_MINOR >= 9 && INDI_VERSION_RELEASE >=4
+            PrimaryCCD.binBayerFrame();
+#else
+            PrimaryCCD.binFrame();
+#endif
+        }
+    }
+
+    return true;
+}
+
+void GPhotoCCD::exposureComplete(double decodeMs)
+{
+    auto uploadStart = std::chrono::steady_clock::now();
+    ExposureComplete(&PrimaryCCD);
+    auto uploadEnd = std::chrono::steady_clock::now();
+
+    captureTimingN[TIMING_DECODE].value = decodeMs;
+    captureTimingN[TIMING_UPLOAD].value = std::chrono::duration<double, std::milli>(uploadEnd - uploadStart).count();
+    captureTimingNP.s = IPS_OK;
+    IDSetNumber(&captureTimingNP, nullptr);
+}
+
 ISwitch * GPhotoCCD::create_switch(const char * basestr, char ** options, int max_opts, int setidx)
 {
     int i;
@@ -2021,6 +2391,12 @@ bool GPhotoCCD::saveConfigItems(FILE * fp)
     // Force BULB Mode
     IUSaveConfigSwitch(fp, &forceBULBSP);
 
+    // Keep native file
+    IUSaveConfigSwitch(fp, &keepNativeSP);
+
+    // Capture pipeline
+    IUSaveConfigSwitch(fp, &pipelineSP);
+
     return true;
 }
 
@@ -2047,6 +2423,19 @@ void GPhotoCCD::addFITSKeywords(INDI::CCDChip * targetChip)
     {
         fits_update_key_s(fptr, TDOUBLE, "CCD-TEMP", &(TemperatureN[0].value), "CCD Temperature (Celsius)", &status);
     }
+
+    // A pipelined frame is sent after the next exposure may have started
+    if (m_PipelinePublishing)
+    {
+        double duration = m_PipelinePublishing->duration;
+        char iso8601[32], timestamp[40];
+        struct tm * tp = gmtime(&m_PipelinePublishing->start.tv_sec);
+        strftime(iso8601, sizeof(iso8601), "%Y-%m-%dT%H:%M:%S", tp);
+        snprintf(timestamp, sizeof(timestamp), "%s.%03d", iso8601,
+                 static_cast<int>(m_PipelinePublishing->start.tv_usec / 1000));
+        fits_update_key_s(fptr, TDOUBLE, "EXPTIME", &duration, "Total Exposure Time (s)", &status);
+        fits_update_key_s(fptr, TSTRING, "DATE-OBS", timestamp, "UTC start date of observation", &status);
+    }
 }
 
 bool GPhotoCCD::UpdateCCDUploadMode(CCD_UPLOAD_MODE mode)
@@ -30,11 +30,15 @@
 #include <map>
 #include <future>
 #include <string>
+#include <deque>
+#include <vector>
+#include <condition_variable>
 
 #define MAXEXPERR 10 /* max err in exp time we allow, secs */
 #define OPENDT    5  /* open retry delay, secs */
 
 typedef struct _Camera Camera;
+class LibRaw;
 
 enum
 {
@@ -148,6 +152,34 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
         double CalcTimeLeft();
         bool grabImage();
 
+        // Image decoded from the camera file, not yet copied to the CCD chip
+        struct DecodedImage
+        {
+            uint8_t * memptr { nullptr };
+            size_t memsize { 0 };
+            int naxis { 2 };
+            int w { 0 };
+            int h { 0 };
+            int bpp { 8 };
+            bool isJPEG { false };
+            char bayer_pattern[8] {};
+        };
+        int decodeImage(LibRaw * processor, const char * gphotoFileData, unsigned long gphotoFileSize,
+                        const char * filename, const char * extension, DecodedImage &image);
+        bool processImage(const char * gphotoFileData, unsigned long gphotoFileSize, const char * filename,
+                          const char * extension);
+        bool frameImage(int rc, DecodedImage &image);
+        void exposureComplete(double decodeMs);
+
+        // Capture pipeline: the decode runs on a worker while the next exposure request is served,
+        // the decoded image is sent from the main thread. The main thread never waits for the worker.
+        bool queueImage(const char * gphotoFileData, unsigned long gphotoFileSize, const char * extension);
+        size_t pipelineBacklog();
+        void pipelineWorker();
+        static void publishPipelineHelper(void * context);
+        void publishPipeline();
+        void stopPipeline();
+
         char name[MAXINDIDEVICE];
         char model[MAXINDINAME];
         char port[MAXINDINAME];
@@ -225,6 +257,32 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
             FORCE_BULB_OFF
         };
 
+        // Keep native image file when converting to FITS, otherwise images are decoded in memory
+        ISwitch keepNativeS[2];
+        ISwitchVectorProperty keepNativeSP;
+        enum
+        {
+            KEEP_NATIVE_ON,
+            KEEP_NATIVE_OFF
+        };
+
+        ISwitch pipelineS[2];
+        ISwitchVectorProperty pipelineSP;
+        enum
+        {
+            PIPELINE_ON,
+            PIPELINE_OFF
+        };
+        // Time spent downloading, decoding and uploading the last image
+        INumber captureTimingN[3];
+        INumberVectorProperty captureTimingNP;
+        enum
+        {
+            TIMING_DOWNLOAD,
+            TIMING_DECODE,
+            TIMING_UPLOAD
+        };
+
         // Upload file, used for testing purposes under simulation under native mode
         ITextVectorProperty UploadFileTP;
         IText UploadFileT[1] {};
@@ -234,6 +292,42 @@ class GPhotoCCD : public INDI::CCD, public INDI::FocuserInterface
 
         Camera * camera = nullptr;
 
+        // Raw decoder reused for every frame
+        LibRaw * m_RawProcessor = nullptr;
+
+        // Capture pipeline
+        struct PipelineFrame
+        {
+            std::vector<uint8_t> data;
+            std::string extension;
+            DecodedImage image;
+            int rc { 0 };
+            double decodeMs { 0 };
+            // Settings the frame was taken with, the chip may have moved on by the time it is sent
+            uint16_t subX { 0 }, subY { 0 }, subW { 0 }, subH { 0 };
+            int binX { 1 }, binY { 1 };
+            bool binning { false };
+            double duration { 0 };
+            struct timeval start {};
+        };
+        std::thread m_PipelineThread;
+        std::mutex m_PipelineMutex;
+        std::condition_variable m_PipelineCondition;
+        // Frames waiting for the worker, being decoded, and decoded but not sent yet
+        std::deque<PipelineFrame> m_PipelineQueue;
+        bool m_PipelineBusy { false };
+        std::deque<PipelineFrame> m_PipelineDone;
+        // Sent frames whose memory is reused
+        std::deque<PipelineFrame> m_PipelineFree;
+        bool m_PipelineRunning { false };
+        // Raw decoder of the worker thread
+        LibRaw * m_PipelineRawProcessor = nullptr;
+        int m_PipelineTimerID { 0 };
+        // Frame being sent, its exposure time and start go into the FITS header
+        const PipelineFrame * m_PipelinePublishing = nullptr;
+        static constexpr size_t PIPELINE_DEPTH = 2;
+        static constexpr uint32_t PIPELINE_POLL = 50;
+
         // Threading
         std::thread liveViewThread;
 
@@ -12,6 +12,8 @@
 #pragma GCC diagnostic pop
 
 
+#include <memory>
+#include <vector>
 #include <unistd.h>
 #include <arpa/inet.h>
 
@@ -136,57 +138,37 @@ int dcraw_parse_header_info(const char *filename, struct dcraw_header *header)
     return 0;
 }
 
-int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
-                char *bayer_pattern)
+// Copy the visible area of an unpacked raw image into the shared BLOB buffer.
+static int copy_libraw(LibRaw *RawProcessor, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h,
+                       int *bitsperpixel, char *bayer_pattern)
 {
-    int ret = 0;
-    // Creation of image processing object
-    LibRaw RawProcessor;
-
-    // Let us open the file
-    if ((ret = RawProcessor.open_file(filename)) != LIBRAW_SUCCESS)
-    {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot open %s: %s", filename, libraw_strerror(ret));
-        RawProcessor.recycle();
-        return -1;
-    }
+    const libraw_image_sizes_t &sizes = RawProcessor->imgdata.rawdata.sizes;
 
-    // Let us unpack the image
-    if ((ret = RawProcessor.unpack()) != LIBRAW_SUCCESS)
+    // Only plain bayer sensors are supported, e.g. no sRAW/Foveon
+    if (RawProcessor->imgdata.rawdata.raw_image == nullptr)
     {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot unpack %s: %s", filename, libraw_strerror(ret));
-        RawProcessor.recycle();
-        return -1;
-    }
-
-    // Covert to image
-    if ((ret = RawProcessor.raw2image()) != LIBRAW_SUCCESS)
-    {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot convert %s : %s", filename, libraw_strerror(ret));
-        RawProcessor.recycle();
+        DEBUGDEVICE(device, INDI::Logger::DBG_ERROR, "Unsupported raw image format: no bayer data.");
         return -1;
     }
 
     *n_axis       = 2;
-    *w            = RawProcessor.imgdata.rawdata.sizes.width;
-    *h            = RawProcessor.imgdata.rawdata.sizes.height;
+    *w            = sizes.width;
+    *h            = sizes.height;
     *bitsperpixel = 16;
     // cdesc contains counter-clock wise e.g. RGBG CFA pattern while we want it sequential as RGGB
-    bayer_pattern[0] = RawProcessor.imgdata.idata.cdesc[RawProcessor.COLOR(0, 0)];
-    bayer_pattern[1] = RawProcessor.imgdata.idata.cdesc[RawProcessor.COLOR(0, 1)];
-    bayer_pattern[2] = RawProcessor.imgdata.idata.cdesc[RawProcessor.COLOR(1, 0)];
-    bayer_pattern[3] = RawProcessor.imgdata.idata.cdesc[RawProcessor.COLOR(1, 1)];
+    bayer_pattern[0] = RawProcessor->imgdata.idata.cdesc[RawProcessor->COLOR(0, 0)];
+    bayer_pattern[1] = RawProcessor->imgdata.idata.cdesc[RawProcessor->COLOR(0, 1)];
+    bayer_pattern[2] = RawProcessor->imgdata.idata.cdesc[RawProcessor->COLOR(1, 0)];
+    bayer_pattern[3] = RawProcessor->imgdata.idata.cdesc[RawProcessor->COLOR(1, 1)];
     bayer_pattern[4] = '\0';
 
-    int first_visible_pixel = RawProcessor.imgdata.rawdata.sizes.raw_width * RawProcessor.imgdata.sizes.top_margin +
-                              RawProcessor.imgdata.sizes.left_margin;
+    int first_visible_pixel = sizes.raw_width * sizes.top_margin + sizes.left_margin;
 
     DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG,
                  "read_libraw: raw_width: %d top_margin %d left_margin %d first_visible_pixel %d",
-                 RawProcessor.imgdata.rawdata.sizes.raw_width, RawProcessor.imgdata.sizes.top_margin,
-                 RawProcessor.imgdata.sizes.left_margin, first_visible_pixel);
+                 sizes.raw_width, sizes.top_margin, sizes.left_margin, first_visible_pixel);
 
-    *memsize = RawProcessor.imgdata.rawdata.sizes.width * RawProcessor.imgdata.rawdata.sizes.height * sizeof(uint16_t);
+    *memsize = sizes.width * sizes.height * sizeof(uint16_t);
     *memptr  = static_cast<uint8_t *>(IDSharedBlobRealloc(*memptr, *memsize));
     if (*memptr == nullptr)
         *memptr = static_cast<uint8_t *>(IDSharedBlobAlloc(*memsize));
@@ -198,83 +180,138 @@ int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_
 
     DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG,
                  "read_libraw: rawdata.sizes.width: %d rawdata.sizes.height %d memsize %d bayer_pattern %s",
-                 RawProcessor.imgdata.rawdata.sizes.width, RawProcessor.imgdata.rawdata.sizes.height, *memsize,
-                 bayer_pattern);
+                 sizes.width, sizes.height, *memsize, bayer_pattern);
 
     uint16_t *image = reinterpret_cast<uint16_t *>(*memptr);
-    uint16_t *src   = RawProcessor.imgdata.rawdata.raw_image + first_visible_pixel;
+    uint16_t *src   = RawProcessor->imgdata.rawdata.raw_image + first_visible_pixel;
 
-    for (int i = 0; i < RawProcessor.imgdata.rawdata.sizes.height; i++)
+    for (int i = 0; i < sizes.height; i++)
     {
-        memcpy(image, src, RawProcessor.imgdata.rawdata.sizes.width * 2);
-        image += RawProcessor.imgdata.rawdata.sizes.width;
-        src += RawProcessor.imgdata.rawdata.sizes.raw_width;
+        memcpy(image, src, sizes.width * 2);
+        image += sizes.width;
+        src += sizes.raw_width;
     }
 
     return 0;
 }
 
-int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxis, int *w, int *h)
+// Unpack an opened raw file/buffer. The processor is always recycled so it can be reused for the next frame.
+static int unpack_libraw(LibRaw *RawProcessor, const char *source, uint8_t **memptr, size_t *memsize, int *n_axis,
+                         int *w, int *h, int *bitsperpixel, char *bayer_pattern)
 {
-    unsigned char *r_data = nullptr, *g_data = nullptr, *b_data = nullptr;
+    int ret = 0;
 
-    /* these are standard libjpeg structures for reading(decompression) */
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    /* libjpeg data structure for storing one row, that is, scanline of an image */
-    JSAMPROW row_pointer[1] = { nullptr };
+    // Let us unpack the image
+    // N.B. raw2image() is not needed since we only copy the bayer data out of raw_image
+    if ((ret = RawProcessor->unpack()) != LIBRAW_SUCCESS)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot unpack %s: %s", source, libraw_strerror(ret));
+        RawProcessor->recycle();
+        return -1;
+    }
 
-    FILE *infile = fopen(filename, "rb");
+    ret = copy_libraw(RawProcessor, memptr, memsize, n_axis, w, h, bitsperpixel, bayer_pattern);
+    RawProcessor->recycle();
+    return ret;
+}
 
-    if (!infile)
+LibRaw *libraw_create()
+{
+    return new LibRaw();
+}
+
+void libraw_destroy(LibRaw *processor)
+{
+    delete processor;
+}
+
+int read_libraw(LibRaw *processor, const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h,
+                int *bitsperpixel, char *bayer_pattern)
+{
+    int ret = 0;
+    // Use a temporary processor if the caller does not keep one around
+    std::unique_ptr<LibRaw> localProcessor;
+    if (processor == nullptr)
     {
-        DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Error opening jpeg file %s!", filename);
+        localProcessor.reset(new LibRaw());
+        processor = localProcessor.get();
+    }
+
+    // Let us open the file
+    if ((ret = processor->open_file(filename)) != LIBRAW_SUCCESS)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot open %s: %s", filename, libraw_strerror(ret));
+        processor->recycle();
         return -1;
     }
-    /* here we set up the standard libjpeg error handler */
-    cinfo.err = jpeg_std_error(&jerr);
-    /* setup decompression process and source, then read JPEG header */
-    jpeg_create_decompress(&cinfo);
-    /* this makes the library read from infile */
-    jpeg_stdio_src(&cinfo, infile);
+
+    return unpack_libraw(processor, filename, memptr, memsize, n_axis, w, h, bitsperpixel, bayer_pattern);
+}
+
+int read_libraw_mem(LibRaw *processor, const void *inBuffer, size_t inSize, uint8_t **memptr, size_t *memsize,
+                    int *n_axis, int *w, int *h, int *bitsperpixel, char *bayer_pattern)
+{
+    int ret = 0;
+    std::unique_ptr<LibRaw> localProcessor;
+    if (processor == nullptr)
+    {
+        localProcessor.reset(new LibRaw());
+        processor = localProcessor.get();
+    }
+
+    // LibRaw only reads from the buffer, it must stay valid until the processor is recycled.
+    if ((ret = processor->open_buffer(const_cast<void *>(inBuffer), inSize)) != LIBRAW_SUCCESS)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "Cannot open raw buffer: %s", libraw_strerror(ret));
+        processor->recycle();
+        return -1;
+    }
+
+    return unpack_libraw(processor, "raw buffer", memptr, memsize, n_axis, w, h, bitsperpixel, bayer_pattern);
+}
+
+// Decompress a JPEG whose source was already set up into separate R, G, B planes (FITS order).
+static int decode_jpeg_planar(struct jpeg_decompress_struct *cinfo, uint8_t **memptr, size_t *memsize, int *naxis,
+                              int *w, int *h)
+{
     /* reading the image header which contains image information */
-    jpeg_read_header(&cinfo, (boolean)TRUE);
+    jpeg_read_header(cinfo, (boolean)TRUE);
 
     /* Start decompression jpeg here */
-    jpeg_start_decompress(&cinfo);
+    jpeg_start_decompress(cinfo);
 
-    *memsize = cinfo.output_width * cinfo.output_height * cinfo.num_components;
+    *memsize = cinfo->output_width * cinfo->output_height * cinfo->num_components;
     *memptr  = static_cast<uint8_t *>(IDSharedBlobRealloc(*memptr, *memsize));
     if (*memptr == nullptr)
         *memptr = static_cast<uint8_t *>(IDSharedBlobAlloc(*memsize));
     if (*memptr == nullptr)
     {
         DEBUGFDEVICE(device, INDI::Logger::DBG_ERROR, "%s: Failed to allocate %d bytes of memory!", __PRETTY_FUNCTION__, *memsize);
+        jpeg_abort_decompress(cinfo);
         return -1;
     }
-    // if you do some ugly pointer math, remember to restore the original pointer or some random crashes will happen. This is why I do not like pointers!!
-    uint8_t *oldmem = *memptr;
-    *naxis = cinfo.num_components;
-    *w     = cinfo.output_width;
-    *h     = cinfo.output_height;
 
-    /* now actually read the jpeg into the raw buffer */
-    row_pointer[0] = (unsigned char *)malloc(cinfo.output_width * cinfo.num_components);
-    if (cinfo.num_components)
-    {
-        r_data = (unsigned char *)*memptr;
-        g_data = r_data + cinfo.output_width * cinfo.output_height;
-        b_data = r_data + 2 * cinfo.output_width * cinfo.output_height;
-    }
+    *naxis = cinfo->num_components;
+    *w     = cinfo->output_width;
+    *h     = cinfo->output_height;
+
+    uint8_t *r_data = *memptr;
+    uint8_t *g_data = r_data + cinfo->output_width * cinfo->output_height;
+    uint8_t *b_data = r_data + 2 * cinfo->output_width * cinfo->output_height;
+
+    /* libjpeg data structure for storing one row, that is, scanline of an image */
+    std::vector<uint8_t> row(cinfo->output_width * cinfo->num_components);
+    JSAMPROW row_pointer[1] = { row.data() };
+
     /* read one scan line at a time */
-    for (unsigned int row = 0; row < cinfo.image_height; row++)
+    while (cinfo->output_scanline < cinfo->output_height)
     {
-        unsigned char *ppm8 = row_pointer[0];
-        jpeg_read_scanlines(&cinfo, row_pointer, 1);
+        const uint8_t *ppm8 = row.data();
+        jpeg_read_scanlines(cinfo, row_pointer, 1);
 
-        if (cinfo.num_components == 3)
+        if (cinfo->num_components == 3)
         {
-            for (unsigned int i = 0; i < cinfo.output_width; i++)
+            for (unsigned int i = 0; i < cinfo->output_width; i++)
             {
                 *r_data++ = *ppm8++;
                 *g_data++ = *ppm8++;
@@ -283,23 +320,63 @@ int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxi
         }
         else
         {
-            memcpy(*memptr, ppm8, cinfo.output_width);
-            *memptr += cinfo.output_width;
+            memcpy(r_data, ppm8, cinfo->output_width);
+            r_data += cinfo->output_width;
         }
     }
 
-    /* wrap up decompression, destroy objects, free pointers and close open files */
-    jpeg_finish_decompress(&cinfo);
+    jpeg_finish_decompress(cinfo);
+    return 0;
+}
+
+int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *naxis, int *w, int *h)
+{
+    /* these are standard libjpeg structures for reading(decompression) */
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+
+    FILE *infile = fopen(filename, "rb");
+
+    if (!infile)
+    {
+        DEBUGFDEVICE(device, INDI::Logger::DBG_DEBUG, "Error opening jpeg file %s!", filename);
+        return -1;
+    }
+    /* here we set up the standard libjpeg error handler */
+    cinfo.err = jpeg_std_error(&jerr);
+    /* setup decompression process and source, then read JPEG header */
+    jpeg_create_decompress(&cinfo);
+    /* this makes the library read from infile */
+    jpeg_stdio_src(&cinfo, infile);
+
+    int rc = decode_jpeg_planar(&cinfo, memptr, memsize, naxis, w, h);
+
+    /* destroy objects and close open files */
     jpeg_destroy_decompress(&cinfo);
+    fclose(infile);
 
-    if (row_pointer[0])
-        free(row_pointer[0]);
-    if (infile)
-        fclose(infile);
+    return rc;
+}
 
-    *memptr = oldmem;
+int read_jpeg_buffer(const unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis,
+                     int *w, int *h)
+{
+    /* these are standard libjpeg structures for reading(decompression) */
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
 
-    return 0;
+    /* here we set up the standard libjpeg error handler */
+    cinfo.err = jpeg_std_error(&jerr);
+    /* setup decompression process and source, then read JPEG header */
+    jpeg_create_decompress(&cinfo);
+    /* this makes the library read from the gphoto buffer */
+    jpeg_mem_src(&cinfo, const_cast<unsigned char *>(inBuffer), inSize);
+
+    int rc = decode_jpeg_planar(&cinfo, memptr, memsize, naxis, w, h);
+
+    jpeg_destroy_decompress(&cinfo);
+
+    return rc;
 }
 
 int read_jpeg_mem(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
@@ -4,9 +4,22 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-int read_libraw(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h, int *bitsperpixel,
-                char *bayer_pattern);
+class LibRaw;
+
+// Persistent LibRaw processor, reused across frames to avoid constructing one per image
+LibRaw *libraw_create();
+void libraw_destroy(LibRaw *processor);
+
+// Decode raw images into 16bit bayer frames. If processor is null, a temporary one is used.
+int read_libraw(LibRaw *processor, const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h,
+                int *bitsperpixel, char *bayer_pattern);
+int read_libraw_mem(LibRaw *processor, const void *inBuffer, size_t inSize, uint8_t **memptr, size_t *memsize,
+                    int *n_axis, int *w, int *h, int *bitsperpixel, char *bayer_pattern);
+// Decode JPEG images into planar R, G, B frames
 int read_jpeg(const char *filename, uint8_t **memptr, size_t *memsize, int *n_axis, int *w, int *h);
+int read_jpeg_buffer(const unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis,
+                     int *w, int *h);
+// Decode JPEG preview frames into packed RGB frames
 int read_jpeg_mem(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
                   int *h);
 int read_jpeg_size(unsigned char *inBuffer, unsigned long inSize, int *w, int *h);
@@ -24,6 +24,7 @@
 
 #include <stream/streammanager.h>
 #include <indielapsedtimer.h>
+#include <pixelconvert.h>
 
 #include "image/image.hpp"
 #include "core/still_options.hpp"
@@ -36,10 +37,14 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <time.h>
 
 #include <libraw.h>
 #include <jpeglib.h>
 
+#include <libcamera/control_ids.h>
+#include <libcamera/formats.h>
+
 
 #define CONTROL_TAB "Controls"
 
@@ -56,6 +61,9 @@ void INDILibCamera::shutdownVideo()
 
 void INDILibCamera::workerStreamVideo(const std::atomic_bool &isAboutToQuit)
 {
+    // Video needs the sensor, release a still session kept alive between exposures
+    stopStillSession();
+
     //m_VideoApp.reset(new LibcameraEncoder());
 
     m_VideoApp->SetEncodeOutputReadyCallback(std::bind(&INDILibCamera::outputReady, this,
@@ -165,12 +173,25 @@ void INDILibCamera::outputReady(void *mem, size_t size, int64_t timestamp_us, bo
 
 void INDILibCamera::shutdownExposure()
 {
-    // m_StillApp->StopCamera();
+    if (m_StillSessionActive)
+        m_StillApp->StopCamera();
     m_StillApp->Teardown();
     m_StillApp->CloseCamera();
+    m_StillCameraOpen = false;
+    m_StillSessionActive = false;
     PrimaryCCD.setExposureFailed();
 }
 
+void INDILibCamera::stopStillSession()
+{
+    if (!m_StillSessionActive)
+        return;
+
+    m_StillApp->StopCamera();
+    m_StillApp->Teardown();
+    m_StillSessionActive = false;
+}
+
 void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float duration)
 {
     //m_StillApp.reset(new LibcameraApp(std::make_unique<StillOptions>()));
@@ -183,12 +204,38 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
     options->denoise = "cdn_off";
 
     unsigned int still_flags = LibcameraApp::FLAG_STILL_RAW;
+    const int captureFormat = IUFindOnSwitchIndex(&CaptureFormatSP);
+    const bool persistent = PersistentSessionSP.findOnSwitchIndex() == INDI_ENABLED;
+
+    // Reuse the running pipeline if nothing but the exposure time changed.
+    if (m_StillSessionActive && (!persistent || m_StillSessionFormat != captureFormat))
+        stopStillSession();
+
+    // Frames that started exposing before this point belong to earlier requests.
+    struct timespec requestTime;
+    clock_gettime(CLOCK_BOOTTIME, &requestTime);
+    const int64_t requestTimestamp = requestTime.tv_sec * 1000000000LL + requestTime.tv_nsec;
 
     try
     {
-        //m_StillApp->OpenCamera();
-        m_StillApp->ConfigureStill(still_flags);
-        m_StillApp->StartCamera();
+        if (m_StillSessionActive)
+        {
+            libcamera::ControlList controls;
+            controls.set(libcamera::controls::ExposureTime, static_cast<int32_t>(options->shutter));
+            m_StillApp->SetControls(controls);
+        }
+        else
+        {
+            if (!m_StillCameraOpen)
+            {
+                m_StillApp->OpenCamera();
+                m_StillCameraOpen = true;
+            }
+            m_StillApp->ConfigureStill(still_flags);
+            m_StillApp->StartCamera();
+            m_StillSessionActive = persistent;
+            m_StillSessionFormat = captureFormat;
+        }
     }
     catch (std::exception &e)
     {
@@ -199,33 +246,56 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
 
     //auto start_time = std::chrono::high_resolution_clock::now();
 
-    LibcameraApp::Msg msg = m_StillApp->Wait();
-    if (msg.type != LibcameraApp::MsgType::RequestComplete)
+    LibcameraApp::Msg msg(LibcameraApp::MsgType::Quit);
+    CompletedRequestPtr payload;
+    while (true)
     {
-        PrimaryCCD.setExposureFailed();
-        LOGF_ERROR("Exposure failed: %d", msg.type);
-        return;
+        msg = m_StillApp->Wait();
+        if (msg.type != LibcameraApp::MsgType::RequestComplete)
+        {
+            PrimaryCCD.setExposureFailed();
+            LOGF_ERROR("Exposure failed: %d", msg.type);
+            return;
+        }
+        else if (isAboutToQuit)
+            return;
+
+        payload = std::get<CompletedRequestPtr>(msg.payload);
+        if (!m_StillSessionActive)
+            break;
+
+        // A running session keeps capturing, so skip stale frames and frames still using the previous exposure time.
+        auto sensorTimestamp = payload->metadata.get(libcamera::controls::SensorTimestamp);
+        auto exposureTime = payload->metadata.get(libcamera::controls::ExposureTime);
+        if (sensorTimestamp && *sensorTimestamp < requestTimestamp)
+            continue;
+        if (exposureTime && std::abs(*exposureTime - options->shutter) > std::max(100.0, options->shutter * 0.02))
+            continue;
+        break;
     }
-    else if (isAboutToQuit)
-        return;
 
     //auto now = std::chrono::high_resolution_clock::now();
 
     auto stream = m_StillApp->StillStream();
-    auto payload = std::get<CompletedRequestPtr>(msg.payload);
     StreamInfo info = m_StillApp->GetStreamInfo(stream);
     const std::vector<libcamera::Span<uint8_t>> mem = m_StillApp->Mmap(payload->buffers[stream]);
 
+    // Raw Bayer data can go straight to the FITS frame without a DNG round trip.
+    StreamInfo rawInfo;
+    auto rawStream = m_StillApp->RawStream(&rawInfo);
+    const bool directRAW = EncodeFormatSP[FORMAT_FITS].getState() == ISS_ON && captureFormat == CAPTURE_DNG &&
+                           rawStream != nullptr && isRAWSupported(rawInfo.pixel_format);
+
     try
     {
         char filename[MAXINDIFORMAT] {0};
 
-        if (IUFindOnSwitchIndex(&CaptureFormatSP) == CAPTURE_DNG)
+        if (!directRAW && captureFormat == CAPTURE_DNG)
         {
             strncpy(filename, "/tmp/output.dng", MAXINDIFORMAT);
             dng_save(mem, info, payload->metadata, filename, m_StillApp->CameraId(), options);
         }
-        else
+        else if (!directRAW)
         {
             strncpy(filename, "/tmp/output.jpg", MAXINDIFORMAT);
             jpeg_save(mem, info, payload->metadata, filename, m_StillApp->CameraId(), options);
@@ -238,7 +308,22 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
 
         if (EncodeFormatSP[FORMAT_FITS].getState() == ISS_ON)
         {
-            if (IUFindOnSwitchIndex(&CaptureFormatSP) == CAPTURE_DNG)
+            if (directRAW)
+            {
+                const std::vector<libcamera::Span<uint8_t>> rawMem = m_StillApp->Mmap(payload->buffers[rawStream]);
+                if (!unpackRAW(rawMem, rawInfo, &memptr, &memsize, &w, &h, bayer_pattern))
+                {
+                    LOG_ERROR("Exposure failed to unpack raw image.");
+                    shutdownExposure();
+                    return;
+                }
+                bpp = 16;
+
+                SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
+                IUSaveText(&BayerT[2], bayer_pattern);
+                IDSetText(&BayerTP, nullptr);
+            }
+            else if (captureFormat == CAPTURE_DNG)
             {
                 if (!processRAW(filename, &memptr, &memsize, &naxis, &w, &h, &bpp, bayer_pattern))
                 {
@@ -391,11 +476,19 @@ void INDILibCamera::workerExposure(const std::atomic_bool &isAboutToQuit, float
             guard.unlock();
         }
 
+        // Release the buffers back to the running session before the image is sent.
+        payload.reset();
+        msg = LibcameraApp::Msg(LibcameraApp::MsgType::Quit);
+
         ExposureComplete(&PrimaryCCD);
 
-        m_StillApp->StopCamera();
-        m_StillApp->Teardown();
-        m_StillApp->CloseCamera();
+        if (!m_StillSessionActive)
+        {
+            m_StillApp->StopCamera();
+            m_StillApp->Teardown();
+            m_StillApp->CloseCamera();
+            m_StillCameraOpen = false;
+        }
     }
     catch (std::exception &e)
     {
@@ -452,6 +545,12 @@ bool INDILibCamera::initProperties()
 
     SetCCDCapability(cap);
 
+    // Persistent still session
+    PersistentSessionSP[INDI_ENABLED].fill("INDI_ENABLED", "Enabled", ISS_OFF);
+    PersistentSessionSP[INDI_DISABLED].fill("INDI_DISABLED", "Disabled", ISS_ON);
+    PersistentSessionSP.fill(getDeviceName(), "PERSISTENT_SESSION", "Keep Session", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60,
+                             IPS_IDLE);
+
     // Add Debug Control.
     addDebugControl();
 
@@ -483,10 +582,12 @@ bool INDILibCamera::updateProperties()
     {
         // Setup camera
         setup();
+
+        defineProperty(PersistentSessionSP);
     }
     else
     {
-
+        deleteProperty(PersistentSessionSP.getName());
     }
 
     return true;
@@ -555,6 +656,7 @@ bool INDILibCamera::Connect()
 
         m_StillApp->OpenCamera();
         m_VideoApp->OpenCamera();
+        m_StillCameraOpen = true;
 
         return true;
     }
@@ -571,6 +673,8 @@ bool INDILibCamera::Connect()
 /////////////////////////////////////////////////////////////////////////////
 bool INDILibCamera::Disconnect()
 {
+    m_Worker.quit();
+    stopStillSession();
     return true;
 }
 
@@ -608,6 +712,19 @@ bool INDILibCamera::ISNewSwitch(const char *dev, const char *name, ISState * sta
             saveConfig(CameraSP);
             return true;
         }
+
+        if (PersistentSessionSP.isNameMatch(name))
+        {
+            PersistentSessionSP.update(states, names, n);
+            PersistentSessionSP.setState(IPS_OK);
+            PersistentSessionSP.apply();
+            if (PersistentSessionSP.findOnSwitchIndex() == INDI_ENABLED)
+                LOG_INFO("Camera shall remain configured between exposures of the same capture format.");
+            else
+                LOG_INFO("Camera shall be configured for each exposure.");
+            saveConfig(PersistentSessionSP);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
@@ -724,6 +841,7 @@ bool INDILibCamera::saveConfigItems(FILE * fp)
     INDI::CCD::saveConfigItems(fp);
 
     IUSaveConfigSwitch(fp, &CameraSP);
+    IUSaveConfigSwitch(fp, &PersistentSessionSP);
 
     return true;
 }
@@ -890,12 +1008,10 @@ bool INDILibCamera::processJPEG(const char *filename, uint8_t **memptr, size_t *
 
         if (cinfo.num_components == 3)
         {
-            for (unsigned int i = 0; i < cinfo.output_width; i++)
-            {
-                *r_data++ = *ppm8++;
-                *g_data++ = *ppm8++;
-                *b_data++ = *ppm8++;
-            }
+            PixelConvert::splitRow(PixelConvert::RGB24, ppm8, r_data, g_data, b_data, cinfo.output_width);
+            r_data += cinfo.output_width;
+            g_data += cinfo.output_width;
+            b_data += cinfo.output_width;
         }
         else
         {
@@ -981,3 +1097,135 @@ int INDILibCamera::processJPEGMemory(unsigned char *inBuffer, unsigned long inSi
 
     return 0;
 }
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////
+namespace
+{
+struct BayerFormat
+{
+    const char *order;
+    int bits;
+    bool packed;
+};
+
+const std::map<libcamera::PixelFormat, BayerFormat> &bayerFormats()
+{
+    static const std::map<libcamera::PixelFormat, BayerFormat> formats =
+    {
+        { libcamera::formats::SRGGB8, { "RGGB", 8, false } },
+        { libcamera::formats::SGRBG8, { "GRBG", 8, false } },
+        { libcamera::formats::SBGGR8, { "BGGR", 8, false } },
+        { libcamera::formats::SGBRG8, { "GBRG", 8, false } },
+        { libcamera::formats::SRGGB10, { "RGGB", 10, false } },
+        { libcamera::formats::SGRBG10, { "GRBG", 10, false } },
+        { libcamera::formats::SBGGR10, { "BGGR", 10, false } },
+        { libcamera::formats::SGBRG10, { "GBRG", 10, false } },
+        { libcamera::formats::SRGGB10_CSI2P, { "RGGB", 10, true } },
+        { libcamera::formats::SGRBG10_CSI2P, { "GRBG", 10, true } },
+        { libcamera::formats::SBGGR10_CSI2P, { "BGGR", 10, true } },
+        { libcamera::formats::SGBRG10_CSI2P, { "GBRG", 10, true } },
+        { libcamera::formats::SRGGB12, { "RGGB", 12, false } },
+        { libcamera::formats::SGRBG12, { "GRBG", 12, false } },
+        { libcamera::formats::SBGGR12, { "BGGR", 12, false } },
+        { libcamera::formats::SGBRG12, { "GBRG", 12, false } },
+        { libcamera::formats::SRGGB12_CSI2P, { "RGGB", 12, true } },
+        { libcamera::formats::SGRBG12_CSI2P, { "GRBG", 12, true } },
+        { libcamera::formats::SBGGR12_CSI2P, { "BGGR", 12, true } },
+        { libcamera::formats::SGBRG12_CSI2P, { "GBRG", 12, true } },
+        { libcamera::formats::SRGGB16, { "RGGB", 16, false } },
+        { libcamera::formats::SGRBG16, { "GRBG", 16, false } },
+        { libcamera::formats::SBGGR16, { "BGGR", 16, false } },
+        { libcamera::formats::SGBRG16, { "GBRG", 16, false } },
+    };
+    return formats;
+}
+}
+
+bool INDILibCamera::isRAWSupported(const libcamera::PixelFormat &format)
+{
+    return bayerFormats().count(format) > 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////
+bool INDILibCamera::unpackRAW(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info, uint8_t **memptr,
+                              size_t *memsize, int *w, int *h, char *bayer_pattern)
+{
+    auto format = bayerFormats().find(info.pixel_format);
+    if (format == bayerFormats().end() || mem.empty())
+        return false;
+
+    const BayerFormat &bayer = format->second;
+    const unsigned int width = info.width, height = info.height;
+
+    if (mem[0].size() < static_cast<size_t>(info.stride) * height)
+    {
+        LOGF_ERROR("Raw buffer too small: %zu bytes for %ux%u stride %u.", mem[0].size(), width, height, info.stride);
+        return false;
+    }
+
+    *w = width;
+    *h = height;
+    strncpy(bayer_pattern, bayer.order, 8);
+
+    *memsize = width * height * sizeof(uint16_t);
+    *memptr  = static_cast<uint8_t *>(IDSharedBlobRealloc(*memptr, *memsize));
+    if (*memptr == nullptr)
+        *memptr = static_cast<uint8_t *>(IDSharedBlobAlloc(*memsize));
+    if (*memptr == nullptr)
+    {
+        LOGF_ERROR("%s: Failed to allocate %d bytes of memory!", __PRETTY_FUNCTION__, *memsize);
+        return false;
+    }
+
+    LOGF_DEBUG("unpackRAW: %ux%u stride %u %d bit%s %s", width, height, info.stride, bayer.bits,
+               bayer.packed ? " packed" : "", bayer_pattern);
+
+    // Pixels keep their native bit depth, same as the values LibRaw reads from the DNG.
+    uint16_t *image = reinterpret_cast<uint16_t *>(*memptr);
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const uint8_t *src = mem[0].data() + static_cast<size_t>(y) * info.stride;
+        uint16_t *dst = image + static_cast<size_t>(y) * width;
+        unsigned int x = 0;
+
+        if (bayer.bits == 8)
+        {
+            for (; x < width; x++)
+                dst[x] = src[x];
+        }
+        else if (!bayer.packed)
+        {
+            memcpy(dst, src, width * sizeof(uint16_t));
+        }
+        else if (bayer.bits == 10)
+        {
+            // MIPI CSI-2 RAW10: 4 pixels in 5 bytes, the 5th byte holds the 2 LSBs of each pixel
+            for (; x + 4 <= width; x += 4, src += 5)
+            {
+                dst[x + 0] = (src[0] << 2) | ((src[4] >> 0) & 0x3);
+                dst[x + 1] = (src[1] << 2) | ((src[4] >> 2) & 0x3);
+                dst[x + 2] = (src[2] << 2) | ((src[4] >> 4) & 0x3);
+                dst[x + 3] = (src[3] << 2) | ((src[4] >> 6) & 0x3);
+            }
+            for (unsigned int i = 0; x < width; x++, i++)
+                dst[x] = (src[i] << 2) | ((src[4] >> (2 * i)) & 0x3);
+        }
+        else
+        {
+            // MIPI CSI-2 RAW12: 2 pixels in 3 bytes, the 3rd byte holds the 4 LSBs of each pixel
+            for (; x + 2 <= width; x += 2, src += 3)
+            {
+                dst[x + 0] = (src[0] << 4) | (src[2] & 0xF);
+                dst[x + 1] = (src[1] << 4) | (src[2] >> 4);
+            }
+            if (x < width)
+                dst[x] = (src[0] << 4) | (src[2] & 0xF);
+        }
+    }
+
+    return true;
+}
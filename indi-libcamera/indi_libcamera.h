@@ -101,6 +101,17 @@ class INDILibCamera : public INDI::CCD
         int processJPEGMemory(unsigned char *inBuffer, unsigned long inSize, uint8_t **memptr, size_t *memsize, int *naxis, int *w,
                           int *h);
 
+        /**
+         * @brief unpackRAW Unpack the mmapped Bayer buffer of the raw stream into 16bit pixels.
+         * @return false if the raw pixel format is not supported, in which case the DNG path must be used.
+         */
+        bool unpackRAW(const std::vector<libcamera::Span<uint8_t>> &mem, const StreamInfo &info, uint8_t **memptr,
+                       size_t *memsize, int *w, int *h, char *bayer_pattern);
+        static bool isRAWSupported(const libcamera::PixelFormat &format);
+
+        /** Stop the still camera if it was kept running between exposures */
+        void stopStillSession();
+
         void shutdownVideo();
         void shutdownExposure();
 
@@ -109,10 +120,17 @@ class INDILibCamera : public INDI::CCD
      private:
 
         INDI::PropertySwitch CameraSP {0};
+        // Keep the still pipeline configured and running between exposures
+        INDI::PropertySwitch PersistentSessionSP {2};
 
         std::unique_ptr<LibcameraApp> m_StillApp;
         std::unique_ptr<LibcameraEncoder> m_VideoApp;
 
         int m_LiveVideoWidth {-1}, m_LiveVideoHeight {-1};
 
+        // Persistent still session
+        bool m_StillCameraOpen {false};
+        bool m_StillSessionActive {false};
+        int m_StillSessionFormat {-1};
+
 };
@@ -37,6 +37,7 @@
 #define MIN_FRAME_SIZE (512)
 #define MAX_FRAME_SIZE (SUBFRAME_SIZE * 16)
 #define SPECTRUM_SIZE  (256)
+#define MAX_FFT_SIZE   (65536)
 
 static class Loader
 {
@@ -99,6 +100,7 @@ bool LIMESDR::Connect()
 ***************************************************************************************/
 bool LIMESDR::Disconnect()
 {
+    stopCapture();
     InIntegration = false;
     LMS_Close(lime_dev);
     setBufferSize(1);
@@ -133,6 +135,16 @@ bool LIMESDR::initProperties()
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_BANDWIDTH", 400.0e+6, 3.8e+9, 1, false);
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_BITSPERSAMPLE", -32, -32, 0, false);
     setIntegrationFileExtension("fits");
+
+    IUFillSwitch(&OutputS[0], "OUTPUT_SPECTRUM", "Power spectrum", ISS_ON);
+    IUFillSwitch(&OutputS[1], "OUTPUT_RAW", "Raw I/Q", ISS_OFF);
+    IUFillSwitchVector(&OutputSP, OutputS, 2, getDeviceName(), "LIMESDR_OUTPUT", "Integration output",
+                       MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&SpectrometerN[0], "FFT_SIZE", "FFT size (power of 2)", "%.0f", 16, MAX_FFT_SIZE, 16, SPECTRUM_SIZE);
+    IUFillNumber(&SpectrometerN[1], "FFT_OVERLAP", "Overlap", "%.2f", 0.0, 0.9, 0.05, 0.5);
+    IUFillNumberVector(&SpectrometerNP, SpectrometerN, 2, getDeviceName(), "LIMESDR_SPECTROMETER", "Spectrometer",
+                       MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
     /*
     // PrimaryReceiver Device Continuum Blob
     IUFillBLOB(&TFitsB[0], "TRMT", "Transmit1", "");
@@ -164,6 +176,8 @@ bool LIMESDR::updateProperties()
         // Inital values
         setupParams(1000000, 1420000000, 10000, 10);
         //defineProperty(&TFitsBP);
+        defineProperty(&OutputSP);
+        defineProperty(&SpectrometerNP);
 
         // Start the timer
         SetTimer(getCurrentPollingPeriod());
@@ -171,11 +185,22 @@ bool LIMESDR::updateProperties()
     else
     {
         //deleteProperty(TFitsBP.name);
+        deleteProperty(OutputSP.name);
+        deleteProperty(SpectrometerNP.name);
     }
 
     return true;
 }
 
+bool LIMESDR::saveConfigItems(FILE *fp)
+{
+    INDI::Receiver::saveConfigItems(fp);
+
+    IUSaveConfigSwitch(fp, &OutputSP);
+    IUSaveConfigNumber(fp, &SpectrometerNP);
+    return true;
+}
+
 /**************************************************************************************
 ** Client is asking us to start an exposure
 ***************************************************************************************/
@@ -188,20 +213,49 @@ bool LIMESDR::StartIntegration(double duration)
     b_read  = 0;
     to_read = getSampleRate() * getIntegrationTime();
 
-    setBufferSize(to_read * sizeof(float));
-
     if (to_read > 0)
     {
+        spectrumOutput = (OutputS[0].s == ISS_ON);
+        if (spectrumOutput)
+        {
+            if (!spectrometer.configure(SpectrometerN[0].value, SpectrometerN[1].value))
+            {
+                LOG_ERROR("Invalid spectrometer settings.");
+                return false;
+            }
+            setBufferSize(spectrometer.fftSize() * sizeof(float));
+        }
+        else
+        {
+            // every sample is an I/Q pair
+            setBufferSize(to_read * 2 * sizeof(float));
+        }
+
+        // the fifo only has to cover the time between two reads of the capture thread
         lime_stream.channel             = 0;
         lime_stream.isTx                = false;
-        lime_stream.fifoSize            = to_read;
+        lime_stream.fifoSize            = MAX_FRAME_SIZE;
         lime_stream.dataFmt             = lms_stream_t::LMS_FMT_F32;
         lime_stream.throughputVsLatency = 0.5;
-        LMS_SetupStream(lime_dev, &lime_stream);
-        LMS_StartStream(&lime_stream);
+        if (LMS_SetupStream(lime_dev, &lime_stream) != 0 || LMS_StartStream(&lime_stream) != 0)
+        {
+            LOG_ERROR("Failed to start the receive stream.");
+            LMS_DestroyStream(lime_dev, &lime_stream);
+            return false;
+        }
         gettimeofday(&CapStart, nullptr);
         InIntegration = true;
-        LOG_INFO("Integration started...");
+
+        captureAbort  = false;
+        captureDone   = false;
+        captureFailed = false;
+        captureThread = std::thread(&LIMESDR::captureLoop, this);
+
+        if (spectrumOutput)
+            LOGF_INFO("Integration started, %d point FFT every %d samples...", (int)spectrometer.fftSize(),
+                      (int)spectrometer.hopSize());
+        else
+            LOG_INFO("Integration started...");
         return true;
     }
 
@@ -231,6 +285,25 @@ void LIMESDR::setupParams(float sr, float freq, float bw, float gain)
 bool LIMESDR::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
     bool r = false;
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, SpectrometerNP.name)) {
+        if (InIntegration) {
+            LOG_WARN("Spectrometer settings cannot be changed during an integration.");
+            SpectrometerNP.s = IPS_ALERT;
+            IDSetNumber(&SpectrometerNP, nullptr);
+            return false;
+        }
+        IUUpdateNumber(&SpectrometerNP, values, names, n);
+
+        // round the FFT size down to a power of two
+        int size = 16;
+        while (size * 2 <= SpectrometerN[0].value && size < MAX_FFT_SIZE)
+            size *= 2;
+        SpectrometerN[0].value = size;
+
+        SpectrometerNP.s = IPS_OK;
+        IDSetNumber(&SpectrometerNP, nullptr);
+        return true;
+    }
     if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ReceiverSettingsNP.name)) {
         for(int i = 0; i < n; i++) {
             if (!strcmp(names[i], "RECEIVER_GAIN")) {
@@ -248,6 +321,23 @@ bool LIMESDR::ISNewNumber(const char *dev, const char *name, double values[], ch
     return processNumber(dev, name, values, names, n) & !r;
 }
 
+bool LIMESDR::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, OutputSP.name)) {
+        if (InIntegration) {
+            LOG_WARN("Integration output cannot be changed during an integration.");
+            OutputSP.s = IPS_ALERT;
+            IDSetSwitch(&OutputSP, nullptr);
+            return false;
+        }
+        IUUpdateSwitch(&OutputSP, states, names, n);
+        OutputSP.s = IPS_OK;
+        IDSetSwitch(&OutputSP, nullptr);
+        return true;
+    }
+    return INDI::Receiver::ISNewSwitch(dev, name, states, names, n);
+}
+
 /**************************************************************************************
 ** Client is asking us to abort a capture
 ***************************************************************************************/
@@ -255,16 +345,54 @@ bool LIMESDR::AbortIntegration()
 {
     if (InIntegration)
     {
-        lms_stream_status_t status;
-        LMS_GetStreamStatus(&lime_stream, &status);
-        if (status.fifoFilledCount <= 0)
+        stopCapture();
+        InIntegration = false;
+        LOG_INFO("Integration aborted.");
+    }
+    return true;
+}
+
+/**************************************************************************************
+** Stops the capture thread and tears down the stream
+***************************************************************************************/
+void LIMESDR::stopCapture()
+{
+    if (!captureThread.joinable())
+        return;
+
+    captureAbort = true;
+    captureThread.join();
+    LMS_StopStream(&lime_stream);
+    LMS_DestroyStream(lime_dev, &lime_stream);
+}
+
+/**************************************************************************************
+** Capture thread, reads the stream in fixed blocks until the integration is complete
+***************************************************************************************/
+void LIMESDR::captureLoop()
+{
+    // raw samples go straight to the integration buffer, the spectrometer
+    // only needs one block at a time
+    std::vector<float> block(spectrumOutput ? SUBFRAME_SIZE * 2 : 0);
+
+    while (!captureAbort && b_read < to_read)
+    {
+        int len = min(SUBFRAME_SIZE, to_read - b_read);
+        float *dest = spectrumOutput ? block.data() : reinterpret_cast<float *>(getBuffer()) + b_read * 2;
+
+        int r = LMS_RecvStream(&lime_stream, dest, len, nullptr, 1000);
+        if (r < 0)
         {
-            InIntegration = false;
-            LMS_StopStream(&lime_stream);
-            LMS_DestroyStream(lime_dev, &lime_stream);
+            captureFailed = true;
+            break;
         }
+
+        if (spectrumOutput)
+            spectrometer.process(dest, r);
+        b_read += r;
     }
-    return true;
+
+    captureDone = true;
 }
 
 /**************************************************************************************
@@ -298,20 +426,14 @@ void LIMESDR::TimerHit()
     if (InIntegration)
     {
         timeleft = CalcTimeLeft();
-        if (timeleft < 0.1)
+        if (captureDone)
         {
             /* We're done capturing */
-            LOG_INFO("Integration done, expecting data...");
-            lms_stream_status_t status;
-            LMS_GetStreamStatus(&lime_stream, &status);
-            if (status.active)
-            {
-                if (status.fifoFilledCount >= status.fifoSize)
-                {
-                    n_read = status.fifoFilledCount;
-                    grabData();
-                }
-            }
+            grabData();
+            timeleft = 0.0;
+        }
+        else if (timeleft < 0.1)
+        {
             timeleft = 0.0;
         }
 
@@ -330,14 +452,29 @@ void LIMESDR::grabData()
 {
     if (InIntegration)
     {
-        continuum = getBuffer();
-        LOG_INFO("Downloading...");
-        LMS_RecvStream(&lime_stream, continuum, n_read, NULL, 1000);
-        LMS_StopStream(&lime_stream);
-        LMS_DestroyStream(lime_dev, &lime_stream);
+        stopCapture();
         InIntegration = false;
 
-        LOG_INFO("Download complete.");
+        if (captureFailed)
+        {
+            LOG_ERROR("Failed to read from the receive stream.");
+            return;
+        }
+
+        if (spectrumOutput)
+        {
+            if (!spectrometer.spectrum(reinterpret_cast<float *>(getBuffer())))
+            {
+                LOG_ERROR("Integration too short for a single FFT.");
+                return;
+            }
+            LOGF_INFO("Integration done, %llu spectra averaged.", (unsigned long long)spectrometer.frames());
+        }
+        else
+        {
+            LOG_INFO("Integration done.");
+        }
+
         IntegrationComplete();
     }
 }
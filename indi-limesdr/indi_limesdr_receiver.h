@@ -20,7 +20,10 @@
 #pragma once
 
 #include <lime/LimeSuite.h>
+#include <atomic>
+#include <thread>
 #include "indireceiver.h"
+#include "spectrometer.h"
 
 enum Settings
 {
@@ -35,6 +38,7 @@ class LIMESDR : public INDI::Receiver
     LIMESDR(uint32_t index);
 
     bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+    bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
 
   protected:
 	// General device functions
@@ -43,6 +47,7 @@ class LIMESDR : public INDI::Receiver
 	const char *getDefaultName() override;
 	bool initProperties() override;
 	bool updateProperties() override;
+	bool saveConfigItems(FILE *fp) override;
 
     // Receiver specific functions
     bool StartIntegration(double duration) override;
@@ -51,6 +56,8 @@ class LIMESDR : public INDI::Receiver
     void TimerHit() override;
 
     void grabData();
+    void captureLoop();
+    void stopCapture();
 
   private:
     lms_device_t *lime_dev = { nullptr };
@@ -64,13 +71,25 @@ class LIMESDR : public INDI::Receiver
 	struct timeval CapStart;
     int to_read;
     int b_read;
-    int n_read;
     float IntegrationRequest;
-	uint8_t* continuum;
-    uint8_t *spectrum;
 
     uint32_t receiverIndex = { 0 };
 
+    // Spectrometer mode accumulates the power spectrum while receiving,
+    // raw mode stores every I/Q sample of the integration
+    Spectrometer spectrometer;
+    bool spectrumOutput = { true };
+    std::thread captureThread;
+    std::atomic<bool> captureAbort = { false };
+    std::atomic<bool> captureDone = { false };
+    std::atomic<bool> captureFailed = { false };
+
+    INumber SpectrometerN[2];
+    INumberVectorProperty SpectrometerNP;
+
+    ISwitch OutputS[2];
+    ISwitchVectorProperty OutputSP;
+
     IBLOB TFitsB[5];
     IBLOBVectorProperty TFitsBP;
 };
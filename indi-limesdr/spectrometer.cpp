@@ -0,0 +1,180 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "spectrometer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+Spectrometer::Spectrometer(size_t fftSize, double overlap)
+{
+    configure(fftSize, overlap);
+}
+
+bool Spectrometer::configure(size_t fftSize, double overlap)
+{
+    if (fftSize < 2 || (fftSize & (fftSize - 1)) != 0 || !(overlap >= 0.0 && overlap < 1.0))
+        return false;
+
+    size = fftSize;
+    hop  = size - static_cast<size_t>(std::floor(size * overlap));
+    if (hop < 1)
+        hop = 1;
+
+    bits = 0;
+    while ((size_t(1) << bits) < size)
+        bits++;
+
+    // Hann window, scaled so the bins hold power per sample for white noise
+    window.resize(size);
+    double sum2 = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        double w  = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / size);
+        window[i] = static_cast<float>(w);
+        sum2 += w * w;
+    }
+    for (size_t i = 0; i < size; i++)
+        window[i] = static_cast<float>(window[i] / std::sqrt(sum2));
+
+    cosTable.resize(size / 2);
+    sinTable.resize(size / 2);
+    for (size_t i = 0; i < size / 2; i++)
+    {
+        cosTable[i] = static_cast<float>(std::cos(2.0 * M_PI * i / size));
+        sinTable[i] = static_cast<float>(-std::sin(2.0 * M_PI * i / size));
+    }
+
+    reversed.resize(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        uint32_t r = 0;
+        for (unsigned b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+    }
+
+    pending.resize(size * 2);
+    re.resize(size);
+    im.resize(size);
+    power.resize(size);
+
+    reset();
+    return true;
+}
+
+void Spectrometer::reset()
+{
+    filled = 0;
+    count  = 0;
+    std::fill(power.begin(), power.end(), 0.0);
+}
+
+void Spectrometer::process(const float *iq, size_t n)
+{
+    while (n > 0)
+    {
+        size_t take = std::min(n, size - filled);
+        memcpy(&pending[filled * 2], iq, take * 2 * sizeof(float));
+        filled += take;
+        iq += take * 2;
+        n -= take;
+
+        if (filled < size)
+            break;
+
+        transform();
+
+        // keep the overlapping tail for the next frame
+        size_t keep = size - hop;
+        memmove(&pending[0], &pending[hop * 2], keep * 2 * sizeof(float));
+        filled = keep;
+    }
+}
+
+long Spectrometer::processFile(const char *path, size_t blockSize)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr)
+        return -1;
+
+    std::vector<float> block(blockSize * 2);
+    long total = 0;
+    size_t n;
+    while ((n = fread(block.data(), 2 * sizeof(float), blockSize, f)) > 0)
+    {
+        process(block.data(), n);
+        total += n;
+    }
+
+    fclose(f);
+    return total;
+}
+
+void Spectrometer::transform()
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        uint32_t r = reversed[i];
+        re[r]      = pending[i * 2] * window[i];
+        im[r]      = pending[i * 2 + 1] * window[i];
+    }
+
+    // iterative radix-2 decimation in time
+    for (size_t len = 2; len <= size; len <<= 1)
+    {
+        size_t half = len >> 1;
+        size_t step = size / len;
+        for (size_t i = 0; i < size; i += len)
+        {
+            for (size_t j = 0; j < half; j++)
+            {
+                float wr = cosTable[j * step];
+                float wi = sinTable[j * step];
+                size_t a = i + j;
+                size_t b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b]    = re[a] - tr;
+                im[b]    = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < size; i++)
+        power[i] += static_cast<double>(re[i]) * re[i] + static_cast<double>(im[i]) * im[i];
+
+    count++;
+}
+
+bool Spectrometer::spectrum(float *out) const
+{
+    if (count == 0)
+        return false;
+
+    // bin 0 is DC, move the negative frequencies in front of it
+    size_t half = size / 2;
+    for (size_t i = 0; i < size; i++)
+        out[i] = static_cast<float>(power[(i + half) % size] / count);
+
+    return true;
+}
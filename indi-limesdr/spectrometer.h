@@ -0,0 +1,80 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Streaming power spectrum integrator. Interleaved float I/Q samples are
+ * fed in blocks of any size, cut into Hann windowed frames of fftSize
+ * samples overlapping by the given fraction, and the power of every frame
+ * is summed into fftSize bins. Memory does not depend on how long it runs.
+ */
+class Spectrometer
+{
+  public:
+    Spectrometer(size_t fftSize = 1024, double overlap = 0.5);
+
+    /* fftSize must be a power of two, overlap in [0, 1). Also resets. */
+    bool configure(size_t fftSize, double overlap);
+
+    /* Drops the accumulated spectrum and any partial frame. */
+    void reset();
+
+    /* Adds count I/Q pairs, iq holds 2 * count floats. */
+    void process(const float *iq, size_t count);
+
+    /* Feeds a raw interleaved float32 I/Q recording through process(), in
+     * blocks of blockSize samples. Returns the number of samples read, or
+     * -1 if the file cannot be opened. */
+    long processFile(const char *path, size_t blockSize = 16384);
+
+    /* Mean power per bin, lowest frequency first with DC in the middle.
+     * out must hold fftSize floats. Returns false if no frame completed. */
+    bool spectrum(float *out) const;
+
+    size_t fftSize() const { return size; }
+    size_t hopSize() const { return hop; }
+    uint64_t frames() const { return count; }
+
+  private:
+    void transform();
+
+    size_t size { 0 };
+    size_t hop { 0 };
+    unsigned bits { 0 };
+
+    /* samples waiting for the next frame */
+    std::vector<float> pending;
+    size_t filled { 0 };
+
+    std::vector<float> window;
+    std::vector<float> cosTable;
+    std::vector<float> sinTable;
+    std::vector<uint32_t> reversed;
+    std::vector<float> re;
+    std::vector<float> im;
+
+    /* doubles so that days of integration do not lose precision */
+    std::vector<double> power;
+    uint64_t count { 0 };
+};
@@ -0,0 +1,145 @@
+//
+// Feeds synthetic I/Q recordings through the spectrometer the receiver
+// uses, and measures how many samples per second it integrates.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <unistd.h>
+#include "spectrometer.h"
+
+// tone at the given bin plus gaussian noise, interleaved I/Q
+static std::vector<float> makeIQ(size_t samples, size_t fftSize, int bin, float noise, unsigned seed = 1) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dist(0.0f, noise);
+    std::vector<float> iq(samples * 2);
+
+    for (size_t i = 0; i < samples; i++) {
+        double phase = 2.0 * M_PI * bin * i / fftSize;
+        iq[i * 2] = std::cos(phase) + dist(gen);
+        iq[i * 2 + 1] = std::sin(phase) + dist(gen);
+    }
+    return iq;
+}
+
+static size_t peak(const std::vector<float>& spectrum) {
+    size_t best = 0;
+    for (size_t i = 1; i < spectrum.size(); i++)
+        if (spectrum[i] > spectrum[best])
+            best = i;
+    return best;
+}
+
+
+TEST(Spectrometer, configure) {
+    Spectrometer spec;
+    ASSERT_FALSE(spec.configure(1000, 0.5));
+    ASSERT_FALSE(spec.configure(1024, 1.0));
+    ASSERT_FALSE(spec.configure(1024, -0.1));
+    ASSERT_TRUE(spec.configure(1024, 0.75));
+    ASSERT_EQ(spec.fftSize(), 1024u);
+    ASSERT_EQ(spec.hopSize(), 256u);
+
+    std::vector<float> out(1024);
+    ASSERT_FALSE(spec.spectrum(out.data()));
+}
+
+
+TEST(Spectrometer, tone) {
+    const size_t N = 256;
+    Spectrometer spec(N, 0.5);
+
+    // positive and negative frequencies land on either side of DC at N/2
+    for (int bin : { 10, -37, 0 }) {
+        spec.reset();
+        auto iq = makeIQ(N * 64, N, bin, 0.5f);
+        spec.process(iq.data(), N * 64);
+
+        std::vector<float> out(N);
+        ASSERT_TRUE(spec.spectrum(out.data()));
+        ASSERT_EQ(peak(out), N / 2 + bin) << "bin " << bin;
+
+        // the window keeps noise at its power per sample, 2 x 0.5^2 here,
+        // a unit tone loses the 1.5 noise bandwidth of the Hann window
+        ASSERT_NEAR(out[N / 2 + bin], N / 1.5, N * 0.05);
+        ASSERT_NEAR(out[N / 2 + bin + 64], 0.5, 0.15);
+    }
+}
+
+
+TEST(Spectrometer, overlap) {
+    const size_t N = 128;
+    auto iq = makeIQ(N * 10, N, 3, 0.1f);
+
+    Spectrometer none(N, 0.0);
+    none.process(iq.data(), N * 10);
+    ASSERT_EQ(none.frames(), 10u);
+
+    Spectrometer half(N, 0.5);
+    half.process(iq.data(), N * 10);
+    ASSERT_EQ(half.frames(), 19u);
+}
+
+
+TEST(Spectrometer, blockSize) {
+    // the result must not depend on how the stream is cut into blocks
+    const size_t N = 512, samples = N * 40 + 123;
+    auto iq = makeIQ(samples, N, 100, 1.0f);
+
+    Spectrometer whole(N, 0.5), pieces(N, 0.5);
+    whole.process(iq.data(), samples);
+
+    size_t pos = 0, len = 1;
+    while (pos < samples) {
+        size_t n = std::min(len, samples - pos);
+        pieces.process(iq.data() + pos * 2, n);
+        pos += n;
+        len = len * 3 + 7;
+    }
+
+    std::vector<float> a(N), b(N);
+    ASSERT_TRUE(whole.spectrum(a.data()));
+    ASSERT_TRUE(pieces.spectrum(b.data()));
+    ASSERT_EQ(whole.frames(), pieces.frames());
+    ASSERT_EQ(a, b);
+}
+
+
+TEST(Spectrometer, recording) {
+    const size_t N = 1024, samples = 1 << 22;
+    auto iq = makeIQ(samples, N, -200, 2.0f);
+
+    char path[] = "/tmp/test_spectrometer_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    FILE *f = fdopen(fd, "wb");
+    ASSERT_EQ(fwrite(iq.data(), 2 * sizeof(float), samples, f), samples);
+    fclose(f);
+
+    Spectrometer spec(N, 0.5);
+    auto t0 = std::chrono::steady_clock::now();
+    long read = spec.processFile(path);
+    auto t1 = std::chrono::steady_clock::now();
+    unlink(path);
+
+    ASSERT_EQ(read, (long)samples);
+
+    std::vector<float> out(N);
+    ASSERT_TRUE(spec.spectrum(out.data()));
+    ASSERT_EQ(peak(out), N / 2 - 200);
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    std::cerr << N << " point FFT, 50% overlap: " << samples / secs / 1e6 << " Msamples/s" << std::endl;
+
+    ASSERT_EQ(Spectrometer().processFile("/nonexistent/iq.raw"), -1);
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
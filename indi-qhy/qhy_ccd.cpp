@@ -30,6 +30,7 @@
 #include <math.h>
 #include <memory>
 #include <deque>
+#include <cerrno>
 
 #define UPDATE_THRESHOLD       0.05   /* Differential temperature threshold (C)*/
 
@@ -275,6 +276,16 @@ bool QHYCCD::initProperties()
     IUFillSwitchVector(&GPSControlSP, GPSControlS, 2, getDeviceName(), "GPS_CONTROL", "GPS Header", GPS_CONTROL_TAB,
                        IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // GPS properties refresh rate while streaming
+    IUFillNumber(&GPSRefreshN[0], "RATE", "Rate (Hz)", "%.1f", 0.1, 100, 1, 1);
+    IUFillNumberVector(&GPSRefreshNP, GPSRefreshN, 1, getDeviceName(), "GPS_REFRESH_RATE", "GPS Refresh", GPS_CONTROL_TAB,
+                       IP_RW, 60, IPS_IDLE);
+
+    // Per-frame GPS timing log
+    IUFillText(&GPSTimingLogT[0], "FILE", "File", "");
+    IUFillTextVector(&GPSTimingLogTP, GPSTimingLogT, 1, getDeviceName(), "GPS_TIMING_LOG", "Timing Log", GPS_CONTROL_TAB,
+                     IP_RW, 60, IPS_IDLE);
+
     /////////////////////////////////////////////////////////////////////////////
     /// Properties: GPS Data
     /////////////////////////////////////////////////////////////////////////////
@@ -387,6 +398,8 @@ void QHYCCD::ISGetProperties(const char *dev)
             defineProperty(&GPSLEDEndPosNP);
 
             defineProperty(&GPSControlSP);
+            defineProperty(&GPSRefreshNP);
+            defineProperty(&GPSTimingLogTP);
 
             defineProperty(&GPSStateLP);
             defineProperty(&GPSDataHeaderTP);
@@ -615,6 +628,8 @@ bool QHYCCD::updateProperties()
             defineProperty(&GPSLEDStartPosNP);
             defineProperty(&GPSLEDEndPosNP);
             defineProperty(&GPSControlSP);
+            defineProperty(&GPSRefreshNP);
+            defineProperty(&GPSTimingLogTP);
 
             defineProperty(&GPSStateLP);
             defineProperty(&GPSDataHeaderTP);
@@ -691,6 +706,8 @@ bool QHYCCD::updateProperties()
             deleteProperty(GPSLEDStartPosNP.name);
             deleteProperty(GPSLEDEndPosNP.name);
             deleteProperty(GPSControlSP.name);
+            deleteProperty(GPSRefreshNP.name);
+            deleteProperty(GPSTimingLogTP.name);
 
             deleteProperty(GPSStateLP.name);
             deleteProperty(GPSDataHeaderTP.name);
@@ -1548,7 +1565,7 @@ int QHYCCD::grabImage()
         LOG_DEBUG("Download complete.");
 
     if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
-        decodeGPSHeader();
+        decodeGPSHeader(PrimaryCCD.getFrameBuffer(), true);
 
     ExposureComplete(&PrimaryCCD);
 
@@ -1900,6 +1917,19 @@ bool QHYCCD::ISNewText(const char *dev, const char *name, char *texts[], char *n
             INDI::FilterInterface::processText(dev, name, texts, names, n);
             return true;
         }
+
+        //////////////////////////////////////////////////////////////////////
+        /// GPS Timing Log
+        //////////////////////////////////////////////////////////////////////
+        if (!strcmp(name, GPSTimingLogTP.name))
+        {
+            IUUpdateText(&GPSTimingLogTP, texts, names, n);
+            GPSTimingLogTP.s = IPS_OK;
+            IDSetText(&GPSTimingLogTP, nullptr);
+            if (GPSTimingLogT[0].text[0])
+                LOGF_INFO("GPS timing of each streamed frame shall be logged to %s.", GPSTimingLogT[0].text);
+            return true;
+        }
     }
 
     return INDI::CCD::ISNewText(dev, name, texts, names, n);
@@ -2135,6 +2165,17 @@ bool QHYCCD::ISNewNumber(const char *dev, const char *name, double values[], cha
             return true;
         }
 
+        //////////////////////////////////////////////////////////////////////
+        /// GPS Refresh Rate
+        //////////////////////////////////////////////////////////////////////
+        else if (!strcmp(name, GPSRefreshNP.name))
+        {
+            IUUpdateNumber(&GPSRefreshNP, values, names, n);
+            GPSRefreshNP.s = IPS_OK;
+            IDSetNumber(&GPSRefreshNP, nullptr);
+            return true;
+        }
+
         //////////////////////////////////////////////////////////////////////
         /// GPS Params
         //////////////////////////////////////////////////////////////////////
@@ -2355,6 +2396,8 @@ bool QHYCCD::saveConfigItems(FILE *fp)
         IUSaveConfigSwitch(fp, &GPSControlSP);
         IUSaveConfigSwitch(fp, &GPSSlavingSP);
         IUSaveConfigNumber(fp, &VCOXFreqNP);
+        IUSaveConfigNumber(fp, &GPSRefreshNP);
+        IUSaveConfigText(fp, &GPSTimingLogTP);
     }
 
     IUSaveConfigNumber(fp, &USBBufferNP);
@@ -2475,6 +2518,9 @@ bool QHYCCD::StartStreaming()
 
     LOGF_INFO("Starting video streaming with exposure %.f seconds (%.f FPS), w=%d h=%d", m_ExposureRequest,
               Streamer->getTargetFPS(), subW, subH);
+    if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
+        openGPSTimingLog();
+
     BeginQHYCCDLive(m_CameraHandle);
     pthread_mutex_lock(&condMutex);
     m_ThreadRequest = StateStream;
@@ -2496,6 +2542,11 @@ bool QHYCCD::StopStreaming()
     pthread_mutex_unlock(&condMutex);
     StopQHYCCDLive(m_CameraHandle);
 
+    // Flush remaining timing records and publish the last decoded header
+    closeGPSTimingLog();
+    if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
+        updateGPSProperties();
+
     //LOG_INFO("stopped live mode"); //DEBUG
 
     //if (HasUSBSpeed)
@@ -2595,8 +2646,9 @@ void QHYCCD::streamVideo()
         {
             Streamer->newFrame(buffer, w * h * bpp / 8 * channels);
 
+            // Header is decoded for every frame, but properties are only refreshed at GPS_REFRESH_RATE.
             if (HasGPS && GPSControlS[INDI_ENABLED].s == ISS_ON)
-                decodeGPSHeader();
+                decodeGPSHeader(buffer, false);
 
             //DEBUG
             //if(!frames)
@@ -2818,115 +2870,124 @@ void QHYCCD::setLEDStartPosNP(const INumberVectorProperty &value)
     GPSLEDStartPosNP = value;
 }
 
-void QHYCCD::decodeGPSHeader()
+void QHYCCD::decodeGPSHeader(const uint8_t *gpsarray, bool publish)
 {
-    char ts[64] = {0}, iso8601[64] = {0}, data[64] = {0};
-
-    uint8_t gpsarray[64] = {0};
-    memcpy(gpsarray, PrimaryCCD.getFrameBuffer(), 64);
-
     // Sequence Number
     GPSHeader.seqNumber = gpsarray[0] << 24 | gpsarray[1] << 16 | gpsarray[2] << 8 | gpsarray[3];
-    snprintf(data, 64, "%u", GPSHeader.seqNumber);
-    IUSaveText(&GPSDataHeaderT[GPS_DATA_SEQ_NUMBER], data);
-
     GPSHeader.tempNumber = gpsarray[4];
 
-    // Width
+    // Width & Height
     GPSHeader.width = gpsarray[5] << 8 | gpsarray[6];
+    GPSHeader.height = gpsarray[7] << 8 | gpsarray[8];
+
+    // Latitude & Longitude
+    GPSHeader.latitude = gpsarray[9] << 24 | gpsarray[10] << 16 | gpsarray[11] << 8 | gpsarray[12];
+    GPSHeader.longitude = gpsarray[13] << 24 | gpsarray[14] << 16 | gpsarray[15] << 8 | gpsarray[16];
+
+    // Start Flag, Seconds and microseconds
+    // It's a 10Mhz crystal so we divide by 10 to get microseconds
+    GPSHeader.start_flag = gpsarray[17];
+    GPSHeader.start_sec = gpsarray[18] << 24 | gpsarray[19] << 16 | gpsarray[20] << 8 | gpsarray[21];
+    GPSHeader.start_us = (gpsarray[22] << 16 | gpsarray[23] << 8 | gpsarray[24]) / 10.0;
+    GPSHeader.start_jd = JStoJD(GPSHeader.start_sec, GPSHeader.start_us);
+
+    // End Flag, Seconds and microseconds
+    GPSHeader.end_flag = gpsarray[25];
+    GPSHeader.end_sec = gpsarray[26] << 24 | gpsarray[27] << 16 | gpsarray[28] << 8 | gpsarray[29];
+    GPSHeader.end_us = (gpsarray[30] << 16 | gpsarray[31] << 8 | gpsarray[32]) / 10.0;
+    GPSHeader.end_jd = JStoJD(GPSHeader.end_sec, GPSHeader.end_us);
+
+    // Now Flag, Seconds and microseconds
+    GPSHeader.now_flag = gpsarray[33];
+    GPSHeader.now_sec = gpsarray[34] << 24 | gpsarray[35] << 16 | gpsarray[36] << 8 | gpsarray[37];
+    GPSHeader.now_us = (gpsarray[38] << 16 | gpsarray[39] << 8 | gpsarray[40]) / 10.0;
+    GPSHeader.now_jd = JStoJD(GPSHeader.now_sec, GPSHeader.now_us);
+
+    // PPS
+    GPSHeader.max_clock = gpsarray[41] << 16 | gpsarray[42] << 8 | gpsarray[43];
+
+    if (m_GPSLogFile)
+    {
+        GPSFrameRecord record;
+        record.frame = m_GPSFrameCounter++;
+        record.seqNumber = GPSHeader.seqNumber;
+        record.start_sec = GPSHeader.start_sec;
+        record.start_us = GPSHeader.start_us;
+        record.end_sec = GPSHeader.end_sec;
+        record.end_us = GPSHeader.end_us;
+        record.now_sec = GPSHeader.now_sec;
+        record.now_us = GPSHeader.now_us;
+        record.now_flag = GPSHeader.now_flag;
+        record.max_clock = GPSHeader.max_clock;
+        m_GPSRecords.push_back(record);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!publish)
+    {
+        std::chrono::duration<double> elapsed = now - m_GPSLastUpdate;
+        publish = elapsed.count() >= 1.0 / GPSRefreshN[0].value;
+    }
+
+    if (publish)
+    {
+        m_GPSLastUpdate = now;
+        flushGPSTimingLog();
+        updateGPSProperties();
+    }
+}
+
+void QHYCCD::updateGPSProperties()
+{
+    char ts[64] = {0}, iso8601[64] = {0}, data[64] = {0};
+
+    snprintf(data, 64, "%u", GPSHeader.seqNumber);
+    IUSaveText(&GPSDataHeaderT[GPS_DATA_SEQ_NUMBER], data);
     snprintf(data, 64, "%u", GPSHeader.width);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_WIDTH], data);
-
-    // Height
-    GPSHeader.height = gpsarray[7] << 8 | gpsarray[8];
     snprintf(data, 64, "%u", GPSHeader.height);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_HEIGHT], data);
-
-    // Latitude
-    GPSHeader.latitude = gpsarray[9] << 24 | gpsarray[10] << 16 | gpsarray[11] << 8 | gpsarray[12];
     snprintf(data, 64, "%u", GPSHeader.latitude);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_LATITUDE], data);
-
-    // Longitude
-    GPSHeader.longitude = gpsarray[13] << 24 | gpsarray[14] << 16 | gpsarray[15] << 8 | gpsarray[16];
     snprintf(data, 64, "%u", GPSHeader.longitude);
     IUSaveText(&GPSDataHeaderT[GPS_DATA_LONGITUDE], data);
+    snprintf(data, 64, "%u", GPSHeader.max_clock);
+    IUSaveText(&GPSDataHeaderT[GPS_DATA_MAX_CLOCK], data);
 
-    // Start Flag
-    GPSHeader.start_flag = gpsarray[17];
+    // Start
     snprintf(data, 64, "%u", GPSHeader.start_flag);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_FLAG], data);
-
-    // Start Seconds
-    GPSHeader.start_sec = gpsarray[18] << 24 | gpsarray[19] << 16 | gpsarray[20] << 8 | gpsarray[21];
     snprintf(data, 64, "%u", GPSHeader.start_sec);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_SEC], data);
-
-    // Start microseconds
-    // It's a 10Mhz crystal so we divide by 10 to get microseconds
-    GPSHeader.start_us = (gpsarray[22] << 16 | gpsarray[23] << 8 | gpsarray[24]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.start_us);
     IUSaveText(&GPSDataStartT[GPS_DATA_START_USEC], data);
-
-    // Start JD
-    GPSHeader.start_jd = JStoJD(GPSHeader.start_sec, GPSHeader.start_us);
-    // Get ISO8601
+    // Get ISO8601 and add millisecond
     JDtoISO8601(GPSHeader.start_jd, iso8601);
-    // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.start_us / 1000.0));
     IUSaveText(&GPSDataStartT[GPS_DATA_START_TS], ts);
 
-    // End Flag
-    GPSHeader.end_flag = gpsarray[25];
+    // End
     snprintf(data, 64, "%u", GPSHeader.end_flag);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_FLAG], data);
-
-    // End Seconds
-    GPSHeader.end_sec = gpsarray[26] << 24 | gpsarray[27] << 16 | gpsarray[28] << 8 | gpsarray[29];
     snprintf(data, 64, "%u", GPSHeader.end_sec);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_SEC], data);
-
-    // End Microseconds
-    GPSHeader.end_us = (gpsarray[30] << 16 | gpsarray[31] << 8 | gpsarray[32]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.end_us);
     IUSaveText(&GPSDataEndT[GPS_DATA_END_USEC], data);
-
-    // End JD
-    GPSHeader.end_jd = JStoJD(GPSHeader.end_sec, GPSHeader.end_us);
-    // Get ISO8601
     JDtoISO8601(GPSHeader.end_jd, iso8601);
-    // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.end_us / 1000.0));
     IUSaveText(&GPSDataEndT[GPS_DATA_END_TS], ts);
 
-    // Now Flag
-    GPSHeader.now_flag = gpsarray[33];
+    // Now
     snprintf(data, 64, "%u", GPSHeader.now_flag);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_FLAG], data);
-
-    // Now Seconds
-    GPSHeader.now_sec = gpsarray[34] << 24 | gpsarray[35] << 16 | gpsarray[36] << 8 | gpsarray[37];
     snprintf(data, 64, "%u", GPSHeader.now_sec);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_SEC], data);
-
-    // Now microseconds
-    GPSHeader.now_us = (gpsarray[38] << 16 | gpsarray[39] << 8 | gpsarray[40]) / 10.0;
     snprintf(data, 64, "%.1f", GPSHeader.now_us);
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_USEC], data);
-
-    // Now JD
-    GPSHeader.now_jd = JStoJD(GPSHeader.now_sec, GPSHeader.now_us);
-    // Get ISO8601
     JDtoISO8601(GPSHeader.now_jd, iso8601);
-    // Add millisecond
     snprintf(ts, sizeof(ts), "%s.%03d", iso8601, static_cast<int>(GPSHeader.now_us / 1000.0));
     IUSaveText(&GPSDataNowT[GPS_DATA_NOW_TS], ts);
 
-    // PPS
-    GPSHeader.max_clock = gpsarray[41] << 16 | gpsarray[42] << 8 | gpsarray[43];
-    snprintf(data, 64, "%u", GPSHeader.max_clock);
-    IUSaveText(&GPSDataHeaderT[GPS_DATA_MAX_CLOCK], data);
-
     IDSetText(&GPSDataHeaderTP, nullptr);
     IDSetText(&GPSDataStartTP, nullptr);
     IDSetText(&GPSDataEndTP, nullptr);
@@ -2946,6 +3007,63 @@ void QHYCCD::decodeGPSHeader()
     }
 }
 
+void QHYCCD::openGPSTimingLog()
+{
+    closeGPSTimingLog();
+
+    m_GPSFrameCounter = 0;
+    m_GPSLastUpdate = std::chrono::steady_clock::time_point();
+
+    if (GPSTimingLogT[0].text == nullptr || GPSTimingLogT[0].text[0] == 0)
+        return;
+
+    m_GPSLogFile = fopen(GPSTimingLogT[0].text, "w");
+    if (m_GPSLogFile == nullptr)
+    {
+        LOGF_ERROR("Failed to open GPS timing log %s: %s", GPSTimingLogT[0].text, strerror(errno));
+        GPSTimingLogTP.s = IPS_ALERT;
+        IDSetText(&GPSTimingLogTP, nullptr);
+        return;
+    }
+
+    // Keep raw seconds and microseconds, a double JD cannot hold microsecond resolution.
+    fprintf(m_GPSLogFile, "frame,seq,start_sec,start_us,start_jd,end_sec,end_us,end_jd,now_sec,now_us,now_jd,now_flag,max_clock\n");
+    m_GPSRecords.reserve(1024);
+    GPSTimingLogTP.s = IPS_BUSY;
+    IDSetText(&GPSTimingLogTP, nullptr);
+}
+
+void QHYCCD::flushGPSTimingLog()
+{
+    if (m_GPSLogFile == nullptr)
+        return;
+
+    for (const auto &record : m_GPSRecords)
+    {
+        fprintf(m_GPSLogFile, "%u,%u,%u,%.1f,%.9f,%u,%.1f,%.9f,%u,%.1f,%.9f,%u,%u\n",
+                record.frame, record.seqNumber,
+                record.start_sec, record.start_us, JStoJD(record.start_sec, record.start_us),
+                record.end_sec, record.end_us, JStoJD(record.end_sec, record.end_us),
+                record.now_sec, record.now_us, JStoJD(record.now_sec, record.now_us),
+                record.now_flag, record.max_clock);
+    }
+    m_GPSRecords.clear();
+}
+
+void QHYCCD::closeGPSTimingLog()
+{
+    if (m_GPSLogFile == nullptr)
+        return;
+
+    flushGPSTimingLog();
+    fclose(m_GPSLogFile);
+    m_GPSLogFile = nullptr;
+
+    LOGF_INFO("GPS timing of %u frames saved to %s.", m_GPSFrameCounter, GPSTimingLogT[0].text);
+    GPSTimingLogTP.s = IPS_OK;
+    IDSetText(&GPSTimingLogTP, nullptr);
+}
+
 double QHYCCD::JStoJD(uint32_t JS, double us)
 {
     // Convert Julian seconds (plus microsecond) to Julian Days since epoch 2450000
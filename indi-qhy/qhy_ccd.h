@@ -27,6 +27,9 @@
 #include <unistd.h>
 #include <functional>
 #include <pthread.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
 
 #define DEVICE struct usb_device *
 
@@ -239,6 +242,14 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         ISwitchVectorProperty GPSControlSP;
         ISwitch GPSControlS[2];
 
+        // GPS property refresh rate while streaming (Hz)
+        INumberVectorProperty GPSRefreshNP;
+        INumber GPSRefreshN[1];
+
+        // Per-frame GPS timing log written while streaming
+        ITextVectorProperty GPSTimingLogTP;
+        IText GPSTimingLogT[1] {};
+
         // GPS Status
         ILightVectorProperty GPSStateLP;
         ILight GPSStateL[4];
@@ -382,6 +393,25 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
             time_t frame_time;
         } GPSData;
 
+        // Compact per-frame GPS record kept at full frame rate while streaming
+        struct GPSFrameRecord
+        {
+            uint32_t frame;
+            uint32_t seqNumber;
+            uint32_t start_sec;
+            double start_us;
+            uint32_t end_sec;
+            double end_us;
+            uint32_t now_sec;
+            double now_us;
+            uint8_t now_flag;
+            uint32_t max_clock;
+        };
+        std::vector<GPSFrameRecord> m_GPSRecords;
+        FILE *m_GPSLogFile { nullptr };
+        uint32_t m_GPSFrameCounter { 0 };
+        std::chrono::steady_clock::time_point m_GPSLastUpdate;
+
 
         /////////////////////////////////////////////////////////////////////////////
         /// Image Capture
@@ -414,8 +444,14 @@ class QHYCCD : public INDI::CCD, public INDI::FilterInterface
         bool isQHY5PIIC();
         // Call when max filter count is known
         bool updateFilterProperties();
-        // Decode GPS Header
-        void decodeGPSHeader();
+        // Decode GPS Header. Properties are only published if requested or once the refresh period elapsed.
+        void decodeGPSHeader(const uint8_t *frame, bool publish);
+        // Send the last decoded GPS header to the client
+        void updateGPSProperties();
+        // Open/close the per-frame GPS timing log
+        void openGPSTimingLog();
+        void closeGPSTimingLog();
+        void flushGPSTimingLog();
         /**
          * @brief JStoJD Convert Julian Second to Julian Date
          * @param JS Julian Second
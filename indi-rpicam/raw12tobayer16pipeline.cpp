@@ -18,14 +18,9 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-#include <iostream>
-#include <cassert>
 
 #include "raw12tobayer16pipeline.h"
-#include "broadcompipeline.h"
-#include "chipwrapper.h"
-
-#include <fstream>
+#include "rawunpack.h"
 
 /**
  * Decoding the RAW12 format (not the official one, the Broadcom one) which is rows of:
@@ -34,79 +29,15 @@
  *
  * h = high 8 bits, l = low 4 bits
  *
- * If subframes are used. The mapping from subframe image start x to first RAW12 x in received buffer is as:
- * x pixel:     0  1  -  2  3  -  4  5  -  6  7  -
- *                       |
- *                       V
- * Raw12 byte:  0  1  2  3  4  5  6  7  8  9  10 11
- *              B  G  bg B  G  bg B  G  bg B  G  bg
- *
- * To simplify, start all raw lines on bayer group boundry
- * startRawX = (getSubX() / 2) * 3
+ * Subframes may start on any pixel, the unpacker finds the 3 byte group holding it.
  */
 
-void Raw12ToBayer16Pipeline::reset()
+void Raw12ToBayer16Pipeline::unpack_row(const uint8_t *row, uint16_t *dst, uint32_t x, uint32_t count)
 {
-    x = 0;
-    y = 0;
-    state = 0;
-    startRawX = (ccd->getSubX() / 2) * 3;
-    raw_x = 0;
-    raw_y = 0;
+    RawUnpack::raw12Row(row, dst, x, count);
 }
 
-void Raw12ToBayer16Pipeline::data_received(uint8_t *data,  uint32_t length)
+uint32_t Raw12ToBayer16Pipeline::row_pixels(uint32_t bytes) const
 {
-    uint8_t byte;
-
-    assert(bcm_pipe->header.omx_data.raw_width == 6112); 
-    assert(ccd->getXRes() == 4056);
-    assert(ccd->getYRes() == 3040);
-
-    int maxX = ccd->getSubW();
-    int maxY = ccd->getSubH();
-
-    for(;length; data++, length--)
-    {
-        byte = *data;
-
-        if (raw_x >= bcm_pipe->header.omx_data.raw_width) {
-            x = 0;
-            raw_x = 0;
-            state = 0;
-
-            raw_y++;
-            if (raw_y > ccd->getSubY()) {
-                y += 1;
-            }
-        }
-
-        if (raw_x >= startRawX && raw_y >= ccd->getSubY() && x < maxX && y < maxY) {
-            uint16_t *cur_row = reinterpret_cast<uint16_t *>(ccd->getFrameBuffer()) + y * ccd->getSubW();
-
-            // RAW according to experiment.
-            switch(state)
-            {
-            case 0:
-                // FIXME: Optimize, if at least 3 bytes remaining here, all data can be calculated faster in one step.
-                cur_row[x] = byte << 8;
-                state = 1;
-                break;
-
-            case 1:
-                cur_row[x+1] = byte << 8;
-                state = 2;
-                break;
-
-            case 2:
-                cur_row[x+0] |= static_cast<uint16_t>((byte & 0x0F) << 4);
-                cur_row[x+1] |= static_cast<uint16_t>((byte & 0xF0) << 0);
-                x += 2;
-                state = 0;
-                break;
-            }
-        }
-
-        raw_x++;
-    }
+    return RawUnpack::raw12Pixels(bytes);
 }
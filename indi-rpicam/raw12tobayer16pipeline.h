@@ -18,14 +18,11 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+
 #ifndef RAW12TOBAYER16PIPELINE_H
 #define RAW12TOBAYER16PIPELINE_H
 
-#include <cstddef>
-#include "pipeline.h"
-
-struct BroadcomPipeline;
-class ChipWrapper;
+#include "rawtobayer16pipeline.h"
 
 /**
  * @brief The Raw12ToBayer16Pipeline class
@@ -34,23 +31,14 @@ class ChipWrapper;
  *                                   b1                                      b2                               b3
  * Odd lines are swapped R->G, G-B
  */
-class Raw12ToBayer16Pipeline : public Pipeline
+class Raw12ToBayer16Pipeline : public RawToBayer16Pipeline
 {
 public:
-    Raw12ToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd) : Pipeline(), bcm_pipe(bcm_pipe), ccd(ccd) {}
-
-    virtual void data_received(uint8_t *data,  uint32_t length) override;
-    virtual void reset() override;
-
-private:
-    const BroadcomPipeline *bcm_pipe;
-    ChipWrapper *ccd;
-    int x {0};
-    int y {0};
-    int raw_x {0}; //! Position in the raw-data comming in.
-    int raw_y {0}; //! Position in the raw-data comming in.
-    int startRawX {0};
-    uint8_t state = 0; //! Which byte in the RAW12 format (see above).
+    Raw12ToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd) : RawToBayer16Pipeline(bcm_pipe, ccd) {}
+
+protected:
+    virtual void unpack_row(const uint8_t *row, uint16_t *dst, uint32_t x, uint32_t count) override;
+    virtual uint32_t row_pixels(uint32_t bytes) const override;
 };
 
 #endif // RAW12TOBAYER16PIPELINE_H
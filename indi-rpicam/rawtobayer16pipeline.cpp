@@ -0,0 +1,102 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+ Copyright (C) 2020 Lars Berntzon (lars.berntzon@cecilia-data.se).
+ All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "rawtobayer16pipeline.h"
+#include "broadcompipeline.h"
+#include "chipwrapper.h"
+
+void RawToBayer16Pipeline::reset()
+{
+    frame_buffer = reinterpret_cast<uint16_t *>(ccd->getFrameBuffer());
+    startX = ccd->getSubX();
+    startY = ccd->getSubY();
+    subW = ccd->getSubW();
+    subH = ccd->getSubH();
+
+    // Never write past the frame buffer, whatever the subframe claims.
+    if (subW > 0) {
+        subH = std::min<uint32_t>(subH, ccd->getFrameBufferSize() / (subW * sizeof(uint16_t)));
+    }
+
+    raw_y = 0;
+    line_fill = 0;
+}
+
+void RawToBayer16Pipeline::store_row(const uint8_t *row)
+{
+    uint32_t pixels = row_pixels(raw_width);
+    if (startX >= pixels) {
+        return;
+    }
+
+    uint16_t *dst = frame_buffer + (raw_y - startY) * subW;
+    unpack_row(row, dst, startX, std::min(subW, pixels - startX));
+}
+
+void RawToBayer16Pipeline::data_received(uint8_t *data,  uint32_t length)
+{
+    raw_width = bcm_pipe->header.omx_data.raw_width;
+    if (raw_width == 0) {
+        throw std::runtime_error("Raw data received before broadcom header.");
+    }
+    if (line.size() < raw_width) {
+        line.resize(raw_width);
+    }
+
+    const uint32_t endY = startY + subH;
+
+    // Anything after the last scanline of the subframe is ignored.
+    while(length > 0 && raw_y < endY)
+    {
+        bool wanted = raw_y >= startY;
+
+        // Whole scanline available in this buffer, unpack in place.
+        if (line_fill == 0 && length >= raw_width) {
+            if (wanted) {
+                store_row(data);
+            }
+            data += raw_width;
+            length -= raw_width;
+            raw_y++;
+            continue;
+        }
+
+        uint32_t n = std::min(length, raw_width - line_fill);
+        if (wanted) {
+            memcpy(line.data() + line_fill, data, n);
+        }
+        data += n;
+        length -= n;
+        line_fill += n;
+
+        if (line_fill == raw_width) {
+            if (wanted) {
+                store_row(line.data());
+            }
+            line_fill = 0;
+            raw_y++;
+        }
+    }
+}
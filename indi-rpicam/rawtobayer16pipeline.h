@@ -0,0 +1,74 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+ Copyright (C) 2020 Lars Berntzon (lars.berntzon@cecilia-data.se).
+ All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef RAWTOBAYER16PIPELINE_H
+#define RAWTOBAYER16PIPELINE_H
+
+#include <cstddef>
+#include <vector>
+#include "pipeline.h"
+
+struct BroadcomPipeline;
+class ChipWrapper;
+
+/**
+ * @brief The RawToBayer16Pipeline class
+ * Common part of the packed raw to 16 bits bayer pipelines.
+ * Splits the incoming bytes into scanlines of the stride given by the broadcom header
+ * and hands every scanline inside the subframe to unpack_row(). Scanlines are unpacked
+ * straight from the received buffers, only lines split between two buffers are copied.
+ */
+class RawToBayer16Pipeline : public Pipeline
+{
+public:
+    RawToBayer16Pipeline(const BroadcomPipeline *bcm_pipe, ChipWrapper *ccd) : Pipeline(), bcm_pipe(bcm_pipe), ccd(ccd) {}
+
+    virtual void data_received(uint8_t *data,  uint32_t length) override;
+    virtual void reset() override;
+
+protected:
+    /**
+     * Unpack @a count pixels starting at pixel @a x of one packed scanline.
+     */
+    virtual void unpack_row(const uint8_t *row, uint16_t *dst, uint32_t x, uint32_t count) = 0;
+
+    /**
+     * @return number of pixels a packed scanline of @a bytes bytes holds.
+     */
+    virtual uint32_t row_pixels(uint32_t bytes) const = 0;
+
+private:
+    void store_row(const uint8_t *row);
+
+    const BroadcomPipeline *bcm_pipe;
+    ChipWrapper *ccd;
+    uint16_t *frame_buffer {nullptr};
+    uint32_t raw_width {0};     //! Bytes per scanline including padding.
+    uint32_t raw_y {0};         //! Scanline currently being received.
+    uint32_t startX {0};
+    uint32_t startY {0};
+    uint32_t subW {0};
+    uint32_t subH {0};
+    std::vector<uint8_t> line;  //! Scanline split over two buffers.
+    uint32_t line_fill {0};     //! Bytes of the current scanline received so far.
+};
+
+#endif // RAWTOBAYER16PIPELINE_H
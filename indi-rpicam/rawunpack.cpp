@@ -0,0 +1,267 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+ Copyright (C) 2020 Lars Berntzon (lars.berntzon@cecilia-data.se).
+ All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "rawunpack.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RAWUNPACK_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__NEON__)
+#define RAWUNPACK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace RawUnpack
+{
+
+namespace
+{
+
+/**
+ * Group kernels start at a group boundary (4 pixels for RAW10, 2 for RAW12) and
+ * return the number of pixels they converted, always a whole number of groups.
+ */
+typedef size_t (*GroupKernel)(const uint8_t *src, uint16_t *dst, size_t count);
+
+inline uint16_t raw10Pixel(const uint8_t *src, size_t x)
+{
+    const uint8_t *group = src + (x / 4) * 5;
+    const unsigned shift = (x % 4) * 2;
+    return static_cast<uint16_t>((group[x % 4] << 8) | (((group[4] >> shift) & 0x03) << 6));
+}
+
+inline uint16_t raw12Pixel(const uint8_t *src, size_t x)
+{
+    const uint8_t *group = src + (x / 2) * 3;
+    const unsigned shift = (x % 2) * 4;
+    return static_cast<uint16_t>((group[x % 2] << 8) | (((group[2] >> shift) & 0x0F) << 4));
+}
+
+size_t raw10Scalar(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint8_t lsb = src[4];
+        dst[0] = static_cast<uint16_t>((src[0] << 8) | ((lsb << 6) & 0xC0));
+        dst[1] = static_cast<uint16_t>((src[1] << 8) | ((lsb << 4) & 0xC0));
+        dst[2] = static_cast<uint16_t>((src[2] << 8) | ((lsb << 2) & 0xC0));
+        dst[3] = static_cast<uint16_t>((src[3] << 8) | ((lsb << 0) & 0xC0));
+        src += 5;
+        dst += 4;
+    }
+    return i;
+}
+
+size_t raw12Scalar(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        const uint8_t lsb = src[2];
+        dst[0] = static_cast<uint16_t>((src[0] << 8) | ((lsb << 4) & 0xF0));
+        dst[1] = static_cast<uint16_t>((src[1] << 8) | ((lsb << 0) & 0xF0));
+        src += 3;
+        dst += 2;
+    }
+    return i;
+}
+
+#ifdef RAWUNPACK_X86
+
+// Both kernels produce 8 pixels per iteration from one unaligned 16 byte load.
+// The high byte of every pixel is shuffled into the upper half of its 16 bit lane,
+// the shared low bits byte into the lower half, where a per lane multiply moves
+// the pixel's own bits to the top before masking. -1 clears the byte.
+alignas(16) const int8_t kRaw10High[16] = { -1, 0, -1, 1, -1, 2, -1, 3, -1, 5, -1, 6, -1, 7, -1, 8 };
+alignas(16) const int8_t kRaw10Low[16]  = { 4, -1, 4, -1, 4, -1, 4, -1, 9, -1, 9, -1, 9, -1, 9, -1 };
+alignas(16) const int8_t kRaw12High[16] = { -1, 0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10 };
+alignas(16) const int8_t kRaw12Low[16]  = { 2, -1, 2, -1, 5, -1, 5, -1, 8, -1, 8, -1, 11, -1, 11, -1 };
+
+__attribute__((target("ssse3")))
+size_t raw10SSSE3(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i *>(kRaw10High));
+    const __m128i low  = _mm_load_si128(reinterpret_cast<const __m128i *>(kRaw10Low));
+    const __m128i mul  = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+    const __m128i mask = _mm_set1_epi16(0x00C0);
+
+    // The 16 byte load reaches 6 bytes past the 10 consumed, so leave at least 8 pixels for the tail.
+    size_t i = 0;
+    for (; i + 16 <= count; i += 8)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i h  = _mm_shuffle_epi8(in, high);
+        __m128i l  = _mm_and_si128(_mm_mullo_epi16(_mm_shuffle_epi8(in, low), mul), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(h, l));
+        src += 10;
+        dst += 8;
+    }
+
+    return i + raw10Scalar(src, dst, count - i);
+}
+
+__attribute__((target("ssse3")))
+size_t raw12SSSE3(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i *>(kRaw12High));
+    const __m128i low  = _mm_load_si128(reinterpret_cast<const __m128i *>(kRaw12Low));
+    const __m128i mul  = _mm_setr_epi16(16, 1, 16, 1, 16, 1, 16, 1);
+    const __m128i mask = _mm_set1_epi16(0x00F0);
+
+    // The 16 byte load reaches 4 bytes past the 12 consumed.
+    size_t i = 0;
+    for (; i + 12 <= count; i += 8)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        __m128i h  = _mm_shuffle_epi8(in, high);
+        __m128i l  = _mm_and_si128(_mm_mullo_epi16(_mm_shuffle_epi8(in, low), mul), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_or_si128(h, l));
+        src += 12;
+        dst += 8;
+    }
+
+    return i + raw12Scalar(src, dst, count - i);
+}
+
+#endif
+
+#ifdef RAWUNPACK_NEON
+
+// Same layout as the x86 kernels, using a two register table lookup
+// (available on both ARMv7 and AArch64) and a per lane shift.
+const uint8_t kRaw10High[8] = { 0, 1, 2, 3, 5, 6, 7, 8 };
+const uint8_t kRaw10Low[8]  = { 4, 4, 4, 4, 9, 9, 9, 9 };
+const int16_t kRaw10Shift[8] = { 6, 4, 2, 0, 6, 4, 2, 0 };
+const uint8_t kRaw12High[8] = { 0, 1, 3, 4, 6, 7, 9, 10 };
+const uint8_t kRaw12Low[8]  = { 2, 2, 5, 5, 8, 8, 11, 11 };
+const int16_t kRaw12Shift[8] = { 4, 0, 4, 0, 4, 0, 4, 0 };
+
+inline uint16x8_t unpackNEON(const uint8_t *src, uint8x8_t high, uint8x8_t low, int16x8_t shift, uint16x8_t mask)
+{
+    uint8x16_t in = vld1q_u8(src);
+    uint8x8x2_t table = {{ vget_low_u8(in), vget_high_u8(in) }};
+    uint16x8_t h = vshll_n_u8(vtbl2_u8(table, high), 8);
+    uint16x8_t l = vandq_u16(vshlq_u16(vmovl_u8(vtbl2_u8(table, low)), shift), mask);
+    return vorrq_u16(h, l);
+}
+
+size_t raw10NEON(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    const uint8x8_t high   = vld1_u8(kRaw10High);
+    const uint8x8_t low    = vld1_u8(kRaw10Low);
+    const int16x8_t shift  = vld1q_s16(kRaw10Shift);
+    const uint16x8_t mask  = vdupq_n_u16(0x00C0);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 8)
+    {
+        vst1q_u16(dst, unpackNEON(src, high, low, shift, mask));
+        src += 10;
+        dst += 8;
+    }
+
+    return i + raw10Scalar(src, dst, count - i);
+}
+
+size_t raw12NEON(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    const uint8x8_t high   = vld1_u8(kRaw12High);
+    const uint8x8_t low    = vld1_u8(kRaw12Low);
+    const int16x8_t shift  = vld1q_s16(kRaw12Shift);
+    const uint16x8_t mask  = vdupq_n_u16(0x00F0);
+
+    size_t i = 0;
+    for (; i + 12 <= count; i += 8)
+    {
+        vst1q_u16(dst, unpackNEON(src, high, low, shift, mask));
+        src += 12;
+        dst += 8;
+    }
+
+    return i + raw12Scalar(src, dst, count - i);
+}
+
+#endif
+
+struct Kernels
+{
+    GroupKernel raw10;
+    GroupKernel raw12;
+    const char *name;
+};
+
+Kernels selectKernels()
+{
+#if defined(RAWUNPACK_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        return { raw10SSSE3, raw12SSSE3, "ssse3" };
+#elif defined(RAWUNPACK_NEON)
+    return { raw10NEON, raw12NEON, "neon" };
+#endif
+    return { raw10Scalar, raw12Scalar, "scalar" };
+}
+
+const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+}
+
+const char *kernelName()
+{
+    return kernels().name;
+}
+
+void raw10Row(const uint8_t *src, uint16_t *dst, size_t x, size_t count)
+{
+    // Pixels before the first group boundary.
+    for (; count > 0 && x % 4 != 0; count--)
+        *dst++ = raw10Pixel(src, x++);
+
+    size_t done = kernels().raw10(src + (x / 4) * 5, dst, count);
+    x += done;
+    dst += done;
+
+    // Trailing partial group.
+    for (count -= done; count > 0; count--)
+        *dst++ = raw10Pixel(src, x++);
+}
+
+void raw12Row(const uint8_t *src, uint16_t *dst, size_t x, size_t count)
+{
+    if (count > 0 && x % 2 != 0)
+    {
+        *dst++ = raw12Pixel(src, x++);
+        count--;
+    }
+
+    size_t done = kernels().raw12(src + (x / 2) * 3, dst, count);
+    x += done;
+    dst += done;
+
+    if (count > done)
+        *dst = raw12Pixel(src, x);
+}
+
+}
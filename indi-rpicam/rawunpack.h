@@ -0,0 +1,71 @@
+/*
+ Raspberry Pi High Quality Camera CCD Driver for Indi.
+ Copyright (C) 2020 Lars Berntzon (lars.berntzon@cecilia-data.se).
+ All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RAWUNPACK_H
+#define RAWUNPACK_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Row unpackers for the packed MIPI formats delivered by the Broadcom raw capture.
+ * All output pixels are scaled up to 16 bits, i.e. the most significant sensor bit ends up in bit 15.
+ */
+namespace RawUnpack
+{
+
+/** @return name of the kernel selected for this CPU, e.g. "ssse3", "neon" or "scalar". */
+const char *kernelName();
+
+/**
+ * @brief Unpack pixels from one RAW10 row: 4 pixels in 5 bytes, the 5th byte holding the 2 low bits of each.
+ * @param src start of the raw row (pixel 0).
+ * @param dst destination for @a count 16 bit pixels.
+ * @param x first pixel to unpack, need not be a multiple of 4.
+ * @param count number of pixels to unpack.
+ * @note Only the packed groups holding pixels x .. x + count - 1 are read.
+ */
+void raw10Row(const uint8_t *src, uint16_t *dst, size_t x, size_t count);
+
+/**
+ * @brief Unpack pixels from one RAW12 row: 2 pixels in 3 bytes, the 3rd byte holding the 4 low bits of each.
+ * @param src start of the raw row (pixel 0).
+ * @param dst destination for @a count 16 bit pixels.
+ * @param x first pixel to unpack, need not be even.
+ * @param count number of pixels to unpack.
+ * @note Only the packed groups holding pixels x .. x + count - 1 are read.
+ */
+void raw12Row(const uint8_t *src, uint16_t *dst, size_t x, size_t count);
+
+/** @return number of complete pixels a RAW10 row of @a bytes bytes holds. */
+inline size_t raw10Pixels(size_t bytes)
+{
+    return (bytes / 5) * 4;
+}
+
+/** @return number of complete pixels a RAW12 row of @a bytes bytes holds. */
+inline size_t raw12Pixels(size_t bytes)
+{
+    return (bytes / 3) * 2;
+}
+
+}
+
+#endif // RAWUNPACK_H
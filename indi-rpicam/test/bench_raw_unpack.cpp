@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include <broadcompipeline.h>
+#include <raw10tobayer16pipeline.h>
+#include <raw12tobayer16pipeline.h>
+#include <rawunpack.h>
+#include <chipwrapper.h>
+
+// Size of the buffers the camera port delivers the raw data in. Deliberately not
+// a multiple of any stride so scanlines get split between buffers.
+static const uint32_t CHUNK_SIZE = 81920 + 7;
+
+// {{{ BenchCCD: Frame buffer sized for the subframe only.
+class BenchCCD : public ChipWrapper
+{
+public:
+    BenchCCD(int xres, int yres, int x, int y, int w, int h) :
+        width(xres), height(yres), subx(x), suby(y), subw(w), subh(h), frameBuffer(w * h * 2)
+    {
+    }
+
+    virtual int getFrameBufferSize() override { return frameBuffer.size(); }
+    virtual uint8_t* getFrameBuffer() override { return frameBuffer.data(); }
+
+    virtual int getSubX() override { return subx; }
+    virtual int getSubY() override { return suby; }
+    virtual int getSubW() override { return subw; }
+    virtual int getSubH() override { return subh; }
+    virtual int getXRes() override { return width; }
+    virtual int getYRes() override { return height; }
+
+private:
+    int width, height;
+    int subx, suby, subw, subh;
+    std::vector<uint8_t> frameBuffer;
+};
+// }}}
+
+// {{{ Synthetic raw capture: broadcom header followed by random scanlines.
+static std::vector<uint8_t> makeCapture(uint16_t raw_width, uint16_t width, uint16_t height)
+{
+    BroadcomHeader header;
+    memset(&header, 0, sizeof header);
+    header.omx_data.raw_width = raw_width;
+    header.omx_data.width = width;
+    header.omx_data.height = height;
+
+    // The header occupies the first 32k, "BRCMo" padded to 8 bytes, then the omx data.
+    std::vector<uint8_t> capture(32768 + static_cast<size_t>(raw_width) * (height + 16));
+    memcpy(capture.data(), "BRCMo", 5);
+    memcpy(capture.data() + 8, &header.omx_data, sizeof header.omx_data);
+
+    srand(raw_width);
+    for (size_t i = 32768; i < capture.size(); i++) {
+        capture[i] = rand();
+    }
+
+    return capture;
+}
+
+static uint16_t referencePixel(int bits, const uint8_t *row, int x)
+{
+    if (bits == 10) {
+        const uint8_t *group = row + (x / 4) * 5;
+        return ((group[x % 4] << 2) | ((group[4] >> (2 * (x % 4))) & 0x03)) << 6;
+    }
+    const uint8_t *group = row + (x / 2) * 3;
+    return ((group[x % 2] << 4) | ((group[2] >> (4 * (x % 2))) & 0x0F)) << 4;
+}
+// }}}
+
+static void runChain(int bits, uint16_t raw_width, int xres, int yres, int x, int y, int w, int h)
+{
+    std::vector<uint8_t> capture = makeCapture(raw_width, xres, yres);
+    BenchCCD ccd(xres, yres, x, y, w, h);
+
+    BroadcomPipeline brcm_pipe;
+    if (bits == 10) {
+        brcm_pipe.daisyChain(new Raw10ToBayer16Pipeline(&brcm_pipe, &ccd));
+    }
+    else {
+        brcm_pipe.daisyChain(new Raw12ToBayer16Pipeline(&brcm_pipe, &ccd));
+    }
+
+    const int runs = 10;
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++) {
+        brcm_pipe.reset_pipe();
+        for (size_t pos = 0; pos < capture.size(); pos += CHUNK_SIZE) {
+            uint32_t length = std::min<size_t>(CHUNK_SIZE, capture.size() - pos);
+            brcm_pipe.data_received(capture.data() + pos, length);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "raw%d %dx%d stride %d sub %d,%d %dx%d (%s): %.1f MB/s raw input\n",
+            bits, xres, yres, raw_width, x, y, w, h, RawUnpack::kernelName(),
+            (runs * static_cast<double>(capture.size()) / (1024 * 1024)) / seconds);
+
+    const uint16_t *frame = reinterpret_cast<const uint16_t *>(ccd.getFrameBuffer());
+    for (int row = 0; row < h; row++) {
+        const uint8_t *raw = capture.data() + 32768 + static_cast<size_t>(y + row) * raw_width;
+        for (int col = 0; col < w; col++) {
+            ASSERT_EQ(frame[row * w + col], referencePixel(bits, raw, x + col)) << "row " << row << " col " << col;
+        }
+    }
+}
+
+TEST(BenchRawUnpack, imx219_raw10_full)
+{
+    runChain(10, 4128, 3280, 2464, 0, 0, 3280, 2464);
+}
+
+TEST(BenchRawUnpack, ov5647_raw10_full)
+{
+    runChain(10, 3264, 2592, 1944, 0, 0, 2592, 1944);
+}
+
+TEST(BenchRawUnpack, imx290_raw10_full)
+{
+    runChain(10, 2432, 1920, 1080, 0, 0, 1920, 1080);
+}
+
+TEST(BenchRawUnpack, imx219_raw10_subframe)
+{
+    runChain(10, 4128, 3280, 2464, 101, 57, 643, 479);
+}
+
+TEST(BenchRawUnpack, imx477_raw12_full)
+{
+    runChain(12, 6112, 4056, 3040, 0, 0, 4056, 3040);
+}
+
+TEST(BenchRawUnpack, imx477_raw12_subframe)
+{
+    runChain(12, 6112, 4056, 3040, 333, 211, 1001, 755);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -32,6 +32,7 @@
 #include <libnova/julian_day.h>
 #include <libnova/sidereal_time.h>
 
+#include <chrono>
 #include <memory>
 #include <unistd.h>
 #include <errno.h>
@@ -41,6 +42,7 @@
 
 #define MAX_RTKRCV_PARSES     50              // Read 50 streams before giving up
 #define MAX_TIMEOUT_COUNT   5               // Maximum timeout before auto-connect
+#define GPS_UTC_LEAP_SECONDS 18             // rtkrcv prints solution times in GPS time
 
 // We declare an auto pointer to GPSD.
 static std::unique_ptr<RTKLIB> rtkrcv(new RTKLIB());
@@ -64,6 +66,16 @@ bool RTKLIB::initProperties()
     IUFillTextVector(&GPSstatusTP, GPSstatusT, 1, getDeviceName(), "GPS_STATUS", "GPS Status", MAIN_CONTROL_TAB, IP_RO,
                      60, IPS_IDLE);
 
+    IUFillNumber(&SolutionN[0], "RTK_RATIO", "AR ratio", "%.1f", 0, 1000, 0, 0);
+    IUFillNumber(&SolutionN[1], "RTK_AGE", "Age of differential (s)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumber(&SolutionN[2], "RTK_SATELLITES", "Satellites", "%.0f", 0, 100, 0, 0);
+    IUFillNumber(&SolutionN[3], "RTK_SIGMA_1", "Sigma N/X/E (m)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&SolutionN[4], "RTK_SIGMA_2", "Sigma E/Y/N (m)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&SolutionN[5], "RTK_SIGMA_3", "Sigma U/Z/U (m)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&SolutionN[6], "RTK_RATE", "Solution rate (Hz)", "%.1f", 0, 1000, 0, 0);
+    IUFillNumberVector(&SolutionNP, SolutionN, 7, getDeviceName(), "RTK_SOLUTION", "RTK Solution", MAIN_CONTROL_TAB,
+                       IP_RO, 60, IPS_IDLE);
+
     tcpConnection = new Connection::TCP(this);
     tcpConnection->setDefaultHost("192.168.1.1");
     tcpConnection->setDefaultPort(50000);
@@ -90,6 +102,7 @@ bool RTKLIB::updateProperties()
     if (isConnected())
     {
         defineProperty(&GPSstatusTP);
+        defineProperty(&SolutionNP);
 
         pthread_create(&rtkThread, nullptr, &RTKLIB::parse_rtkrcv_helper, this);
     }
@@ -97,24 +110,70 @@ bool RTKLIB::updateProperties()
     {
         // We're disconnected
         deleteProperty(GPSstatusTP.name);
+        deleteProperty(SolutionNP.name);
     }
     return true;
 }
 
 IPState RTKLIB::updateGPS()
 {
-    IPState rc = IPS_BUSY;
+    static char ts[32] = {0};
 
-    pthread_mutex_lock(&lock);
-    if (locationPending == false && timePending == false)
+    RtkrcvHistory<256>::Entry latest;
+    if (!history.latest(latest) || latest.seq == lastReported)
+        return IPS_BUSY;
+    lastReported = latest.seq;
+
+    const rtkrcv_solution &sol = latest.sol;
+
+    IUSaveText(&GPSstatusT[0], rtkrcv_fix_name(sol.fix));
+    GPSstatusTP.s = IPS_OK;
+    IDSetText(&GPSstatusTP, nullptr);
+
+    // rate over the solutions of the last few seconds in the history
+    RtkrcvHistory<256>::Entry recent[64];
+    size_t n = history.recent(recent, 64);
+    double span = n > 1 ? recent[0].received - recent[n - 1].received : 0;
+
+    SolutionN[0].value = sol.ratio;
+    SolutionN[1].value = sol.age;
+    SolutionN[2].value = sol.ns;
+    SolutionN[3].value = sol.sigma[0];
+    SolutionN[4].value = sol.sigma[1];
+    SolutionN[5].value = sol.sigma[2];
+    SolutionN[6].value = span > 0 ? (n - 1) / span : 0;
+    SolutionNP.s = (sol.flags & RTKRCV_HAS_QUALITY) ? IPS_OK : IPS_BUSY;
+    IDSetNumber(&SolutionNP, nullptr);
+
+    if (sol.fix != status_fix || sol.format != format_llh || !(sol.flags & RTKRCV_HAS_POS))
+        return IPS_BUSY;
+
+    LocationN[LOCATION_LATITUDE].value  = sol.pos[0];
+    LocationN[LOCATION_LONGITUDE].value = sol.pos[1];
+    LocationN[LOCATION_ELEVATION].value = sol.pos[2];
+    if (LocationN[LOCATION_LONGITUDE].value < 0)
+        LocationN[LOCATION_LONGITUDE].value += 360;
+
+    time_t raw_time;
+    struct tm utc, local;
+
+    if (sol.flags & RTKRCV_HAS_TIME)
     {
-        rc = IPS_OK;
-        locationPending = true;
-        timePending = true;
+        raw_time = (time_t)sol.time - GPS_UTC_LEAP_SECONDS;
+        setSystemTime(raw_time);
     }
-    pthread_mutex_unlock(&lock);
+    else
+        raw_time = time(nullptr);
+
+    gmtime_r(&raw_time, &utc);
+    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", &utc);
+    IUSaveText(&TimeT[0], ts);
 
-    return rc;
+    localtime_r(&raw_time, &local);
+    snprintf(ts, 32, "%4.2f", (local.tm_gmtoff / 3600.0));
+    IUSaveText(&TimeT[1], ts);
+
+    return IPS_OK;
 }
 
 bool RTKLIB::is_rtkrcv()
@@ -122,7 +181,7 @@ bool RTKLIB::is_rtkrcv()
     char line[RTKRCV_MAX_LENGTH];
 
     int bytes_read = 0;
-    int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
+    int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH - 1, 0xC, 3, &bytes_read);
     if (tty_rc < 0)
     {
         LOGF_ERROR("Error getting device readings: %s", strerror(errno));
@@ -162,14 +221,12 @@ void* RTKLIB::parse_rtkrcv_helper(void *obj)
 
 void RTKLIB::parse_rtkrcv()
 {
-    static char ts[32] = {0};
-
     char line[RTKRCV_MAX_LENGTH];
 
     while (isConnected())
     {
         int bytes_read = 0;
-        int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
+        int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH - 1, 0xC, 3, &bytes_read);
         if (tty_rc < 0)
         {
             if (tty_rc == TTY_OVERFLOW)
@@ -210,76 +267,14 @@ void RTKLIB::parse_rtkrcv()
         }
         line[bytes_read] = '\0';
 
-        LOGF_DEBUG("%s", line);
-        char flags;
-        char type;
-        double enu[3];
-        double timestamp;
-        rtkrcv_fix_status fix;
-        scansolution(line, &flags, &type, enu, &fix, &timestamp);
-        switch (fix)
+        rtkrcv_solution sol;
+        if (rtkrcv_parse(line, bytes_read, &sol) & RTKRCV_HAS_STATUS)
         {
-        case status_no_fix:
-            LOG_DEBUG("no fix");
-            break;
-        case status_float:
-            LOG_DEBUG("float fix");
-            break;
-        case status_sbas:
-            LOG_DEBUG("sbas fix");
-            break;
-        case status_dgps:
-            LOG_DEBUG("dgps fix");
-            break;
-        case status_single:
-            LOG_DEBUG("single fix");
-            break;
-        case status_ppp:
-            LOG_DEBUG("ppp fix");
-            break;
-        case status_unknown:
-            LOG_DEBUG("unknown fix status");
-            break;
-            case status_fix:
-            {
-                LocationN[LOCATION_LATITUDE].value  = enu[0];
-                LocationN[LOCATION_LONGITUDE].value = enu[1];
-                LocationN[LOCATION_ELEVATION].value = enu[2];
-                if (LocationN[LOCATION_LONGITUDE].value < 0)
-                    LocationN[LOCATION_LONGITUDE].value += 360;
-
-                struct timespec timesp;
-                time_t raw_time;
-                struct tm *utc, *local;
-
-                timesp.tv_sec = (time_t)timestamp;
-                timesp.tv_nsec = (time_t)(timestamp*1000000000.0);
-
-                raw_time = timesp.tv_sec;
-                utc = gmtime(&raw_time);
-                strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                IUSaveText(&TimeT[0], ts);
-
-                setSystemTime(raw_time);
-
-                local = localtime(&raw_time);
-                snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                IUSaveText(&TimeT[1], ts);
-
-                pthread_mutex_lock(&lock);
-                locationPending = false;
-                timePending = false;
-                LOG_DEBUG("Threaded Location and Time updates complete.");
-                pthread_mutex_unlock(&lock);
-                break;
-
-                default:
-                {
-                    LOG_DEBUG("solution is not parsed");
-                }
-                break;
-            }
+            double received = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            history.push(sol, received);
         }
+        else
+            LOGF_DEBUG("solution is not parsed: %s", line);
     }
 
     pthread_exit(nullptr);
@@ -26,6 +26,8 @@
 
 #include <indigps.h>
 
+#include "rtkrcv_history.h"
+
 class RTKLIB : public INDI::GPS
 {
   public:
@@ -35,6 +37,9 @@ class RTKLIB : public INDI::GPS
     IText GPSstatusT[1] {};
     ITextVectorProperty GPSstatusTP;
 
+    INumber SolutionN[7];
+    INumberVectorProperty SolutionNP;
+
     static void* parse_rtkrcv_helper(void *);
     virtual bool setSystemTime(time_t& raw_time);
 
@@ -52,8 +57,11 @@ private:
 
     int PortFD { -1 };
     uint8_t timeoutCounter=0;
-    bool locationPending = true, timePending=true;
 
-    pthread_mutex_t lock;
+    // Every solution goes into the history, the INDI properties are only
+    // refreshed from its latest entry when the GPS timer calls updateGPS()
+    RtkrcvHistory<256> history;
+    uint64_t lastReported { UINT64_MAX };
+
     pthread_t rtkThread;
 };
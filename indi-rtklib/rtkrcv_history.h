@@ -0,0 +1,128 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "rtkrcv_parser.h"
+
+/*
+ * Ring of the latest N solutions, filled by the reader thread at the full
+ * rtkrcv rate. One thread pushes and any thread reads without locking:
+ * every slot carries a sequence number that is odd while the slot is being
+ * written, a reader drops a slot whose sequence changed while copying it.
+ */
+template <size_t N>
+class RtkrcvHistory
+{
+  public:
+    struct Entry
+    {
+        // number of the solution since the driver started
+        uint64_t seq;
+        // steady clock time the line was received, in seconds
+        double received;
+        rtkrcv_solution sol;
+    };
+
+    // Only ever called from one thread
+    void push(const rtkrcv_solution &sol, double received)
+    {
+        uint64_t n = head.load(std::memory_order_relaxed);
+        Slot &slot = slots[n % N];
+
+        Entry e;
+        memset(&e, 0, sizeof(e));
+        e.seq      = n;
+        e.received = received;
+        e.sol      = sol;
+
+        uint64_t w[WORDS] = {};
+        memcpy(w, &e, sizeof(e));
+
+        slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++)
+            slot.words[i].store(w[i], std::memory_order_relaxed);
+        slot.seq.store(2 * n + 2, std::memory_order_release);
+
+        head.store(n + 1, std::memory_order_release);
+    }
+
+    // Total number of solutions pushed so far
+    uint64_t count() const
+    {
+        return head.load(std::memory_order_acquire);
+    }
+
+    bool latest(Entry &e) const
+    {
+        uint64_t h = count();
+        return h > 0 && read(h - 1, e);
+    }
+
+    // Copies up to max of the latest solutions, newest first
+    size_t recent(Entry *out, size_t max) const
+    {
+        uint64_t h = count();
+        size_t n = 0;
+
+        while (n < max && n < N && n < h && read(h - 1 - n, out[n]))
+            n++;
+        return n;
+    }
+
+  private:
+    static constexpr size_t WORDS = (sizeof(Entry) + 7) / 8;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> seq { 0 };
+        std::atomic<uint64_t> words[WORDS];
+    };
+
+    bool read(uint64_t n, Entry &e) const
+    {
+        const Slot &slot = slots[n % N];
+        uint64_t w[WORDS];
+
+        uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 != 2 * n + 2)
+            return false;
+        for (size_t i = 0; i < WORDS; i++)
+            w[i] = slot.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != s1)
+            return false;
+
+        memcpy(&e, w, sizeof(e));
+        return true;
+    }
+
+    Slot slots[N];
+    std::atomic<uint64_t> head { 0 };
+};
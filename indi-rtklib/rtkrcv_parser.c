@@ -23,97 +23,281 @@
 *******************************************************************************/
 
 #include "rtkrcv_parser.h"
-#include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <stdarg.h>
-#include <time.h>
 
-#define boolstr(s) ((s) ? "true" : "false")
+/*
+ * Single pass parser of the rtkrcv solution output. It never allocates,
+ * never calls into libc for number conversion and never reads past len,
+ * so it is cheap enough to run on every solution at 20 Hz and safe on
+ * truncated or garbled lines.
+ */
 
-void scansolution(char* solution, char *flags, char *type, double *dms, enum rtkrcv_fix_status *fix, double *timestamp)
+struct cursor {
+    const char *p;
+    const char *e;
+};
+
+static const char *fix_names[] = {
+    RTKRCV_FIX_NONE, RTKRCV_FIX, RTKRCV_FIX_FLOAT, RTKRCV_FIX_SBAS,
+    RTKRCV_FIX_DGPS, RTKRCV_FIX_SINGLE, RTKRCV_FIX_PPP, RTKRCV_FIX_UNKNOWN
+};
+
+static int isdigitc(char c)
 {
-    double pos[3]={0},Qe[9]={0},dms1[3]={0},dms2[3]={0},rr[3]={0};
-    double sol_age,sol_ratio;
-    int sol_ns;
-    char solflag, soltype;
-    char ns, we, el, enu[3]={0};
-    int matched;
-    char status[6];
-    sscanf(solution,"(%6c)",status);
-
-    if(!strcmp(status, RTKRCV_FIX_NONE))
-        *fix = status_no_fix;
-    else if(!strcmp(status, RTKRCV_FIX))
-        *fix = status_fix;
-    else if(!strcmp(status, RTKRCV_FIX_FLOAT))
-        *fix = status_float;
-    else if(!strcmp(status, RTKRCV_FIX_SBAS))
-        *fix = status_sbas;
-    else if(!strcmp(status, RTKRCV_FIX_DGPS))
-        *fix = status_dgps;
-    else if(!strcmp(status, RTKRCV_FIX_SINGLE))
-        *fix = status_single;
-    else if(!strcmp(status, RTKRCV_FIX_PPP))
-        *fix = status_ppp;
-    else if(!strcmp(status, RTKRCV_FIX_UNKNOWN))
-        *fix = status_unknown;
-
-    solflag = 0;
-    matched = 0;
-    soltype = 0;
-    matched += sscanf(solution," %c:%lf %lf %lf",&ns,&dms1[0],&dms1[1],&dms1[2]);
-    matched += sscanf(solution," %c:%lf %lf %lf",&we,&dms2[0],&dms2[1],&dms2[2]);
-    matched += sscanf(solution," %c:%lf",&el,&pos[2]);
-    if(matched != 9) {
-        matched += sscanf(solution," %c:%lf",&ns,&rr[0]);
-        matched += sscanf(solution," %c:%lf",&we,&rr[1]);
-        matched += sscanf(solution," %c:%lf",&el,&rr[2]);
-        if(matched == 6) {
-            switch (ns) {
-            case 'N':
-            case 'S':
-                soltype=1;
-                break;
-            case 'X':
-                soltype=2;
-                break;
-            case 'E':
-                soltype=3;
-                break;
-            case 'P':
-                soltype=4;
+    return c >= '0' && c <= '9';
+}
+
+static int isupperc(char c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+static void skipspace(struct cursor *c)
+{
+    while (c->p < c->e && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r' || *c->p == '\n'))
+        c->p++;
+}
+
+static void skiptoken(struct cursor *c)
+{
+    while (c->p < c->e && *c->p != ' ' && *c->p != '\t')
+        c->p++;
+}
+
+static int parse_number(struct cursor *c, double *v)
+{
+    const char *p = c->p;
+    double sign = 1, x = 0, scale = 1;
+    int digits = 0;
+
+    if (p < c->e && (*p == '-' || *p == '+'))
+        sign = (*p++ == '-') ? -1 : 1;
+    while (p < c->e && isdigitc(*p)) {
+        x = x * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p < c->e && *p == '.') {
+        p++;
+        while (p < c->e && isdigitc(*p)) {
+            scale *= 0.1;
+            x += (*p++ - '0') * scale;
+            digits++;
+        }
+    }
+    if (digits == 0)
+        return 0;
+
+    *v = sign * x;
+    c->p = p;
+    return 1;
+}
+
+static int expect(struct cursor *c, char ch)
+{
+    if (c->p < c->e && *c->p == ch) {
+        c->p++;
+        return 1;
+    }
+    return 0;
+}
+
+/* days from 1970-01-01 to the given date of the proleptic Gregorian calendar */
+static long days_from_civil(long y, long m, long d)
+{
+    long era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/* 2020/06/01 12:00:00.200 */
+static int parse_time(struct cursor *c, double *t)
+{
+    double y, mo, d, h, mi, sec;
+
+    if (!parse_number(c, &y) || !expect(c, '/') || !parse_number(c, &mo) || !expect(c, '/') ||
+        !parse_number(c, &d))
+        return 0;
+    skipspace(c);
+    if (!parse_number(c, &h) || !expect(c, ':') || !parse_number(c, &mi) || !expect(c, ':') ||
+        !parse_number(c, &sec))
+        return 0;
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || y < 1970 || y > 9999)
+        return 0;
+
+    *t = days_from_civil((long)y, (long)mo, (long)d) * 86400.0 + h * 3600.0 + mi * 60.0 + sec;
+    return 1;
+}
+
+/* (FIX   ) */
+static void parse_status(struct cursor *c, const char *close, struct rtkrcv_solution *sol)
+{
+    const char *b = c->p, *e = close;
+    size_t n, i;
+
+    while (b < e && *b == ' ')
+        b++;
+    while (e > b && e[-1] == ' ')
+        e--;
+    n = (size_t)(e - b);
+
+    sol->fix = status_unknown;
+    for (i = 0; i < sizeof(fix_names) / sizeof(fix_names[0]); i++) {
+        if (strlen(fix_names[i]) == n && !memcmp(fix_names[i], b, n)) {
+            sol->fix = (enum rtkrcv_fix_status)(status_no_fix + i);
+            break;
+        }
+    }
+    sol->flags |= RTKRCV_HAS_STATUS;
+    c->p = close + 1;
+}
+
+/* (N:  0.005 E:  0.004 U:  0.011) */
+static void parse_sigma(struct cursor *c, const char *close, struct rtkrcv_solution *sol)
+{
+    struct cursor g = { c->p, close };
+    int i = 0;
+
+    while (i < 3) {
+        skipspace(&g);
+        if (g.p + 1 >= g.e || !isupperc(g.p[0]) || g.p[1] != ':')
+            break;
+        g.p += 2;
+        skipspace(&g);
+        if (!parse_number(&g, &sol->sigma[i]))
+            break;
+        i++;
+    }
+    if (i == 3)
+        sol->flags |= RTKRCV_HAS_SIGMA;
+    c->p = close + 1;
+}
+
+/* N: 45 27 51.1234 or N:45.46420094, returns degrees */
+static int parse_angle(struct cursor *c, double *deg)
+{
+    double v, m = 0, s = 0;
+    struct cursor save;
+
+    skipspace(c);
+    if (!parse_number(c, &v))
+        return 0;
+
+    save = *c;
+    skipspace(c);
+    if (parse_number(c, &m)) {
+        skipspace(c);
+        if (!parse_number(c, &s))
+            s = 0;
+    } else {
+        *c = save;
+    }
+
+    *deg = v + m / 60.0 + s / 3600.0;
+    return 1;
+}
+
+int rtkrcv_parse(const char *line, size_t len, struct rtkrcv_solution *sol)
+{
+    struct cursor c = { line, line + len };
+    int axis = 0, quality = 0;
+
+    memset(sol, 0, sizeof(*sol));
+    sol->fix = status_unknown;
+
+    while (1) {
+        char key;
+        double v;
+
+        skipspace(&c);
+        if (c.p >= c.e)
+            break;
+
+        if (*c.p == '(') {
+            const char *close = memchr(c.p, ')', (size_t)(c.e - c.p));
+            if (close == NULL)
                 break;
+            c.p++;
+            if (memchr(c.p, ':', (size_t)(close - c.p)) != NULL)
+                parse_sigma(&c, close, sol);
+            else
+                parse_status(&c, close, sol);
+            continue;
+        }
+
+        /* the time comes first, possibly after terminal control codes */
+        if (isdigitc(*c.p) && !(sol->flags & (RTKRCV_HAS_TIME | RTKRCV_HAS_STATUS))) {
+            if (parse_time(&c, &sol->time)) {
+                sol->flags |= RTKRCV_HAS_TIME;
+                continue;
             }
         }
-    }
-    matched = sscanf(solution," (%c:%lf %c:%lf %c:%lf)",&enu[0],&Qe[0],&enu[1],&Qe[4],&enu[2],&Qe[8]);
-    if(matched == 6) {
-        solflag |= 1;
-        switch (enu[0]) {
-        case 'N':
-            dms[0] = Qe[0];
-            dms[1] = Qe[1];
-            dms[2] = Qe[2];
+
+        if (c.p + 1 >= c.e || !isupperc(c.p[0]) || c.p[1] != ':') {
+            skiptoken(&c);
+            continue;
+        }
+        key = c.p[0];
+        c.p += 2;
+
+        if (axis == 0 && !quality) {
+            if (key == 'N' || key == 'S')
+                sol->format = format_llh;
+            else if (key == 'X')
+                sol->format = format_xyz;
+            else if (key == 'E')
+                sol->format = format_enu;
+        }
+
+        if (axis < 3 && !quality && sol->format != format_none) {
+
+            if (sol->format == format_llh && axis < 2) {
+                if (!parse_angle(&c, &v))
+                    continue;
+                sol->pos[axis] = (key == 'S' || key == 'W') ? -v : v;
+            } else {
+                skipspace(&c);
+                if (!parse_number(&c, &v))
+                    continue;
+                sol->pos[axis] = v;
+            }
+            if (++axis == 3)
+                sol->flags |= RTKRCV_HAS_POS;
+            continue;
+        }
+
+        skipspace(&c);
+        if (!parse_number(&c, &v))
+            continue;
+
+        switch (key) {
+        case 'A':
+            sol->age = v;
+            quality |= 1;
             break;
-        case 'E':
-            dms[0] = Qe[1];
-            dms[1] = Qe[0];
-            dms[2] = Qe[2];
+        case 'R':
+            sol->ratio = v;
+            quality |= 2;
             break;
-        case 'X':
-            dms[0] = Qe[0];
-            dms[1] = Qe[1];
-            dms[2] = Qe[2];
+        case 'N':
+            sol->ns = (int)v;
+            quality |= 4;
             break;
         }
     }
-    *timestamp = 0;
-    matched = sscanf(solution," A:%lf R:%lf N:%2d",&sol_age,&sol_ratio,&sol_ns);
-    if(matched == 3) {
-        *timestamp = sol_age+(sol_ratio/1000000000.0);
-        solflag |= 2;
-    }
-    *flags = solflag;
-    *type = soltype;
+
+    if (quality == 7)
+        sol->flags |= RTKRCV_HAS_QUALITY;
+    return sol->flags;
+}
+
+const char *rtkrcv_fix_name(enum rtkrcv_fix_status fix)
+{
+    if (fix < status_no_fix || fix > status_unknown)
+        return RTKRCV_FIX_UNKNOWN;
+    return fix_names[fix - status_no_fix];
 }
@@ -29,6 +29,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -36,7 +37,7 @@ extern "C" {
 #include <time.h>
 #include <math.h>
 
-#define RTKRCV_MAX_LENGTH 150
+#define RTKRCV_MAX_LENGTH 256
 
 #define RTKRCV_FIX_NONE "------"
 #define RTKRCV_FIX "FIX"
@@ -58,7 +59,47 @@ enum rtkrcv_fix_status {
     status_unknown
 };
 
-void scansolution(char* solution, char *flags, char *type, double *dms, enum rtkrcv_fix_status *fix, double *timestamp);
+enum rtkrcv_pos_format {
+    format_none=0,
+    format_llh,
+    format_xyz,
+    format_enu
+};
+
+/* parts of the line that were found, see rtkrcv_solution.flags */
+#define RTKRCV_HAS_TIME    0x01
+#define RTKRCV_HAS_STATUS  0x02
+#define RTKRCV_HAS_POS     0x04
+#define RTKRCV_HAS_SIGMA   0x08
+#define RTKRCV_HAS_QUALITY 0x10
+
+/*
+ * One rtkrcv solution line, e.g.
+ * 2020/06/01 12:00:00.200 (FIX   ) N: 45 27 51.1234 E:  9 11 12.5678 H:  120.123 (N:  0.005 E:  0.004 U:  0.011) A:  1.0 R:  3.4 N:12
+ */
+struct rtkrcv_solution {
+    int flags;
+    /* GPS time of the solution in seconds since 1970, as printed by rtkrcv */
+    double time;
+    enum rtkrcv_fix_status fix;
+    enum rtkrcv_pos_format format;
+    /* latitude and longitude in degrees, north and east positive, height in m,
+       or X Y Z / E N U in m */
+    double pos[3];
+    /* standard deviations in m, in the order of pos */
+    double sigma[3];
+    /* age of differential in s, ambiguity ratio, number of satellites */
+    double age;
+    double ratio;
+    int ns;
+};
+
+/* Parses len bytes of line in a single pass, the line need not be terminated.
+   Returns sol->flags, 0 if nothing was recognised. */
+int rtkrcv_parse(const char *line, size_t len, struct rtkrcv_solution *sol);
+
+/* Status string of a fix, as rtkrcv prints it */
+const char *rtkrcv_fix_name(enum rtkrcv_fix_status fix);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,214 @@
+//
+// Runs the rtkrcv solution parser over captured rtkrcv output, over
+// randomly damaged copies of it, and measures how many lines it parses
+// per second. Also checks the solution history under concurrent access.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rtkrcv_parser.h"
+#include "rtkrcv_history.h"
+
+// rtkrcv "solution" output in its different position formats
+static const char *captured[] = {
+    "2020/06/01 12:00:00.200 (FIX   ) N: 45 27 51.1234 E:  9 11 12.5678 H:   120.123 (N:  0.005 E:  0.004 U:  0.011) A:  1.0 R:  3.4 N:12",
+    "2020/06/01 12:00:00.400 (FLOAT ) S: 33 52 07.0001 W: 151 12 30.4000 H:    58.001 (N:  0.120 E:  0.098 U:  0.301) A:  1.2 R:  1.1 N:10",
+    "2020/06/01 12:00:00.600 (SINGLE) N:45.46420094 E:  9.18682439 H:   121.500 (N:  1.500 E:  1.200 U:  3.100) A:  0.0 R:  0.0 N: 8",
+    "2020/06/01 12:00:00.800 (FIX   ) X:  4398306.123 Y:   713109.987 Z:  4550916.456 (X:  0.004 Y:  0.003 Z:  0.009) A:  0.8 R: 12.0 N:14",
+    "2020/06/01 12:00:01.000 (FIX   ) E:       1.234 N:      -2.345 U:       0.012 (E:  0.002 N:  0.003 U:  0.007) A:  0.6 R: 99.9 N:15",
+    "2020/06/01 12:00:01.200 (------) N:  0 00 00.0000 E:  0 00 00.0000 H:     0.000 (N:  0.000 E:  0.000 U:  0.000) A:  0.0 R:  0.0 N: 0",
+};
+
+TEST(RtkrcvParser, llh_dms) {
+    rtkrcv_solution sol;
+    int flags = rtkrcv_parse(captured[0], strlen(captured[0]), &sol);
+
+    ASSERT_EQ(flags, RTKRCV_HAS_TIME | RTKRCV_HAS_STATUS | RTKRCV_HAS_POS | RTKRCV_HAS_SIGMA | RTKRCV_HAS_QUALITY);
+    ASSERT_EQ(sol.fix, status_fix);
+    ASSERT_EQ(sol.format, format_llh);
+    ASSERT_NEAR(sol.pos[0], 45 + 27 / 60.0 + 51.1234 / 3600, 1e-9);
+    ASSERT_NEAR(sol.pos[1], 9 + 11 / 60.0 + 12.5678 / 3600, 1e-9);
+    ASSERT_NEAR(sol.pos[2], 120.123, 1e-9);
+    ASSERT_NEAR(sol.sigma[0], 0.005, 1e-12);
+    ASSERT_NEAR(sol.sigma[2], 0.011, 1e-12);
+    ASSERT_NEAR(sol.age, 1.0, 1e-12);
+    ASSERT_NEAR(sol.ratio, 3.4, 1e-12);
+    ASSERT_EQ(sol.ns, 12);
+
+    // 2020-06-01T12:00:00.2
+    ASSERT_NEAR(sol.time, 1591012800.2, 1e-6);
+    ASSERT_STREQ(rtkrcv_fix_name(sol.fix), "FIX");
+}
+
+TEST(RtkrcvParser, formats) {
+    rtkrcv_solution sol;
+
+    rtkrcv_parse(captured[1], strlen(captured[1]), &sol);
+    ASSERT_EQ(sol.fix, status_float);
+    ASSERT_NEAR(sol.pos[0], -(33 + 52 / 60.0 + 7.0001 / 3600), 1e-9);
+    ASSERT_NEAR(sol.pos[1], -(151 + 12 / 60.0 + 30.4 / 3600), 1e-9);
+
+    rtkrcv_parse(captured[2], strlen(captured[2]), &sol);
+    ASSERT_EQ(sol.fix, status_single);
+    ASSERT_NEAR(sol.pos[0], 45.46420094, 1e-12);
+    ASSERT_NEAR(sol.pos[1], 9.18682439, 1e-12);
+    ASSERT_EQ(sol.ns, 8);
+
+    rtkrcv_parse(captured[3], strlen(captured[3]), &sol);
+    ASSERT_EQ(sol.format, format_xyz);
+    ASSERT_NEAR(sol.pos[0], 4398306.123, 1e-6);
+    ASSERT_NEAR(sol.pos[2], 4550916.456, 1e-6);
+    ASSERT_NEAR(sol.sigma[1], 0.003, 1e-12);
+
+    rtkrcv_parse(captured[4], strlen(captured[4]), &sol);
+    ASSERT_EQ(sol.format, format_enu);
+    ASSERT_NEAR(sol.pos[1], -2.345, 1e-12);
+    ASSERT_EQ(sol.ns, 15);
+
+    rtkrcv_parse(captured[5], strlen(captured[5]), &sol);
+    ASSERT_EQ(sol.fix, status_no_fix);
+}
+
+TEST(RtkrcvParser, garbage) {
+    rtkrcv_solution sol;
+
+    ASSERT_EQ(rtkrcv_parse("", 0, &sol), 0);
+    ASSERT_EQ(rtkrcv_parse("rtkrcv> ", 8, &sol), 0);
+
+    // truncated in the middle of the position, nothing past len is read
+    std::string line(captured[0]);
+    std::vector<char> cut(line.begin(), line.begin() + 60);
+    int flags = rtkrcv_parse(cut.data(), cut.size(), &sol);
+    ASSERT_TRUE(flags & RTKRCV_HAS_STATUS);
+    ASSERT_FALSE(flags & RTKRCV_HAS_POS);
+
+    // terminal control codes in front of the line
+    line = "\x1b[2K" + line;
+    flags = rtkrcv_parse(line.c_str(), line.size(), &sol);
+    ASSERT_TRUE(flags & RTKRCV_HAS_POS);
+    ASSERT_EQ(sol.ns, 12);
+}
+
+TEST(RtkrcvParser, fuzz) {
+    std::mt19937 gen(42);
+    const char alphabet[] = " ()-.:/0123456789NSEWHXYZUARFIXLOT\x1b\t\r\n";
+    rtkrcv_solution sol;
+
+    for (int i = 0; i < 200000; i++) {
+        std::string line(captured[gen() % (sizeof(captured) / sizeof(captured[0]))]);
+
+        int edits = gen() % 8;
+        for (int e = 0; e < edits && !line.empty(); e++) {
+            size_t pos = gen() % line.size();
+            switch (gen() % 3) {
+            case 0:
+                line[pos] = alphabet[gen() % (sizeof(alphabet) - 1)];
+                break;
+            case 1:
+                line.erase(pos, 1 + gen() % 10);
+                break;
+            case 2:
+                line.insert(pos, 1, alphabet[gen() % (sizeof(alphabet) - 1)]);
+                break;
+            }
+        }
+
+        // exact size heap copy, so reading past len shows up with a sanitizer
+        std::unique_ptr<char[]> copy(new char[line.size() ? line.size() : 1]);
+        memcpy(copy.get(), line.data(), line.size());
+        int flags = rtkrcv_parse(copy.get(), line.size(), &sol);
+
+        ASSERT_EQ(flags, sol.flags);
+        ASSERT_GE(sol.fix, status_no_fix);
+        ASSERT_LE(sol.fix, status_unknown);
+    }
+}
+
+TEST(RtkrcvParser, benchmark) {
+    const int lines = 1000000;
+    rtkrcv_solution sol;
+    double sum = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < lines; i++) {
+        const char *line = captured[i % 5];
+        rtkrcv_parse(line, strlen(line), &sol);
+        sum += sol.pos[0];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    std::cerr << "parsed " << lines / secs / 1e6 << " M lines/s (" << sum << ")" << std::endl;
+}
+
+TEST(RtkrcvHistory, order) {
+    RtkrcvHistory<8> history;
+    RtkrcvHistory<8>::Entry e[8];
+    rtkrcv_solution sol {};
+
+    ASSERT_FALSE(history.latest(e[0]));
+    ASSERT_EQ(history.recent(e, 8), 0u);
+
+    for (int i = 0; i < 20; i++) {
+        sol.ns = i;
+        history.push(sol, i * 0.1);
+    }
+
+    ASSERT_EQ(history.count(), 20u);
+    ASSERT_TRUE(history.latest(e[0]));
+    ASSERT_EQ(e[0].sol.ns, 19);
+
+    ASSERT_EQ(history.recent(e, 8), 8u);
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(e[i].seq, 19u - i);
+        ASSERT_EQ(e[i].sol.ns, 19 - i);
+        ASSERT_DOUBLE_EQ(e[i].received, (19 - i) * 0.1);
+    }
+}
+
+TEST(RtkrcvHistory, concurrent) {
+    RtkrcvHistory<16> history;
+    std::atomic<bool> done { false };
+    const int pushes = 200000;
+
+    std::thread writer([&] {
+        rtkrcv_solution sol {};
+        for (int i = 0; i < pushes; i++) {
+            // all fields derived from i, so a torn copy is detectable
+            sol.ns = i;
+            sol.pos[0] = sol.pos[1] = sol.pos[2] = i;
+            sol.ratio = -i;
+            history.push(sol, i);
+        }
+        done = true;
+    });
+
+    // no ASSERT while the writer runs, it has to be joined first
+    RtkrcvHistory<16>::Entry e[16];
+    bool torn = false;
+    while (!done && !torn) {
+        size_t n = history.recent(e, 16);
+        for (size_t i = 0; i < n; i++) {
+            torn |= e[i].sol.ns != (int)e[i].seq || e[i].sol.pos[2] != e[i].seq ||
+                    e[i].sol.ratio != -(double)e[i].seq || e[i].received != e[i].seq;
+            torn |= i > 0 && e[i].seq + 1 != e[i - 1].seq;
+        }
+    }
+    writer.join();
+
+    ASSERT_FALSE(torn);
+    ASSERT_TRUE(history.latest(e[0]));
+    ASSERT_EQ(e[0].sol.ns, pushes - 1);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -26,6 +26,11 @@
     ########### ####### ########## ## ###
     Julian_Date Voltage Freqnuency RA DEC
 
+    Samples are acquired by a separate thread and published in batches, see the
+    "Batch" property. ASCII BLOBs (.ascii_cont, .ascii_spec) carry one line per
+    sample in the format above. Binary BLOBs (.bin_cont, .bin_spec) carry one
+    record of five native doubles per sample, in the same order.
+
 */
 
 #include "spectracyber.h"
@@ -36,6 +41,9 @@
 
 #include <libnova/julian_day.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <memory>
 #include <stdlib.h>
 #include <string.h>
@@ -65,8 +73,19 @@ const unsigned int SPECTROMETER_OFFSET = 0x050;
 /* 90 Khz Rest Correction */
 const double SPECTROMETER_REST_CORRECTION = 0.090;
 
+/* Time for the receiver to settle after a frequency change */
+const int SPECTROMETER_SETTLE_MS = 500;
+
+/* Approximate round trip of a channel read at 2400 baud, used to pace simulated reads */
+const int SPECTROMETER_SIM_READ_MS = 40;
+
+/* Samples kept until they are published, older ones are dropped on overrun */
+const size_t SPECTROMETER_RING_SIZE = 4096;
+
 static const char *contFMT = ".ascii_cont";
 static const char *specFMT = ".ascii_spec";
+static const char *contBinFMT = ".bin_cont";
+static const char *specBinFMT = ".bin_spec";
 
 // We declare an auto pointer to spectrometer.
 std::unique_ptr<SpectraCyber> spectracyber(new SpectraCyber());
@@ -92,6 +111,11 @@ SpectraCyber::SpectraCyber()
     setVersion(SPECTRACYBER_VERSION_MAJOR, SPECTRACYBER_VERSION_MINOR);        
 }
 
+SpectraCyber::~SpectraCyber()
+{
+    stop_acquisition();
+}
+
 /****************************************************************
 **
 **
@@ -128,7 +152,14 @@ void SpectraCyber::ISGetProperties(const char *dev)
 *****************************************************************/
 bool SpectraCyber::ISSnoopDevice(XMLEle *root)
 {
-    if (IUSnoopNumber(root, &EquatorialCoordsRNP) != 0)
+    int rc;
+
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        rc = IUSnoopNumber(root, &EquatorialCoordsRNP);
+    }
+
+    if (rc != 0)
     {
         LOG_WARN("Error processing snooped EQUATORIAL_EOD_COORD_REQUEST value! No RA/DEC information available.");
 
@@ -157,6 +188,14 @@ bool SpectraCyber::initProperties()
     if (ScanNP == nullptr)
         LOG_ERROR("Error: Scan parameters property is missing. Spectrometer cannot be operated.");
 
+    BatchNP = getNumber("Batch");
+    if (BatchNP == nullptr)
+        LOG_WARN("Batch property is missing. Samples are published one at a time.");
+
+    FormatSP = getSwitch("Data Format");
+    if (FormatSP == nullptr)
+        LOG_WARN("Data format property is missing. Samples are published as ASCII.");
+
     ChannelSP = getSwitch("Channels");
     if (ChannelSP == nullptr)
         LOG_ERROR("Error: Channel property is missing. Spectrometer cannot be operated.");
@@ -169,8 +208,7 @@ bool SpectraCyber::initProperties()
     if (DataStreamBP == nullptr)
         LOG_ERROR("Error: BLOB data property is missing. Spectrometer cannot be operated.");
 
-    if (DataStreamBP)
-        DataStreamBP->bp[0].blob = (char *)malloc(MAXBLEN * sizeof(char));
+    ring.resize(SPECTROMETER_RING_SIZE);
 
     /**************************************************************************/
     // Equatorial Coords - SET
@@ -251,6 +289,18 @@ bool SpectraCyber::init_spectrometer()
 *****************************************************************/
 bool SpectraCyber::Disconnect()
 {
+    stop_acquisition();
+
+    if (ScanSP && ScanSP->s == IPS_BUSY)
+    {
+        publish_samples(true);
+
+        ScanSP->s = IPS_IDLE;
+        IUResetSwitch(ScanSP);
+        ScanSP->sp[1].s = ISS_ON;
+        IDSetSwitch(ScanSP, "Scan stopped.");
+    }
+
     tty_disconnect(fd);
 
     return true;
@@ -343,10 +393,18 @@ bool SpectraCyber::ISNewNumber(const char *dev, const char *name, double values[
 
     // Freq Change
     if (!strcmp(nProp->name, "Freq (Mhz)"))
+    {
+        if (ScanSP && ScanSP->s == IPS_BUSY)
+        {
+            IDSetNumber(nProp, "Stop the scan before changing the frequency.");
+            return false;
+        }
+
         return update_freq(values[0]);
+    }
 
-    // Scan Options
-    if (!strcmp(nProp->name, "Scan Parameters"))
+    // Scan & Batch Options
+    if (!strcmp(nProp->name, "Scan Parameters") || !strcmp(nProp->name, "Batch"))
     {
         if (IUUpdateNumber(nProp, values, names, n) < 0)
             return false;
@@ -447,6 +505,9 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
         {
             if (sProp->s == IPS_BUSY)
             {
+                stop_acquisition();
+                publish_samples(true);
+
                 sProp->s        = IPS_IDLE;
                 FreqNP->s       = IPS_IDLE;
                 DataStreamBP->s = IPS_IDLE;
@@ -462,12 +523,17 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
             return true;
         }
 
+        // Restarting a running scan
+        stop_acquisition();
+        publish_samples(true);
+
         sProp->s        = IPS_BUSY;
         DataStreamBP->s = IPS_BUSY;
 
         // Compute starting freq  = base_freq - low
-        if (sProp->sp[SPEC_CHANNEL].s == ISS_ON)
+        if (ChannelSP->sp[SPEC_CHANNEL].s == ISS_ON)
         {
+            scanChannel = SPECTRAL_CHANNEL;
             start_freq  = (SPECTROMETER_RF_FREQ + SPECTROMETER_REST_FREQ) - abs((int)ScanNP->np[0].value) / 1000.;
             target_freq = (SPECTROMETER_RF_FREQ + SPECTROMETER_REST_FREQ) + abs((int)ScanNP->np[1].value) / 1000.;
             sample_rate = ScanNP->np[2].value * 5;
@@ -478,7 +544,13 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
                         target_freq, sample_rate);
         }
         else
+        {
+            scanChannel = CONTINUUM_CHANNEL;
+            start_freq  = target_freq = FreqNP->np[0].value;
             IDSetSwitch(sProp, "Starting continuum scan @ %g MHz...", FreqNP->np[0].value);
+        }
+
+        start_acquisition();
 
         return true;
     }
@@ -575,6 +647,17 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
         return true;
     }
 
+    // Data Format
+    if (!strcmp(sProp->name, "Data Format"))
+    {
+        if (IUUpdateSwitch(sProp, states, names, n) < 0)
+            return false;
+
+        sProp->s = IPS_OK;
+        IDSetSwitch(sProp, nullptr);
+        return true;
+    }
+
     // Bandwidth Control
     if (!strcmp(sProp->name, "Bandwidth (Khz)"))
     {
@@ -641,6 +724,14 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
 }
 
 bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
+{
+    std::lock_guard<std::mutex> lock(serialMutex);
+
+    return send_command(command_type);
+}
+
+/* Builds and writes a command, the caller holds serialMutex */
+bool SpectraCyber::send_command(SpectrometerCommand command_type)
 {
     char spectrometer_error[SPECTROMETER_ERROR_BUFFER];
     int err_code = 0, nbytes_written = 0, final_value = 0;
@@ -758,13 +849,13 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
             // e.g. To set 50.00 Mhz, diff = 50 - 46.4 = 3.6 / 0.005 = 800 = 320h
             //      Freq = 320h + 050h (or 800 + 80) = 370h = 880 decimal
 
-            final_value = (int)((FreqNP->np[0].value + SPECTROMETER_REST_CORRECTION - FreqNP->np[0].min) / 0.005 +
+            final_value = (int)((tuneFreq + SPECTROMETER_REST_CORRECTION - FreqNP->np[0].min) / 0.005 +
                                 SPECTROMETER_OFFSET);
             sprintf(hex, "%03X", (uint32_t)final_value);
             if (isDebug())
                 IDLog("Required Freq is: %.3f --- Min Freq is: %.3f --- Spec Offset is: %d -- Final Value (Dec): %d "
                       "--- Final Value (Hex): %s\n",
-                      FreqNP->np[0].value, FreqNP->np[0].min, SPECTROMETER_OFFSET, final_value, hex);
+                      tuneFreq, FreqNP->np[0].min, SPECTROMETER_OFFSET, final_value, hex);
             command[2] = hex[0];
             command[3] = hex[1];
             command[4] = hex[2];
@@ -775,8 +866,7 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
             command[1]  = 'D';
             command[2]  = '0';
             command[3]  = '0';
-            final_value = get_on_switch(ChannelSP);
-            command[4]  = (final_value == 0) ? '0' : '1';
+            command[4]  = (scanChannel == CONTINUUM_CHANNEL) ? '0' : '1';
             break;
 
         // Bandwidth
@@ -841,7 +931,7 @@ bool SpectraCyber::update_freq(double nFreq)
 
     FreqNP->np[0].value = nFreq;
 
-    if (dispatch_command(RECV_FREQ) == false)
+    if (tune(nFreq) == false)
     {
         FreqNP->np[0].value = last_value;
         FreqNP->s           = IPS_ALERT;
@@ -865,21 +955,25 @@ bool SpectraCyber::reset()
     char response[4];
     char err_msg[SPECTROMETER_ERROR_BUFFER];
 
-    if (isDebug())
-        IDLog("Attempting to write to spectrometer....\n");
+    {
+        std::lock_guard<std::mutex> lock(serialMutex);
 
-    dispatch_command(RESET);
+        if (isDebug())
+            IDLog("Attempting to write to spectrometer....\n");
 
-    if (isDebug())
-        IDLog("Attempting to read from spectrometer....\n");
+        send_command(RESET);
 
-    // Read echo from spectrometer, we're expecting R000
-    if ((err_code = tty_read(fd, response, SPECTROMETER_CMD_REPLY, 5, &nbytes_read)) != TTY_OK)
-    {
-        tty_error_msg(err_code, err_msg, 32);
         if (isDebug())
-            IDLog("TTY error detected: %s\n", err_msg);
-        return false;
+            IDLog("Attempting to read from spectrometer....\n");
+
+        // Read echo from spectrometer, we're expecting R000
+        if ((err_code = tty_read(fd, response, SPECTROMETER_CMD_REPLY, 5, &nbytes_read)) != TTY_OK)
+        {
+            tty_error_msg(err_code, err_msg, 32);
+            if (isDebug())
+                IDLog("TTY error detected: %s\n", err_msg);
+            return false;
+        }
     }
 
     if (isDebug())
@@ -905,86 +999,45 @@ void SpectraCyber::TimerHit()
     if (!isConnected())
         return;
 
-    char RAStr[16], DecStr[16];
-
-    switch (ScanSP->s)
+    if (ScanSP->s == IPS_BUSY)
     {
-        case IPS_BUSY:
-            if (ChannelSP->sp[CONT_CHANNEL].s == ISS_ON)
-                break;
-
-            if (current_freq >= target_freq)
-            {
-                ScanSP->s = IPS_OK;
-                FreqNP->s = IPS_OK;
-
-                IDSetNumber(FreqNP, nullptr);
-                IDSetSwitch(ScanSP, "Scan complete.");
-                SetTimer(getCurrentPollingPeriod());
-                return;
-            }
-
-            if (update_freq(current_freq) == false)
-            {
-                abort_scan();
-                SetTimer(getCurrentPollingPeriod());
-                return;
-            }
+        if (scanChannel == SPECTRAL_CHANNEL)
+        {
+            current_freq = scanFreq;
+            IDSetNumber(FreqNP, nullptr);
+        }
 
-            current_freq += sample_rate / 1000.;
-            break;
+        publish_samples(false);
 
-        default:
-            break;
-    }
+        switch (acqState)
+        {
+            case ACQ_DONE:
+                stop_acquisition();
+                publish_samples(true);
 
-    switch (DataStreamBP->s)
-    {
-        case IPS_BUSY:
-            if (ScanSP->s != IPS_BUSY)
-            {
+                ScanSP->s       = IPS_OK;
+                FreqNP->s       = IPS_OK;
                 DataStreamBP->s = IPS_IDLE;
+
+                IDSetNumber(FreqNP, nullptr);
                 IDSetBLOB(DataStreamBP, nullptr);
+                IDSetSwitch(ScanSP, "Scan complete.");
                 break;
-            }
 
-            if (read_channel() == false)
-            {
+            case ACQ_ERROR:
                 DataStreamBP->s = IPS_ALERT;
-
-                if (ScanSP->s == IPS_BUSY)
-                    abort_scan();
-
+                abort_scan();
                 IDSetBLOB(DataStreamBP, nullptr);
-            }
-
-            JD = ln_get_julian_from_sys();
-
-            // Continuum
-            if (ChannelSP->sp[0].s == ISS_ON)
-                strncpy(DataStreamBP->bp[0].format, contFMT, MAXINDIBLOBFMT);
-            else
-                strncpy(DataStreamBP->bp[0].format, specFMT, MAXINDIBLOBFMT);
-
-            fs_sexa(RAStr, EquatorialCoordsRN[0].value, 2, 3600);
-            fs_sexa(DecStr, EquatorialCoordsRN[1].value, 2, 3600);
-
-            if (telescopeID && strlen(telescopeID->text) > 0)
-                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f %s %s", JD, chanValue, current_freq, RAStr, DecStr);
-            else
-                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f", JD, chanValue, current_freq);
-
-            DataStreamBP->bp[0].bloblen = DataStreamBP->bp[0].size = strlen(bLine);
-            memcpy(DataStreamBP->bp[0].blob, bLine, DataStreamBP->bp[0].bloblen);
-
-            //IDLog("\nSTRLEN: %d -- BLOB:'%s'\n", strlen(bLine), (char *) DataStreamBP->bp[0].blob);
-
-            IDSetBLOB(DataStreamBP, nullptr);
-
-            break;
+                break;
 
-        default:
-            break;
+            default:
+                break;
+        }
+    }
+    else if (DataStreamBP->s == IPS_BUSY)
+    {
+        DataStreamBP->s = IPS_IDLE;
+        IDSetBLOB(DataStreamBP, nullptr);
     }
 
     SetTimer(getCurrentPollingPeriod());
@@ -992,6 +1045,9 @@ void SpectraCyber::TimerHit()
 
 void SpectraCyber::abort_scan()
 {
+    stop_acquisition();
+    publish_samples(true);
+
     FreqNP->s = IPS_IDLE;
     ScanSP->s = IPS_ALERT;
 
@@ -1002,19 +1058,29 @@ void SpectraCyber::abort_scan()
     IDSetSwitch(ScanSP, "Scan aborted due to errors.");
 }
 
-bool SpectraCyber::read_channel()
+bool SpectraCyber::tune(double freq)
+{
+    std::lock_guard<std::mutex> lock(serialMutex);
+
+    tuneFreq = freq;
+    return send_command(RECV_FREQ);
+}
+
+bool SpectraCyber::read_channel(double &value)
 {
     int err_code = 0, nbytes_read = 0;
-    char response[SPECTROMETER_CMD_REPLY];
+    char response[SPECTROMETER_CMD_REPLY + 1];
     char err_msg[SPECTROMETER_ERROR_BUFFER];
 
     if (isSimulation())
     {
-        chanValue = ((double)rand()) / ((double)RAND_MAX) * 10.0;
+        value = ((double)rand()) / ((double)RAND_MAX) * 10.0;
         return true;
     }
 
-    dispatch_command(READ_CHANNEL);
+    std::lock_guard<std::mutex> lock(serialMutex);
+
+    send_command(READ_CHANNEL);
     if ((err_code = tty_read(fd, response, SPECTROMETER_CMD_REPLY, 5, &nbytes_read)) != TTY_OK)
     {
         tty_error_msg(err_code, err_msg, 32);
@@ -1023,17 +1089,220 @@ bool SpectraCyber::read_channel()
         return false;
     }
 
+    response[nbytes_read] = '\0';
+
     if (isDebug())
         IDLog("Response from Spectrometer: #%s#\n", response);
 
     int result = 0;
     sscanf(response, "D%x", &result);
     // We divide by 409.5 to scale the value to 0 - 10 VDC range
-    chanValue = result / 409.5;
+    value = result / 409.5;
 
     return true;
 }
 
+/****************************************************************
+** Acquisition thread
+**
+** Steps the frequency and reads the channel back to back, without
+** waiting for the polling period. Samples go to a ring buffer that
+** TimerHit publishes in batches.
+*****************************************************************/
+void SpectraCyber::start_acquisition()
+{
+    stop_acquisition();
+
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        ringHead = ringCount = 0;
+        ringOverruns = 0;
+    }
+
+    scanFreq = start_freq;
+    acqState = ACQ_RUNNING;
+    acqRunning = true;
+    acqThread = std::thread(&SpectraCyber::acquisition_loop, this);
+}
+
+void SpectraCyber::stop_acquisition()
+{
+    {
+        std::lock_guard<std::mutex> lock(acqMutex);
+        acqRunning = false;
+    }
+    acqCV.notify_all();
+
+    if (acqThread.joinable())
+        acqThread.join();
+
+    acqState = ACQ_IDLE;
+}
+
+void SpectraCyber::acquisition_loop()
+{
+    const bool spectral = (scanChannel == SPECTRAL_CHANNEL);
+    const double step   = sample_rate / 1000.;
+    const long nsteps   = spectral ? lround((target_freq - start_freq) / step) : 0;
+    const int wait_ms   = isSimulation() ? SPECTROMETER_SIM_READ_MS : 0;
+    long i              = 0;
+
+    std::unique_lock<std::mutex> lock(acqMutex);
+
+    while (acqRunning)
+    {
+        Sample sample;
+
+        sample.freq = start_freq + i * step;
+
+        if (spectral)
+        {
+            if (i >= nsteps)
+            {
+                acqState = ACQ_DONE;
+                return;
+            }
+
+            lock.unlock();
+            bool rc = tune(sample.freq);
+            lock.lock();
+
+            if (rc == false)
+            {
+                LOG_ERROR("Error dispatching RECV FREQ command to spectrometer. Check logs.");
+                acqState = ACQ_ERROR;
+                return;
+            }
+
+            scanFreq = sample.freq;
+            i++;
+
+            // Let the receiver settle on the new frequency
+            if (acqCV.wait_for(lock, std::chrono::milliseconds(SPECTROMETER_SETTLE_MS), [this] { return !acqRunning; }))
+                return;
+        }
+        else if (wait_ms > 0 &&
+                 acqCV.wait_for(lock, std::chrono::milliseconds(wait_ms), [this] { return !acqRunning; }))
+            return;
+
+        lock.unlock();
+        bool rc = read_channel(sample.value);
+        if (rc)
+        {
+            sample.JD = ln_get_julian_from_sys();
+            push_sample(sample);
+        }
+        lock.lock();
+
+        if (rc == false)
+        {
+            LOG_ERROR("Error reading channel value from spectrometer. Check logs.");
+            acqState = ACQ_ERROR;
+            return;
+        }
+    }
+}
+
+void SpectraCyber::push_sample(Sample &sample)
+{
+    std::lock_guard<std::mutex> lock(dataMutex);
+
+    sample.ra  = EquatorialCoordsRN[0].value;
+    sample.dec = EquatorialCoordsRN[1].value;
+
+    if (ringCount == ring.size())
+    {
+        ringHead = (ringHead + 1) % ring.size();
+        ringCount--;
+        ringOverruns++;
+    }
+
+    ring[(ringHead + ringCount) % ring.size()] = sample;
+    ringCount++;
+}
+
+/* Publishes every complete batch, or whatever is pending if flush is set */
+void SpectraCyber::publish_samples(bool flush)
+{
+    size_t batch_samples = BatchNP ? std::max(1, (int)BatchNP->np[0].value) : 1;
+    double batch_seconds = BatchNP ? BatchNP->np[1].value : 0;
+    unsigned long overruns;
+
+    std::unique_lock<std::mutex> lock(dataMutex);
+
+    while (ringCount > 0)
+    {
+        bool full = ringCount >= batch_samples;
+        bool old  = batch_seconds > 0 && (ln_get_julian_from_sys() - ring[ringHead].JD) * 86400. >= batch_seconds;
+
+        if (!full && !old && !flush)
+            break;
+
+        size_t n = std::min(ringCount, batch_samples);
+
+        batch.clear();
+        for (size_t k = 0; k < n; k++)
+            batch.push_back(ring[(ringHead + k) % ring.size()]);
+
+        ringHead = (ringHead + n) % ring.size();
+        ringCount -= n;
+
+        lock.unlock();
+        send_batch(batch);
+        lock.lock();
+    }
+
+    overruns     = ringOverruns;
+    ringOverruns = 0;
+    lock.unlock();
+
+    if (overruns > 0)
+        LOGF_WARN("%lu samples were dropped before they could be published.", overruns);
+}
+
+void SpectraCyber::send_batch(const std::vector<Sample> &batch)
+{
+    bool binary    = FormatSP && FormatSP->sp[1].s == ISS_ON;
+    bool continuum = (scanChannel == CONTINUUM_CHANNEL);
+
+    if (binary)
+    {
+        strncpy(DataStreamBP->bp[0].format, continuum ? contBinFMT : specBinFMT, MAXINDIBLOBFMT);
+
+        blobBuffer.resize(batch.size() * sizeof(Sample));
+        memcpy(blobBuffer.data(), batch.data(), blobBuffer.size());
+    }
+    else
+    {
+        char RAStr[16], DecStr[16];
+        bool coords = telescopeID && strlen(telescopeID->text) > 0;
+
+        strncpy(DataStreamBP->bp[0].format, continuum ? contFMT : specFMT, MAXINDIBLOBFMT);
+
+        blobBuffer.clear();
+        for (const Sample &sample : batch)
+        {
+            if (coords)
+            {
+                fs_sexa(RAStr, sample.ra, 2, 3600);
+                fs_sexa(DecStr, sample.dec, 2, 3600);
+                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f %s %s", sample.JD, sample.value, sample.freq, RAStr, DecStr);
+            }
+            else
+                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f", sample.JD, sample.value, sample.freq);
+
+            if (!blobBuffer.empty())
+                blobBuffer.push_back('\n');
+            blobBuffer.insert(blobBuffer.end(), bLine, bLine + strlen(bLine));
+        }
+    }
+
+    DataStreamBP->bp[0].blob    = blobBuffer.data();
+    DataStreamBP->bp[0].bloblen = DataStreamBP->bp[0].size = blobBuffer.size();
+
+    IDSetBLOB(DataStreamBP, nullptr);
+}
+
 const char *SpectraCyber::getDefaultName()
 {
     return mydev;
@@ -28,7 +28,12 @@
 
 #include <defaultdevice.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define MAXBLEN 64
 
@@ -67,6 +72,7 @@ class SpectraCyber : public INDI::DefaultDevice
     };
 
     SpectraCyber();
+    virtual ~SpectraCyber();
 
     // Standard INDI interface functions
     virtual void ISGetProperties(const char *dev) override;
@@ -86,10 +92,30 @@ class SpectraCyber : public INDI::DefaultDevice
     bool update_freq(double nFreq);
 
   private:
+    // One acquired sample, also the record layout of binary BLOBs
+    struct Sample
+    {
+        double JD;
+        double value;
+        double freq;
+        double ra;
+        double dec;
+    };
+
+    enum AcquisitionState
+    {
+        ACQ_IDLE,
+        ACQ_RUNNING,
+        ACQ_DONE,
+        ACQ_ERROR
+    };
+
     INumberVectorProperty *FreqNP;
     INumberVectorProperty *ScanNP;
+    INumberVectorProperty *BatchNP;
     ISwitchVectorProperty *ScanSP;
     ISwitchVectorProperty *ChannelSP;
+    ISwitchVectorProperty *FormatSP;
     IBLOBVectorProperty *DataStreamBP;
     IText *telescopeID;
 
@@ -101,11 +127,21 @@ class SpectraCyber : public INDI::DefaultDevice
     virtual bool initProperties() override;
     bool init_spectrometer();
     void abort_scan();
-    bool read_channel();
+    bool read_channel(double &value);
+    bool tune(double freq);
     bool dispatch_command(SpectrometerCommand command);
+    bool send_command(SpectrometerCommand command);
     int get_on_switch(ISwitchVectorProperty *sp);
     bool reset();
 
+    // Acquisition thread
+    void start_acquisition();
+    void stop_acquisition();
+    void acquisition_loop();
+    void push_sample(Sample &sample);
+    void publish_samples(bool flush);
+    void send_batch(const std::vector<Sample> &batch);
+
     // Variables
     std::string type_name;
     std::string default_port;
@@ -113,5 +149,26 @@ class SpectraCyber : public INDI::DefaultDevice
     int fd;
     char bLine[MAXBLEN];
     char command[5];
-    double start_freq, target_freq, sample_rate, JD, chanValue;
+    double start_freq, target_freq, sample_rate;
+
+    // Serializes commands and replies on the serial port, and the command buffer
+    std::mutex serialMutex;
+    double tuneFreq { 0 };
+    int scanChannel { CONTINUUM_CHANNEL };
+
+    std::thread acqThread;
+    std::mutex acqMutex;
+    std::condition_variable acqCV;
+    bool acqRunning { false };
+    std::atomic<int> acqState { ACQ_IDLE };
+    std::atomic<double> scanFreq { 0 };
+
+    // Samples not yet published, guarded by dataMutex along with the snooped coordinates
+    std::mutex dataMutex;
+    std::vector<Sample> ring;
+    size_t ringHead { 0 }, ringCount { 0 };
+    unsigned long ringOverruns { 0 };
+
+    std::vector<Sample> batch;
+    std::vector<char> blobBuffer;
 };
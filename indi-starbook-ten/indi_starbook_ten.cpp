@@ -93,6 +93,7 @@ INDIStarbookTen::INDIStarbookTen() {
 
 
 INDIStarbookTen::~INDIStarbookTen() {
+    delete poller;
     delete starbook;
 }
 
@@ -170,8 +171,19 @@ INDIStarbookTen::updateProperties() {
         defineProperty(&GuideRateNP);
         defineProperty(&HomeSP);
 
-        return fetchStartupInfo();
+        if (!fetchStartupInfo())
+            return false;
+
+        delete poller;
+        poller = new StarbookTenPoller(httpConnection->host());
+        lastPollCycle = 0;
+        poller->start(getCurrentPollingPeriod());
+
+        return true;
     } else {
+        delete poller;
+        poller = nullptr;
+
         deleteProperty(InfoTP.name);
         deleteProperty(StateTP.name);
         deleteProperty(GuideNSNP.name);
@@ -218,11 +230,15 @@ INDIStarbookTen::ISNewNumber(const char *dev, const char *name, double values[],
         } else if (!strcmp(GuideNSNP.name, name)) {
             LOG_DEBUG("Prop guiding in DE started");
             isPropGuidingDE = true;
+            if (poller)
+                poller->setGuideQuery(true);
             INDI::GuiderInterface::processGuiderProperties(name, values, names, n);
             return true;
         } else if (!strcmp(GuideWENP.name, name)) {
             LOG_DEBUG("Prop guiding in RA started");
             isPropGuidingRA = true;
+            if (poller)
+                poller->setGuideQuery(true);
             INDI::GuiderInterface::processGuiderProperties(name, values, names, n);
             return true;
         }
@@ -243,6 +259,7 @@ INDIStarbookTen::ISNewSwitch(const char *dev, const char *name, ISState *states,
             try {
                 LOG_INFO("Find home started");
                 retry<bool>(2, &StarbookTen::findHome, starbook);
+                refreshStatus();
                 TrackState = SCOPE_SLEWING;
                 HomeS[HS_FIND_HOME].s = ISS_ON;
                 HomeSP.s = IPS_BUSY;
@@ -332,62 +349,82 @@ INDIStarbookTen::fetchStartupInfo() {
 }
 
 
+void
+INDIStarbookTen::refreshStatus() {
+    if (poller)
+        poller->refresh();
+}
+
+
 bool
 INDIStarbookTen::ReadScopeStatus() {
-    try {
-        auto stat = retry<StarbookTen::MountStatus>(2, &StarbookTen::getStatus, starbook);
-        bool isTracking = retry<bool>(2, &StarbookTen::isTracking, starbook);
+    if (!poller)
+        return false;
 
-        updateStarbookState(stat);
+    StarbookTenPoller::Snapshot snap;
 
-        if (stat.goto_busy) {
-            if ((TrackState == SCOPE_IDLE) ||
-                (TrackState == SCOPE_TRACKING))
-                TrackState = SCOPE_SLEWING;
+    // nothing polled since the last call, or since the last command
+    if (!poller->snapshot(snap) || snap.cycle == lastPollCycle)
+        return true;
+
+    lastPollCycle = snap.cycle;
+
+    if (!snap.error.empty()) {
+        LOGF_ERROR("ReadScopeStatus failed: %s", snap.error.c_str());
+        return false;
+    }
+
+    DEBUGF(DBG_SCOPE, "Status poll took %.0f ms", snap.cycle_ms);
+
+    auto& stat = snap.status;
+
+    updateStarbookState(stat);
+
+    if (stat.goto_busy) {
+        if ((TrackState == SCOPE_IDLE) ||
+            (TrackState == SCOPE_TRACKING))
+            TrackState = SCOPE_SLEWING;
+    } else {
+        if (TrackState == SCOPE_PARKING) {
+            SetParked(true);
+        } else if ((stat.state == StarbookTen::STATE_INIT) ||
+                   (stat.state == StarbookTen::STATE_USER)) {
+            TrackState = SCOPE_IDLE;
         } else {
-            if (TrackState == SCOPE_PARKING) {
-                SetParked(true);
-            } else if ((stat.state == StarbookTen::STATE_INIT) ||
-                       (stat.state == StarbookTen::STATE_USER)) {
-                TrackState = SCOPE_IDLE;
-            } else {
-                TrackState = isTracking ? SCOPE_TRACKING : SCOPE_IDLE;
-            }
+            TrackState = snap.tracking ? SCOPE_TRACKING : SCOPE_IDLE;
+        }
 
-            if (HomeSP.s == IPS_BUSY) {
-                LOG_INFO("Find home completed");
-                HomeSP.s = IPS_OK;
-                HomeS[HS_FIND_HOME].s = ISS_OFF;
-                IDSetSwitch(&HomeSP, nullptr);
-            }
+        if (HomeSP.s == IPS_BUSY) {
+            LOG_INFO("Find home completed");
+            HomeSP.s = IPS_OK;
+            HomeS[HS_FIND_HOME].s = ISS_OFF;
+            IDSetSwitch(&HomeSP, nullptr);
         }
+    }
 
-        NewRaDec(stat.ra, stat.dec);
+    NewRaDec(stat.ra, stat.dec);
 
-        auto ps = retry<StarbookTen::PierSide>(2, &StarbookTen::getPierSide, starbook);
-        setPierSide((ps == StarbookTen::PIERSIDE_EAST) ? INDI::Telescope::PIER_EAST : INDI::Telescope::PIER_WEST);
+    setPierSide((snap.pier_side == StarbookTen::PIERSIDE_EAST) ? INDI::Telescope::PIER_EAST : INDI::Telescope::PIER_WEST);
 
-        if (isPropGuidingRA || isPropGuidingDE) {
-            auto gs = retry<std::tuple<bool,bool> >(2, &StarbookTen::getGuidingRaDec, starbook);
-            LOGF_DEBUG("Prop guiding status: RA=%d, DEC=%d", !!(std::get<0>(gs)), !!(std::get<1>(gs)));
-            if (isPropGuidingRA && !std::get<0>(gs)) {
-                LOG_DEBUG("Prop guiding in RA finished");
-                isPropGuidingRA = false;
-                INDI::GuiderInterface::GuideComplete(AXIS_RA);
-            }
+    if ((isPropGuidingRA || isPropGuidingDE) && snap.guide_valid) {
+        LOGF_DEBUG("Prop guiding status: RA=%d, DEC=%d", !!snap.guiding_ra, !!snap.guiding_dec);
+        if (isPropGuidingRA && !snap.guiding_ra) {
+            LOG_DEBUG("Prop guiding in RA finished");
+            isPropGuidingRA = false;
+            INDI::GuiderInterface::GuideComplete(AXIS_RA);
+        }
 
-            if (isPropGuidingDE && !std::get<1>(gs)) {
-                LOG_DEBUG("Prop guiding in DE finished");
-                isPropGuidingDE = false;
-                INDI::GuiderInterface::GuideComplete(AXIS_DE);
-            }
+        if (isPropGuidingDE && !snap.guiding_dec) {
+            LOG_DEBUG("Prop guiding in DE finished");
+            isPropGuidingDE = false;
+            INDI::GuiderInterface::GuideComplete(AXIS_DE);
         }
 
-        return true;
-    } catch (std::exception &ex) {
-        LOGF_ERROR("ReadScopeStatus failed: %s", ex.what());
-        return false;
+        if (!isPropGuidingRA && !isPropGuidingDE)
+            poller->setGuideQuery(false);
     }
+
+    return true;
 }
 
 
@@ -395,6 +432,7 @@ bool
 INDIStarbookTen::Goto(double ra, double dec) {
     try {
         retry<bool>(2, &StarbookTen::goTo, starbook, ra, dec);
+        refreshStatus();
         TrackState = SCOPE_SLEWING;
         return true;
     } catch (std::exception &ex) {
@@ -408,6 +446,7 @@ bool
 INDIStarbookTen::Sync(double ra, double dec) {
     try {
         retry<bool>(2, &StarbookTen::sync, starbook, ra, dec);
+        refreshStatus();
         NewRaDec(ra, dec);
         return true;
     } catch (std::exception &ex) {
@@ -455,6 +494,7 @@ bool
 INDIStarbookTen::Park() {
     try {
         retry<bool>(2, &StarbookTen::park, starbook);
+        refreshStatus();
         TrackState = SCOPE_PARKING;
         return true;
     } catch (std::exception &ex) {
@@ -470,6 +510,7 @@ INDIStarbookTen::UnPark() {
         retry<bool>(2, &StarbookTen::unpark, starbook);
         SetParked(false);
         retry<bool>(2, &StarbookTen::start, starbook, true);
+        refreshStatus();
         TrackState = SCOPE_TRACKING;
         return true;
     } catch (std::exception &ex) {
@@ -497,7 +538,9 @@ INDIStarbookTen::Abort() {
         retry<bool>(2, &StarbookTen::move, starbook, StarbookTen::AXIS_PRIMARY, 0);
         retry<bool>(2, &StarbookTen::move, starbook, StarbookTen::AXIS_SECONDARY, 0);
         retry<bool>(2, &StarbookTen::stop, starbook);
-        return retry<bool>(2, &StarbookTen::start, starbook, true);
+        bool rc = retry<bool>(2, &StarbookTen::start, starbook, true);
+        refreshStatus();
+        return rc;
     } catch (std::exception &ex) {
         LOGF_ERROR("Abort failed: %s", ex.what());
         return false;
@@ -508,13 +551,16 @@ INDIStarbookTen::Abort() {
 bool
 INDIStarbookTen::SetTrackEnabled(bool enabled) {
     try {
+        bool rc;
         if (enabled) {
             LOG_INFO("Enabling tracking");
-            return retry<bool>(2, &StarbookTen::start, starbook, true);
+            rc = retry<bool>(2, &StarbookTen::start, starbook, true);
         } else {
             LOG_INFO("Disabling tracking");
-            return retry<bool>(2, &StarbookTen::stop, starbook);
+            rc = retry<bool>(2, &StarbookTen::stop, starbook);
         }
+        refreshStatus();
+        return rc;
     } catch (std::exception &ex) {
         LOGF_ERROR("SetTrackEnabled failed: %s", ex.what());
         return false;
@@ -572,6 +618,7 @@ IPState
 INDIStarbookTen::GuideNorth(uint32_t ms) {
     try {
         retry<bool>(1, &StarbookTen::movePulse, starbook, StarbookTen::GUIDE_NORTH, ms);
+        refreshStatus();
         return IPS_OK;
     } catch (std::exception &ex) {
         LOGF_ERROR("GuideNorth failed: %s", ex.what());
@@ -584,6 +631,7 @@ IPState
 INDIStarbookTen::GuideSouth(uint32_t ms) {
     try {
         retry<bool>(1, &StarbookTen::movePulse, starbook, StarbookTen::GUIDE_SOUTH, ms);
+        refreshStatus();
         return IPS_OK;
     } catch (std::exception &ex) {
         LOGF_ERROR("GuideSouth failed: %s", ex.what());
@@ -596,6 +644,7 @@ IPState
 INDIStarbookTen::GuideEast(uint32_t ms) {
     try {
         retry<bool>(1, &StarbookTen::movePulse, starbook, StarbookTen::GUIDE_EAST, ms);
+        refreshStatus();
         return IPS_OK;
     } catch (std::exception &ex) {
         LOGF_ERROR("GuideEast failed: %s", ex.what());
@@ -608,6 +657,7 @@ IPState
 INDIStarbookTen::GuideWest(uint32_t ms) {
     try {
         retry<bool>(1, &StarbookTen::movePulse, starbook, StarbookTen::GUIDE_WEST, ms);
+        refreshStatus();
         return IPS_OK;
     } catch (std::exception &ex) {
         LOGF_ERROR("GuideWest failed: %s", ex.what());
@@ -5,6 +5,7 @@
 #include "indiguiderinterface.h"
 #include "connectionhttp.h"
 #include "starbook_ten.h"
+#include "starbook_ten_poller.h"
 
 class INDIStarbookTen : public INDI::Telescope, INDI::GuiderInterface {
 public:
@@ -58,6 +59,7 @@ protected:
 private:
     bool fetchStartupInfo();
     bool updateStarbookState(StarbookTen::MountStatus& stat);
+    void refreshStatus();
 
     uint8_t DBG_SCOPE { INDI::Logger::DBG_IGNORE };
 
@@ -104,6 +106,10 @@ private:
     Connection::HTTP *httpConnection = nullptr;
 
     StarbookTen *starbook;
+
+    /* Status is polled in the background, ReadScopeStatus only picks up new snapshots */
+    StarbookTenPoller *poller = nullptr;
+    unsigned long lastPollCycle = 0;
 };
 
 #endif /* _INDI_STARBOOK_TEN_H_ */
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <functional>
+#include <future>
+#include "starbook_ten_poller.h"
+
+template <typename Tr>
+static Tr
+retryGet(int retries, std::function<Tr()> f) {
+    for (;;) {
+        try {
+            return f();
+        } catch (std::exception& ex) {
+            if (retries-- > 0) {
+                continue;
+            } else {
+                throw;
+            }
+        }
+    }
+}
+
+
+StarbookTenPoller::StarbookTenPoller(const std::string& base_url, int retries) :
+    retries(retries),
+    status_client(base_url.c_str()), tracking_client(base_url.c_str()),
+    pierside_client(base_url.c_str()), guide_client(base_url.c_str()) {
+}
+
+
+StarbookTenPoller::~StarbookTenPoller() {
+    stop();
+}
+
+
+void
+StarbookTenPoller::start(unsigned int period_ms) {
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    this->period_ms = period_ms;
+    running = true;
+    latest_valid = false;
+    generation++;
+    thread = std::thread(&StarbookTenPoller::run, this);
+}
+
+
+void
+StarbookTenPoller::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+
+void
+StarbookTenPoller::setGuideQuery(bool enabled) {
+    guide_query = enabled;
+}
+
+
+void
+StarbookTenPoller::refresh() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    wake.notify_all();
+}
+
+
+bool
+StarbookTenPoller::snapshot(Snapshot& snap) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!latest_valid || latest_generation != generation)
+        return false;
+
+    snap = latest;
+    return true;
+}
+
+
+void
+StarbookTenPoller::run() {
+    unsigned long cycle = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        unsigned long cycle_generation = generation;
+        auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(period_ms);
+
+        lock.unlock();
+
+        Snapshot snap {};
+        poll(snap);
+        snap.cycle = ++cycle;
+
+        lock.lock();
+
+        latest = snap;
+        latest_valid = true;
+        latest_generation = cycle_generation;
+
+        // a refresh() during the cycle makes its data stale, poll again right away
+        wake.wait_until(lock, next, [&] {
+            return !running || generation != cycle_generation;
+        });
+    }
+}
+
+
+void
+StarbookTenPoller::poll(Snapshot& snap) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto status = std::async(std::launch::async, [this] {
+        return retryGet<StarbookTen::MountStatus>(retries, [this] { return status_client.getStatus(); });
+    });
+    auto tracking = std::async(std::launch::async, [this] {
+        return retryGet<bool>(retries, [this] { return tracking_client.isTracking(); });
+    });
+    auto pierside = std::async(std::launch::async, [this] {
+        return retryGet<StarbookTen::PierSide>(retries, [this] { return pierside_client.getPierSide(); });
+    });
+
+    // the guide status is only needed while pulse guiding, fetch it from this thread
+    std::tuple<bool,bool> guide(false, false);
+    if (guide_query) {
+        try {
+            guide = retryGet<std::tuple<bool,bool> >(retries, [this] { return guide_client.getGuidingRaDec(); });
+            snap.guide_valid = true;
+        } catch (std::exception& ex) {
+            snap.error = ex.what();
+        }
+    }
+    snap.guiding_ra = std::get<0>(guide);
+    snap.guiding_dec = std::get<1>(guide);
+
+    try {
+        snap.status = status.get();
+    } catch (std::exception& ex) {
+        snap.error = ex.what();
+    }
+
+    try {
+        snap.tracking = tracking.get();
+    } catch (std::exception& ex) {
+        snap.error = ex.what();
+    }
+
+    try {
+        snap.pier_side = pierside.get();
+    } catch (std::exception& ex) {
+        snap.error = ex.what();
+    }
+
+    snap.cycle_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
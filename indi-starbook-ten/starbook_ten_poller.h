@@ -0,0 +1,80 @@
+#ifndef _STARBOOK_TEN_POLLER_H_
+#define _STARBOOK_TEN_POLLER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "starbook_ten.h"
+
+/*
+ * Polls the mount status endpoints in the background so the INDI main
+ * thread never waits on HTTP. Every endpoint has its own keep-alive
+ * client and all of them are queried concurrently, so a poll cycle takes
+ * about as long as the slowest reply instead of the sum of all of them.
+ */
+class StarbookTenPoller {
+public:
+    struct Snapshot {
+        StarbookTen::MountStatus status;
+        bool tracking;
+        StarbookTen::PierSide pier_side;
+
+        /* only valid when guide_valid is set, see setGuideQuery() */
+        bool guide_valid;
+        bool guiding_ra;
+        bool guiding_dec;
+
+        /* counts completed cycles, a new value means new data */
+        unsigned long cycle;
+        double cycle_ms;
+
+        /* non-empty if any endpoint failed in this cycle */
+        std::string error;
+    };
+
+    StarbookTenPoller(const std::string& base_url, int retries = 2);
+    ~StarbookTenPoller();
+
+    void start(unsigned int period_ms);
+    void stop();
+
+    /* Also query /getguidestatus while pulse guiding is in progress. */
+    void setGuideQuery(bool enabled);
+
+    /* Discards the data polled so far and polls again right away. Call it after
+     * commands that change the mount state, so no stale state is reported. */
+    void refresh();
+
+    /* Copies the latest snapshot, returns false if there is none taken after
+     * the last refresh(). Never waits for the network. */
+    bool snapshot(Snapshot& snap);
+
+private:
+    void run();
+    void poll(Snapshot& snap);
+
+    int retries;
+
+    /* one client per endpoint, each used by a single request at a time */
+    StarbookTen status_client;
+    StarbookTen tracking_client;
+    StarbookTen pierside_client;
+    StarbookTen guide_client;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running = false;
+    unsigned int period_ms = 1000;
+    unsigned long generation = 0;
+
+    std::atomic<bool> guide_query { false };
+
+    Snapshot latest {};
+    bool latest_valid = false;
+    unsigned long latest_generation = 0;
+};
+
+#endif /* _STARBOOK_TEN_POLLER_H_ */
@@ -0,0 +1,116 @@
+//
+// Loopback StarBook Ten emulator, to check the status parsing and to
+// measure how long a status poll cycle takes with a slow mount.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "starbook_ten.h"
+#include "starbook_ten_poller.h"
+
+class StarbookTenEmulator {
+public:
+    explicit StarbookTenEmulator(int latency_ms) : latency_ms(latency_ms) {
+        reply("/getstatus2", "<!--RA=12.5&DEC=-30.25&GOTO=0&STATE=SCOPE-->");
+        reply("/gettrackstatus", "<!--TRACK=1-->");
+        reply("/get_pierside", "<!--PIERSIDE=1-->");
+        reply("/getguidestatus", "<!--RA+=0&RA-=1&DEC+=0&DEC-=0-->");
+
+        port = server.bind_to_any_port("127.0.0.1");
+        thread = std::thread([this] { server.listen_after_bind(); });
+
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ~StarbookTenEmulator() {
+        server.stop();
+        thread.join();
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port);
+    }
+
+private:
+    void reply(const char *path, const char *body) {
+        std::string content = std::string("<html><body>") + body + "</body></html>";
+
+        server.Get(path, [this, content](const httplib::Request&, httplib::Response& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+            res.set_content(content, "text/html");
+        });
+    }
+
+    int latency_ms;
+    int port;
+    httplib::Server server;
+    std::thread thread;
+};
+
+
+TEST(StarbookTen, status) {
+    StarbookTenEmulator emu(0);
+    StarbookTen starbook(emu.url().c_str());
+
+    auto stat = starbook.getStatus();
+    ASSERT_DOUBLE_EQ(stat.ra, 12.5);
+    ASSERT_DOUBLE_EQ(stat.dec, -30.25);
+    ASSERT_FALSE(stat.goto_busy);
+    ASSERT_EQ(stat.state, StarbookTen::STATE_SCOPE);
+
+    ASSERT_TRUE(starbook.isTracking());
+    ASSERT_EQ(starbook.getPierSide(), StarbookTen::PIERSIDE_EAST);
+
+    auto gs = starbook.getGuidingRaDec();
+    ASSERT_TRUE(std::get<0>(gs));
+    ASSERT_FALSE(std::get<1>(gs));
+}
+
+
+TEST(StarbookTen, poller) {
+    const int latency_ms = 100;
+    StarbookTenEmulator emu(latency_ms);
+    StarbookTenPoller poller(emu.url());
+    StarbookTenPoller::Snapshot snap;
+
+    poller.setGuideQuery(true);
+    poller.start(200);
+
+    auto t0 = std::chrono::steady_clock::now();
+    while (!poller.snapshot(snap)) {
+        ASSERT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    ASSERT_TRUE(snap.error.empty()) << snap.error;
+    ASSERT_DOUBLE_EQ(snap.status.ra, 12.5);
+    ASSERT_TRUE(snap.tracking);
+    ASSERT_EQ(snap.pier_side, StarbookTen::PIERSIDE_EAST);
+    ASSERT_TRUE(snap.guide_valid);
+    ASSERT_TRUE(snap.guiding_ra);
+
+    std::cerr << "poll cycle with " << latency_ms << " ms per request: " << snap.cycle_ms << " ms" << std::endl;
+
+    // four requests one after the other would take at least 4 x latency
+    ASSERT_LT(snap.cycle_ms, 3 * latency_ms);
+
+    // a refresh discards what was polled before it
+    poller.refresh();
+    ASSERT_FALSE(poller.snapshot(snap));
+
+    t0 = std::chrono::steady_clock::now();
+    while (!poller.snapshot(snap)) {
+        ASSERT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    poller.stop();
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
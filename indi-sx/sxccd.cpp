@@ -33,9 +33,12 @@
 
 #include "sxconfig.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <deque>
 #include <memory>
+#include <sys/time.h>
 #include <unistd.h>
 
 #define SX_GUIDE_EAST  0x08 /* RA+ */
@@ -63,6 +66,92 @@ static class Loader
         }
 } loader;
 
+/*
+ * Readout sinks, sxReadPixelsStream hands them each transfer as it completes,
+ * so pixels are reordered while the rest of the frame is still being read.
+ */
+
+// One field of an interlaced sensor, its rows go to every other frame row
+struct FieldSink
+{
+    uint8_t *frame;
+    unsigned long rowBytes;
+    unsigned long rows;
+    unsigned long parity;
+};
+
+static void FieldSinkCallback(void *context, const unsigned char *data, unsigned long offset, unsigned long length)
+{
+    FieldSink *sink = (FieldSink *)context;
+    while (length > 0)
+    {
+        unsigned long row = 2 * (offset / sink->rowBytes) + sink->parity;
+        unsigned long col = offset % sink->rowBytes;
+        unsigned long n   = std::min(length, sink->rowBytes - col);
+        if (row >= sink->rows)
+            return;
+        memcpy(sink->frame + row * sink->rowBytes + col, data, n);
+        data += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+// ICX453 reads two frame rows at once, each group of four readout pixels
+// holds two pixels of both rows
+struct ICX453Sink
+{
+    uint16_t *frame;
+    unsigned long width, height;
+    int offset_1, offset_2;
+    unsigned long row, col;
+    unsigned char carry[8];
+    unsigned long carried;
+};
+
+static inline void ICX453StoreGroup(ICX453Sink *sink, const unsigned char *data)
+{
+    uint16_t group[4];
+    memcpy(group, data, sizeof(group));
+    if (sink->row + 1 >= sink->height)
+        return;
+    uint16_t *top    = sink->frame + sink->row * sink->width + sink->col;
+    uint16_t *bottom = top + sink->width;
+    top[0]           = group[0];
+    top[1]           = group[sink->offset_1];
+    bottom[0]        = group[1];
+    bottom[1]        = group[sink->offset_2];
+    sink->col += 2;
+    if (sink->col >= sink->width)
+    {
+        sink->col = 0;
+        sink->row += 2;
+    }
+}
+
+static void ICX453SinkCallback(void *context, const unsigned char *data, unsigned long offset, unsigned long length)
+{
+    INDI_UNUSED(offset);
+    ICX453Sink *sink = (ICX453Sink *)context;
+    // finish a group split by a short transfer
+    if (sink->carried > 0)
+    {
+        unsigned long n = std::min(length, sizeof(sink->carry) - sink->carried);
+        memcpy(sink->carry + sink->carried, data, n);
+        sink->carried += n;
+        data += n;
+        length -= n;
+        if (sink->carried < sizeof(sink->carry))
+            return;
+        ICX453StoreGroup(sink, sink->carry);
+        sink->carried = 0;
+    }
+    for (; length >= sizeof(sink->carry); data += sizeof(sink->carry), length -= sizeof(sink->carry))
+        ICX453StoreGroup(sink, data);
+    memcpy(sink->carry, data, length);
+    sink->carried = length;
+}
+
 void ExposureTimerCallback(void *p)
 {
     ((SXCCD *)p)->ExposureTimerHit();
@@ -88,8 +177,6 @@ SXCCD::SXCCD(DEVICE device, const char *name)
     this->device          = device;
     handle                = nullptr;
     model                 = 0;
-    oddBuf                = nullptr;
-    evenBuf               = nullptr;
     GuideStatus           = 0;
     TemperatureRequest    = 0;
     TemperatureReported   = 0;
@@ -103,6 +190,7 @@ SXCCD::SXCCD(DEVICE device, const char *name)
     ExposureTimerID       = 0;
     DidFlush              = false;
     DidLatch              = false;
+    ReadoutAborted        = false;
     GuideExposureTimerID  = 0;
     InGuideExposure       = false;
     DidGuideLatch         = false;
@@ -115,6 +203,8 @@ SXCCD::SXCCD(DEVICE device, const char *name)
 
 SXCCD::~SXCCD()
 {
+    if (readoutThread.joinable())
+        readoutThread.join();
     if (handle)
         sxClose(&handle);
 }
@@ -297,6 +387,8 @@ bool SXCCD::Connect()
 
 bool SXCCD::Disconnect()
 {
+    if (readoutThread.joinable())
+        readoutThread.join();
     if (handle != nullptr)
     {
         sxClose(&handle);
@@ -329,21 +421,6 @@ void SXCCD::SetupParms()
         nbuf *= 2;
     //nbuf += 512;
     PrimaryCCD.setFrameBufferSize(nbuf);
-    if (isInterlaced)
-    {
-        if (evenBuf != nullptr)
-            delete evenBuf;
-        if (oddBuf != nullptr)
-            delete oddBuf;
-        evenBuf      = new char[nbuf / 2];
-        oddBuf       = new char[nbuf / 2];
-    }
-    else if (isICX453)
-    {
-        if (evenBuf != nullptr)
-            delete evenBuf;
-        evenBuf      = new char[nbuf];
-    }
 
     if (HasGuideHead)
     {
@@ -361,7 +438,9 @@ void SXCCD::TimerHit()
 {
     if (isConnected() && HasCooler)
     {
-        if (!DidLatch && !DidGuideLatch)
+        // skip the cooler update while a frame is read out
+        std::unique_lock<std::mutex> lock(usbMutex, std::try_to_lock);
+        if (lock.owns_lock() && !DidLatch && !DidGuideLatch)
         {
             unsigned char status;
             unsigned short temperature;
@@ -393,8 +472,10 @@ int SXCCD::SetTemperature(double temperature)
     TemperatureRequest = temperature;
     unsigned char status;
     unsigned short sx_temperature;
+    std::unique_lock<std::mutex> lock(usbMutex);
     sxSetCooler(handle, (unsigned char)(CoolerS[0].s == ISS_ON), (unsigned short)(TemperatureRequest * 10 + 2730),
                 &status, &sx_temperature);
+    lock.unlock();
     TemperatureReported = TemperatureN[0].value = (sx_temperature - 2730) / 10.0;
     if (std::fabs(TemperatureRequest - TemperatureReported) < 1)
         result = 1;
@@ -411,6 +492,9 @@ int SXCCD::SetTemperature(double temperature)
 
 bool SXCCD::StartExposure(float n)
 {
+    if (readoutThread.joinable())
+        readoutThread.join();
+    std::lock_guard<std::mutex> lock(usbMutex);
     InExposure = true;
     PrimaryCCD.setExposureDuration(n);
     if (sxIsInterlaced(model) && PrimaryCCD.getBinY() == 1)
@@ -445,11 +529,15 @@ bool SXCCD::AbortExposure()
     {
         if (ExposureTimerID)
             IERmTimer(ExposureTimerID);
-        if (HasShutter)
+        // a readout in progress still runs to the end, its frame is dropped
+        ReadoutAborted = true;
+        if (HasShutter && !DidLatch)
+        {
+            std::lock_guard<std::mutex> lock(usbMutex);
             sxSetShutter(handle, 1);
+        }
         ExposureTimerID = 0;
         PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
-        DidLatch = false;
         DidFlush = false;
         return true;
     }
@@ -463,132 +551,130 @@ void SXCCD::ExposureTimerHit()
         if (!DidFlush)
         {
             ExposureTimerID = IEAddTimer(3000, ExposureTimerCallback, this);
+            std::lock_guard<std::mutex> lock(usbMutex);
             sxClearPixels(handle, CCD_EXP_FLAGS_NOWIPE_FRAME, 0);
             DidFlush = true;
         }
         else
         {
-            int rc;
-            ExposureTimerID   = 0;
-            bool isInterlaced = sxIsInterlaced(model);
-            int subX          = PrimaryCCD.getSubX();
-            int subY          = PrimaryCCD.getSubY();
-            int subW          = PrimaryCCD.getSubW();
-            int subH          = PrimaryCCD.getSubH();
-            int binX          = PrimaryCCD.getBinX();
-            int binY          = PrimaryCCD.getBinY();
-            int subWW         = subW * 2;
-            bool isICX453     = sxIsICX453(model);
-            uint8_t *buf      = PrimaryCCD.getFrameBuffer();
-            int size;
-            if (isInterlaced && binY > 1)
-                size = subW * subH / 2 / binX / (binY / 2);
-            else
-                size = subW * subH / binX / binY;
-            if (HasShutter)
-                sxSetShutter(handle, 1);
-            DidLatch = true;
-            if (isInterlaced)
-            {
-                if (binY > 1)
-                {
-                    rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY / binY, subW, subH / 2, binX,
-                                       binY / 2);
-                    if (rc)
-                        rc = sxReadPixels(handle, buf, size * 2);
-                }
-                else
-                {
-                    rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_EVEN | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2, subW,
-                                       subH / 2, binX, 1);
-                    struct timeval tv;
-                    gettimeofday(&tv, nullptr);
-                    long startTime = tv.tv_sec * 1000000 + tv.tv_usec;
-                    if (rc)
-                        rc = sxReadPixels(handle, evenBuf, size);
-                    gettimeofday(&tv, nullptr);
-                    wipeDelay = tv.tv_sec * 1000000 + tv.tv_usec - startTime;
-                    if (rc)
-                        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_ODD | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2,
-                                           subW, subH / 2, binX, 1);
-                    if (rc)
-                        rc = sxReadPixels(handle, oddBuf, size);
-                    if (rc)
-                    {
-                        for (int i = 0, j = 0; i < subH; i += 2, j++)
-                        {
-                            memcpy(buf + i * subWW, oddBuf + (j * subWW), subWW);
-                            memcpy(buf + ((i + 1) * subWW), evenBuf + (j * subWW), subWW);
-                        }
-                        //            deinterlace((unsigned short *)buf, subW, subH);
-                    }
-                }
-            }
-            else if (isICX453)
+            // Read the frame out on a worker, so the timer callbacks keep running meanwhile
+            ExposureTimerID = 0;
+            if (readoutThread.joinable())
+                readoutThread.join();
+            ReadoutAborted = false;
+            DidLatch       = true;
+            readoutThread  = std::thread(&SXCCD::ReadPrimaryCCD, this);
+        }
+    }
+}
+
+void SXCCD::ReadPrimaryCCD()
+{
+    int rc;
+    bool isInterlaced = sxIsInterlaced(model);
+    int subX          = PrimaryCCD.getSubX();
+    int subY          = PrimaryCCD.getSubY();
+    int subW          = PrimaryCCD.getSubW();
+    int subH          = PrimaryCCD.getSubH();
+    int binX          = PrimaryCCD.getBinX();
+    int binY          = PrimaryCCD.getBinY();
+    bool isICX453     = sxIsICX453(model);
+    uint8_t *buf      = PrimaryCCD.getFrameBuffer();
+    int size;
+    if (isInterlaced && binY > 1)
+        size = subW * subH / 2 / binX / (binY / 2);
+    else
+        size = subW * subH / binX / binY;
+    std::unique_lock<std::mutex> lock(usbMutex);
+    if (HasShutter)
+        sxSetShutter(handle, 1);
+    if (isInterlaced)
+    {
+        if (binY > 1)
+        {
+            rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY / binY, subW, subH / 2, binX,
+                               binY / 2);
+            if (rc)
+                rc = sxReadPixels(handle, buf, size * 2);
+        }
+        else
+        {
+            // Each field lands on its own frame rows while it is read
+            FieldSink even = { buf, (unsigned long)subW / binX * 2, (unsigned long)subH, 1 };
+            FieldSink odd  = { buf, (unsigned long)subW / binX * 2, (unsigned long)subH, 0 };
+            rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_EVEN | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2, subW,
+                               subH / 2, binX, 1);
+            struct timeval tv;
+            gettimeofday(&tv, nullptr);
+            long startTime = tv.tv_sec * 1000000 + tv.tv_usec;
+            if (rc)
+                rc = sxReadPixelsStream(handle, size, FieldSinkCallback, &even);
+            gettimeofday(&tv, nullptr);
+            wipeDelay = tv.tv_sec * 1000000 + tv.tv_usec - startTime;
+            if (rc)
+                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_ODD | CCD_EXP_FLAGS_SPARE2, 0, subX, subY / 2,
+                                   subW, subH / 2, binX, 1);
+            if (rc)
+                rc = sxReadPixelsStream(handle, size, FieldSinkCallback, &odd);
+        }
+    }
+    else if (isICX453)
+    {
+        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX * 2, subY / 2, subW * 2, subH / 2, binX, binY);
+        if (rc)
+        {
+            if (binX == 1 && binY == 1)
             {
-                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX * 2, subY / 2, subW * 2, subH / 2, binX, binY);
-                if (rc)
+                ICX453Sink sink;
+                memset(&sink, 0, sizeof(sink));
+                sink.frame    = reinterpret_cast<uint16_t *>(buf);
+                sink.width    = subW;
+                sink.height   = subH;
+                sink.offset_1 = 2;
+                sink.offset_2 = 3;
+                if (strstr(getDeviceName(), "SXVF-M25C"))
                 {
-                    if (binX == 1 && binY == 1)
-                    {
-                        rc = sxReadPixels(handle, evenBuf, size * 2);
-                        if (rc)
-                        {
-                            uint16_t *buf16 = reinterpret_cast<uint16_t *>(buf);
-                            uint16_t *evenBuf16 = reinterpret_cast<uint16_t *>(evenBuf);
-
-                            int offset_1 = 2, offset_2 = 3;
-                            if (strstr(getDeviceName(), "SXVF-M25C"))
-                            {
-                                // Patch by Greg Bosch on 2020-01-02 to fix bayer pattern
-                                // on SXVF-M25C.
-                                offset_1 = 3;
-                                offset_2 = 2;
-                            }
-
-                            for (int i = 0; i < subH; i += 2)
-                            {
-                                for (int j = 0; j < subW; j += 2)
-                                {
-                                    int isubW = i * subW;
-                                    int i1subW = (i + 1) * subW;
-                                    int j2 = j * 2;
-
-                                    buf16[isubW + j]  = evenBuf16[isubW + j2];
-                                    buf16[isubW + j + 1]  = evenBuf16[isubW + j2 + offset_1];
-                                    buf16[i1subW + j]  = evenBuf16[isubW + j2 + 1];
-                                    buf16[i1subW + j + 1]  = evenBuf16[isubW + j2 + offset_2];
-
-                                }
-                            }
-                        }
-                    }
-                    else
-                    {
-                        rc = sxReadPixels(handle, buf, size * 2);
-                    }
+                    // Patch by Greg Bosch on 2020-01-02 to fix bayer pattern
+                    // on SXVF-M25C.
+                    sink.offset_1 = 3;
+                    sink.offset_2 = 2;
                 }
+                rc = sxReadPixelsStream(handle, size * 2, ICX453SinkCallback, &sink);
             }
             else
             {
-                rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY, subW, subH, binX, binY);
-                if (rc)
-                    rc = sxReadPixels(handle, buf, size * 2);
+                rc = sxReadPixels(handle, buf, size * 2);
             }
-            DidLatch   = false;
-            InExposure = false;
-            PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
-            if (rc)
-                ExposureComplete(&PrimaryCCD);
         }
     }
+    else
+    {
+        rc = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, subX, subY, subW, subH, binX, binY);
+        if (rc)
+            rc = sxReadPixels(handle, buf, size * 2);
+    }
+    DidLatch = false;
+    lock.unlock();
+    if (ReadoutAborted)
+        return;
+    InExposure = false;
+    PrimaryCCD.setExposureLeft(ExposureTimeLeft = 0);
+    if (rc)
+        ExposureComplete(&PrimaryCCD);
+    else
+    {
+        LOG_ERROR("Failed to read the frame from the camera.");
+        PrimaryCCD.setExposureFailed();
+    }
 }
 
 bool SXCCD::StartGuideExposure(float n)
 {
     InGuideExposure = true;
     GuideCCD.setExposureDuration(n);
+    std::unique_lock<std::mutex> lock(usbMutex);
     sxClearPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 1);
+    lock.unlock();
     int time = (int)(1000 * n);
     if (time < 1)
         time = 1;
@@ -625,11 +711,13 @@ void SXCCD::GuideExposureTimerHit()
         int binY             = GuideCCD.getBinY();
         int size             = subW * subH / binX / binY;
         uint8_t *buf         = GuideCCD.getFrameBuffer();
+        std::unique_lock<std::mutex> lock(usbMutex);
         DidGuideLatch        = true;
         rc                   = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 1, subX, subY, subW, subH, binX, binY);
         if (rc)
             rc = sxReadPixels(handle, buf, size);
         DidGuideLatch   = false;
+        lock.unlock();
         InGuideExposure = false;
         GuideCCD.setExposureLeft(GuideExposureTimeLeft = 0);
         if (rc)
@@ -650,12 +738,12 @@ IPState SXCCD::GuideWest(uint32_t ms)
     }
     GuideStatus &= SX_CLEAR_WE;
     GuideStatus |= SX_GUIDE_WEST;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     if (ms < 100)
     {
         usleep(ms * 1000);
         GuideStatus &= SX_CLEAR_WE;
-        sxSetSTAR2000(handle, GuideStatus);
+        SendGuideStatus();
     }
     else
         WEGuiderTimerID = IEAddTimer(ms, WEGuiderTimerCallback, this);
@@ -675,22 +763,28 @@ IPState SXCCD::GuideEast(uint32_t ms)
     }
     GuideStatus &= SX_CLEAR_WE;
     GuideStatus |= SX_GUIDE_EAST;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     if (ms < 100)
     {
         usleep(ms * 1000);
         GuideStatus &= SX_CLEAR_WE;
-        sxSetSTAR2000(handle, GuideStatus);
+        SendGuideStatus();
     }
     else
         WEGuiderTimerID = IEAddTimer(ms, WEGuiderTimerCallback, this);
     return IPS_OK;
 }
 
+void SXCCD::SendGuideStatus()
+{
+    std::lock_guard<std::mutex> lock(usbMutex);
+    sxSetSTAR2000(handle, GuideStatus);
+}
+
 void SXCCD::WEGuiderTimerHit()
 {
     GuideStatus &= SX_CLEAR_WE;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     WEGuiderTimerID = 0;
     GuideComplete(AXIS_RA);
 }
@@ -708,12 +802,12 @@ IPState SXCCD::GuideNorth(uint32_t ms)
     }
     GuideStatus &= SX_CLEAR_NS;
     GuideStatus |= SX_GUIDE_NORTH;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     if (ms < 100)
     {
         usleep(ms * 1000);
         GuideStatus &= SX_CLEAR_NS;
-        sxSetSTAR2000(handle, GuideStatus);
+        SendGuideStatus();
     }
     else
         NSGuiderTimerID = IEAddTimer(ms, NSGuiderTimerCallback, this);
@@ -733,12 +827,12 @@ IPState SXCCD::GuideSouth(uint32_t ms)
     }
     GuideStatus &= SX_CLEAR_NS;
     GuideStatus |= SX_GUIDE_SOUTH;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     if (ms < 100)
     {
         usleep(ms * 1000);
         GuideStatus &= SX_CLEAR_NS;
-        sxSetSTAR2000(handle, GuideStatus);
+        SendGuideStatus();
     }
     else
         NSGuiderTimerID = IEAddTimer(ms, NSGuiderTimerCallback, this);
@@ -748,7 +842,7 @@ IPState SXCCD::GuideSouth(uint32_t ms)
 void SXCCD::NSGuiderTimerHit()
 {
     GuideStatus &= SX_CLEAR_NS;
-    sxSetSTAR2000(handle, GuideStatus);
+    SendGuideStatus();
     NSGuiderTimerID = 0;
     GuideComplete(AXIS_DE);
 }
@@ -768,6 +862,7 @@ bool SXCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char
         IUUpdateSwitch(&ShutterSP, states, names, n);
         ShutterSP.s = IPS_OK;
         IDSetSwitch(&ShutterSP, nullptr);
+        std::lock_guard<std::mutex> lock(usbMutex);
         sxSetShutter(handle, ShutterS[0].s != ISS_ON);
         result = true;
     }
@@ -778,8 +873,10 @@ bool SXCCD::ISNewSwitch(const char *dev, const char *name, ISState *states, char
         IDSetSwitch(&CoolerSP, nullptr);
         unsigned char status;
         unsigned short temperature;
+        std::unique_lock<std::mutex> lock(usbMutex);
         sxSetCooler(handle, (unsigned char)(CoolerS[0].s == ISS_ON), (unsigned short)(TemperatureRequest * 10 + 2730),
                     &status, &temperature);
+        lock.unlock();
         TemperatureReported = TemperatureN[0].value = (temperature - 2730) / 10.0;
         TemperatureNP.s                             = IPS_OK;
         IDSetNumber(&TemperatureNP, nullptr);
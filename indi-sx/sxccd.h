@@ -35,6 +35,10 @@
 
 #include <indiccd.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 void ExposureTimerCallback(void *p);
 void GuideExposureTimerCallback(void *p);
 void WEGuiderTimerCallback(void *p);
@@ -47,7 +51,6 @@ class SXCCD : public INDI::CCD
         HANDLE handle;
         unsigned short model;
         char name[32];
-        char *evenBuf, *oddBuf;
         long wipeDelay;
         ISwitch CoolerS[2];
         ISwitchVectorProperty CoolerSP;
@@ -64,10 +67,14 @@ class SXCCD : public INDI::CCD
         int WEGuiderTimerID;
         int NSGuiderTimerID;
         bool DidFlush;
-        bool DidLatch;
+        std::atomic<bool> DidLatch;
         bool DidGuideLatch;
         bool InGuideExposure;
         char GuideStatus;
+        // Serializes command and reply sequences on the USB pipes
+        std::mutex usbMutex;
+        std::thread readoutThread;
+        std::atomic<bool> ReadoutAborted;
 
     protected:
         const char *getDefaultName();
@@ -85,7 +92,9 @@ class SXCCD : public INDI::CCD
         bool AbortGuideExposure();
         void TimerHit();
         void ExposureTimerHit();
+        void ReadPrimaryCCD();
         void GuideExposureTimerHit();
+        void SendGuideStatus();
         void WEGuiderTimerHit();
         void NSGuiderTimerHit();
         //bool saveConfigItems(FILE *fp);
@@ -31,9 +31,11 @@
 
 #include "sxconfig.h"
 
+#include <chrono>
 #include <iostream>
 #include <memory.h>
 #include <unistd.h>
+#include <vector>
 
 int n;
 DEVICE devices[20];
@@ -125,6 +127,26 @@ int main()
         }
         std::cout << std::endl;
 
+        if (params.width > 0 && params.height > 0)
+        {
+            unsigned long count = (unsigned long)params.width * params.height * (params.bits_per_pixel == 16 ? 2 : 1);
+            std::vector<unsigned char> frame(count);
+
+            i = sxClearPixels(handle, 0, 0);
+            std::cout << "sxClearPixels(..., 0) -> " << i << std::endl << std::endl;
+
+            i = sxLatchPixels(handle, CCD_EXP_FLAGS_FIELD_BOTH, 0, 0, 0, params.width, params.height, 1, 1);
+            std::cout << "sxLatchPixels(..., " << params.width << ", " << params.height << ", ...) -> " << i << std::endl
+                      << std::endl;
+
+            auto start = std::chrono::steady_clock::now();
+            i          = sxReadPixels(handle, frame.data(), count);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "sxReadPixels() -> " << i << ", " << count << " bytes in " << elapsed.count() << " s, "
+                      << count / elapsed.count() / 1e6 << " MB/s" << std::endl
+                      << std::endl;
+        }
+
         if (params.extra_caps & SXCCD_CAPS_GUIDER)
         {
             memset(&params, 0, sizeof(params));
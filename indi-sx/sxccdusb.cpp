@@ -117,12 +117,17 @@
 #define BULK_COMMAND_TIMEOUT 2000
 #define BULK_DATA_TIMEOUT    40000 //Older SXV-M25C takes 14s unbinned
 
+/*
+ * Pixel readout keeps several bulk transfers in flight, so the host
+ * controller always has a request queued when the previous one completes.
+ * Transfer sizes are multiples of the 512 byte high speed packet size.
+ */
+#define ASYNC_TRANSFERS 4
+
 #ifdef __arm__
-#define CHUNK_SIZE (4 * 1024 * 1024)
-//#warning "ARM mode, 4MB CHUNK_SIZE"
+#define ASYNC_TRANSFER_SIZE (256 * 1024)
 #else
-#define CHUNK_SIZE (16*1024*1024)
-//#warning "Intel mode, 16MB CHUNK_SIZE"
+#define ASYNC_TRANSFER_SIZE (1024 * 1024)
 #endif
 
 #if 1
@@ -734,27 +739,111 @@ int sxExposePixelsGated(HANDLE sxHandle, unsigned short flags, unsigned short ca
     return rc >= 0;
 }
 
-int sxReadPixels(HANDLE sxHandle, void *pixels, unsigned long count)
+struct t_read_slot
 {
-    int transferred;
-    unsigned long read = 0;
-    int rc             = 0;
-    while (read < count && rc >= 0)
+    libusb_transfer *transfer;
+    unsigned char *buffer;
+    bool busy;
+    int done;
+};
+
+static void LIBUSB_CALL sxReadPixelsDone(libusb_transfer *transfer)
+{
+    ((struct t_read_slot *)transfer->user_data)->done = 1;
+}
+
+static void sxCopyPixels(void *context, const unsigned char *data, unsigned long offset, unsigned long length)
+{
+    memcpy((unsigned char *)context + offset, data, length);
+}
+
+int sxReadPixelsStream(HANDLE sxHandle, unsigned long count, SXREADCALLBACK callback, void *context)
+{
+    struct t_read_slot slots[ASYNC_TRANSFERS];
+    unsigned long requested = 0, received = 0;
+    int head = 0, tail = 0, inflight = 0;
+    int rc = 0;
+    memset(slots, 0, sizeof(slots));
+    for (int i = 0; i < ASYNC_TRANSFERS && rc == 0; i++)
+    {
+        slots[i].transfer = libusb_alloc_transfer(0);
+        slots[i].buffer   = (unsigned char *)malloc(ASYNC_TRANSFER_SIZE);
+        if (slots[i].transfer == nullptr || slots[i].buffer == nullptr)
+            rc = LIBUSB_ERROR_NO_MEM;
+    }
+    while (rc == 0 && received < count)
     {
-        int size = count - read;
-        if (size > CHUNK_SIZE)
-            size = CHUNK_SIZE;
-        rc = libusb_bulk_transfer(sxHandle, BULK_IN, (unsigned char *)pixels + read, size, &transferred,
-                                  BULK_DATA_TIMEOUT);
-        DEBUG(log(true, "sxReadPixels: libusb_control_transfer -> %s\n", rc < 0 ? libusb_error_name(rc) : "OK"));
-        if (transferred >= 0)
+        // keep the queue full, transfers are submitted and completed in slot order
+        while (inflight < ASYNC_TRANSFERS && requested < count)
         {
-            read += transferred;
+            struct t_read_slot *slot = &slots[tail];
+            int size                 = count - requested;
+            if (size > ASYNC_TRANSFER_SIZE)
+                size = ASYNC_TRANSFER_SIZE;
+            libusb_fill_bulk_transfer(slot->transfer, sxHandle, BULK_IN, slot->buffer, size, sxReadPixelsDone, slot,
+                                      BULK_DATA_TIMEOUT);
+            slot->done = 0;
+            rc         = libusb_submit_transfer(slot->transfer);
+            if (rc < 0)
+                break;
+            slot->busy = true;
+            requested += size;
+            inflight++;
+            tail = (tail + 1) % ASYNC_TRANSFERS;
         }
+        if (rc < 0)
+            break;
+        struct t_read_slot *slot = &slots[head];
+        while (!slot->done && rc == 0)
+            rc = libusb_handle_events_completed(ctx, &slot->done);
+        if (rc < 0)
+            break;
+        slot->busy = false;
+        inflight--;
+        head = (head + 1) % ASYNC_TRANSFERS;
+        libusb_transfer *transfer = slot->transfer;
+        if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+        {
+            rc = transfer->status == LIBUSB_TRANSFER_TIMED_OUT ? LIBUSB_ERROR_TIMEOUT : LIBUSB_ERROR_IO;
+            break;
+        }
+        if (transfer->actual_length <= 0)
+        {
+            rc = LIBUSB_ERROR_IO;
+            break;
+        }
+        // the transfers behind a short one carry on with the next bytes, only the tail has to be requested again
+        requested -= transfer->length - transfer->actual_length;
+        callback(context, slot->buffer, received, transfer->actual_length);
+        received += transfer->actual_length;
+    }
+    for (int i = 0; i < ASYNC_TRANSFERS; i++)
+    {
+        if (slots[i].busy)
+            libusb_cancel_transfer(slots[i].transfer);
     }
+    for (int i = 0; i < ASYNC_TRANSFERS; i++)
+    {
+        while (slots[i].busy && !slots[i].done)
+        {
+            if (libusb_handle_events_completed(ctx, &slots[i].done) < 0)
+                break;
+        }
+        // a transfer that never came back still belongs to libusb
+        if (slots[i].busy && !slots[i].done)
+            continue;
+        libusb_free_transfer(slots[i].transfer);
+        free(slots[i].buffer);
+    }
+    DEBUG(log(true, "sxReadPixelsStream: %lu of %lu bytes -> %s\n", received, count, rc < 0 ? libusb_error_name(rc) : "OK"));
     return rc >= 0;
 }
 
+int sxReadPixels(HANDLE sxHandle, void *pixels, unsigned long count)
+{
+    return sxReadPixelsStream(sxHandle, count, sxCopyPixels, pixels);
+}
+
 int sxSetSTAR2000(HANDLE sxHandle, char star2k)
 {
     unsigned char setup_data[8];
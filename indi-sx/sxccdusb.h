@@ -115,6 +115,12 @@
 #define DEVICE libusb_device *
 #define HANDLE libusb_device_handle *
 
+/*
+ * Receives pixel data in readout order, offset counts bytes from the start
+ * of the readout.
+ */
+typedef void (*SXREADCALLBACK)(void *context, const unsigned char *data, unsigned long offset, unsigned long length);
+
 /*
  * Structure to hold camera information.
  */
@@ -160,6 +166,7 @@ int sxExposePixelsGated(HANDLE sxHandle, unsigned short flags, unsigned short ca
                         unsigned short yoffset, unsigned short width, unsigned short height, unsigned short xbin,
                         unsigned short ybin, unsigned long msec);
 int sxReadPixels(HANDLE sxHandle, void *pixels, unsigned long count);
+int sxReadPixelsStream(HANDLE sxHandle, unsigned long count, SXREADCALLBACK callback, void *context);
 int sxSetShutter(HANDLE sxHandle, unsigned short state);
 int sxSetTimer(HANDLE sxHandle, unsigned long msec);
 unsigned long sxGetTimer(HANDLE sxHandle);
@@ -588,6 +588,8 @@ bool ToupBase::Disconnect()
 
     FP(Close(m_CameraHandle));
 
+    m_RGBBuffer.release();
+
     return true;
 }
 
@@ -2393,49 +2395,19 @@ void ToupBase::pushCallback(const void* pData, const XP(FrameInfoV2)* pInfo, int
 
         InExposure  = false;
         PrimaryCCD.setExposureLeft(0);
-        uint8_t *buffer = PrimaryCCD.getFrameBuffer();
-        uint32_t size = PrimaryCCD.getFrameBufferSize();
-
-        if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-        {
-            size = PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3;
-            buffer = static_cast<uint8_t*>(malloc(size));
-        }
 
         if (pData == nullptr)
         {
             LOG_ERROR("Failed to push image.");
             PrimaryCCD.setExposureFailed();
-            if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                free(buffer);
         }
         else
         {
-            memcpy(buffer, pData, size);
-
+            // Colour frames are split straight out of the SDK buffer, no intermediate copy needed.
             if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-            {
-                std::unique_lock<std::mutex> guard(ccdBufferLock);
-                uint8_t *image  = PrimaryCCD.getFrameBuffer();
-                uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * (PrimaryCCD.getBPP() / 8);
-                uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * (PrimaryCCD.getBPP() / 8);
-
-                uint8_t *subR = image;
-                uint8_t *subG = image + width * height;
-                uint8_t *subB = image + width * height * 2;
-                int totalSize = width * height * 3 - 3;
-
-                // RGB to three sepearate R-frame, G-frame, and B-frame for color FITS
-                for (int i = 0; i <= totalSize; i += 3)
-                {
-                    *subR++ = buffer[i];
-                    *subG++ = buffer[i + 1];
-                    *subB++ = buffer[i + 2];
-                }
-
-                guard.unlock();
-                free(buffer);
-            }
+                copyRGBToPlanar(static_cast<const uint8_t*>(pData));
+            else
+                memcpy(PrimaryCCD.getFrameBuffer(), pData, PrimaryCCD.getFrameBufferSize());
 
             LOGF_DEBUG("Image received. Width: %d Height: %d flag: %d timestamp: %ld"
                        , pInfo->width,
@@ -2447,6 +2419,17 @@ void ToupBase::pushCallback(const void* pData, const XP(FrameInfoV2)* pInfo, int
     }
 }
 
+void ToupBase::copyRGBToPlanar(const uint8_t *rgb)
+{
+    std::unique_lock<std::mutex> guard(ccdBufferLock);
+    uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+    uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+
+    // RGB to three separate R-frame, G-frame, and B-frame for color FITS
+    PixelConvert::toPlanar(PrimaryCCD.getBPP() > 8 ? PixelConvert::RGB48 : PixelConvert::RGB24, rgb,
+                           PrimaryCCD.getFrameBuffer(), width, height);
+}
+
 void ToupBase::eventCB(unsigned event, void* pCtx)
 {
     static_cast<ToupBase*>(pCtx)->eventPullCallBack(event);
@@ -2501,7 +2484,7 @@ void ToupBase::eventPullCallBack(unsigned event)
                 uint8_t *buffer = PrimaryCCD.getFrameBuffer();
 
                 if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                    buffer = static_cast<uint8_t*>(malloc(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3));
+                    buffer = m_RGBBuffer.get(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3 * (PrimaryCCD.getBPP() / 8));
 
                 std::unique_lock<std::mutex> guard(ccdBufferLock);
                 HRESULT rc = FP(PullImageV2(m_CameraHandle, buffer, captureBits * m_Channels, &info));
@@ -2510,34 +2493,11 @@ void ToupBase::eventPullCallBack(unsigned event)
                 {
                     LOGF_ERROR("Failed to pull image. %s", errorCodes[rc].c_str());
                     PrimaryCCD.setExposureFailed();
-                    if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                        free(buffer);
                 }
                 else
                 {
                     if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                    {
-                        std::unique_lock<std::mutex> locker(ccdBufferLock);
-                        uint8_t *image  = PrimaryCCD.getFrameBuffer();
-                        uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * (PrimaryCCD.getBPP() / 8);
-                        uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * (PrimaryCCD.getBPP() / 8);
-
-                        uint8_t *subR = image;
-                        uint8_t *subG = image + width * height;
-                        uint8_t *subB = image + width * height * 2;
-                        int size      = width * height * 3 - 3;
-
-                        // RGB to three sepearate R-frame, G-frame, and B-frame for color FITS
-                        for (int i = 0; i <= size; i += 3)
-                        {
-                            *subR++ = buffer[i];
-                            *subG++ = buffer[i + 1];
-                            *subB++ = buffer[i + 2];
-                        }
-
-                        locker.unlock();
-                        free(buffer);
-                    }
+                        copyRGBToPlanar(buffer);
 
                     LOGF_DEBUG("Image received. Width: %d Height: %d flag: %d timestamp: %ld", info.width, info.height, info.flag,
                                info.timestamp);
@@ -2587,7 +2547,7 @@ void ToupBase::eventPullCallBack(unsigned event)
                 uint8_t *buffer = PrimaryCCD.getFrameBuffer();
 
                 if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                    buffer = static_cast<uint8_t*>(malloc(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3));
+                    buffer = m_RGBBuffer.get(PrimaryCCD.getXRes() * PrimaryCCD.getYRes() * 3 * (PrimaryCCD.getBPP() / 8));
 
                 std::unique_lock<std::mutex> guard(ccdBufferLock);
                 HRESULT rc = FP(PullStillImageV2(m_CameraHandle, buffer, captureBits * m_Channels, &info));
@@ -2596,34 +2556,11 @@ void ToupBase::eventPullCallBack(unsigned event)
                 {
                     LOGF_ERROR("Failed to pull image. %s", errorCodes[rc].c_str());
                     PrimaryCCD.setExposureFailed();
-                    if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                        free(buffer);
                 }
                 else
                 {
                     if (m_MonoCamera == false && m_CurrentVideoFormat == TC_VIDEO_COLOR_RGB)
-                    {
-                        std::unique_lock<std::mutex> locker(ccdBufferLock);
-                        uint8_t *image  = PrimaryCCD.getFrameBuffer();
-                        uint32_t width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * (PrimaryCCD.getBPP() / 8);
-                        uint32_t height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY() * (PrimaryCCD.getBPP() / 8);
-
-                        uint8_t *subR = image;
-                        uint8_t *subG = image + width * height;
-                        uint8_t *subB = image + width * height * 2;
-                        int size      = width * height * 3 - 3;
-
-                        // RGB to three sepearate R-frame, G-frame, and B-frame for color FITS
-                        for (int i = 0; i <= size; i += 3)
-                        {
-                            *subR++ = buffer[i];
-                            *subG++ = buffer[i + 1];
-                            *subB++ = buffer[i + 2];
-                        }
-
-                        locker.unlock();
-                        free(buffer);
-                    }
+                        copyRGBToPlanar(buffer);
 
                     LOGF_DEBUG("Image received. Width: %d Height: %d flag: %d timestamp: %ld", info.width, info.height, info.flag,
                                info.timestamp);
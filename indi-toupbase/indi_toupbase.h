@@ -24,6 +24,7 @@
 #include <map>
 #include <indiccd.h>
 #include <inditimer.h>
+#include <pixelconvert.h>
 
 #ifdef BUILD_TOUPCAM
 #include <toupcam.h>
@@ -427,6 +428,9 @@ class ToupBase : public INDI::CCD
 
         bool updateBinningMode(int binx, int mode);
 
+        // Split a packed RGB frame into the FITS R, G and B planes of the frame buffer
+        void copyRGBToPlanar(const uint8_t *rgb);
+
         //#############################################################################
         // Callbacks
         //#############################################################################
@@ -684,6 +688,9 @@ class ToupBase : public INDI::CCD
 
         int m_ConfigResolutionIndex {-1};
 
+        // Packed RGB frames pulled from the SDK land here before conversion
+        PixelConvert::ScratchBuffer m_RGBBuffer;
+
         friend void ::ISGetProperties(const char *dev);
         friend void ::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int num);
         friend void ::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int num);
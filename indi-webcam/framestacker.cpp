@@ -0,0 +1,501 @@
+/*
+INDI Webcam CCD Driver
+
+Copyright (C) 2018 Robert Lancaster (rlancaste AT gmail DOT com)
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "framestacker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRAMESTACKER_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FRAMESTACKER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+//Adds count samples of 8 or 16 bits to a row of 32 bit sums
+typedef void (*AccumulateKernel)(const uint8_t *src, uint32_t *acc, size_t count);
+
+void accumulate8Scalar(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        acc[i] += src[i];
+}
+
+void accumulate16Scalar(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    const uint16_t *in = reinterpret_cast<const uint16_t *>(src);
+    for (size_t i = 0; i < count; i++)
+        acc[i] += in[i];
+}
+
+#ifdef FRAMESTACKER_X86
+
+#ifdef __SSE2__
+void accumulate8SSE2(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(in, zero);
+        __m128i hi = _mm_unpackhi_epi8(in, zero);
+        __m128i *out = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(out + 0, _mm_add_epi32(_mm_loadu_si128(out + 0), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+    accumulate8Scalar(src + i, acc + i, count - i);
+}
+
+void accumulate16SSE2(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const uint16_t *in16 = reinterpret_cast<const uint16_t *>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in16 + i));
+        __m128i *out = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(out + 0, _mm_add_epi32(_mm_loadu_si128(out + 0), _mm_unpacklo_epi16(in, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(in, zero)));
+    }
+    accumulate16Scalar(src + i * 2, acc + i, count - i);
+}
+#endif
+
+__attribute__((target("avx2")))
+void accumulate8AVX2(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m256i *out = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_storeu_si256(out + 0, _mm256_add_epi32(_mm256_loadu_si256(out + 0), _mm256_cvtepu8_epi32(in)));
+        _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                            _mm256_cvtepu8_epi32(_mm_srli_si128(in, 8))));
+    }
+    accumulate8Scalar(src + i, acc + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void accumulate16AVX2(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    const uint16_t *in16 = reinterpret_cast<const uint16_t *>(src);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in16 + i));
+        __m256i *out = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_storeu_si256(out + 0, _mm256_add_epi32(_mm256_loadu_si256(out + 0),
+                            _mm256_cvtepu16_epi32(_mm256_castsi256_si128(in))));
+        _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                            _mm256_cvtepu16_epi32(_mm256_extracti128_si256(in, 1))));
+    }
+    accumulate16Scalar(src + i * 2, acc + i, count - i);
+}
+
+#endif
+
+#ifdef FRAMESTACKER_NEON
+
+void accumulate8NEON(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t in = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(in));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(in));
+        vst1q_u32(acc + i + 0, vaddw_u16(vld1q_u32(acc + i + 0), vget_low_u16(lo)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+        vst1q_u32(acc + i + 8, vaddw_u16(vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+        vst1q_u32(acc + i + 12, vaddw_u16(vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+    }
+    accumulate8Scalar(src + i, acc + i, count - i);
+}
+
+void accumulate16NEON(const uint8_t *src, uint32_t *acc, size_t count)
+{
+    const uint16_t *in16 = reinterpret_cast<const uint16_t *>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint16x8_t in = vld1q_u16(in16 + i);
+        vst1q_u32(acc + i + 0, vaddw_u16(vld1q_u32(acc + i + 0), vget_low_u16(in)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(in)));
+    }
+    accumulate16Scalar(src + i * 2, acc + i, count - i);
+}
+
+#endif
+
+struct Kernels
+{
+    AccumulateKernel accumulate8;
+    AccumulateKernel accumulate16;
+    const char *name;
+};
+
+Kernels selectKernels()
+{
+#if defined(FRAMESTACKER_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { accumulate8AVX2, accumulate16AVX2, "avx2" };
+#ifdef __SSE2__
+    return { accumulate8SSE2, accumulate16SSE2, "sse2" };
+#endif
+#elif defined(FRAMESTACKER_NEON)
+    return { accumulate8NEON, accumulate16NEON, "neon" };
+#endif
+    return { accumulate8Scalar, accumulate16Scalar, "scalar" };
+}
+
+const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+//The rejection modes work on this many samples of every frame in the group at a time
+constexpr size_t REJECTION_CHUNK = 1024;
+
+}
+
+FrameStacker::FrameStacker()
+{
+    m_Thread = std::thread(&FrameStacker::run, this);
+}
+
+FrameStacker::~FrameStacker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_all();
+    m_Thread.join();
+}
+
+const char *FrameStacker::kernelName()
+{
+    return kernels().name;
+}
+
+void FrameStacker::start(Mode mode, size_t samples, int bpp, int groupSize, float sigma)
+{
+    abort();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Mode = mode;
+    m_Samples = samples;
+    m_BPP = bpp;
+    m_GroupSize = std::max(groupSize, 1);
+    m_Sigma = sigma;
+    m_Dropped = 0;
+
+    //Spare buffers of another frame size are of no use
+    size_t frameBytes = samples * (bpp / 8);
+    if (!m_Free.empty() && m_Free.front().size() != frameBytes)
+        m_Free.clear();
+
+    if (mode == SUM || mode == MEAN)
+    {
+        m_Sum.assign(samples, 0);
+        std::vector<float>().swap(m_Accum);
+        m_Group.clear();
+    }
+    else
+    {
+        std::vector<uint32_t>().swap(m_Sum);
+        m_Accum.assign(samples, 0.0f);
+        m_Group.resize(m_GroupSize);
+        for (auto &frame : m_Group)
+            frame.resize(frameBytes);
+    }
+}
+
+bool FrameStacker::push(const uint8_t *frame)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Queue.size() >= MAX_QUEUED)
+        {
+            m_Dropped++;
+            return false;
+        }
+        if (!m_Free.empty())
+        {
+            buffer = std::move(m_Free.back());
+            m_Free.pop_back();
+        }
+    }
+
+    //The copy happens outside the lock so the stacker keeps running meanwhile
+    buffer.resize(m_Samples * (m_BPP / 8));
+    memcpy(buffer.data(), frame, buffer.size());
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(buffer));
+    }
+    m_Wake.notify_one();
+    return true;
+}
+
+int FrameStacker::finish(uint8_t *result)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this]()
+    {
+        return m_Queue.empty() && !m_Busy;
+    });
+
+    if (m_Frames == 0)
+        return 0;
+
+    const uint32_t maxValue = (m_BPP == 16) ? 65535 : 255;
+    if (m_Mode == SUM || m_Mode == MEAN)
+    {
+        const uint32_t frames = m_Frames;
+        for (size_t i = 0; i < m_Samples; i++)
+        {
+            uint32_t value = m_Sum[i];
+            if (m_Mode == MEAN)
+                value = (value + frames / 2) / frames;
+            value = std::min(value, maxValue);
+            if (m_BPP == 16)
+                reinterpret_cast<uint16_t *>(result)[i] = value;
+            else
+                result[i] = value;
+        }
+    }
+    else
+    {
+        //A partial last group still counts
+        if (m_GroupFrames > 0)
+            reduceGroup();
+        const float groups = m_Groups;
+        for (size_t i = 0; i < m_Samples; i++)
+        {
+            float value = std::min(std::round(m_Accum[i] / groups), static_cast<float>(maxValue));
+            if (m_BPP == 16)
+                reinterpret_cast<uint16_t *>(result)[i] = value;
+            else
+                result[i] = value;
+        }
+    }
+
+    int frames = m_Frames;
+    clear();
+    return frames;
+}
+
+void FrameStacker::abort()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Queue.empty())
+    {
+        m_Free.push_back(std::move(m_Queue.front()));
+        m_Queue.pop_front();
+    }
+    m_Idle.wait(lock, [this]()
+    {
+        return !m_Busy;
+    });
+    clear();
+}
+
+//Only called with the stacker thread idle
+void FrameStacker::clear()
+{
+    std::fill(m_Sum.begin(), m_Sum.end(), 0);
+    std::fill(m_Accum.begin(), m_Accum.end(), 0.0f);
+    m_GroupFrames = 0;
+    m_Groups = 0;
+    m_Frames = 0;
+}
+
+void FrameStacker::run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_Wake.wait(lock, [this]()
+        {
+            return m_Stop || !m_Queue.empty();
+        });
+        if (m_Stop)
+            break;
+
+        std::vector<uint8_t> frame = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        m_Busy = true;
+
+        lock.unlock();
+        stack(frame);
+        lock.lock();
+
+        m_Free.push_back(std::move(frame));
+        m_Busy = false;
+        if (m_Queue.empty())
+            m_Idle.notify_all();
+    }
+}
+
+//Runs on the stacker thread. For the rejection modes the frame is swapped into the group,
+//and the buffer that comes back goes to the spare buffers.
+void FrameStacker::stack(std::vector<uint8_t> &frame)
+{
+    if (m_Mode == SUM || m_Mode == MEAN)
+    {
+        if (m_BPP == 16)
+            kernels().accumulate16(frame.data(), m_Sum.data(), m_Samples);
+        else
+            kernels().accumulate8(frame.data(), m_Sum.data(), m_Samples);
+    }
+    else
+    {
+        std::swap(frame, m_Group[m_GroupFrames]);
+        if (++m_GroupFrames == m_GroupSize)
+            reduceGroup();
+    }
+    m_Frames++;
+}
+
+//Combines the frames of the current group sample by sample and adds the result to the accumulator.
+void FrameStacker::reduceGroup()
+{
+    const int n = m_GroupFrames;
+    std::vector<float> rows(n * REJECTION_CHUNK);
+
+    for (size_t start = 0; start < m_Samples; start += REJECTION_CHUNK)
+    {
+        const size_t count = std::min(REJECTION_CHUNK, m_Samples - start);
+        float *acc = m_Accum.data() + start;
+
+        for (int f = 0; f < n; f++)
+        {
+            float *row = rows.data() + f * REJECTION_CHUNK;
+            if (m_BPP == 16)
+            {
+                const uint16_t *in = reinterpret_cast<const uint16_t *>(m_Group[f].data()) + start;
+                for (size_t k = 0; k < count; k++)
+                    row[k] = in[k];
+            }
+            else
+            {
+                const uint8_t *in = m_Group[f].data() + start;
+                for (size_t k = 0; k < count; k++)
+                    row[k] = in[k];
+            }
+        }
+
+        if (m_Mode == MEDIAN)
+        {
+            //Odd-even transposition sort across the rows, n passes leave every column sorted
+            for (int pass = 0; pass < n; pass++)
+            {
+                for (int f = pass % 2; f + 1 < n; f += 2)
+                {
+                    float *a = rows.data() + f * REJECTION_CHUNK;
+                    float *b = a + REJECTION_CHUNK;
+                    for (size_t k = 0; k < count; k++)
+                    {
+                        float lo = std::min(a[k], b[k]);
+                        float hi = std::max(a[k], b[k]);
+                        a[k] = lo;
+                        b[k] = hi;
+                    }
+                }
+            }
+            const float *mid = rows.data() + (n / 2) * REJECTION_CHUNK;
+            if (n % 2)
+            {
+                for (size_t k = 0; k < count; k++)
+                    acc[k] += mid[k];
+            }
+            else
+            {
+                const float *below = mid - REJECTION_CHUNK;
+                for (size_t k = 0; k < count; k++)
+                    acc[k] += 0.5f * (below[k] + mid[k]);
+            }
+        }
+        else
+        {
+            float mean[REJECTION_CHUNK], squares[REJECTION_CHUNK], sum[REJECTION_CHUNK], kept[REJECTION_CHUNK];
+            std::fill(mean, mean + count, 0.0f);
+            std::fill(squares, squares + count, 0.0f);
+            for (int f = 0; f < n; f++)
+            {
+                const float *row = rows.data() + f * REJECTION_CHUNK;
+                for (size_t k = 0; k < count; k++)
+                    mean[k] += row[k];
+            }
+            for (size_t k = 0; k < count; k++)
+                mean[k] /= n;
+            for (int f = 0; f < n; f++)
+            {
+                const float *row = rows.data() + f * REJECTION_CHUNK;
+                for (size_t k = 0; k < count; k++)
+                    squares[k] += (row[k] - mean[k]) * (row[k] - mean[k]);
+            }
+
+            //Each sample is measured against the mean and sigma of the other frames, a sigma that
+            //includes the sample can never be exceeded by more than sqrt(n-1). A sample d off the
+            //group mean is d*n/(n-1) off the others, whose variance is (D2-d^2)/(n-1) - (d/(n-1))^2.
+            //Fewer than 3 frames leave nothing to judge by, so they are all kept.
+            const bool clip = n > 2;
+            const float others = std::max(n - 1, 1);
+            std::fill(sum, sum + count, 0.0f);
+            std::fill(kept, kept + count, 0.0f);
+            for (int f = 0; f < n; f++)
+            {
+                const float *row = rows.data() + f * REJECTION_CHUNK;
+                for (size_t k = 0; k < count; k++)
+                {
+                    float d = row[k] - mean[k];
+                    float variance = std::max((squares[k] - d * d) / others - (d / others) * (d / others), 0.0f);
+                    bool keep = !clip || std::fabs(d) * n / others <= m_Sigma * std::sqrt(variance);
+                    sum[k] += keep ? row[k] : 0.0f;
+                    kept[k] += keep ? 1.0f : 0.0f;
+                }
+            }
+            //If every sample was rejected fall back to the plain mean
+            for (size_t k = 0; k < count; k++)
+                acc[k] += (kept[k] > 0) ? sum[k] / kept[k] : mean[k];
+        }
+    }
+
+    m_Groups++;
+    m_GroupFrames = 0;
+}
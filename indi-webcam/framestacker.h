@@ -0,0 +1,112 @@
+/*
+INDI Webcam CCD Driver
+
+Copyright (C) 2018 Robert Lancaster (rlancaste AT gmail DOT com)
+
+This driver is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#ifndef framestacker_H
+#define framestacker_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//This stacks the frames of a webcam "exposure" on its own thread.
+//Frames are copied in and the caller goes straight back to capturing,
+//while the stacker thread adds whole rows at a time with SIMD.
+class FrameStacker
+{
+public:
+    enum Mode
+    {
+        SUM,        //Integration, clipped to the sample range
+        MEAN,       //Average of all frames
+        SIGMA_CLIP, //Mean of each group of frames without the samples further than sigma from the other frames, then averaged
+        MEDIAN      //Median of each group of frames, then averaged
+    };
+
+    FrameStacker();
+    ~FrameStacker();
+
+    //Starts a new stack of frames of samples 8 or 16 bit values each (packed RGB is fine, it is stacked per sample).
+    //The rejection modes work on groups of groupSize consecutive frames.
+    void start(Mode mode, size_t samples, int bpp, int groupSize = 5, float sigma = 2.0f);
+
+    //Queues a copy of the frame, never waits for the stacker.
+    //Returns false if the frame was dropped because the stacker is too far behind.
+    bool push(const uint8_t *frame);
+
+    //Waits for the queued frames and writes the stacked result in the input format.
+    //Returns the number of frames in the result.
+    int finish(uint8_t *result);
+
+    //Throws away the current stack.
+    void abort();
+
+    //Frames dropped since start()
+    int droppedFrames() const
+    {
+        return m_Dropped;
+    }
+
+    //Name of the accumulate kernel selected for this CPU, e.g. "avx2", "sse2", "neon" or "scalar".
+    static const char *kernelName();
+
+private:
+    void run();
+    void stack(std::vector<uint8_t> &frame);
+    void reduceGroup();
+    void clear();
+
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    bool m_Stop = false;
+    bool m_Busy = false;
+
+    //Frames waiting to be stacked, and spare buffers to copy the next ones into
+    std::deque<std::vector<uint8_t>> m_Queue;
+    std::vector<std::vector<uint8_t>> m_Free;
+
+    Mode m_Mode = MEAN;
+    size_t m_Samples = 0;
+    int m_BPP = 8;
+    int m_GroupSize = 5;
+    float m_Sigma = 2.0f;
+
+    //Running sums for SUM and MEAN
+    std::vector<uint32_t> m_Sum;
+    //Sum of the group results for the rejection modes
+    std::vector<float> m_Accum;
+    std::vector<std::vector<uint8_t>> m_Group;
+    int m_GroupFrames = 0;
+    int m_Groups = 0;
+
+    int m_Frames = 0;
+    int m_Dropped = 0;
+
+    //How many frames may wait for the stacker before new ones are dropped
+    static constexpr int MAX_QUEUED = 4;
+};
+
+#endif // framestacker_H
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <eventloop.h>
 
 #include "indi_webcam.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -101,6 +102,7 @@ void indi_webcam::findAVFoundationVideoSources()
     //Need to disconnect the source to probe the streams
     if(isConnected())
     {
+        stop_reading();
         avcodec_close(pCodecCtx);
         avformat_close_input(&pFormatCtx);
     }
@@ -157,7 +159,6 @@ indi_webcam::indi_webcam()
     pCodec = nullptr;
     optionsDict = nullptr;
     pFrame = nullptr;
-    pFrameOUT = nullptr;
     sws_ctx = nullptr;
     buffer = nullptr;
 
@@ -193,7 +194,6 @@ indi_webcam::indi_webcam()
     frameRate = 30;
     videoSize = "640x480";
     webcamStacking = false;
-    averaging = false;
     outputFormat = "8 bit RGB";
 
     protocol = "HTTP";
@@ -213,6 +213,7 @@ indi_webcam::indi_webcam()
 
 indi_webcam::~indi_webcam()
 {
+    stop_reading();
     if(pFormatCtx)
         free(pFormatCtx);
 }
@@ -249,6 +250,7 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
     snprintf(stringffmpegTimeout, 16, "%.0f", ffmpegTimeout);
     if(isConnected())
     {
+        stop_reading();
         avcodec_close(pCodecCtx);
         avformat_close_input(&pFormatCtx);
     }
@@ -270,6 +272,10 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
         av_dict_set(&options, "pixel_format", inputpixelformat.c_str(), 0);
         iformat = av_find_input_format(device.c_str());
     }
+    //The test source is either a local video file or a lavfi graph such as testsrc=size=1920x1080:rate=30.
+    //Both are read as fast as they can be decoded, so it benchmarks decoding and conversion without a camera.
+    if(device == "Test Source" && source.find('=') != std::string::npos)
+        iformat = av_find_input_format("lavfi");
     DEBUG(INDI::Logger::DBG_SESSION, "Attempting to connect");
 
     //This opens the input to get it ready for streaming.
@@ -319,6 +325,10 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
         return false;
     }
 
+    //Decode on several threads.  Frame threading suits MJPEG and H.264, codecs that can't do that use slices.
+    pCodecCtx->thread_count = decodeThreads;
+    pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     //Attempt to open the codec.  If that fails, abort the connection.
     if(avcodec_open2(pCodecCtx, pCodec, &optionsDict) < 0)
     {
@@ -329,7 +339,7 @@ bool indi_webcam::ConnectToSource(std::string device, std::string source, int fr
     //Set the initial parameters for the CCD.
     SetCCDParams(pCodecCtx->width, pCodecCtx->height, 8, pixelSize, pixelSize);
 
-    DEBUG(INDI::Logger::DBG_SESSION, "Connection Successful.");
+    DEBUGF(INDI::Logger::DBG_SESSION, "Connection Successful. Decoding %s on %d threads.", pCodec->name, pCodecCtx->thread_count);
     return true;
 
 }
@@ -487,6 +497,8 @@ bool indi_webcam::Disconnect()
 {
     if (isConnected())
     {
+        stop_reading();
+
         // Close the codecs
         avcodec_close(pCodecCtx);
 
@@ -520,15 +532,24 @@ bool indi_webcam::initProperties()
     CaptureFormat rgb = {"INDI_RGB", "RGB", 8, true};
     addCaptureFormat(rgb);
 
-    RapidStacking = new ISwitch[3];
+    RapidStacking = new ISwitch[5];
     IUFillSwitch(&RapidStacking[0], "Integration", "Integration", ISS_OFF);
     IUFillSwitch(&RapidStacking[1], "Average", "Average", ISS_OFF);
-    IUFillSwitch(&RapidStacking[2], "Off", "Off", ISS_ON);
+    IUFillSwitch(&RapidStacking[2], "Sigma Clip", "Sigma Clip", ISS_OFF);
+    IUFillSwitch(&RapidStacking[3], "Median", "Median", ISS_OFF);
+    IUFillSwitch(&RapidStacking[4], "Off", "Off", ISS_ON);
 
-    IUFillSwitchVector(&RapidStackingSelection, RapidStacking, 3, getDeviceName(), "RAPID_STACKING_OPTION", "Rapid Stacking",
+    IUFillSwitchVector(&RapidStackingSelection, RapidStacking, 5, getDeviceName(), "RAPID_STACKING_OPTION", "Rapid Stacking",
                        MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     defineProperty(&RapidStackingSelection);
 
+    //The rejection modes reduce each group of this many frames to one before averaging the groups
+    IUFillNumber(&StackRejectionT[0], "GROUP_FRAMES", "Frames per Group", "%.0f", 2, 100, 1, 5);
+    IUFillNumber(&StackRejectionT[1], "SIGMA", "Sigma", "%.1f", 0.5, 10, 0.1, 2);
+    IUFillNumberVector(&StackRejectionTP, StackRejectionT, NARRAY(StackRejectionT), getDeviceName(), "STACK_REJECTION",
+                       "Stack Rejection", MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
+    defineProperty(&StackRejectionTP);
+
     OutputFormats = new ISwitch[3];
     IUFillSwitch(&OutputFormats[0], "16 bit Grayscale", "16 bit Grayscale", ISS_OFF);
     IUFillSwitch(&OutputFormats[1], "16 bit RGB", "16 bit RGB", ISS_OFF);
@@ -545,6 +566,13 @@ bool indi_webcam::initProperties()
 
     defineProperty(&TimeoutOptionsTP);
 
+    IUFillNumber(&DecoderOptionsT[0], "DECODE_THREADS", "Threads (0 = auto)", "%.0f", 0, 16, 1, decodeThreads);
+    IUFillNumber(&DecoderOptionsT[1], "QUEUE_DEPTH", "Queue Depth (packets)", "%.0f", 1, 64, 1, packetQueueDepth);
+    IUFillNumberVector(&DecoderOptionsTP, DecoderOptionsT, NARRAY(DecoderOptionsT), getDeviceName(), "DECODER_OPTIONS",
+                     "Decoder", OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
+
+    defineProperty(&DecoderOptionsTP);
+
     IUFillNumber(&PixelSizeT[0], "PIXEL_SIZE_um", "Pixel Size (µm)", "%.3f", 0 , 50, 0.1, pixelSize);
     IUFillNumberVector(&PixelSizeTP, PixelSizeT, NARRAY(PixelSizeT), getDeviceName(), "PIXEL_SIZE",
                      "Pixel Size", OPTIONS_TAB, IP_RW, 0, IPS_IDLE);
@@ -667,10 +695,12 @@ bool indi_webcam::initProperties()
     SetCCDCapability(cap);
 
     loadConfig(true, RapidStackingSelection.name);
+    loadConfig(true, StackRejectionTP.name);
     loadConfig(true, OutputFormatSelection.name);
     loadConfig(true, PixelSizeTP.name);
     loadConfig(true, InputOptionsTP.name);
     loadConfig(true, TimeoutOptionsTP.name);
+    loadConfig(true, DecoderOptionsTP.name);
     loadConfig(true, OnlineInputOptionsP.name);
     loadConfig(true, URLPathTP.name);
     loadConfig(true, OnlineProtocolSelection.name);
@@ -693,7 +723,7 @@ bool indi_webcam::refreshInputDevices()
 #endif
     int i = 0;
     int numDevices = getNumOfInputDevices();
-    CaptureDevices = new ISwitch[numDevices + 1];
+    CaptureDevices = new ISwitch[numDevices + 2];
     while ((d = av_input_video_device_next(d)))
     {
         if(!strcmp(d->name, videoDevice.c_str()))
@@ -703,7 +733,8 @@ bool indi_webcam::refreshInputDevices()
         i++;
     }
     IUFillSwitch(&CaptureDevices[numDevices], "IP Camera", "IP Camera", ISS_OFF);
-    IUFillSwitchVector(&CaptureDeviceSelection, CaptureDevices, numDevices + 1, getDeviceName(), "CAPTURE_DEVICE",
+    IUFillSwitch(&CaptureDevices[numDevices + 1], "Test Source", "Test Source", ISS_OFF);
+    IUFillSwitchVector(&CaptureDeviceSelection, CaptureDevices, numDevices + 2, getDeviceName(), "CAPTURE_DEVICE",
                        "Capture Devices",
                        CONNECTION_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
     defineProperty(&CaptureDeviceSelection);
@@ -761,6 +792,15 @@ bool indi_webcam::refreshInputSources()
     {
         //No Source Buttons for IP Camera
     }
+    else if(videoDevice == "Test Source")
+    {
+        //Some lavfi test patterns, a video file can be typed in as the capture source instead
+        const char *patterns[] = { "testsrc=size=640x480:rate=30", "testsrc=size=1920x1080:rate=30", "testsrc=size=3840x2160:rate=30" };
+        sourceNum = 3;
+        CaptureSources = new ISwitch[sourceNum];
+        for(int x = 0; x < sourceNum; x++)
+            IUFillSwitch(&CaptureSources[x], patterns[x], patterns[x], videoSource == patterns[x] ? ISS_ON : ISS_OFF);
+    }
     else
     {
         int nbdev = 0;
@@ -897,6 +937,32 @@ bool indi_webcam::ISNewNumber (const char *dev, const char *name, double values[
         return true;
     }
 
+    if (!strcmp(name, StackRejectionTP.name) )
+    {
+        IUUpdateNumber(&StackRejectionTP, values, names, n);
+        DEBUGF(INDI::Logger::DBG_SESSION, "New Stack Rejection: %.0f frames per group, sigma: %.1f", StackRejectionT[0].value,
+               StackRejectionT[1].value);
+        StackRejectionTP.s = IPS_OK;
+        IDSetNumber(&StackRejectionTP, nullptr);
+        return true;
+    }
+
+    if (!strcmp(name, DecoderOptionsTP.name) )
+    {
+        IUUpdateNumber(&DecoderOptionsTP, values, names, n);
+        decodeThreads = IUFindNumber( &DecoderOptionsTP, "DECODE_THREADS" )->value;
+        {
+            std::lock_guard<std::mutex> lock(packetMutex);
+            packetQueueDepth = IUFindNumber( &DecoderOptionsTP, "QUEUE_DEPTH" )->value;
+        }
+        packetCV.notify_all();
+        DEBUGF(INDI::Logger::DBG_SESSION, "New Decoder Options: %d threads (on the next connection), queue depth: %d", decodeThreads,
+               packetQueueDepth);
+        IDSetNumber (&DecoderOptionsTP, nullptr);
+        DecoderOptionsTP.s = IPS_OK;
+        return true;
+    }
+
     if (!strcmp(name, TimeoutOptionsTP.name) )
     {
         IUUpdateNumber(&TimeoutOptionsTP, values, names, n);
@@ -1039,21 +1105,17 @@ bool indi_webcam::ISNewSwitch (const char *dev, const char *name, ISState *state
         ISwitch *sp = IUFindOnSwitch(&RapidStackingSelection);
         if (sp)
         {
+            webcamStacking = true;
             if(!strcmp(sp->name, "Integration"))
-            {
-                webcamStacking = true;
-                averaging = false;
-            }
+                stackMode = FrameStacker::SUM;
             if(!strcmp(sp->name, "Average"))
-            {
-                webcamStacking = true;
-                averaging = true;
-            }
+                stackMode = FrameStacker::MEAN;
+            if(!strcmp(sp->name, "Sigma Clip"))
+                stackMode = FrameStacker::SIGMA_CLIP;
+            if(!strcmp(sp->name, "Median"))
+                stackMode = FrameStacker::MEDIAN;
             if(!strcmp(sp->name, "Off"))
-            {
                 webcamStacking = false;
-                averaging = false;
-            }
             RapidStackingSelection.s = IPS_OK;
             IDSetSwitch(&RapidStackingSelection, nullptr);
             return true;
@@ -1233,24 +1295,17 @@ bool indi_webcam::StartExposure(float duration)
         return false;
     }
 
-    //This resets the stack buffer
-    if(webcamStacking)
-    {
-        if(stackBuffer)
-            free(stackBuffer);
-        stackBuffer = nullptr;
-    }
-
     //This sets up the output format for the exposure
+    //RGB is scaled to planar GBR, whose planes are put in FITS R, G, B order in the CCD buffer
     if(outputFormat == "16 bit RGB")
     {
-        out_pix_fmt = AV_PIX_FMT_RGB48LE;
+        out_pix_fmt = AV_PIX_FMT_GBRP16LE;
         PrimaryCCD.setBPP(16);
         PrimaryCCD.setNAxis(3);
     }
     else if(outputFormat == "8 bit RGB")
     {
-        out_pix_fmt = AV_PIX_FMT_RGB24;
+        out_pix_fmt = AV_PIX_FMT_GBRP;
         PrimaryCCD.setBPP(8);
         PrimaryCCD.setNAxis(3);
     }
@@ -1266,6 +1321,9 @@ bool indi_webcam::StartExposure(float duration)
         return false;
     }
 
+    //Single frames go straight into the CCD buffer, stacked frames go through the stacker
+    outputToCCD = !webcamStacking;
+
     //Set up the stream, if there is an error, return
     if(!setupStreaming())
     {
@@ -1273,9 +1331,18 @@ bool indi_webcam::StartExposure(float duration)
         return false;
     }
 
+    //This resets the stack, the frames are already in the FITS layout
+    if(webcamStacking)
+    {
+        stacker.start(stackMode, numBytes / (PrimaryCCD.getBPP() / 8), PrimaryCCD.getBPP(),
+                      StackRejectionT[0].value, StackRejectionT[1].value);
+        DEBUGF(INDI::Logger::DBG_DEBUG, "Stacking with the %s kernel", FrameStacker::kernelName());
+    }
+
     //This will ensure that we get the current frame, not some old frame still in the buffer
     if(!flush_frame_buffer())
         DEBUG(INDI::Logger::DBG_SESSION, "FFMPEG Issue in flushing buffer");
+    start_reading();
 
     /*
     int ret = avformat_flush(pFormatCtx);
@@ -1299,8 +1366,12 @@ bool indi_webcam::StartExposure(float duration)
 
 bool indi_webcam::AbortExposure()
 {
-    if(stackBuffer)
-        free(stackBuffer);
+    //INDI::CCD also aborts while video streaming, the capture thread owns the decoder then
+    if(InExposure && !is_streaming)
+    {
+        stacker.abort();
+        freeMemory();
+    }
     InExposure = false;
     return true;
 }
@@ -1363,19 +1434,16 @@ void indi_webcam::TimerHit()
 }
 
 // Downloads the image from the Webcam.
-//If the image is an RGB, it converts it to Fits RGB
-//If rapid stacking is happening, it adds the image to the stack.
+//Without rapid stacking it is scaled straight into the CCD buffer,
+//with it the image is handed to the stacker thread.
 
 bool indi_webcam::grabImage()
 {
     if(getStreamFrame())
     {
-        if(PrimaryCCD.getNAxis() == 3)
-            convertINDI_RGBtoFITS_RGB(pFrameOUT->data[0], PrimaryCCD.getFrameBuffer());
-        else
-            memcpy(PrimaryCCD.getFrameBuffer(), pFrameOUT->data[0], numBytes);
+        //This only copies the frame, so the capture is never held up by the stacking
         if(webcamStacking)
-            addToStack();
+            stacker.push(buffer);
         gotAnImageAlready = true;
     }
     else
@@ -1387,98 +1455,16 @@ bool indi_webcam::grabImage()
     return true;
 }
 
-//This adds each image to the running stack
-bool indi_webcam::addToStack()
-{
-    if(!stackBuffer)
-    {
-        stackBuffer = (float *)malloc(numBytes * sizeof(float_t));
-        numberOfFramesInStack = 0;
-    }
-
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    int h = pCodecCtx->height;
-
-    for (int i = 0; i < w * h; i++)
-    {
-        int x = i % w;
-        int y = i / w;
-        if(x >= 0 && y >= 0 && x < w && y < h)
-        {
-            if(numberOfFramesInStack == 0)
-                stackBuffer[i] = getImageDataFloatValue(x, y);
-            else
-                stackBuffer[i] += getImageDataFloatValue(x, y);
-        }
-    }
-    numberOfFramesInStack++;
-    return true;
-}
-
-//This gets the pixel value at an x, y position in the image
-float indi_webcam::getImageDataFloatValue(int x, int y)
-{
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    uint8_t *primaryBuffer = PrimaryCCD.getFrameBuffer();
-    if(PrimaryCCD.getBPP() == 8)
-        return (float) primaryBuffer[y * w + x];
-    else if(PrimaryCCD.getBPP() == 16)
-    {
-        uint16_t *newBuffer = reinterpret_cast<uint16_t *>(primaryBuffer);
-        return (float) newBuffer[y * w + x];
-    }
-    else
-        return 0;
-}
-//This sets the pixel value at an x, y position in the image
-void indi_webcam::setImageDataValueFromFloat(int x, int y, float value, bool roundAnswer)
-{
-    uint8_t *primaryBuffer = PrimaryCCD.getFrameBuffer();
-    int w = pCodecCtx->width * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    if(!stackBuffer)
-        return;
-    if(PrimaryCCD.getBPP() == 8)
-    {
-        int max = std::numeric_limits<uint8_t>::max();
-        if (value > max)
-            value = max;
-        if(roundAnswer)
-            primaryBuffer[y * w + x] = round(value);
-        else
-            primaryBuffer[y * w + x] = value;
-    }
-    else if(PrimaryCCD.getBPP() == 16)
-    {
-        int max = std::numeric_limits<uint16_t>::max();
-        if (value > max)
-            value = max;
-        uint16_t *newBuffer = reinterpret_cast<uint16_t *>(primaryBuffer);
-        if(roundAnswer)
-            newBuffer[y * w + x] = round(value);
-        else
-            newBuffer[y * w + x] = value;
-    }
-}
-
-//This will take the final image stack and copy it back to the primary buffer for final download.
+//This will take the final image stack and copy it to the primary buffer for final download.
 void indi_webcam::copyFinalStackToPrimaryFrameBuffer()
 {
-    int w = pCodecCtx->width  * ((PrimaryCCD.getNAxis() == 3) ? 3 : 1);
-    int h = pCodecCtx->height;
-    for (int i = 0; i < w * h; i++)
-    {
-        int x = i % w;
-        int y = i / w;
-        if(x >= 0 && y >= 0 && x < w && y < h)
-        {
-            if(averaging)
-                setImageDataValueFromFloat(x, y, round(stackBuffer[i] / numberOfFramesInStack), true);
-            else //Integrating
-                setImageDataValueFromFloat(x, y, round(stackBuffer[i]), true);
-        }
-    }
+    int frames = stacker.finish(PrimaryCCD.getFrameBuffer());
+    if(frames == 0)
+        return;
 
-    LOGF_INFO("Final Image is a stack of %u exposures.", numberOfFramesInStack);
+    LOGF_INFO("Final Image is a stack of %u exposures.", frames);
+    if(stacker.droppedFrames() > 0)
+        LOGF_WARN("%d frames were dropped because the stacker fell behind.", stacker.droppedFrames());
 }
 
 //This will crop the image to a subframe if desired.
@@ -1647,10 +1633,17 @@ void indi_webcam::run_capture()
     int h = pCodecCtx->height;
     Streamer->setSize(w, h);
     PrimaryCCD.setFrame(0, 0, w, h);
+    outputToCCD = false;
 
     //This will clear the frame button before streaming is started so that the frames are all current.
     if(!flush_frame_buffer())
         DEBUG(INDI::Logger::DBG_SESSION, "FFMPEG Issue in flushing buffer");
+    start_reading();
+
+    statsFrames = 0;
+    statsDecodeTime = 0;
+    statsScaleTime = 0;
+    statsStart = std::chrono::steady_clock::now();
 
     /*
     int ret = avformat_flush(pFormatCtx);
@@ -1666,7 +1659,10 @@ void indi_webcam::run_capture()
     {
 
         if(getStreamFrame())
-            Streamer->newFrame(pFrameOUT->data[0], numBytes);
+        {
+            Streamer->newFrame(buffer, numBytes);
+            reportDecodeStats();
+        }
         else
         {
             is_capturing = false;
@@ -1679,66 +1675,22 @@ void indi_webcam::run_capture()
     DEBUG(INDI::Logger::DBG_SESSION, "Capture thread releasing device.");
 }
 
-//This converts an image from INDI_RGB to FITS_RGB so the FITSViewer can read it.
-bool indi_webcam::convertINDI_RGBtoFITS_RGB(uint8_t *originalImage, uint8_t *convertedImage)
-{
-    if(PrimaryCCD.getBPP() == 8)
-    {
-        int size =  numBytes / 3;
-        uint8_t *r, *g, *b;
-        r = (convertedImage);
-        g = (convertedImage + size);
-        b = (convertedImage + size * 2);
-        for(int i = 0; i < numBytes; i += 3)
-        {
-            *r++ = *originalImage++;
-            *g++ = *originalImage++;
-            *b++ = *originalImage++;
-        }
-    }
-    else if(PrimaryCCD.getBPP() == 16)
-    {
-        uint16_t *bigOriginalImage = reinterpret_cast<uint16_t *>(originalImage);
-        uint16_t *bigConvertedImage = reinterpret_cast<uint16_t *>(convertedImage);
-        int size =  numBytes / 2 / 3;
-        uint16_t *r, *g, *b;
-        r = (bigConvertedImage);
-        g = (bigConvertedImage + size);
-        b = (bigConvertedImage + size * 2);
-        for(int i = 0; i < numBytes / 2; i += 3)
-        {
-            *r++ = *bigOriginalImage++;
-            *g++ = *bigOriginalImage++;
-            *b++ = *bigOriginalImage++;
-        }
-    }
-    return true;
-}
-
 //This sets up the webcam to get images
 //It is used for both the streaming and exposing algorithms
 bool indi_webcam::setupStreaming()
 {
-    // Determine required buffer size and allocate buffer for pframeRGB
+    // Determine required buffer size and allocate the stream/stack buffer
     numBytes = av_image_get_buffer_size(out_pix_fmt, pCodecCtx->width, pCodecCtx->height, 1);
 
     // Allocate video frame
     pFrame = av_frame_alloc();
     if(pFrame == nullptr)
         return false;
-    // Allocate an AVFrame structure
-    pFrameOUT = av_frame_alloc();
-    if(pFrameOUT == nullptr)
-        return false;
 
-    // Assign appropriate parts of buffer to image planes in pFrameRGB
     buffer = (uint8_t *)av_malloc(numBytes * sizeof(uint8_t));
     if(buffer == nullptr)
         return false;
 
-    av_image_fill_arrays (pFrameOUT->data, pFrameOUT->linesize, buffer, out_pix_fmt,
-                          pCodecCtx->width, pCodecCtx->height, 1);
-
     // initialize SWS context for software scaling
     sws_ctx = sws_getContext( pCodecCtx->width, pCodecCtx->height,
                               pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height,
@@ -1771,90 +1723,221 @@ void indi_webcam::updateVideoAdjustments()
 //It is used for both the streaming and exposing algorithms
 bool indi_webcam::getStreamFrame()
 {
-    AVPacket packet;
-    //If at first you don't succees to get a frame, try again.
-    int ret = -1;
-    while(ret < 0)
+    auto decodeStart = std::chrono::steady_clock::now();
+
+    //A frame threaded decoder holds a few frames, so it is asked for one before it is sent more packets.
+    int ret = avcodec_receive_frame(pCodecCtx, pFrame);
+    while(ret == AVERROR(EAGAIN))
     {
-        int tries = 0;
-        while(tries < 10) //Try a maximum of 10 times before trying to reconnect the source
-        {
-            ret = av_read_frame(pFormatCtx, &packet);
-            if(ret == 0)
-                break;
-            else
-            {
-                if(ret != -35) // Don't display "Resource Temporarily Unavailable"
-                {
-                    char errbuff[200];
-                    av_make_error_string(errbuff, 200, ret);
-                    DEBUGF(INDI::Logger::DBG_SESSION, "FFMPEG Error: %d, %s.", ret, errbuff);
-                }
-                tries++;
-                usleep(bufferTimeout); //give it a moment, if it is unavailable
-            }
-        }
-        if(ret < 0) // If it still is not working after 10 tries, we should try reconnecting the source.
+        AVPacket *packet = nextPacket();
+        if(packet == nullptr)
         {
-            if(reconnectSource())
+            //The reader gave up after 10 tries, so we should try reconnecting the source.
+            stop_reading();
+            if(!reconnectSource())
             {
-                DEBUG(INDI::Logger::DBG_SESSION, "Device successfully reconnected.");
-                freeMemory();
-                //Try to set up streaming again, if there is an error, return
-                if(!setupStreaming())
-                {
-                    DEBUG(INDI::Logger::DBG_SESSION, "Error on Stream Setup.");
-                    return false;
-                }
+                DEBUG(INDI::Logger::DBG_SESSION, "Device did not reconnect after 10 tries.");
+                return false;
             }
-            else
+            DEBUG(INDI::Logger::DBG_SESSION, "Device successfully reconnected.");
+            freeMemory();
+            //Try to set up streaming again, if there is an error, return
+            if(!setupStreaming())
             {
-                DEBUG(INDI::Logger::DBG_SESSION, "Device did not reconnect after 10 tries.");
-                av_packet_unref(&packet);
+                DEBUG(INDI::Logger::DBG_SESSION, "Error on Stream Setup.");
                 return false;
             }
+            start_reading();
+            ret = avcodec_receive_frame(pCodecCtx, pFrame);
+            continue;
         }
-    }
-    if(packet.stream_index == videoStream)
-    {
-        int ret;
-        ret = avcodec_send_packet(pCodecCtx, &packet);
-        char errbuff[200];
-        av_make_error_string(errbuff, 200, ret);
-        if (ret < 0)
+
+        int sent = avcodec_send_packet(pCodecCtx, packet);
+        av_packet_free(&packet);
+        if (sent < 0 && sent != AVERROR_INVALIDDATA)
         {
+            char errbuff[200];
+            av_make_error_string(errbuff, 200, sent);
             DEBUGF(INDI::Logger::DBG_SESSION, "Error sending a packet for decoding:%s", errbuff);
-            av_packet_unref(&packet);
             return false;
         }
-        while (ret >= 0)
+        ret = avcodec_receive_frame(pCodecCtx, pFrame);
+    }
+    if (ret < 0)
+    {
+        DEBUG(INDI::Logger::DBG_SESSION, "Error during decoding");
+        return false;
+    }
+
+    // We have a frame at that point
+    // Convert the image from its native format to our output format
+    auto scaleStart = std::chrono::steady_clock::now();
+    bool scaled = scaleFrame(outputToCCD ? PrimaryCCD.getFrameBuffer() : buffer);
+    auto scaleEnd = std::chrono::steady_clock::now();
+
+    statsFrames++;
+    statsDecodeTime += std::chrono::duration<double>(scaleStart - decodeStart).count();
+    statsScaleTime += std::chrono::duration<double>(scaleEnd - scaleStart).count();
+    return scaled;
+}
+
+//This converts the decoded frame straight into the destination.
+//Planar RGB output is laid out as FITS R, G, B planes, everything else is packed.
+bool indi_webcam::scaleFrame(uint8_t *destination)
+{
+    int w = pCodecCtx->width;
+    int h = pCodecCtx->height;
+    uint8_t *planes[4] = { nullptr, nullptr, nullptr, nullptr };
+    int linesizes[4] = { 0, 0, 0, 0 };
+
+    if(out_pix_fmt == AV_PIX_FMT_GBRP || out_pix_fmt == AV_PIX_FMT_GBRP16LE)
+    {
+        int bytesPerSample = (out_pix_fmt == AV_PIX_FMT_GBRP) ? 1 : 2;
+        size_t planeSize = static_cast<size_t>(w) * h * bytesPerSample;
+        planes[0] = destination + planeSize;     // G
+        planes[1] = destination + 2 * planeSize; // B
+        planes[2] = destination;                 // R
+        linesizes[0] = linesizes[1] = linesizes[2] = w * bytesPerSample;
+    }
+    else if(av_image_fill_arrays(planes, linesizes, destination, out_pix_fmt, w, h, 1) < 0)
+        return false;
+
+    sws_scale(sws_ctx, (uint8_t const * const *)pFrame->data,
+              pFrame->linesize, 0, h, planes, linesizes);
+    return true;
+}
+
+//This starts reading packets from the source into the queue.
+void indi_webcam::start_reading()
+{
+    stop_reading();
+    is_reading = true;
+    readerFailed = false;
+    reader_thread = std::thread(&indi_webcam::run_reader, this);
+}
+
+//This stops the reader and throws away any packets it queued.
+void indi_webcam::stop_reading()
+{
+    {
+        std::lock_guard<std::mutex> lock(packetMutex);
+        is_reading = false;
+    }
+    packetCV.notify_all();
+    if(reader_thread.joinable())
+        reader_thread.join();
+
+    for(AVPacket *packet : packetQueue)
+        av_packet_free(&packet);
+    packetQueue.clear();
+}
+
+//This is the loop that reads packets while capturing.
+//Once the queue is full it waits for the decoder, so frames are not dropped here.
+void indi_webcam::run_reader()
+{
+    int tries = 0;
+    while(true)
+    {
         {
-            ret = avcodec_receive_frame(pCodecCtx, pFrame);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-                continue;
-            else if (ret < 0)
+            std::unique_lock<std::mutex> lock(packetMutex);
+            packetCV.wait(lock, [this]()
             {
-                DEBUG(INDI::Logger::DBG_SESSION, "Error during decoding");
-                av_packet_unref(&packet);
-                return false;
+                return !is_reading || static_cast<int>(packetQueue.size()) < packetQueueDepth;
+            });
+            if(!is_reading)
+                return;
+        }
+
+        AVPacket *packet = av_packet_alloc();
+        int ret = av_read_frame(pFormatCtx, packet);
+        if(ret == AVERROR_EOF && videoDevice == "Test Source")
+        {
+            //Loop a test video file
+            av_packet_free(&packet);
+            av_seek_frame(pFormatCtx, videoStream, 0, AVSEEK_FLAG_BACKWARD);
+            continue;
+        }
+        if(ret < 0)
+        {
+            av_packet_free(&packet);
+            if(ret != AVERROR(EAGAIN)) // Don't display "Resource Temporarily Unavailable"
+            {
+                char errbuff[200];
+                av_make_error_string(errbuff, 200, ret);
+                DEBUGF(INDI::Logger::DBG_SESSION, "FFMPEG Error: %d, %s.", ret, errbuff);
             }
-            // We have a frame at that point
-            // Convert the image from its native format to our output format
-            sws_scale(sws_ctx, (uint8_t const * const *)pFrame->data,
-                      pFrame->linesize, 0, pCodecCtx->height,
-                      pFrameOUT->data, pFrameOUT->linesize);
-            av_packet_unref(&packet);
-            return true;
+            //Try a maximum of 10 times before the source needs to be reconnected
+            if(++tries >= 10)
+            {
+                std::lock_guard<std::mutex> lock(packetMutex);
+                readerFailed = true;
+                packetCV.notify_all();
+                return;
+            }
+            usleep(bufferTimeout); //give it a moment, if it is unavailable
+            continue;
         }
+        tries = 0;
 
+        if(packet->stream_index != videoStream)
+        {
+            av_packet_free(&packet);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(packetMutex);
+        packetQueue.push_back(packet);
+        packetCV.notify_all();
     }
-    return false;
+}
+
+//This waits for the next packet, it returns nullptr if the reader has stopped.
+AVPacket *indi_webcam::nextPacket()
+{
+    std::unique_lock<std::mutex> lock(packetMutex);
+    packetCV.wait(lock, [this]()
+    {
+        return !packetQueue.empty() || readerFailed || !is_reading;
+    });
+    if(packetQueue.empty())
+        return nullptr;
+
+    AVPacket *packet = packetQueue.front();
+    packetQueue.pop_front();
+    packetCV.notify_all();
+    return packet;
+}
+
+//This reports the decode rate every 5 seconds while streaming.
+//For the test source that is the point, so it goes to the session log.
+void indi_webcam::reportDecodeStats()
+{
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+    if(elapsed < 5 || statsFrames == 0)
+        return;
+
+    DEBUGF(videoDevice == "Test Source" ? INDI::Logger::DBG_SESSION : INDI::Logger::DBG_DEBUG,
+           "Decoded %d frames in %.1f s: %.1f fps, %.2f ms decoding and %.2f ms converting per frame.",
+           statsFrames, elapsed, statsFrames / elapsed, 1000 * statsDecodeTime / statsFrames, 1000 * statsScaleTime / statsFrames);
+
+    statsFrames = 0;
+    statsDecodeTime = 0;
+    statsScaleTime = 0;
+    statsStart = std::chrono::steady_clock::now();
 }
 
 //This will clear out the frame buffer of any unread frames.
 //That way we are sure to get the latest frames when exposing
  bool indi_webcam::flush_frame_buffer()
  {
+     stop_reading();
+     avcodec_flush_buffers(pCodecCtx);
+
+     //A test source never runs out of frames, and has no stale ones either
+     if(videoDevice == "Test Source")
+         return true;
+
      int packetReceiveTime = -1;
      int num = 0;
      while(packetReceiveTime < bufferTimeout)
@@ -1884,6 +1967,8 @@ bool indi_webcam::getStreamFrame()
 //This frees up the resources used for streaming/exposing
 void indi_webcam::freeMemory()
 {
+    stop_reading();
+
     // Free the sws_context
     if(sws_ctx)
         sws_freeContext(sws_ctx);
@@ -1894,11 +1979,6 @@ void indi_webcam::freeMemory()
         av_free(buffer);
     buffer = nullptr;
 
-    // Free the RGB image
-    if(pFrameOUT)
-        av_free(pFrameOUT);
-    pFrameOUT = nullptr;
-
     // Free the input frame
     if(pFrame)
         av_free(pFrame);
@@ -1911,6 +1991,7 @@ bool indi_webcam::saveConfigItems(FILE *fp)
     INDI::CCD::saveConfigItems(fp);
     IUSaveConfigSwitch(fp, &CaptureDeviceSelection);
     IUSaveConfigSwitch(fp, &RapidStackingSelection);
+    IUSaveConfigNumber(fp, &StackRejectionTP);
     IUSaveConfigSwitch(fp, &OutputFormatSelection);
     IUSaveConfigSwitch(fp, &OnlineProtocolSelection);
     IUSaveConfigNumber(fp, &PixelSizeTP);
@@ -1918,6 +1999,7 @@ bool indi_webcam::saveConfigItems(FILE *fp)
     IUSaveConfigText(fp, &OnlineInputOptionsP);
     IUSaveConfigText(fp, &URLPathTP);
     IUSaveConfigNumber(fp, &TimeoutOptionsTP);
+    IUSaveConfigNumber(fp, &DecoderOptionsTP);
 
     return true;
 }
@@ -42,8 +42,14 @@ extern "C" {
 }
 #endif
 //#include <ctime>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 
+#include "framestacker.h"
+
 //These are required to check for AVFoundation Devices
 //The reason is that we have to print and parse the output
 //These can't be in indi_webcam class declaration because the callback method has to be passed to FFMpeg
@@ -96,7 +102,6 @@ private:
     //Related to exposures
     struct timeval ExpStart { 0, 0 };
     float ExposureRequest { 0 };
-    bool convertINDI_RGBtoFITS_RGB(uint8_t *originalImage, uint8_t *convertedImage);
 
     //These are related to how we change sources
     bool ConnectToSource(std::string device, std::string source, int framerate, std::string videosize, std::string inputpixelformat,  std::string urlSource);
@@ -117,15 +122,9 @@ private:
     bool webcamStacking = false;
     bool gotAnImageAlready = false;
     bool loadingSettings = false;
-    bool averaging = false;
-    float *stackBuffer = nullptr;
-    int numberOfFramesInStack = 0;
-    bool addToStack();
+    FrameStacker::Mode stackMode = FrameStacker::MEAN;
+    FrameStacker stacker;
     void copyFinalStackToPrimaryFrameBuffer();
-    void setImageDataValueFromFloat(int x, int y, float value, bool roundAnswer);
-    void setRGBImageDataValueFromFloat(int x, int y, int channel, float value, bool roundAnswer);
-    float getImageDataFloatValue(int x, int y);
-    float getRGBImageDataFloatValue(int x, int y, int channel);
 
     //These are our device capture settings
     bool use16Bit = true;
@@ -185,6 +184,10 @@ private:
     INumberVectorProperty PixelSizeTP;
     INumber VideoAdjustmentsT[3] {};
     INumberVectorProperty VideoAdjustmentsTP;
+    INumber StackRejectionT[2] {};
+    INumberVectorProperty StackRejectionTP;
+    INumber DecoderOptionsT[2] {};
+    INumberVectorProperty DecoderOptionsTP;
 
 
     //Webcam setup, release, and frame capture
@@ -192,6 +195,33 @@ private:
     bool setupStreaming();
     void freeMemory();
     bool getStreamFrame();
+    bool scaleFrame(uint8_t *destination);
+    //When this is set, frames are scaled straight into the CCD buffer instead of the stream/stack buffer
+    bool outputToCCD = false;
+
+    //Packets are read on their own thread and queued for the decoder,
+    //so a slow USB or network read does not hold up decoding and conversion.
+    std::thread reader_thread;
+    std::mutex packetMutex;
+    std::condition_variable packetCV;
+    std::deque<AVPacket *> packetQueue;
+    bool is_reading = false;
+    bool readerFailed = false;
+    void start_reading();
+    void stop_reading();
+    void run_reader();
+    AVPacket *nextPacket();
+
+    //Decoder settings, 0 threads lets FFMpeg use one per core
+    int decodeThreads = 0;
+    int packetQueueDepth = 8;
+
+    //Decode throughput, reported while streaming
+    int statsFrames = 0;
+    double statsDecodeTime = 0;
+    double statsScaleTime = 0;
+    std::chrono::steady_clock::time_point statsStart;
+    void reportDecodeStats();
 
     //Related to streaming
     std::thread capture_thread;
@@ -204,6 +234,7 @@ private:
 
     //FFMpeg Variables to make captures work.
     struct SwsContext *sws_ctx;
+    //Stream and stack buffer, exposures that are not stacked do not use it
     uint8_t *buffer;
     int numBytes = 0;
     AVPixelFormat out_pix_fmt;
@@ -216,7 +247,6 @@ private:
     const AVCodec         *pCodec;
 #endif
     AVFrame         *pFrame;
-    AVFrame         *pFrameOUT;
     AVDictionary *optionsDict;
 
     //FFMpeg Video Adjustments
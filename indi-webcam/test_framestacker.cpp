@@ -0,0 +1,105 @@
+//
+// Stacks synthetic frames and checks that the rejection modes drop a frame
+// that is far off the rest of its group, e.g. a satellite trail or a hot
+// readout, while a plain mean keeps it.
+//
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "framestacker.h"
+
+static const size_t SAMPLES = 1000;
+
+// Frame of 16 bit samples around level with gaussian noise
+static std::vector<uint16_t> makeFrame(std::mt19937 &gen, float level, float noise) {
+    std::normal_distribution<float> dist(level, noise);
+    std::vector<uint16_t> frame(SAMPLES);
+    for (auto &sample : frame)
+        sample = static_cast<uint16_t>(std::max(0.0f, dist(gen)));
+    return frame;
+}
+
+// The stacker drops frames when it falls behind, wait for it like a slow camera would
+static void push(FrameStacker &stacker, const void *frame) {
+    while (!stacker.push(static_cast<const uint8_t *>(frame)))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// Stacks one group of five frames, the third one far brighter than the others
+static std::vector<uint16_t> stackWithOutlier(FrameStacker::Mode mode, float sigma) {
+    std::mt19937 gen(7);
+    FrameStacker stacker;
+    stacker.start(mode, SAMPLES, 16, 5, sigma);
+
+    for (int f = 0; f < 5; f++) {
+        auto frame = makeFrame(gen, f == 2 ? 5000.0f : 1000.0f, 10.0f);
+        push(stacker, frame.data());
+    }
+
+    std::vector<uint16_t> result(SAMPLES);
+    EXPECT_EQ(stacker.finish(reinterpret_cast<uint8_t *>(result.data())), 5);
+    return result;
+}
+
+TEST(FrameStacker, meanKeepsOutlier) {
+    auto result = stackWithOutlier(FrameStacker::MEAN, 2.0f);
+    for (auto sample : result)
+        ASSERT_NEAR(sample, 1800, 30);
+}
+
+TEST(FrameStacker, sigmaClipRejectsOutlier) {
+    // Defaults of the driver, 5 frames per group and 2 sigma
+    auto result = stackWithOutlier(FrameStacker::SIGMA_CLIP, 2.0f);
+    for (auto sample : result)
+        ASSERT_NEAR(sample, 1000, 30);
+}
+
+TEST(FrameStacker, medianRejectsOutlier) {
+    auto result = stackWithOutlier(FrameStacker::MEDIAN, 2.0f);
+    for (auto sample : result)
+        ASSERT_NEAR(sample, 1000, 30);
+}
+
+TEST(FrameStacker, sigmaClipKeepsNoise) {
+    // Without an outlier clipping only trims the noise, the level stays put
+    std::mt19937 gen(11);
+    FrameStacker stacker;
+    stacker.start(FrameStacker::SIGMA_CLIP, SAMPLES, 16, 5, 2.0f);
+
+    for (int f = 0; f < 20; f++) {
+        auto frame = makeFrame(gen, 1000.0f, 10.0f);
+        push(stacker, frame.data());
+    }
+
+    std::vector<uint16_t> result(SAMPLES);
+    ASSERT_EQ(stacker.finish(reinterpret_cast<uint8_t *>(result.data())), 20);
+
+    double mean = 0;
+    for (auto sample : result)
+        mean += sample;
+    ASSERT_NEAR(mean / SAMPLES, 1000, 1);
+}
+
+TEST(FrameStacker, sigmaClipShortGroup) {
+    // A last group of two frames has nothing to clip against and is averaged
+    FrameStacker stacker;
+    stacker.start(FrameStacker::SIGMA_CLIP, SAMPLES, 8, 5, 2.0f);
+
+    std::vector<uint8_t> dark(SAMPLES, 10), bright(SAMPLES, 30);
+    push(stacker, dark.data());
+    push(stacker, bright.data());
+
+    std::vector<uint8_t> result(SAMPLES);
+    ASSERT_EQ(stacker.finish(result.data()), 2);
+    for (auto sample : result)
+        ASSERT_EQ(sample, 20);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
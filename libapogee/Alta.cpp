@@ -478,6 +478,21 @@ Apg::Status Alta::GetImagingStatus()
 //////////////////////////// 
 // GET  IMAGE 
 void Alta::GetImage( std::vector<uint16_t> & out )
+{
+    const size_t len = GetImageNumPixels();
+
+    if( len != out.size() )
+    {
+        out.clear();
+        out.resize( len );
+    }
+
+    GetImage( out.data(), out.size() );
+}
+
+//////////////////////////// 
+// GET  IMAGE 
+void Alta::GetImage( uint16_t * out, const size_t len )
 {
 #ifdef DEBUGGING_CAMERA
     apgHelper::DebugMsg( "Alta::GetImage -> BEGINNING" );
@@ -517,24 +532,30 @@ void Alta::GetImage( std::vector<uint16_t> & out )
     // even if the GetImage function throws
     // we can try to copy whatever data we managed
     // to fetch from the camera into the user supplied
-    // vector
+    // buffer
     uint16_t r=0, c = 0;
     ExposureAndGetImgRC( r, c );
     const uint16_t z = GetImageZ();
-    std::vector<uint16_t> datafromCam( r*c*z, 0 ); 
+
+    // the transfer buffer persists between images, it is only
+    // reallocated when an image is larger than any before it
+    m_ImgXferBuf.resize( r*c*z ); 
 
     const int32_t dataLen = r*z;
     const int32_t numCols = GetRoiNumCols();  
 
-    if( dataLen*numCols != apgHelper::SizeT2Int32( out.size() ) )
+    if( static_cast<size_t>( dataLen ) * numCols > len )
     {
-        out.clear();
-        out.resize( dataLen*numCols );
+        std::stringstream msg;
+        msg << "Image buffer of " << len << " pixels is too small for ";
+        msg << dataLen*numCols << " pixels.";
+        apgHelper::throwRuntimeException( m_fileName, msg.str(), 
+            __LINE__, Apg::ErrorType_InvalidUsage );
     }
 
     try
     {
-        m_CamIo->GetImageData( datafromCam );
+        m_CamIo->GetImageData( m_ImgXferBuf );
     }
     catch(std::exception & err )
     {
@@ -545,7 +566,7 @@ void Alta::GetImage( std::vector<uint16_t> & out )
         ApgLogger::Instance().Write(ApgLogger::LEVEL_RELEASE,"error",
         apgHelper::mkMsg( m_fileName, msg, __LINE__) );
 
-        FixImgFromCamera( datafromCam, out, dataLen, numCols );
+        FixImgFromCamera( m_ImgXferBuf, out, dataLen, numCols );
         throw;
     }
     
@@ -580,7 +601,7 @@ void Alta::GetImage( std::vector<uint16_t> & out )
 #endif
 
     // removing the AD garbage pixels at the beginning of every row
-    FixImgFromCamera( datafromCam, out, dataLen, numCols );
+    FixImgFromCamera( m_ImgXferBuf, out, dataLen, numCols );
   
     ApgLogger::Instance().Write(ApgLogger::LEVEL_DEBUG,"info","Get Image Completed.");
 
@@ -955,7 +976,7 @@ Apg::FanMode Alta::GetFanMode()
 //////////////////////////// 
 //      FIX      IMG        FROM          CAMERA
 void Alta::FixImgFromCamera( const std::vector<uint16_t> & data,
-                              std::vector<uint16_t> & out,  const int32_t rows, 
+                              uint16_t * out,  const int32_t rows, 
                               const int32_t cols )
 {
     const int32_t offset = m_CcdAcqSettings->GetPixelShift();
@@ -13,6 +13,7 @@
 
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include <cstring>  //for memset
 
 #include "libCurlWrap.h" 
@@ -334,6 +335,9 @@ void AltaEthernetIo::GetImageData(std::vector<uint16_t> & ImageData)
 
     if( NumBytesExpected !=  apgHelper::SizeT2Int32( result.size() ) )
     {
+        // nothing is copied, do not hand back the previous image
+        std::fill( ImageData.begin(), ImageData.end(), 0 );
+
         std::stringstream received;
         received <<  result.size();
 
@@ -189,7 +189,7 @@ void AltaF::VerifyCamId()
 //////////////////////////// 
 //      FIX      IMG        FROM          CAMERA
 void AltaF::FixImgFromCamera( const std::vector<uint16_t> & data,
-                              std::vector<uint16_t> & out,  const int32_t rows, 
+                              uint16_t * out,  const int32_t rows, 
                               const int32_t cols )
 {
     int32_t offset = 0; 
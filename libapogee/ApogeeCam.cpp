@@ -401,6 +401,16 @@ uint16_t ApogeeCam::GetRoiNumCols()
     return m_CcdAcqSettings->GetRoiNumCols();
 }
 
+//////////////////////////// 
+// GET       IMAGE      NUM      PIXELS
+size_t ApogeeCam::GetImageNumPixels()
+{
+    uint16_t r=0, c=0;
+    ExposureAndGetImgRC( r, c );
+
+    return static_cast<size_t>( r ) * GetImageZ() * GetRoiNumCols();
+}
+
 //////////////////////////// 
 // SET       ROI       START ROW
 void ApogeeCam::SetRoiStartRow( const uint16_t row )
@@ -17,6 +17,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <stddef.h>
 
 #include <memory>
 
@@ -95,6 +96,13 @@ class DLL_EXPORT ApogeeCam
          */
         uint16_t GetRoiNumCols(); 
 
+        /*! 
+         * Returns the number of pixels GetImage() delivers for the current
+         * ROI, image count and camera mode.
+         * \exception std::runtime_error
+         */
+        size_t GetImageNumPixels();
+
         /*! 
          * Sets the starting row for the imaging ROI. 0 is the default value.
          * \param [in] row 0 to GetMaxImgRows() -1 is the valid value range.
@@ -1166,6 +1174,15 @@ class DLL_EXPORT ApogeeCam
          */
         virtual void GetImage( std::vector<uint16_t> & out ) = 0;
 
+        /*! 
+         * Downloads the image data from the camera straight into the 
+         * caller's memory, without allocating a buffer per image.
+         * \param [out] out Buffer that will recieve the image data
+         * \param [in] len Size of out in pixels, must be at least GetImageNumPixels()
+         * \exception std::runtime_error
+         */
+        virtual void GetImage( uint16_t * out, size_t len ) = 0;
+
         /*! 
          * This method halts an in progress exposure. If this method is called 
          * and there is no exposure in progress a std::runtime_error exception is thrown.
@@ -1284,7 +1301,7 @@ class DLL_EXPORT ApogeeCam
         virtual uint16_t GetImageZ() = 0;
         virtual uint16_t GetIlluminationMask() = 0;
         virtual void FixImgFromCamera( const std::vector<uint16_t> & data,
-            std::vector<uint16_t> & out,  int32_t rows, int32_t cols) = 0;
+            uint16_t * out,  int32_t rows, int32_t cols) = 0;
                 
 //this code removes vc++ compiler warning C4251
 //from http://www.unknownroad.com/rtfm/VisualStudio/warningC4251.html
@@ -1316,6 +1333,10 @@ class DLL_EXPORT ApogeeCam
         bool m_IsInitialized;
         bool m_IsConnected;
 		double m_LastExposureTime;
+
+        // raw image data as read from the camera, kept between
+        // images so it is only reallocated when the image grows
+        std::vector<uint16_t> m_ImgXferBuf;
      
     private:
 
@@ -216,6 +216,9 @@ void AspenEthernetIo::GetImageData(std::vector<uint16_t> & ImageData)
 
     if( NumBytesExpected !=  apgHelper::SizeT2Int32( result.size() ) )
     {
+        // nothing is copied, do not hand back the previous image
+        std::fill( ImageData.begin(), ImageData.end(), 0 );
+
         std::stringstream msg;
         msg <<  fullUrl.c_str() << " error -  requested ";
         msg << NumBytesExpected << " bytes, but received ";
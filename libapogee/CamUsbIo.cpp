@@ -169,23 +169,33 @@ void CamUsbIo::GetImageData( std::vector<uint16_t> & data )
         apgHelper::SizeT2Uint32( data.size() ) * sizeof(uint16_t);
     std::vector<uint16_t>::iterator iter = data.begin();
 
-    while( NumBytesExpected > 0 )
+    try
     {
-        uint32_t SizeToRead = std::min<uint32_t>(NumBytesExpected,
-            m_MaxBufSize );
+        while( NumBytesExpected > 0 )
+        {
+            uint32_t SizeToRead = std::min<uint32_t>(NumBytesExpected,
+                m_MaxBufSize );
 
-        uint32_t ReceivedSize = 0;
+            uint32_t ReceivedSize = 0;
 
-        m_Usb->ReadImage(&(*iter),SizeToRead,ReceivedSize);
+            m_Usb->ReadImage(&(*iter),SizeToRead,ReceivedSize);
 
-        NumBytesExpected -= ReceivedSize;
-        
-        if( ReceivedSize != SizeToRead )
-        {
-            break;
+            NumBytesExpected -= ReceivedSize;
+            
+            if( ReceivedSize != SizeToRead )
+            {
+                break;
+            }
+            
+            iter += ReceivedSize / sizeof(uint16_t);
         }
-        
-        iter += ReceivedSize / sizeof(uint16_t);
+    }
+    catch( std::exception & )
+    {
+        // callers reuse the buffer between images and salvage what was
+        // read, so blank the rest instead of leaving the last image there
+        std::fill( iter, data.end(), 0 );
+        throw;
     }
 
     if( NumBytesExpected )
@@ -193,6 +203,9 @@ void CamUsbIo::GetImageData( std::vector<uint16_t> & data )
         const uint32_t TotalBytes = 
              apgHelper::SizeT2Uint32( data.size() ) * sizeof(uint16_t);
         const uint32_t  DownloadedBytes = TotalBytes - NumBytesExpected;
+
+        std::fill( data.begin() + DownloadedBytes / sizeof(uint16_t), data.end(), 0 );
+
         std::stringstream msg;
         msg << "GetImageData error - Expected " << data.size()*sizeof(uint16_t) << " bytes.";
         msg << "  Downloaded " <<  DownloadedBytes << " bytes.";
@@ -108,7 +108,7 @@ void HiC::Get4kby4kImage( std::vector<uint16_t> & out )
         ApgLogger::Instance().Write(ApgLogger::LEVEL_RELEASE,"error",
         apgHelper::mkMsg( m_fileName, msg, __LINE__) );
 
-        FixImgFromCamera( datafromCam, out, dataLen, numCols );
+        FixImgFromCamera( datafromCam, out.data(), dataLen, numCols );
         throw;
     }
         
@@ -167,14 +167,14 @@ void HiC::Get4kby4kImage( std::vector<uint16_t> & out )
     const int32_t OUTPUT_OFFSET =  
     ( (m_CamCfgData->m_MetaData.ImagingRows - r) / 2 ) * numCols;
 
-    ImgFix::QuadOuputCopy( datafromCam, out, dataLen, 
+    ImgFix::QuadOuputCopy( datafromCam, out.data(), dataLen, 
         numCols, LATENCY_PIXELS, OUTPUT_OFFSET );
 
     if( IsPixelReorderOn() )
     {
         std::vector<uint16_t> temp = out;
         //already removed latency pixels above
-        ImgFix::QuadOuputFix( temp, out, dataLen, numCols, 0 );
+        ImgFix::QuadOuputFix( temp, out.data(), dataLen, numCols, 0 );
     }
    
    ApgLogger::Instance().Write(ApgLogger::LEVEL_DEBUG,"info","Get Image Completed.");
@@ -46,7 +46,8 @@ class ICamIo
          *  Moves the data from the camera to the host PC.  Called at different
          *  times depending on the cameras acquistion mode
          * \param[in] NumberOfPixels Total number of pixels to transfer from the camera to host
-         * \return ImageData Image from the camera
+         * \return ImageData Image from the camera, on failure the pixels that
+         * did not arrive are zeroed as callers may reuse the vector
          */
         virtual void GetImageData( std::vector<uint16_t> & data ) = 0;	
 
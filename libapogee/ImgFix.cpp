@@ -11,6 +11,315 @@
 
 #include "ImgFix.h" 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// SSE2 kernels are built with a target attribute, so they are available
+// on 32 bit x86 builds too and only used when the cpu reports SSE2
+#if defined(__GNUC__) && ( defined(__i386__) || defined(__x86_64__) )
+#define IMGFIX_SSE2 1
+#define IMGFIX_TARGET_SSE2 __attribute__((target("sse2")))
+#include <emmintrin.h>
+#elif defined(_M_X64)
+#define IMGFIX_SSE2 1
+#define IMGFIX_TARGET_SSE2
+#include <emmintrin.h>
+#endif
+
+// NEON is part of the baseline wherever the compiler enables it
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMGFIX_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    enum Kernel
+    {
+        Kernel_Scalar,
+        Kernel_Sse2,
+        Kernel_Neon
+    };
+
+    std::atomic<int> g_Accel( ImgFix::Accel_Auto );
+
+    // each band moves at least 4 MB, so only full frames of the big sensors
+    // are split and thumbnails or subframes never start a thread; beyond four
+    // threads the reordering is limited by memory bandwidth
+    const int64_t MIN_PIXELS_PER_THREAD = 1 << 21;
+    const unsigned MAX_THREADS = 4;
+
+    Kernel BestKernel()
+    {
+#if defined(IMGFIX_SSE2)
+#if defined(__GNUC__)
+        if( __builtin_cpu_supports( "sse2" ) )
+#endif
+        {
+            return Kernel_Sse2;
+        }
+#endif
+
+#if defined(IMGFIX_NEON)
+        return Kernel_Neon;
+#endif
+
+        return Kernel_Scalar;
+    }
+
+    Kernel ActiveKernel()
+    {
+        static const Kernel best = BestKernel();
+        return ( ImgFix::Accel_Auto == g_Accel ) ? best : Kernel_Scalar;
+    }
+
+    // Runs fn( begin, end ) over [0, count) split into bands, one per thread
+    template<typename F>
+    void ForEachBand( const int32_t count, const int64_t pixels, F fn )
+    {
+        unsigned n = std::thread::hardware_concurrency();
+        n = std::min<unsigned>( std::max<unsigned>( n, 1 ), MAX_THREADS );
+        n = static_cast<unsigned>( std::min<int64_t>( n, std::max<int64_t>( pixels / MIN_PIXELS_PER_THREAD, 1 ) ) );
+        n = static_cast<unsigned>( std::min<int64_t>( n, std::max<int32_t>( count, 1 ) ) );
+
+        if( n <= 1 )
+        {
+            fn( 0, count );
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        unsigned t = 1;
+
+        try
+        {
+            for( ; t < n; ++t )
+            {
+                const int32_t begin = static_cast<int32_t>( ( static_cast<int64_t>( count ) * t ) / n );
+                const int32_t end = static_cast<int32_t>( ( static_cast<int64_t>( count ) * ( t + 1 ) ) / n );
+                workers.push_back( std::thread( fn, begin, end ) );
+            }
+        }
+        catch( std::exception & )
+        {
+            // out of threads, the caller does the rest of the bands
+        }
+
+        fn( 0, static_cast<int32_t>( count / n ) );
+
+        for( ; t < n; ++t )
+        {
+            const int32_t begin = static_cast<int32_t>( ( static_cast<int64_t>( count ) * t ) / n );
+            const int32_t end = static_cast<int32_t>( ( static_cast<int64_t>( count ) * ( t + 1 ) ) / n );
+            fn( begin, end );
+        }
+
+        for( size_t i = 0; i < workers.size(); ++i )
+        {
+            workers[i].join();
+        }
+    }
+
+#if defined(IMGFIX_SSE2)
+    // Reverses the order of the 8 pixels in v
+    IMGFIX_TARGET_SSE2 inline __m128i Reverse8( const __m128i v )
+    {
+        const __m128i w = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0x1B ), 0x1B );
+        return _mm_shuffle_epi32( w, 0x4E );
+    }
+
+    // Splits 8 pixel pairs into the 8 first and the 8 second pixels
+    IMGFIX_TARGET_SSE2 inline void Deinterleave2( const uint16_t * src, __m128i & even, __m128i & odd )
+    {
+        __m128i v0 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src ) );
+        __m128i v1 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + 8 ) );
+
+        // [e0 e1 o0 o1 e2 e3 o2 o3] -> [e0 e1 e2 e3 o0 o1 o2 o3]
+        v0 = _mm_shuffle_epi32( _mm_shufflehi_epi16( _mm_shufflelo_epi16( v0, 0xD8 ), 0xD8 ), 0xD8 );
+        v1 = _mm_shuffle_epi32( _mm_shufflehi_epi16( _mm_shufflelo_epi16( v1, 0xD8 ), 0xD8 ), 0xD8 );
+
+        even = _mm_unpacklo_epi64( v0, v1 );
+        odd = _mm_unpackhi_epi64( v0, v1 );
+    }
+
+    // Splits 8 groups of 4 pixels into 8 of each of the 4 outputs
+    IMGFIX_TARGET_SSE2 inline void Deinterleave4( const uint16_t * src,
+        __m128i & a, __m128i & b, __m128i & c, __m128i & d )
+    {
+        const __m128i v0 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src ) );
+        const __m128i v1 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + 8 ) );
+        const __m128i v2 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + 16 ) );
+        const __m128i v3 = _mm_loadu_si128( reinterpret_cast<const __m128i *>( src + 24 ) );
+
+        // [a0 a1 a2 a3 b0 b1 b2 b3] and [c0 c1 c2 c3 d0 d1 d2 d3]
+        const __m128i t0 = _mm_unpacklo_epi16( v0, v1 );
+        const __m128i t1 = _mm_unpackhi_epi16( v0, v1 );
+        const __m128i ab0 = _mm_unpacklo_epi16( t0, t1 );
+        const __m128i cd0 = _mm_unpackhi_epi16( t0, t1 );
+
+        const __m128i t2 = _mm_unpacklo_epi16( v2, v3 );
+        const __m128i t3 = _mm_unpackhi_epi16( v2, v3 );
+        const __m128i ab1 = _mm_unpacklo_epi16( t2, t3 );
+        const __m128i cd1 = _mm_unpackhi_epi16( t2, t3 );
+
+        a = _mm_unpacklo_epi64( ab0, ab1 );
+        b = _mm_unpackhi_epi64( ab0, ab1 );
+        c = _mm_unpacklo_epi64( cd0, cd1 );
+        d = _mm_unpackhi_epi64( cd0, cd1 );
+    }
+
+    IMGFIX_TARGET_SSE2 int32_t DualRowSse2( const uint16_t * src, uint16_t * dst,
+        const int32_t halfCols, const int32_t urEnd )
+    {
+        int32_t c = 0;
+        for( ; c + 8 <= halfCols; c += 8 )
+        {
+            __m128i ur, ul;
+            Deinterleave2( src + 2*c, ur, ul );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( dst + urEnd - c - 8 ), Reverse8( ur ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( dst + c ), ul );
+        }
+        return c;
+    }
+
+    IMGFIX_TARGET_SSE2 int32_t QuadRowSse2( const uint16_t * src, uint16_t * top, uint16_t * bottom,
+        const int32_t halfCols, const int32_t cols )
+    {
+        int32_t c = 0;
+        for( ; c + 8 <= halfCols; c += 8 )
+        {
+            __m128i ul, ur, lr, ll;
+            Deinterleave4( src + 4*c, ul, ur, lr, ll );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( top + c ), ul );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( top + cols - c - 8 ), Reverse8( ur ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( bottom + cols - c - 8 ), Reverse8( lr ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i *>( bottom + c ), ll );
+        }
+        return c;
+    }
+#endif
+
+#if defined(IMGFIX_NEON)
+    inline uint16x8_t Reverse8( const uint16x8_t v )
+    {
+        const uint16x8_t w = vrev64q_u16( v );
+        return vextq_u16( w, w, 4 );
+    }
+
+    int32_t DualRowNeon( const uint16_t * src, uint16_t * dst,
+        const int32_t halfCols, const int32_t urEnd )
+    {
+        int32_t c = 0;
+        for( ; c + 8 <= halfCols; c += 8 )
+        {
+            const uint16x8x2_t v = vld2q_u16( src + 2*c );
+            vst1q_u16( dst + urEnd - c - 8, Reverse8( v.val[0] ) );
+            vst1q_u16( dst + c, v.val[1] );
+        }
+        return c;
+    }
+
+    int32_t QuadRowNeon( const uint16_t * src, uint16_t * top, uint16_t * bottom,
+        const int32_t halfCols, const int32_t cols )
+    {
+        int32_t c = 0;
+        for( ; c + 8 <= halfCols; c += 8 )
+        {
+            const uint16x8x4_t v = vld4q_u16( src + 4*c );
+            vst1q_u16( top + c, v.val[0] );
+            vst1q_u16( top + cols - c - 8, Reverse8( v.val[1] ) );
+            vst1q_u16( bottom + cols - c - 8, Reverse8( v.val[2] ) );
+            vst1q_u16( bottom + c, v.val[3] );
+        }
+        return c;
+    }
+#endif
+
+    // Fixes one row of dual output data, returns nothing as the tail is
+    // always finished with the scalar loop
+    void DualRow( const Kernel kernel, const uint16_t * src, uint16_t * dst,
+        const int32_t halfCols, const int32_t urEnd )
+    {
+        int32_t c = 0;
+
+        switch( kernel )
+        {
+#if defined(IMGFIX_SSE2)
+            case Kernel_Sse2:
+                c = DualRowSse2( src, dst, halfCols, urEnd );
+            break;
+#endif
+#if defined(IMGFIX_NEON)
+            case Kernel_Neon:
+                c = DualRowNeon( src, dst, halfCols, urEnd );
+            break;
+#endif
+            default:
+            break;
+        }
+
+        for( ; c < halfCols; ++c )
+        {
+            dst[urEnd - (c+1)] = src[2*c];
+            dst[c] = src[2*c + 1];
+        }
+    }
+
+    void QuadRow( const Kernel kernel, const uint16_t * src, uint16_t * top, uint16_t * bottom,
+        const int32_t halfCols, const int32_t cols )
+    {
+        int32_t c = 0;
+
+        switch( kernel )
+        {
+#if defined(IMGFIX_SSE2)
+            case Kernel_Sse2:
+                c = QuadRowSse2( src, top, bottom, halfCols, cols );
+            break;
+#endif
+#if defined(IMGFIX_NEON)
+            case Kernel_Neon:
+                c = QuadRowNeon( src, top, bottom, halfCols, cols );
+            break;
+#endif
+            default:
+            break;
+        }
+
+        for( ; c < halfCols; ++c )
+        {
+            top[c] = src[4*c];
+            top[cols - (c+1)] = src[4*c + 1];
+            bottom[cols - (c+1)] = src[4*c + 2];
+            bottom[c] = src[4*c + 3];
+        }
+    }
+}
+
+////////////////////////////
+//      SET       ACCEL
+void ImgFix::SetAccel( const Accel mode )
+{
+    g_Accel = mode;
+}
+
+////////////////////////////
+//      GET       ACCEL        NAME
+const char * ImgFix::GetAccelName()
+{
+    switch( ActiveKernel() )
+    {
+        case Kernel_Sse2:
+            return "SSE2";
+
+        case Kernel_Neon:
+            return "NEON";
+
+        default:
+            return "Scalar";
+    }
+}
 
 //////////////////////////// 
 //      SINGLE       OUPUT       ERASE
@@ -29,7 +338,7 @@ void ImgFix::SingleOuputErase( std::vector<uint16_t> & data, const int32_t rows,
 //////////////////////////// 
 //      SINGLE       OUPUT       COPY
 void ImgFix::SingleOuputCopy( const std::vector<uint16_t> & data, 
-      std::vector<uint16_t> & out, const int32_t rows,  const int32_t numImgCols,  
+      uint16_t * out, const int32_t rows,  const int32_t numImgCols,  
       const int32_t numLatencyPixels )
 {
 
@@ -41,7 +350,7 @@ void ImgFix::SingleOuputCopy( const std::vector<uint16_t> & data,
     {
         std::vector<uint16_t>::const_iterator start = data.begin()+actColsOffset;
         std::vector<uint16_t>::const_iterator end = start + numImgCols;
-        std::vector<uint16_t>::iterator outStart = out.begin() + outColsOffset;
+        uint16_t * outStart = out + outColsOffset;
         std::copy( start, end, outStart );
     }
 }
@@ -50,7 +359,7 @@ void ImgFix::SingleOuputCopy( const std::vector<uint16_t> & data,
 //////////////////////////// 
 //      QUAD      OUPUT       COPY
 void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data, 
-      std::vector<uint16_t> & out, const int32_t rows,  const int32_t cols,  
+      uint16_t * out, const int32_t rows,  const int32_t cols,  
       const int32_t numLatencyPixels, const int32_t outputBuffOffset )
 {
     int32_t numGood =  ( cols / 2 ) * 4;
@@ -61,13 +370,33 @@ void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data,
     int32_t goodStart = 0;
     int32_t badStart = numLatencyPixels*2;
 
+    if( Kernel_Scalar != ActiveKernel() && numGood > 0 )
+    {
+        // every block of good pixels lands at a fixed place, spread them over the cores
+        const uint16_t * src = data.data();
+        const int32_t numBlocks = ( down + numGood - 1 ) / numGood;
+        ForEachBand( numBlocks, down,
+            [=]( const int32_t begin, const int32_t end )
+            {
+                for( int32_t b = begin; b < end; ++b )
+                {
+                    const int64_t good = static_cast<int64_t>( b ) * numGood;
+                    const int32_t len = static_cast<int32_t>( std::min<int64_t>( down - good, numGood ) );
+                    std::memcpy( out + outputBuffOffset + good,
+                        src + badStart + static_cast<int64_t>( b ) * ( numGood + numBad ),
+                        len * sizeof(uint16_t) );
+                }
+            } );
+        return;
+    }
+
     while( down > 0 )
     {
          int32_t len = std::min<int32_t>( down, numGood );
 
         std::vector<uint16_t>::const_iterator start = data.begin()+badStart;
         std::vector<uint16_t>::const_iterator end = start + len;
-        std::vector<uint16_t>::iterator outStart = out.begin() + outputBuffOffset + goodStart;
+        uint16_t * outStart = out + outputBuffOffset + goodStart;
         std::copy( start, end, outStart );
 
          goodStart += len;
@@ -79,13 +408,34 @@ void ImgFix::QuadOuputCopy( const std::vector<uint16_t> & data,
 //////////////////////////// 
 //      QUAD       OUPUT       FIX
 void ImgFix::QuadOuputFix( const std::vector<uint16_t> & data, 
-                                             std::vector<uint16_t> & out,
+                                             uint16_t * out,
                                              const int32_t rows,  const int32_t cols,
                                              const int32_t numLatencyPixels)
 {
     const int32_t HALF_COLS = cols / 2;
     const int32_t HALF_ROWS = rows / 2;
     
+    const Kernel kernel = ActiveKernel();
+
+    if( Kernel_Scalar != kernel )
+    {
+        // every row pair reads its own stretch of the camera data
+        const uint16_t * src = data.data();
+        const int64_t rowStride = HALF_COLS*4 + numLatencyPixels*2;
+        ForEachBand( HALF_ROWS, static_cast<int64_t>( rows ) * cols,
+            [=]( const int32_t begin, const int32_t end )
+            {
+                for( int32_t r = begin; r < end; ++r )
+                {
+                    QuadRow( kernel, src + numLatencyPixels*2 + r*rowStride,
+                        out + static_cast<int64_t>( cols ) * r,
+                        out + static_cast<int64_t>( cols ) * ( rows - (r+1) ),
+                        HALF_COLS, cols );
+                }
+            } );
+        return;
+    }
+
     int32_t index = numLatencyPixels*2;
   
     for( int32_t r=0; r < HALF_ROWS; ++r )
@@ -121,7 +471,7 @@ void ImgFix::QuadOuputFix( const std::vector<uint16_t> & data,
 //////////////////////////// 
 //      DUAL       OUPUT       FIX
 void ImgFix::DualOuputFix( const std::vector<uint16_t> & data, 
-                                             std::vector<uint16_t> & out,
+                                             uint16_t * out,
                                              const int32_t rows,  const int32_t cols,
                                              const int32_t numLatencyPixels)
 {
@@ -132,6 +482,26 @@ void ImgFix::DualOuputFix( const std::vector<uint16_t> & data,
     const int32_t oddAdjust = ( cols % 2 ) ? 1 : 0;
     const int32_t START_UR_COL = cols;
 
+    const Kernel kernel = ActiveKernel();
+
+    if( Kernel_Scalar != kernel )
+    {
+        // every row reads its own stretch of the camera data
+        const uint16_t * src = data.data();
+        const int64_t rowStride = HALF_COLS*2 + numLatencyPixels;
+        ForEachBand( rows, static_cast<int64_t>( rows ) * cols,
+            [=]( const int32_t begin, const int32_t end )
+            {
+                for( int32_t r = begin; r < end; ++r )
+                {
+                    DualRow( kernel, src + numLatencyPixels + r*rowStride,
+                        out + static_cast<int64_t>( cols ) * r,
+                        HALF_COLS, START_UR_COL - oddAdjust );
+                }
+            } );
+        return;
+    }
+
     int32_t index = numLatencyPixels;
   
     for( int32_t r=0; r < rows; ++r )
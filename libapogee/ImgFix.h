@@ -18,24 +18,38 @@
 
 namespace ImgFix 
 { 
+    //! Selects the reordering kernels, Accel_Auto uses SSE2/NEON and up to four
+    //! threads on large frames, Accel_Scalar the plain single threaded loops.
+    //! SingleOuputCopy is a plain row copy and always uses the scalar loop.
+    enum Accel
+    {
+        Accel_Auto,
+        Accel_Scalar
+    };
+
+    void SetAccel( Accel mode );
+
+    //! Name of the kernels in use, "SSE2", "NEON" or "Scalar"
+    const char * GetAccelName();
+
     void SingleOuputErase( std::vector<uint16_t> & data, int32_t rows,  
         int32_t numImgCols,  int32_t numLatencyPixels );
 
     void SingleOuputCopy( const std::vector<uint16_t> & data,   
-        std::vector<uint16_t> & out, int32_t rows, int32_t numImgCols,  
+        uint16_t * out, int32_t rows, int32_t numImgCols,  
         int32_t numLatencyPixels );
 
     void QuadOuputCopy( const std::vector<uint16_t> & data, 
-        std::vector<uint16_t> & out, int32_t rows,  
+        uint16_t * out, int32_t rows,  
         int32_t cols,  int32_t numLatencyPixels, int32_t outputBuffOffset=0 );
 
     void QuadOuputFix( const std::vector<uint16_t> & data, 
-                                     std::vector<uint16_t> & out,
+                                     uint16_t * out,
                                      const int32_t rows,  const int32_t cols,
                                      const int32_t numLatencyPixels );
 
     void DualOuputFix( const std::vector<uint16_t> & data, 
-                                     std::vector<uint16_t> & out,
+                                     uint16_t * out,
                                      const int32_t rows,  const int32_t cols,
                                      const int32_t numLatencyPixels );
 }; 
@@ -528,6 +528,36 @@ long fli_camera_parport_grab_row(flidev_t dev, void *buff, size_t width)
   return 0;
 }
 
+long fli_camera_parport_grab_frame(flidev_t dev, void *buff, size_t buffsize, size_t *bytesgrabbed)
+{
+  flicamdata_t *cam;
+  size_t rowbytes;
+  long rows, row;
+  long r;
+
+  cam = DEVICE->device_data;
+  *bytesgrabbed = 0;
+
+  if (cam->grabrowwidth <= 0)
+    return -EINVAL;
+
+  rowbytes = cam->grabrowwidth *
+    ((cam->bitdepth == FLI_MODE_8BIT) ? sizeof(unsigned char) : sizeof(unsigned short));
+  rows = MIN((long) (buffsize / rowbytes), cam->grabrowcount);
+
+  /* The parallel port moves a word at a time, there is nothing to batch */
+  for (row = 0; row < rows; row++)
+  {
+    if ((r = fli_camera_parport_grab_row(dev, (unsigned char *) buff + row * rowbytes,
+					 cam->grabrowwidth)))
+      return r;
+
+    *bytesgrabbed += rowbytes;
+  }
+
+  return 0;
+}
+
 long fli_camera_parport_expose_frame(flidev_t dev)
 {
   flicamdata_t *cam;
@@ -91,6 +91,7 @@ long fli_camera_parport_get_exposure_status(flidev_t dev, long *timeleft);
 long fli_camera_parport_set_temperature(flidev_t dev, double temperature);
 long fli_camera_parport_get_temperature(flidev_t dev, double *temperature);
 long fli_camera_parport_grab_row(flidev_t dev, void *buf, size_t width);
+long fli_camera_parport_grab_frame(flidev_t dev, void *buff, size_t buffsize, size_t *bytesgrabbed);
 long fli_camera_parport_expose_frame(flidev_t dev);
 long fli_camera_parport_flush_rows(flidev_t dev, long rows, long repeat);
 long fli_camera_parport_set_bit_depth(flidev_t dev, flibitdepth_t bitdepth);
@@ -48,6 +48,7 @@
 #include <sys/param.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 #include <stdio.h>
@@ -63,6 +64,9 @@
 #include "libfli-usb.h"
 #include "indimacros.h"
 
+/* Transfers of this many max_usb_xfer blocks are used to read whole frames */
+#define FRAME_XFER_BLOCKS (16)
+
 double dconvert(void *buf)
 {
   unsigned char *fnum = (unsigned char *) buf;
@@ -1730,6 +1734,378 @@ long fli_camera_usb_grab_row(flidev_t dev, void *buff, size_t width)
 	return 0;
 }
 
+/* Pixel order fixups applied to every transfer of a frame */
+static void fix_swap(unsigned short *p, long n)
+{
+	long index;
+
+	for (index = 0; index < n; index ++)
+		p[index] = ((p[index] << 8) & 0xff00) | ((p[index] >> 8) & 0x00ff);
+}
+
+static void fix_ntohs(unsigned short *p, long n)
+{
+	long index;
+
+	for (index = 0; index < n; index ++)
+		p[index] = ntohs(p[index]);
+}
+
+static void fix_ntohs_offset(unsigned short *p, long n)
+{
+	long index;
+
+	for (index = 0; index < n; index ++)
+		p[index] = ntohs(p[index]) + 32768;
+}
+
+/* Double buffering of frame transfers. While the next transfer is read from
+ * the camera into one part of the frame, a worker thread fixes the pixel
+ * order of the part that was read just before. Where the thread cannot be
+ * started, or on Windows, every transfer is fixed in line instead. */
+typedef struct {
+	void (*fix)(unsigned short *p, long n);
+#ifndef _WIN32
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned short *p; /* Transfer waiting to be fixed, NULL when idle */
+	long n;
+	int quit;
+#endif
+	int running;
+} fli_frame_xfer_t;
+
+#ifndef _WIN32
+static void *fli_frame_xfer_worker(void *arg)
+{
+	fli_frame_xfer_t *x = (fli_frame_xfer_t *) arg;
+
+	pthread_mutex_lock(&x->lock);
+	for (;;)
+	{
+		while ((x->p == NULL) && (x->quit == 0))
+			pthread_cond_wait(&x->cond, &x->lock);
+
+		if (x->p == NULL)
+			break;
+
+		pthread_mutex_unlock(&x->lock);
+		x->fix(x->p, x->n);
+		pthread_mutex_lock(&x->lock);
+
+		x->p = NULL;
+		pthread_cond_broadcast(&x->cond);
+	}
+	pthread_mutex_unlock(&x->lock);
+
+	return NULL;
+}
+#endif
+
+static void fli_frame_xfer_start(fli_frame_xfer_t *x, void (*fix)(unsigned short *p, long n))
+{
+	x->fix = fix;
+	x->running = 0;
+
+#ifndef _WIN32
+	x->p = NULL;
+	x->n = 0;
+	x->quit = 0;
+
+	if (pthread_mutex_init(&x->lock, NULL) != 0)
+		return;
+
+	if (pthread_cond_init(&x->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&x->lock);
+		return;
+	}
+
+	if (pthread_create(&x->thread, NULL, fli_frame_xfer_worker, x) != 0)
+	{
+		debug(FLIDEBUG_WARN, "Could not start the transfer thread, fixing frames in line.");
+		pthread_cond_destroy(&x->cond);
+		pthread_mutex_destroy(&x->lock);
+		return;
+	}
+
+	x->running = 1;
+#endif
+}
+
+/* Hands a transfer that just landed to the worker, once it is done with the
+ * previous one */
+static void fli_frame_xfer_queue(fli_frame_xfer_t *x, unsigned short *p, long n)
+{
+	if (n <= 0)
+		return;
+
+#ifndef _WIN32
+	if (x->running)
+	{
+		pthread_mutex_lock(&x->lock);
+		while (x->p != NULL)
+			pthread_cond_wait(&x->cond, &x->lock);
+
+		x->p = p;
+		x->n = n;
+		pthread_cond_broadcast(&x->cond);
+		pthread_mutex_unlock(&x->lock);
+		return;
+	}
+#endif
+
+	x->fix(p, n);
+}
+
+/* Waits for the last transfer to be fixed and stops the worker */
+static void fli_frame_xfer_finish(fli_frame_xfer_t *x)
+{
+#ifndef _WIN32
+	if (x->running)
+	{
+		pthread_mutex_lock(&x->lock);
+		x->quit = 1;
+		pthread_cond_broadcast(&x->cond);
+		pthread_mutex_unlock(&x->lock);
+
+		pthread_join(x->thread, NULL);
+		pthread_cond_destroy(&x->cond);
+		pthread_mutex_destroy(&x->lock);
+		x->running = 0;
+	}
+#else
+	INDI_UNUSED(x);
+#endif
+}
+
+/* Reads up to *len bytes of the image the camera holds straight into dst,
+ * with transfers much larger than a row. Each transfer is byte swapped by
+ * the worker while the next one is read. On return *len holds the number
+ * of bytes read. */
+static long fli_camera_usb_read_image(flidev_t dev, unsigned short *dst, size_t *len)
+{
+  flicamdata_t *cam = DEVICE->device_data;
+	fli_frame_xfer_t xfer;
+	size_t total = 0;
+	long rlen, rtotal, r = 0;
+	unsigned short *p;
+
+	fli_frame_xfer_start(&xfer, fix_swap);
+
+	while ((total < *len) && (cam->bytesleft > 0))
+	{
+		rlen = (long) MIN(MIN(cam->bytesleft, *len - total), (size_t) (cam->max_usb_xfer * FRAME_XFER_BLOCKS));
+		rtotal = rlen;
+		p = dst + (total / sizeof(unsigned short));
+
+		if ((usb_bulktransfer(dev, 0x82, p, &rlen)) != 0) /* Grab the buffer */
+		{
+			debug(FLIDEBUG_FAIL, "Read failed...");
+			r = -EIO;
+			break;
+		}
+
+		if (rlen < rtotal)
+		{
+			debug(FLIDEBUG_FAIL, "Transfer did not complete...");
+		}
+
+		if (rlen == 0x03) /* This is a special case, the camera is telling us there
+											 * is no more data, something went wrong */
+		{
+			cam->bytesleft = 0;
+			break;
+		}
+
+		cam->bytesleft -= rlen;
+
+		fli_frame_xfer_queue(&xfer, p, rlen / (long) sizeof(unsigned short));
+
+		total += rlen;
+
+		if (rlen == 0)
+			break;
+	}
+
+	fli_frame_xfer_finish(&xfer);
+
+	*len = total;
+	return r;
+}
+
+long fli_camera_usb_grab_frame(flidev_t dev, void *buff, size_t buffsize, size_t *bytesgrabbed)
+{
+  flicamdata_t *cam = DEVICE->device_data;
+	unsigned char *dst = (unsigned char *) buff;
+	size_t rowbytes;
+	long rows, row = 0;
+	long r;
+
+	*bytesgrabbed = 0;
+
+	if (cam->gbuf == NULL)
+		return -ENOMEM;
+
+	if (cam->grabrowwidth <= 0)
+		return -EINVAL;
+
+	rowbytes = cam->grabrowwidth * sizeof(unsigned short);
+
+	switch (DEVICE->devinfo.devid)
+  {
+		/* MaxCam and IMG cameras */
+		case FLIUSB_CAM_ID:
+		{
+			fli_frame_xfer_t xfer;
+			long rlen, wlen, batch;
+			unsigned short *p;
+
+			rows = MIN((long) (buffsize / rowbytes), cam->grabrowcount);
+
+			/* Hand out the rows an earlier FLIGrabRow() left in memory first */
+			while ((row < rows) && (cam->grabrowbufferindex < cam->grabrowbatchsize))
+			{
+				if ((r = fli_camera_usb_grab_row(dev, dst + row * rowbytes, cam->grabrowwidth)))
+					return r;
+
+				row ++;
+				*bytesgrabbed += rowbytes;
+			}
+
+			if ((row < rows) && (cam->flushcountbeforefirstrow > 0))
+			{
+				debug(FLIDEBUG_INFO, "Flushing %d rows before image download.", cam->flushcountbeforefirstrow);
+				if ((r = fli_camera_usb_flush_rows(dev, cam->flushcountbeforefirstrow, 1)))
+					return r;
+
+				cam->flushcountbeforefirstrow = 0;
+			}
+
+			fli_frame_xfer_start(&xfer, ((DEVICE->devinfo.hwrev & 0xff00) == 0x0100) ? fix_ntohs_offset : fix_ntohs);
+
+			r = 0;
+			while (row < rows)
+			{
+				batch = MIN(cam->grabrowbatchsize, rows - row);
+				rlen = batch * rowbytes;
+
+				if (rlen < 6)
+				{
+					/* Too small to hold the request, go through the grab buffer */
+					if ((r = fli_camera_usb_grab_row(dev, dst + row * rowbytes, cam->grabrowwidth)))
+						break;
+
+					row ++;
+					*bytesgrabbed += rowbytes;
+					continue;
+				}
+
+				/* The rows land where the request was written, no grab buffer copy */
+				debug(FLIDEBUG_INFO, "Grabbing %d rows of width %d.", batch, cam->grabrowwidth);
+				p = (unsigned short *) (dst + row * rowbytes);
+				wlen = 6;
+				p[0] = htons(FLI_USBCAM_SENDROW);
+				p[1] = htons((unsigned short) cam->grabrowwidth);
+				p[2] = htons((unsigned short) batch);
+				if ((r = DEVICE->fli_io(dev, p, &wlen, &rlen)))
+				{
+					debug(FLIDEBUG_WARN, "Communication error: %d [%s]", r, strerror(-r));
+					break;
+				}
+
+				/* Fixed by the worker while the next batch is read */
+				fli_frame_xfer_queue(&xfer, p, cam->grabrowwidth * batch);
+
+				row += batch;
+				cam->grabrowindex += batch;
+				cam->grabrowcount -= batch;
+				*bytesgrabbed += batch * rowbytes;
+
+				if (cam->grabrowcount == 0)
+				{
+					if (cam->flushcountafterlastrow > 0)
+					{
+						debug(FLIDEBUG_INFO, "Flushing %d rows after image download.", cam->flushcountafterlastrow);
+						if ((r = fli_camera_usb_flush_rows(dev, cam->flushcountafterlastrow, 1)))
+							break;
+					}
+
+					cam->flushcountafterlastrow = 0;
+					cam->grabrowbatchsize = 1;
+				}
+
+				/* Nothing is left in the grab buffer */
+				cam->grabrowbufferindex = cam->grabrowbatchsize;
+			}
+
+			fli_frame_xfer_finish(&xfer);
+			if (r != 0)
+				return r;
+		}
+		break;
+
+		case FLIUSB_PROLINE_ID:
+		{
+			size_t len;
+
+			/* TDI rows are read one at a time with FLIGrabRow() */
+			if (cam->tdirate != 0)
+				return -EINVAL;
+
+			rows = MIN((long) (buffsize / rowbytes), cam->grabrowcount - cam->grabrowindex);
+
+#ifndef BADCOLUMN
+			/* A single quadrant arrives in row order, so it can be read straight
+			 * into the caller's buffer */
+			if ((cam->grabrowindex == 0) && (cam->ibuf_wr_idx == cam->ibuf) &&
+					(rows == cam->grabrowcount) &&
+					(cam->top_height == cam->grabrowcount) && (cam->bottom_height == 0) &&
+					(cam->left_width == cam->grabrowwidth) && (cam->right_width == 0) &&
+					(cam->left_offset <= cam->right_offset))
+			{
+				len = rows * rowbytes;
+				r = fli_camera_usb_read_image(dev, (unsigned short *) dst, &len);
+
+				/* Whatever the camera did not send reads as zero, like FLIGrabRow() */
+				memset(dst + len, 0x00, rows * rowbytes - len);
+
+				cam->grabrowindex += rows;
+				*bytesgrabbed = rows * rowbytes;
+				return r;
+			}
+#endif
+
+			/* Multiple quadrants need the whole image in memory, fill it without the
+			 * grab buffer and then unscramble it row by row */
+			if (cam->ibuf != NULL)
+			{
+				len = cam->ibuf_siz - ((cam->ibuf_wr_idx - cam->ibuf) * sizeof(unsigned short));
+				r = fli_camera_usb_read_image(dev, cam->ibuf_wr_idx, &len);
+				cam->ibuf_wr_idx += len / sizeof(unsigned short);
+				if (r != 0)
+					return r;
+			}
+
+			for (row = 0; row < rows; row ++)
+			{
+				if ((r = fli_camera_usb_grab_row(dev, dst + row * rowbytes, cam->grabrowwidth)))
+					return r;
+
+				*bytesgrabbed += rowbytes;
+			}
+		}
+		break;
+
+		default:
+			debug(FLIDEBUG_WARN, "Hmmm, shouldn't be here, operation on NO camera...");
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
 long fli_camera_usb_stop_video_mode(flidev_t dev)
 {
   flicamdata_t *cam = DEVICE->device_data;
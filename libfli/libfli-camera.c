@@ -668,6 +668,34 @@ long fli_camera_command(flidev_t dev, int cmd, int argc, ...)
 			}
 			break;
 
+		case FLI_GRAB_FRAME:
+			if (argc != 3)
+				r = -EINVAL;
+			else
+			{
+				void *buf;
+				size_t buffsize, *bytesgrabbed;
+
+				buf = va_arg(ap, void *);
+				buffsize = *va_arg(ap, size_t *);
+				bytesgrabbed = va_arg(ap, size_t *);
+
+				switch (DEVICE->domain)
+				{
+					case FLIDOMAIN_PARALLEL_PORT:
+						r = fli_camera_parport_grab_frame(dev, buf, buffsize, bytesgrabbed);
+						break;
+
+					case FLIDOMAIN_USB:
+						r = fli_camera_usb_grab_frame(dev, buf, buffsize, bytesgrabbed);
+						break;
+
+					default:
+						r = -EINVAL;
+				}
+			}
+			break;
+
 		case FLI_EXPOSE_FRAME:
 			if (argc != 0)
 				r = -EINVAL;
@@ -219,6 +219,7 @@ extern flidevdesc_t *devices[MAX_OPEN_DEVICES];
   FLI_COMMAND(FLI_SET_TEMPERATURE, 1)		\
   FLI_COMMAND(FLI_GET_TEMPERATURE, 1)		\
   FLI_COMMAND(FLI_GRAB_ROW, 2)			\
+  FLI_COMMAND(FLI_GRAB_FRAME, 3)		\
   FLI_COMMAND(FLI_EXPOSE_FRAME, 0)		\
   FLI_COMMAND(FLI_FLUSH_ROWS, 2)		\
   FLI_COMMAND(FLI_SET_FLUSHES, 1)		\
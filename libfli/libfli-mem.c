@@ -55,58 +55,100 @@
 #include "libfli-mem.h"
 #include "indimacros.h"
 
+/* Every pointer handed out is kept in an open addressing hash set, so
+ * saving, finding and deleting one takes constant time no matter how many
+ * blocks are live. The set is shared by all devices and protected by a lock,
+ * since several cameras may be read out from different threads. */
+
 #define DEFAULT_NUM_POINTERS (1024)
 
+#ifdef _WIN32
+#include <windows.h>
+static SRWLOCK allocated_lock = SRWLOCK_INIT;
+#define LOCK_ALLOCATED() AcquireSRWLockExclusive(&allocated_lock)
+#define UNLOCK_ALLOCATED() ReleaseSRWLockExclusive(&allocated_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t allocated_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_ALLOCATED() pthread_mutex_lock(&allocated_lock)
+#define UNLOCK_ALLOCATED() pthread_mutex_unlock(&allocated_lock)
+#endif
+
 static struct _mem_ptrs {
   void **pointers;
-  int total;
-  int used;
+  size_t total; /* Always a power of two */
+  size_t used;
 } allocated = {NULL, 0, 0};
 
+static size_t hashptr(const void *ptr)
+{
+  /* Fibonacci hashing, the low bits of a heap pointer carry little entropy */
+  unsigned long long h = (unsigned long long) (size_t) ptr;
+
+  h = (h >> 4) * 0x9e3779b97f4a7c15ULL;
+  return (size_t) (h >> 32) & (allocated.total - 1);
+}
+
+/* Returns the slot holding ptr, or the empty slot where it belongs */
+static size_t slotptr(const void *ptr)
+{
+  size_t i = hashptr(ptr);
+
+  while ((allocated.pointers[i] != NULL) && (allocated.pointers[i] != ptr))
+    i = (i + 1) & (allocated.total - 1);
+
+  return i;
+}
+
+static int growptrs(void)
+{
+  void **old = allocated.pointers;
+  size_t oldtotal = allocated.total, i;
+  size_t newtotal = (oldtotal == 0) ? DEFAULT_NUM_POINTERS : 2 * oldtotal;
+  void **tmp;
+
+  if ((tmp = calloc(newtotal, sizeof(void *))) == NULL)
+    return -1;
+
+  allocated.pointers = tmp;
+  allocated.total = newtotal;
+
+  for (i = 0; i < oldtotal; i++)
+    if (old[i] != NULL)
+      allocated.pointers[slotptr(old[i])] = old[i];
+
+  free(old);
+
+  return 0;
+}
+
 static void *saveptr(void *ptr)
 {
-  int i, err = 0;
+  int err = 0;
 
-  if (allocated.used + 1 > allocated.total)
-  {
-    void **tmp;
-    int newtotal;
+  if (ptr == NULL)
+    return NULL;
 
-    if (allocated.total == 0)
-      newtotal = DEFAULT_NUM_POINTERS;
-    else
-      newtotal = 2 * allocated.total;
+  LOCK_ALLOCATED();
 
-    if ((tmp = realloc(allocated.pointers,
-		       newtotal * sizeof(void **))) == NULL)
+  /* Keep the set at most half full so probe sequences stay short */
+  if (2 * (allocated.used + 1) > allocated.total)
+  {
+    if (growptrs())
     {
+      debug(FLIDEBUG_WARN, "Internal memory allocation error");
       err = 1;
       goto done;
     }
-
-    allocated.pointers = tmp;
-    memset(allocated.pointers + allocated.total, 0,
-	   (newtotal - allocated.total) * sizeof(void **));
-    allocated.total = newtotal;
-  }
-
-  for (i = 0; i < allocated.total; i++)
-    if (allocated.pointers[i] == NULL)
-      break;
-
-  if (i == allocated.total)
-  {
-    /* This shouldn't happen */
-    debug(FLIDEBUG_WARN, "Internal memory allocation error");
-    err = 1;
-    goto done;
   }
 
-  allocated.pointers[i] = ptr;
+  allocated.pointers[slotptr(ptr)] = ptr;
   allocated.used++;
 
  done:
 
+  UNLOCK_ALLOCATED();
+
   if (err)
   {
     free(ptr);
@@ -116,30 +158,59 @@ static void *saveptr(void *ptr)
   return ptr;
 }
 
-static void **findptr(void *ptr)
+/* Returns the slot holding ptr, or -1 if it isn't tracked. Must be called
+ * with the lock held. */
+static long findptr(void *ptr)
 {
-  int i;
+  size_t i;
 
-  for (i = 0; i < allocated.total; i++)
-    if (allocated.pointers[i] == ptr)
-      return &allocated.pointers[i];
+  if ((allocated.total == 0) || (allocated.pointers[i = slotptr(ptr)] == NULL))
+  {
+    debug(FLIDEBUG_WARN, "Invalid pointer not found: %p", ptr);
+    return -1;
+  }
+
+  return (long) i;
+}
+
+/* Must be called with the lock held */
+static void deleteslot(size_t i)
+{
+  size_t j, k;
+
+  allocated.pointers[i] = NULL;
+  allocated.used--;
+
+  /* Shift the rest of the probe sequence back, so no tombstones are needed */
+  j = i;
+  while (1)
+  {
+    j = (j + 1) & (allocated.total - 1);
+    if (allocated.pointers[j] == NULL)
+      break;
 
-  debug(FLIDEBUG_WARN, "Invalid pointer not found: %p", ptr);
+    k = hashptr(allocated.pointers[j]);
 
-  return NULL;
+    /* Move the entry unless its home slot lies cyclically in (i, j] */
+    if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+      continue;
+
+    allocated.pointers[i] = allocated.pointers[j];
+    allocated.pointers[j] = NULL;
+    i = j;
+  }
 }
 
 static int deleteptr(void *ptr)
 {
-  void **allocatedptr;
-
-  if ((allocatedptr = findptr(ptr)) == NULL)
-    return -1;
+  long i;
 
-  *allocatedptr = NULL;
-  allocated.used--;
+  LOCK_ALLOCATED();
+  if ((i = findptr(ptr)) >= 0)
+    deleteslot(i);
+  UNLOCK_ALLOCATED();
 
-  return 0;
+  return (i >= 0) ? 0 : -1;
 }
 
 void *xmalloc(size_t size)
@@ -192,24 +263,44 @@ void xfree(void *ptr)
 
 void *xrealloc(void *ptr, size_t size)
 {
-  void **allocatedptr, *tmp;
+  void *tmp;
+  long i;
 
-  if ((allocatedptr = findptr(ptr)) == NULL)
+  /* Keep the lock across realloc() so the old pointer can't be freed meanwhile */
+  LOCK_ALLOCATED();
+
+  if ((i = findptr(ptr)) < 0)
+  {
+    UNLOCK_ALLOCATED();
     return NULL;
+  }
 
   if ((tmp = realloc(ptr, size)) == NULL)
+  {
+    UNLOCK_ALLOCATED();
     return NULL;
+  }
+
+  if (tmp != ptr)
+  {
+    /* The set never grows here, one entry is swapped for another */
+    deleteslot(i);
+    allocated.pointers[slotptr(tmp)] = tmp;
+    allocated.used++;
+  }
 
-  *allocatedptr = tmp;
+  UNLOCK_ALLOCATED();
 
   return tmp;
 }
 
 int xfree_all(void)
 {
-  int i;
+  size_t i;
   int freed = 0;
 
+  LOCK_ALLOCATED();
+
   for (i = 0; i < allocated.total; i++)
   {
     if (allocated.pointers[i] != NULL)
@@ -231,6 +322,8 @@ int xfree_all(void)
   allocated.used = 0;
   allocated.total = 0;
 
+  UNLOCK_ALLOCATED();
+
   return freed;
 }
 
@@ -273,7 +366,6 @@ char *xstrndup(const char *s, size_t siz)
 
 int xasprintf(char **strp, const char *fmt, ...)
 {
-  INDI_UNUSED(strp);
   va_list ap;
   char *tmp;
   int err;
@@ -283,7 +375,7 @@ int xasprintf(char **strp, const char *fmt, ...)
   if ((err = vasprintf(&tmp, fmt, ap)) < 0)
     goto done;
 
-  if (saveptr(tmp) == NULL)
+  if ((*strp = saveptr(tmp)) == NULL)
     err = -1;
 
 	done:
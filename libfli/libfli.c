@@ -225,14 +225,38 @@ LIBFLIAPI FLIUsbBulkIO(flidev_t dev, int ep, void *buf, long *len)
 	return usb_bulktransfer(dev, ep, buf, len);
 }
 
+/**
+   Grab the rows of an image that are still to be read.  This function
+   reads the rest of the image of the last exposure on camera
+   \texttt{dev} into the buffer pointed to by \texttt{buff}, one row
+   after the other.  Rows are as wide as the image area and use the
+   bit depth of the image.  At most \texttt{buffsize} bytes worth of
+   whole rows are read, so a buffer too small for the image can be
+   followed by further calls to this function or to FLIGrabRow.  The
+   image is read with transfers much larger than a row, directly into
+   \texttt{buff} where the camera allows it.
+
+   @param dev Camera whose image to grab.
+
+   @param buff Pointer to where the image will be placed.
+
+   @param buffsize Size of \texttt{buff} in bytes.
+
+   @param bytesgrabbed Pointer to where the number of bytes placed in
+   \texttt{buff} will be stored.
+
+   @return Zero on success.
+   @return Non-zero on failure.
+
+   @see FLIGrabRow
+   @see FLIExposeFrame
+*/
 LIBFLIAPI FLIGrabFrame(flidev_t dev, void* buff,
 		       size_t buffsize, size_t* bytesgrabbed)
 {
-  INDI_UNUSED(dev);
-  INDI_UNUSED(buff);
-  INDI_UNUSED(buffsize);
-  INDI_UNUSED(bytesgrabbed);
-	return -EINVAL;
+  CHKDEVICE(dev);
+
+  return DEVICE->fli_command(dev, FLI_GRAB_FRAME, 3, buff, &buffsize, bytesgrabbed);
 }
 
 /**
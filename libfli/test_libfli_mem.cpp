@@ -0,0 +1,141 @@
+//
+// Stresses the libfli allocation tracker from several threads at once.
+//
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "libfli-mem.h"
+}
+
+TEST(LibFLIMem, allocFree)
+{
+    std::vector<void *> ptrs;
+
+    for (int i = 0; i < 10000; i++)
+    {
+        void *p = xmalloc(16 + i % 64);
+        ASSERT_NE(p, nullptr);
+        ptrs.push_back(p);
+    }
+
+    // free every other block first, so later lookups probe past deleted slots
+    for (size_t i = 0; i < ptrs.size(); i += 2)
+        xfree(ptrs[i]);
+    for (size_t i = 1; i < ptrs.size(); i += 2)
+        xfree(ptrs[i]);
+
+    ASSERT_EQ(xfree_all(), 0);
+}
+
+
+TEST(LibFLIMem, realloc)
+{
+    char *p = (char *) xmalloc(8);
+    ASSERT_NE(p, nullptr);
+    strcpy(p, "libfli");
+
+    p = (char *) xrealloc(p, 1 << 20);
+    ASSERT_NE(p, nullptr);
+    ASSERT_STREQ(p, "libfli");
+
+    // unknown pointers are refused, not freed
+    int local;
+    ASSERT_EQ(xrealloc(&local, 16), nullptr);
+    xfree(&local);
+
+    xfree(p);
+    ASSERT_EQ(xfree_all(), 0);
+}
+
+
+TEST(LibFLIMem, strings)
+{
+    char *s = xstrdup("FLI Focuser");
+    char *n = xstrndup("Filter Wheel", 6);
+    char *f = nullptr;
+
+    ASSERT_STREQ(s, "FLI Focuser");
+    ASSERT_STREQ(n, "Filter");
+    ASSERT_GT(xasprintf(&f, "Filter Wheel (%d position)", 7), 0);
+    ASSERT_STREQ(f, "Filter Wheel (7 position)");
+
+    // xfree_all() releases what is still tracked
+    xfree(n);
+    ASSERT_EQ(xfree_all(), 2);
+}
+
+
+TEST(LibFLIMem, concurrent)
+{
+    const int threads = 8;
+    const int cycles  = 20000;
+    const int live    = 256;
+    std::vector<std::thread> workers;
+    std::vector<int> errors(threads, 0);
+
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t, &errors] {
+            std::vector<uint32_t *> ptrs(live, nullptr);
+
+            for (int i = 0; i < cycles; i++)
+            {
+                uint32_t *&slot = ptrs[(i * 7919) % live];
+
+                if (slot != nullptr)
+                {
+                    // the block must still hold what this thread wrote into it
+                    if (slot[0] != (uint32_t)t || slot[1] != (uint32_t)(uintptr_t)slot)
+                        errors[t]++;
+
+                    if (i % 3 == 0)
+                    {
+                        slot = (uint32_t *) xrealloc(slot, 8 + (i % 512));
+                        if (slot == nullptr || slot[0] != (uint32_t)t)
+                        {
+                            errors[t]++;
+                            continue;
+                        }
+                        slot[1] = (uint32_t)(uintptr_t)slot;
+                        continue;
+                    }
+
+                    xfree(slot);
+                }
+
+                slot = (uint32_t *) xcalloc(1, 8 + (i % 256));
+                if (slot == nullptr)
+                {
+                    errors[t]++;
+                    continue;
+                }
+                slot[0] = t;
+                slot[1] = (uint32_t)(uintptr_t)slot;
+            }
+
+            for (uint32_t *p : ptrs)
+                if (p != nullptr)
+                    xfree(p);
+        });
+    }
+
+    for (auto &w : workers)
+        w.join();
+
+    for (int t = 0; t < threads; t++)
+        ASSERT_EQ(errors[t], 0) << "thread " << t;
+
+    ASSERT_EQ(xfree_all(), 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,54 @@
+%define __cmake_in_source_build %{_vpath_builddir}
+Name: libpixelconvert
+Version:1.9.9.git
+Release: %(date -u +%%Y%%m%%d%%H%%M%%S)%{?dist}
+Summary: Pixel format conversion kernels shared by INDI 3rd party drivers
+
+License: LGPLv2
+# See COPYRIGHT file for a description of the licenses and files covered
+
+URL: https://indilib.org
+Source0: https://github.com/indilib/indi-3rdparty/archive/master.tar.gz
+
+%global debug_package %{nil}
+%define __find_requires %{nil}
+
+BuildRequires: cmake
+BuildRequires: gcc-c++
+
+Provides: libpixelconvert.so.1()(64bit)
+Provides: libpixelconvert.so
+
+%description
+INDI is a distributed control protocol designed to operate
+astronomical instrumentation. INDI is small, flexible, easy to parse,
+and scalable. It supports common DCS functions such as remote control,
+data acquisition, monitoring, and a lot more. This library holds the
+pixel format conversion routines used by several 3rd party drivers.
+
+
+%prep -v
+%autosetup -v -p1 -n indi-3rdparty-master
+
+%build
+# This package tries to mix and match PIE and PIC which is wrong and will
+# trigger link errors when LTO is enabled.
+# Disable LTO
+%define _lto_cflags %{nil}
+
+cd libpixelconvert
+%cmake .
+make VERBOSE=1 %{?_smp_mflags} -j4
+
+%install
+cd libpixelconvert
+find %buildroot -type f \( -name '*.so' -o -name '*.so.*' \) -exec chmod 755 {} +
+make DESTDIR=%{buildroot} install
+
+%files
+%{_libdir}/*
+%{_includedir}/libpixelconvert
+
+
+
+%changelog
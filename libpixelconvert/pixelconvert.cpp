@@ -0,0 +1,368 @@
+/*
+    Pixel Format Conversion Library
+
+    Shared packed to planar conversion kernels for INDI colour camera drivers.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "pixelconvert.h"
+
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXELCONVERT_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXELCONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace PixelConvert
+{
+
+namespace
+{
+
+typedef void (*SplitKernel)(const void *src, void *c0, void *c1, void *c2, size_t count);
+
+template <typename T>
+void splitScalar(const void *src, void *c0, void *c1, void *c2, size_t count)
+{
+    const T *in = static_cast<const T *>(src);
+    T *out0 = static_cast<T *>(c0);
+    T *out1 = static_cast<T *>(c1);
+    T *out2 = static_cast<T *>(c2);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        out0[i] = in[0];
+        out1[i] = in[1];
+        out2[i] = in[2];
+        in += 3;
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// SSE2 has no byte shuffle, so the x86 kernels start at SSSE3 (pshufb).
+// Each 48 byte block is loaded as three vectors a, b, c and every channel
+// is gathered from them with one shuffle per vector.
+// Masks are indexed [channel][vector], -1 clears the byte.
+alignas(16) const int8_t kMask8[3][3][16] =
+{
+    {
+        { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 }
+    },
+    {
+        { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 }
+    },
+    {
+        { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 }
+    }
+};
+
+alignas(16) const int8_t kMask16[3][3][16] =
+{
+    {
+        { 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 10, 11 }
+    },
+    {
+        { 2, 3, 8, 9, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, 4, 5, 10, 11, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 6, 7, 12, 13 }
+    },
+    {
+        { 4, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15 }
+    }
+};
+
+__attribute__((target("ssse3")))
+inline __m128i gather128(__m128i a, __m128i b, __m128i c, const int8_t (&mask)[3][16])
+{
+    __m128i ra = _mm_shuffle_epi8(a, _mm_load_si128(reinterpret_cast<const __m128i *>(mask[0])));
+    __m128i rb = _mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i *>(mask[1])));
+    __m128i rc = _mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i *>(mask[2])));
+    return _mm_or_si128(_mm_or_si128(ra, rb), rc);
+}
+
+template <typename T>
+__attribute__((target("ssse3")))
+void splitSSSE3(const void *src, void *c0, void *c1, void *c2, size_t count)
+{
+    const int8_t (&masks)[3][3][16] = sizeof(T) == 1 ? kMask8 : kMask16;
+    const size_t block = 16 / sizeof(T);
+
+    const uint8_t *in = static_cast<const uint8_t *>(src);
+    uint8_t *out0 = static_cast<uint8_t *>(c0);
+    uint8_t *out1 = static_cast<uint8_t *>(c1);
+    uint8_t *out2 = static_cast<uint8_t *>(c2);
+
+    size_t i = 0;
+    for (; i + block <= count; i += block)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 32));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out0), gather128(a, b, c, masks[0]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out1), gather128(a, b, c, masks[1]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out2), gather128(a, b, c, masks[2]));
+
+        in   += 48;
+        out0 += 16;
+        out1 += 16;
+        out2 += 16;
+    }
+
+    splitScalar<T>(in, out0, out1, out2, count - i);
+}
+
+__attribute__((target("avx2")))
+inline __m256i loadMask256(const int8_t *mask)
+{
+    __m128i m = _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(m), m, 1);
+}
+
+__attribute__((target("avx2")))
+inline __m256i gather256(__m256i a, __m256i b, __m256i c, const int8_t (&mask)[3][16])
+{
+    __m256i ra = _mm256_shuffle_epi8(a, loadMask256(mask[0]));
+    __m256i rb = _mm256_shuffle_epi8(b, loadMask256(mask[1]));
+    __m256i rc = _mm256_shuffle_epi8(c, loadMask256(mask[2]));
+    return _mm256_or_si256(_mm256_or_si256(ra, rb), rc);
+}
+
+__attribute__((target("avx2")))
+inline __m256i loadPair(const uint8_t *lo, const uint8_t *hi)
+{
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lo));
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hi));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(l), h, 1);
+}
+
+// pshufb does not cross 128 bit lanes, so the low lane handles the first
+// 48 byte block and the high lane the second one, using the SSSE3 masks.
+template <typename T>
+__attribute__((target("avx2")))
+void splitAVX2(const void *src, void *c0, void *c1, void *c2, size_t count)
+{
+    const int8_t (&masks)[3][3][16] = sizeof(T) == 1 ? kMask8 : kMask16;
+    const size_t block = 32 / sizeof(T);
+
+    const uint8_t *in = static_cast<const uint8_t *>(src);
+    uint8_t *out0 = static_cast<uint8_t *>(c0);
+    uint8_t *out1 = static_cast<uint8_t *>(c1);
+    uint8_t *out2 = static_cast<uint8_t *>(c2);
+
+    size_t i = 0;
+    for (; i + block <= count; i += block)
+    {
+        __m256i a = loadPair(in,      in + 48);
+        __m256i b = loadPair(in + 16, in + 64);
+        __m256i c = loadPair(in + 32, in + 80);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out0), gather256(a, b, c, masks[0]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out1), gather256(a, b, c, masks[1]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out2), gather256(a, b, c, masks[2]));
+
+        in   += 96;
+        out0 += 32;
+        out1 += 32;
+        out2 += 32;
+    }
+
+    splitSSSE3<T>(in, out0, out1, out2, count - i);
+}
+
+#endif
+
+#ifdef PIXELCONVERT_NEON
+
+void split8NEON(const void *src, void *c0, void *c1, void *c2, size_t count)
+{
+    const uint8_t *in = static_cast<const uint8_t *>(src);
+    uint8_t *out0 = static_cast<uint8_t *>(c0);
+    uint8_t *out1 = static_cast<uint8_t *>(c1);
+    uint8_t *out2 = static_cast<uint8_t *>(c2);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t px = vld3q_u8(in);
+        vst1q_u8(out0, px.val[0]);
+        vst1q_u8(out1, px.val[1]);
+        vst1q_u8(out2, px.val[2]);
+        in   += 48;
+        out0 += 16;
+        out1 += 16;
+        out2 += 16;
+    }
+
+    splitScalar<uint8_t>(in, out0, out1, out2, count - i);
+}
+
+void split16NEON(const void *src, void *c0, void *c1, void *c2, size_t count)
+{
+    const uint16_t *in = static_cast<const uint16_t *>(src);
+    uint16_t *out0 = static_cast<uint16_t *>(c0);
+    uint16_t *out1 = static_cast<uint16_t *>(c1);
+    uint16_t *out2 = static_cast<uint16_t *>(c2);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        uint16x8x3_t px = vld3q_u16(in);
+        vst1q_u16(out0, px.val[0]);
+        vst1q_u16(out1, px.val[1]);
+        vst1q_u16(out2, px.val[2]);
+        in   += 24;
+        out0 += 8;
+        out1 += 8;
+        out2 += 8;
+    }
+
+    splitScalar<uint16_t>(in, out0, out1, out2, count - i);
+}
+
+#endif
+
+struct Kernels
+{
+    SplitKernel split8;
+    SplitKernel split16;
+    const char *name;
+};
+
+Kernels selectKernels()
+{
+#if defined(PIXELCONVERT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { splitAVX2<uint8_t>, splitAVX2<uint16_t>, "avx2" };
+    if (__builtin_cpu_supports("ssse3"))
+        return { splitSSSE3<uint8_t>, splitSSSE3<uint16_t>, "ssse3" };
+#elif defined(PIXELCONVERT_NEON)
+    return { split8NEON, split16NEON, "neon" };
+#endif
+    return { splitScalar<uint8_t>, splitScalar<uint16_t>, "scalar" };
+}
+
+Kernels &kernels()
+{
+    static Kernels selected = selectKernels();
+    return selected;
+}
+
+}
+
+size_t bytesPerPixel(Format format)
+{
+    switch (format)
+    {
+        case RGB24:
+        case BGR24:
+            return 3;
+        case RGB48:
+        case BGR48:
+            return 6;
+    }
+    return 3;
+}
+
+const char *kernelName()
+{
+    return kernels().name;
+}
+
+bool setKernel(const char *name)
+{
+    const std::string kernel(name);
+
+#if defined(PIXELCONVERT_X86)
+    __builtin_cpu_init();
+#endif
+
+    if (kernel == "auto")
+        kernels() = selectKernels();
+    else if (kernel == "scalar")
+        kernels() = { splitScalar<uint8_t>, splitScalar<uint16_t>, "scalar" };
+#if defined(PIXELCONVERT_X86)
+    else if (kernel == "avx2" && __builtin_cpu_supports("avx2"))
+        kernels() = { splitAVX2<uint8_t>, splitAVX2<uint16_t>, "avx2" };
+    else if (kernel == "ssse3" && __builtin_cpu_supports("ssse3"))
+        kernels() = { splitSSSE3<uint8_t>, splitSSSE3<uint16_t>, "ssse3" };
+#elif defined(PIXELCONVERT_NEON)
+    else if (kernel == "neon")
+        kernels() = { split8NEON, split16NEON, "neon" };
+#endif
+    else
+        return false;
+
+    return true;
+}
+
+void splitRow(Format format, const void *src, void *r, void *g, void *b, size_t count)
+{
+    if (format == BGR24 || format == BGR48)
+        std::swap(r, b);
+
+    if (format == RGB24 || format == BGR24)
+        kernels().split8(src, r, g, b, count);
+    else
+        kernels().split16(src, r, g, b, count);
+}
+
+void toPlanar(Format format, const void *src, size_t srcWidth, void *dst, size_t x, size_t y, size_t w, size_t h)
+{
+    const size_t pixelBytes = bytesPerPixel(format);
+    const size_t planeBytes = w * h * (pixelBytes / 3);
+    const size_t rowBytes   = w * (pixelBytes / 3);
+
+    const uint8_t *in = static_cast<const uint8_t *>(src) + (y * srcWidth + x) * pixelBytes;
+    uint8_t *r = static_cast<uint8_t *>(dst);
+    uint8_t *g = r + planeBytes;
+    uint8_t *b = g + planeBytes;
+
+    // Contiguous frames are converted in a single pass to keep the vector loop hot.
+    if (x == 0 && w == srcWidth)
+    {
+        splitRow(format, in, r, g, b, w * h);
+        return;
+    }
+
+    for (size_t row = 0; row < h; row++)
+    {
+        splitRow(format, in, r, g, b, w);
+        in += srcWidth * pixelBytes;
+        r  += rowBytes;
+        g  += rowBytes;
+        b  += rowBytes;
+    }
+}
+
+}
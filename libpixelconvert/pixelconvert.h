@@ -0,0 +1,109 @@
+/*
+    Pixel Format Conversion Library
+
+    Shared packed to planar conversion kernels for INDI colour camera drivers.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PixelConvert
+{
+
+/** Packed (interleaved) pixel layouts as delivered by camera SDKs and decoders. */
+enum Format
+{
+    RGB24,  /*!< 8 bit R,G,B triplets */
+    BGR24,  /*!< 8 bit B,G,R triplets (e.g. ZWO ASI_IMG_RGB24) */
+    RGB48,  /*!< 16 bit R,G,B triplets, host endian */
+    BGR48   /*!< 16 bit B,G,R triplets, host endian */
+};
+
+/** @return bytes occupied by one packed pixel in @a format. */
+size_t bytesPerPixel(Format format);
+
+/** @return name of the kernel selected for this CPU, e.g. "avx2", "ssse3", "neon" or "scalar". */
+const char *kernelName();
+
+/**
+ * @brief Force the kernels used by splitRow() and toPlanar(), for tests and benchmarks.
+ * @param name "scalar", "ssse3", "avx2", "neon", or "auto" to select for this CPU again.
+ * @return false if the kernel is not available on this CPU, the selection is then unchanged.
+ * @note Not thread safe, do not call while another thread is converting.
+ */
+bool setKernel(const char *name);
+
+/**
+ * @brief Split one row of packed pixels into three separate channel rows.
+ * @param format packed layout of @a src.
+ * @param src packed row.
+ * @param r destination for the red channel, @a count elements of 8 or 16 bits.
+ * @param g destination for the green channel.
+ * @param b destination for the blue channel.
+ * @param count number of pixels in the row.
+ */
+void splitRow(Format format, const void *src, void *r, void *g, void *b, size_t count);
+
+/**
+ * @brief Convert a packed frame into FITS style planar R, G, B planes.
+ * @param format packed layout of @a src.
+ * @param src packed frame of @a srcWidth pixels per row.
+ * @param srcWidth width of the packed frame in pixels.
+ * @param dst destination holding three consecutive planes of @a w x @a h pixels each.
+ * @param x left edge of the subframe to extract.
+ * @param y top edge of the subframe to extract.
+ * @param w width of the subframe.
+ * @param h height of the subframe.
+ * @note @a src and @a dst must not overlap.
+ */
+void toPlanar(Format format, const void *src, size_t srcWidth, void *dst, size_t x, size_t y, size_t w, size_t h);
+
+/** Convert a whole packed frame of @a w x @a h pixels into planar R, G, B planes. */
+inline void toPlanar(Format format, const void *src, void *dst, size_t w, size_t h)
+{
+    toPlanar(format, src, w, dst, 0, 0, w, h);
+}
+
+/**
+ * @brief Persistent scratch area for SDKs that can only deliver packed frames.
+ * Drivers keep one instance alive so a frame download does not allocate.
+ */
+class ScratchBuffer
+{
+    public:
+        /** @return a buffer of at least @a size bytes, reused across calls. */
+        uint8_t *get(size_t size)
+        {
+            if (m_Buffer.size() < size)
+                m_Buffer.resize(size);
+            return m_Buffer.data();
+        }
+
+        /** Release the memory, e.g. on disconnect. */
+        void release()
+        {
+            std::vector<uint8_t>().swap(m_Buffer);
+        }
+
+    private:
+        std::vector<uint8_t> m_Buffer;
+};
+
+}
@@ -0,0 +1,128 @@
+//
+// Checks that every SIMD kernel this CPU can run splits packed pixels
+// exactly like the scalar loop, for row lengths around the vector widths.
+//
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include "pixelconvert.h"
+
+static const char *accelKernels[] = { "ssse3", "avx2", "neon" };
+
+// Odd widths leave a tail after every vector loop
+static const size_t widths[] = { 1, 3, 5, 7, 15, 17, 31, 33, 47, 63, 65, 95, 97, 127, 129, 191, 255, 257, 1001 };
+
+static std::vector<uint8_t> makeRow(size_t bytes, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> row(bytes);
+    for (size_t i = 0; i < row.size(); ++i)
+        row[i] = static_cast<uint8_t>(gen());
+    return row;
+}
+
+// Planes are one pixel longer than the row so a kernel writing past the end shows up
+static std::vector<uint8_t> split(const char *kernel, PixelConvert::Format format, const std::vector<uint8_t> &src, size_t count)
+{
+    const size_t channelBytes = PixelConvert::bytesPerPixel(format) / 3;
+    const size_t planeBytes = (count + 1) * channelBytes;
+    std::vector<uint8_t> planes(planeBytes * 3, 0xA5);
+
+    PixelConvert::setKernel(kernel);
+    PixelConvert::splitRow(format, src.data(), planes.data(), planes.data() + planeBytes, planes.data() + planeBytes * 2, count);
+    return planes;
+}
+
+static void compareKernels(PixelConvert::Format format)
+{
+    int tested = 0;
+    for (const char *kernel : accelKernels)
+    {
+        if (!PixelConvert::setKernel(kernel))
+            continue;
+        ++tested;
+
+        for (size_t count : widths)
+        {
+            const std::vector<uint8_t> src = makeRow(count * PixelConvert::bytesPerPixel(format), count);
+            ASSERT_EQ(split("scalar", format, src, count), split(kernel, format, src, count))
+                    << kernel << " width " << count;
+        }
+    }
+    PixelConvert::setKernel("auto");
+
+    if (tested == 0)
+        std::cerr << "no SIMD kernel available, only scalar checked" << std::endl;
+}
+
+TEST(PixelConvert, RGB24)
+{
+    compareKernels(PixelConvert::RGB24);
+}
+
+TEST(PixelConvert, BGR24)
+{
+    compareKernels(PixelConvert::BGR24);
+}
+
+TEST(PixelConvert, RGB48)
+{
+    compareKernels(PixelConvert::RGB48);
+}
+
+TEST(PixelConvert, BGR48)
+{
+    compareKernels(PixelConvert::BGR48);
+}
+
+TEST(PixelConvert, ScalarOrder)
+{
+    const uint8_t src[] = { 1, 2, 3, 4, 5, 6 };
+    uint8_t r[2], g[2], b[2];
+
+    PixelConvert::setKernel("scalar");
+    PixelConvert::splitRow(PixelConvert::BGR24, src, r, g, b, 2);
+    PixelConvert::setKernel("auto");
+
+    EXPECT_EQ(r[0], 3);
+    EXPECT_EQ(g[0], 2);
+    EXPECT_EQ(b[0], 1);
+    EXPECT_EQ(r[1], 6);
+    EXPECT_EQ(g[1], 5);
+    EXPECT_EQ(b[1], 4);
+}
+
+// Subframes go row by row through the selected kernel
+TEST(PixelConvert, SubframePlanar)
+{
+    const size_t srcWidth = 101, srcHeight = 7, x = 3, y = 2, w = 67, h = 4;
+    const std::vector<uint8_t> src = makeRow(srcWidth * srcHeight * 6, 42);
+
+    for (const char *kernel : accelKernels)
+    {
+        if (!PixelConvert::setKernel(kernel))
+            continue;
+
+        std::vector<uint8_t> accel(w * h * 6), scalar(w * h * 6);
+        PixelConvert::toPlanar(PixelConvert::RGB48, src.data(), srcWidth, accel.data(), x, y, w, h);
+        PixelConvert::setKernel("scalar");
+        PixelConvert::toPlanar(PixelConvert::RGB48, src.data(), srcWidth, scalar.data(), x, y, w, h);
+
+        ASSERT_EQ(scalar, accel) << kernel;
+    }
+    PixelConvert::setKernel("auto");
+}
+
+TEST(PixelConvert, UnknownKernel)
+{
+    const std::string before = PixelConvert::kernelName();
+    EXPECT_FALSE(PixelConvert::setKernel("sse9"));
+    EXPECT_EQ(before, PixelConvert::kernelName());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}